@@ -248,6 +248,70 @@ static int bad_writer(cls_method_context_t hctx, bufferlist *in, bufferlist *out
   return cls_cxx_write_full(hctx, in);
 }
 
+/**
+ * walk the omap in place - a "read" method using cls_cxx_map_iterate
+ *
+ * Takes the start_after key, the key prefix, the maximum number of
+ * entries and whether to return values, and returns the keys (and
+ * values) visited, in order, and whether there are more.
+ */
+static int omap_iterate(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  string start_after, prefix;
+  uint64_t max;
+  bool with_values;
+  try {
+    auto p = in->cbegin();
+    decode(start_after, p);
+    decode(prefix, p);
+    decode(max, p);
+    decode(with_values, p);
+  } catch (const buffer::error &err) {
+    return -EINVAL;
+  }
+
+  std::vector<std::pair<string, bufferlist>> entries;
+  bool more = false;
+  int r = cls_cxx_map_iterate(
+    hctx, start_after, prefix, max, with_values,
+    [&entries](const string& key, bufferlist& val) {
+      entries.emplace_back(key, val);
+    },
+    &more);
+  if (r < 0)
+    return r;
+  if ((size_t)r != entries.size())
+    return -EIO;
+
+  encode(entries, *out);
+  encode(more, *out);
+  return 0;
+}
+
+/**
+ * look up omap keys - a "read" method using cls_cxx_map_get_vals_by_keys
+ *
+ * Takes a set of keys and returns those that exist, with their values.
+ */
+static int omap_get_by_keys(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  std::set<string> keys;
+  try {
+    auto p = in->cbegin();
+    decode(keys, p);
+  } catch (const buffer::error &err) {
+    return -EINVAL;
+  }
+
+  std::map<string, bufferlist> vals;
+  int r = cls_cxx_map_get_vals_by_keys(hctx, keys, &vals);
+  if (r < 0)
+    return r;
+
+  encode(vals, *out);
+  return 0;
+}
+
 
 class PGLSHelloFilter : public PGLSFilter {
   string val;
@@ -303,6 +367,8 @@ CLS_INIT(hello)
   cls_method_handle_t h_turn_it_to_11;
   cls_method_handle_t h_bad_reader;
   cls_method_handle_t h_bad_writer;
+  cls_method_handle_t h_omap_iterate;
+  cls_method_handle_t h_omap_get_by_keys;
 
   cls_register("hello", &h_class);
 
@@ -339,6 +405,12 @@ CLS_INIT(hello)
   cls_register_cxx_method(h_class, "bad_writer", CLS_METHOD_RD,
 			  bad_writer, &h_bad_writer);
 
+  // omap readers
+  cls_register_cxx_method(h_class, "omap_iterate", CLS_METHOD_RD,
+			  omap_iterate, &h_omap_iterate);
+  cls_register_cxx_method(h_class, "omap_get_by_keys", CLS_METHOD_RD,
+			  omap_get_by_keys, &h_omap_get_by_keys);
+
   // A PGLS filter
   cls_register_cxx_filter(h_class, "hello", hello_filter);
 }
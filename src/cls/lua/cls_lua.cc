@@ -3,8 +3,12 @@
  */
 #include <errno.h>
 #include <setjmp.h>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <lua.hpp>
 #include "include/types.h"
 #include "objclass/objclass.h"
@@ -41,6 +45,7 @@ struct clslua_err {
 enum InputEncoding {
   JSON_ENC,
   BUFFERLIST_ENC,
+  BUFFERLIST_NAMED_ENC, /* cls_lua_eval_op with a script_name */
 };
 
 struct clslua_hctx {
@@ -53,10 +58,84 @@ struct clslua_hctx {
   bufferlist *outbl;  // raw cls output
 
   string script;      // lua script
+  string script_name; // name the script is cached under
   string handler;     // lua handler
   bufferlist input;   // lua handler input
+
+  uint64_t instructions;  // executed so far, in hook intervals
+  ceph::mono_time deadline;
+  bool over_budget;
 };
 
+/*
+ * Per-call execution budgets, from osd_cls_lua_max_instructions and
+ * osd_cls_lua_max_time. Zero means no limit.
+ */
+static uint64_t clslua_max_instructions = 100000000;
+static ceph::timespan clslua_max_time = std::chrono::seconds(5);
+
+/* instructions between budget checks */
+#define CLSLUA_HOOK_INTERVAL 1000
+
+/*
+ * Compiled script cache.
+ *
+ * Compiling the script dominates the cost of small calls, so each OSD keeps
+ * the bytecode of recently run scripts in an LRU and loads that instead.
+ * Anonymous scripts are keyed by a hash of their text, named scripts by
+ * their name, scoped to the calling client and the pool and namespace of
+ * the object, so that one client can not replace the script another one
+ * runs. The source is kept to tell a hash collision or a re-registered name
+ * from a hit.
+ */
+struct clslua_chunk {
+  std::string key;
+  std::string script;
+  std::shared_ptr<const std::string> bytecode;
+};
+
+static std::mutex clslua_cache_lock;
+static std::list<clslua_chunk> clslua_cache_lru; /* most recent first */
+static std::unordered_map<std::string,
+  std::list<clslua_chunk>::iterator> clslua_cache;
+static uint64_t clslua_cache_size = 128; /* osd_cls_lua_cache_size */
+
+/*
+ * Look up the bytecode cached under @key. If @script is given it must match
+ * the cached source.
+ */
+static std::shared_ptr<const std::string> clslua_cache_get(
+    const std::string& key, const std::string *script)
+{
+  std::lock_guard<std::mutex> l(clslua_cache_lock);
+  auto it = clslua_cache.find(key);
+  if (it == clslua_cache.end())
+    return nullptr;
+  if (script && it->second->script != *script)
+    return nullptr;
+  clslua_cache_lru.splice(clslua_cache_lru.begin(), clslua_cache_lru,
+      it->second);
+  return it->second->bytecode;
+}
+
+static void clslua_cache_put(const std::string& key, const std::string& script,
+    std::string&& bytecode)
+{
+  std::lock_guard<std::mutex> l(clslua_cache_lock);
+  auto it = clslua_cache.find(key);
+  if (it != clslua_cache.end()) {
+    clslua_cache_lru.erase(it->second);
+    clslua_cache.erase(it);
+  }
+  clslua_cache_lru.push_front(clslua_chunk{key, script,
+      std::make_shared<const std::string>(std::move(bytecode))});
+  clslua_cache[key] = clslua_cache_lru.begin();
+  while (clslua_cache_lru.size() > clslua_cache_size) {
+    clslua_cache.erase(clslua_cache_lru.back().key);
+    clslua_cache_lru.pop_back();
+  }
+}
+
 /* Lua registry key for method context */
 static char clslua_hctx_reg_key;
 
@@ -128,6 +207,54 @@ static int clslua_pcall(lua_State *L)
 }
 
 
+/* Registry key for real `load` function */
+static char clslua_load_reg_key;
+
+/*
+ * Wrap Lua load to refuse precompiled chunks, which can be crafted to break
+ * out of the VM.
+ */
+static int clslua_load(lua_State *L)
+{
+  int nargs = lua_gettop(L);
+  if (nargs < 3) {
+    lua_settop(L, 3);
+    nargs = 3;
+  }
+  lua_pushstring(L, "t");
+  lua_replace(L, 3);
+  lua_pushlightuserdata(L, &clslua_load_reg_key);
+  lua_gettable(L, LUA_REGISTRYINDEX);
+  lua_insert(L, 1);
+  lua_call(L, nargs, LUA_MULTRET);
+  return lua_gettop(L);
+}
+
+/*
+ * Enforce the per-call budgets. Once a budget is exceeded the hook runs on
+ * every instruction, so a script can not keep going by catching the error
+ * with pcall.
+ */
+static void clslua_budget_hook(lua_State *L, lua_Debug *ar)
+{
+  struct clslua_hctx *ctx = __clslua_get_hctx(L);
+  if (!ctx->over_budget) {
+    ctx->instructions += CLSLUA_HOOK_INTERVAL;
+    if ((!clslua_max_instructions ||
+         ctx->instructions <= clslua_max_instructions) &&
+        (clslua_max_time == ceph::timespan::zero() ||
+         ceph::mono_clock::now() <= ctx->deadline))
+      return;
+    CLS_ERR("error: script exceeded its budget after %llu instructions",
+        (unsigned long long)ctx->instructions);
+    ctx->over_budget = true;
+    lua_sethook(L, clslua_budget_hook, LUA_MASKCOUNT, 1);
+  }
+  ctx->error.error = true;
+  ctx->error.ret = -ETIMEDOUT;
+  luaL_error(L, "execution budget exceeded");
+}
+
 /*
  * cls_log
  */
@@ -736,6 +863,14 @@ static void clslua_setup_env(lua_State *L)
   lua_pushnil(L);
   lua_setglobal(L, "xpcall");
 
+  /* text chunks only */
+  lua_pushlightuserdata(L, &clslua_load_reg_key);
+  lua_getglobal(L, "load");
+  lua_settable(L, LUA_REGISTRYINDEX);
+
+  lua_pushcfunction(L, clslua_load);
+  lua_setglobal(L, "load");
+
   luaL_requiref(L, LUA_TABLIBNAME, luaopen_table, 1);
   lua_pop(L, 1);
 
@@ -825,6 +960,66 @@ static int unpack_json_command(lua_State *L, struct clslua_hctx *ctx,
   return 0;
 }
 
+static int clslua_dump_writer(lua_State *L, const void *p, size_t sz,
+    void *ud)
+{
+  static_cast<std::string*>(ud)->append(static_cast<const char*>(p), sz);
+  return 0;
+}
+
+/*
+ * Push the compiled script, loading it from the cache when possible. Returns
+ * non-zero with ctx->ret set if only a name was given and it is not cached.
+ */
+static int clslua_load_script(lua_State *L, struct clslua_hctx *ctx)
+{
+  std::string key;
+  const std::string *script = &ctx->script;
+  if (ctx->script_name.size()) {
+    entity_inst_t origin;
+    hobject_t obj;
+    cls_get_request_origin(*ctx->hctx, &origin);
+    cls_get_request_object(*ctx->hctx, &obj);
+    std::ostringstream ss;
+    ss << "n:" << origin.name << ":" << obj.pool << ":"
+       << obj.nspace.size() << ":" << obj.nspace << ":" << ctx->script_name;
+    key = ss.str();
+    if (ctx->script.empty())
+      script = NULL;
+  } else {
+    key = "h:" + std::to_string(std::hash<std::string>()(ctx->script));
+  }
+
+  if (clslua_cache_size) {
+    auto bytecode = clslua_cache_get(key, script);
+    if (bytecode) {
+      CLS_LOG(20, "loading cached script %s", key.c_str());
+      if (luaL_loadbufferx(L, bytecode->data(), bytecode->size(), "=cls_lua",
+            "b"))
+        return lua_error(L);
+      return 0;
+    }
+  }
+
+  if (!script) {
+    CLS_LOG(10, "script %s is not cached", ctx->script_name.c_str());
+    ctx->ret = -ENOEXEC;
+    return 1;
+  }
+
+  /* load and compile chunk; precompiled chunks are not accepted */
+  if (luaL_loadbufferx(L, ctx->script.data(), ctx->script.size(),
+        ctx->script.c_str(), "t"))
+    return lua_error(L);
+
+  if (clslua_cache_size) {
+    std::string bytecode;
+    lua_dump(L, clslua_dump_writer, &bytecode, 0);
+    clslua_cache_put(key, ctx->script, std::move(bytecode));
+  }
+  return 0;
+}
+
 /*
  * Runs the script, and calls handler.
  */
@@ -861,6 +1056,7 @@ static int clslua_eval(lua_State *L)
       break;
 
     case BUFFERLIST_ENC:
+    case BUFFERLIST_NAMED_ENC:
       {
         cls_lua_eval_op op;
 
@@ -873,6 +1069,16 @@ static int clslua_eval(lua_State *L)
           return 0;
         }
 
+        /* only eval_named uses the name */
+        if (ctx->in_enc == BUFFERLIST_NAMED_ENC) {
+          if (op.script_name.empty()) {
+            CLS_ERR("error: no script name");
+            ctx->ret = -EINVAL;
+            return 0;
+          }
+          ctx->script_name.swap(op.script_name);
+        }
+
         ctx->script.swap(op.script);
         ctx->handler.swap(op.handler);
         ctx->input = op.input;
@@ -897,9 +1103,8 @@ static int clslua_eval(lua_State *L)
   lua_newtable(L);
   lua_settable(L, LUA_REGISTRYINDEX);
 
-  /* load and compile chunk */
-  if (luaL_loadstring(L, ctx->script.c_str()))
-    return lua_error(L);
+  if (clslua_load_script(L, ctx))
+    return 0;
 
   /* execute chunk */
   lua_call(L, 0, 0);
@@ -957,6 +1162,8 @@ static int eval_generic(cls_method_context_t hctx, bufferlist *in, bufferlist *o
   ctx.in_enc = in_enc;
   ctx.outbl = out;
   ctx.error.error = false;
+  ctx.instructions = 0;
+  ctx.over_budget = false;
 
   /* build lua vm state */
   L = luaL_newstate();
@@ -965,6 +1172,11 @@ static int eval_generic(cls_method_context_t hctx, bufferlist *in, bufferlist *o
     goto out;
   }
 
+  if (clslua_max_instructions || clslua_max_time != ceph::timespan::zero()) {
+    ctx.deadline = ceph::mono_clock::now() + clslua_max_time;
+    lua_sethook(L, clslua_budget_hook, LUA_MASKCOUNT, CLSLUA_HOOK_INTERVAL);
+  }
+
   /* panic handler for unhandled errors */
   lua_atpanic(L, &cls_lua_atpanic);
 
@@ -1034,13 +1246,37 @@ static int eval_bufferlist(cls_method_context_t hctx, bufferlist *in, bufferlist
   return eval_generic(hctx, in, out, BUFFERLIST_ENC);
 }
 
+/*
+ * Like eval_bufferlist, but runs or caches the script under its name. It is
+ * a separate method so that OSDs that do not know named scripts fail the
+ * call with EOPNOTSUPP instead of running an empty script.
+ */
+static int eval_named(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  return eval_generic(hctx, in, out, BUFFERLIST_NAMED_ENC);
+}
+
+static void clslua_read_config()
+{
+  std::string val;
+  if (cls_get_config_value("osd_cls_lua_cache_size", &val) == 0)
+    clslua_cache_size = strtoull(val.c_str(), NULL, 10);
+  if (cls_get_config_value("osd_cls_lua_max_instructions", &val) == 0)
+    clslua_max_instructions = strtoull(val.c_str(), NULL, 10);
+  if (cls_get_config_value("osd_cls_lua_max_time", &val) == 0)
+    clslua_max_time = ceph::make_timespan(strtod(val.c_str(), NULL));
+}
+
 CLS_INIT(lua)
 {
   CLS_LOG(20, "Loaded lua class!");
 
+  clslua_read_config();
+
   cls_handle_t h_class;
   cls_method_handle_t h_eval_json;
   cls_method_handle_t h_eval_bufferlist;
+  cls_method_handle_t h_eval_named;
 
   cls_register("lua", &h_class);
 
@@ -1049,4 +1285,7 @@ CLS_INIT(lua)
 
   cls_register_cxx_method(h_class, "eval_bufferlist",
       CLS_METHOD_RD | CLS_METHOD_WR, eval_bufferlist, &h_eval_bufferlist);
+
+  cls_register_cxx_method(h_class, "eval_named",
+      CLS_METHOD_RD | CLS_METHOD_WR, eval_named, &h_eval_named);
 }
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <string>
 #include <vector>
 #include "include/encoding.h"
@@ -31,4 +32,41 @@ namespace cls_lua_client {
 
     return ioctx.exec(oid, "lua", "eval_bufferlist", inbl, output);
   }
+
+  /*
+   * Sends only the script name, and the script itself when the OSD does not
+   * have it cached under that name (yet). Names are private to this client
+   * and to the pool and namespace of ioctx. OSDs without named scripts get
+   * the script with every call.
+   */
+  int exec_named(IoCtx& ioctx, const string& oid, const string& name,
+      const string& script, const string& handler, bufferlist& input,
+      bufferlist& output)
+  {
+    cls_lua_eval_op op;
+
+    op.script_name = name;
+    op.handler = handler;
+    op.input = input;
+
+    bufferlist inbl;
+    encode(op, inbl);
+
+    int ret = ioctx.exec(oid, "lua", "eval_named", inbl, output);
+    if (ret == -EOPNOTSUPP) {
+      // an OSD that does not know named scripts; it may also mean that
+      // the handler was not found, in which case exec() fails the same way
+      output.clear();
+      return exec(ioctx, oid, script, handler, input, output);
+    }
+    if (ret != -ENOEXEC)
+      return ret;
+
+    op.script = script;
+    inbl.clear();
+    encode(op, inbl);
+    output.clear();
+
+    return ioctx.exec(oid, "lua", "eval_named", inbl, output);
+  }
 }
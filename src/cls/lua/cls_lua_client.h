@@ -12,6 +12,10 @@ namespace cls_lua_client {
   int exec(librados::IoCtx& ioctx, const std::string& oid,
       const std::string& script, const std::string& handler,
       librados::bufferlist& inbl, librados::bufferlist& outbl);
+  int exec_named(librados::IoCtx& ioctx, const std::string& oid,
+      const std::string& name, const std::string& script,
+      const std::string& handler, librados::bufferlist& inbl,
+      librados::bufferlist& outbl);
 }
 
 #endif
@@ -9,20 +9,27 @@ struct cls_lua_eval_op {
   std::string script;
   std::string handler;
   bufferlist input;
+  // eval_named only: the script is cached under this name, and an empty
+  // script runs the script cached under it
+  std::string script_name;
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(1, 1, bl);
+    ENCODE_START(2, 1, bl);
     encode(script, bl);
     encode(handler, bl);
     encode(input, bl);
+    encode(script_name, bl);
     ENCODE_FINISH(bl);
   }
 
   void decode(bufferlist::const_iterator &bl) {
-    DECODE_START(1, bl);
+    DECODE_START(2, bl);
     decode(script, bl);
     decode(handler, bl);
     decode(input, bl);
+    if (struct_v >= 2) {
+      decode(script_name, bl);
+    }
     DECODE_FINISH(bl);
   }
 };
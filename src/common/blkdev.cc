@@ -246,6 +246,23 @@ int block_device_serial(const char *devname, char *serial, size_t max)
   return get_block_device_string_property(devname, "device/serial", serial, max);
 }
 
+int block_device_io_ticks(const char *devname, uint64_t *ms)
+{
+  char buf[512];
+  int r = get_block_device_string_property(devname, "stat", buf, sizeof(buf));
+  if (r < 0)
+    return r;
+  // reads, read merges, read sectors, read ticks, writes, write merges,
+  // write sectors, write ticks, in flight, io ticks, ...
+  unsigned long long f[10];
+  if (sscanf(buf, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+	     &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6], &f[7], &f[8],
+	     &f[9]) != 10)
+    return -EINVAL;
+  *ms = f[9];
+  return 0;
+}
+
 int get_device_by_fd(int fd, char *partition, char *device, size_t max)
 {
   struct stat st;
@@ -524,6 +541,11 @@ bool block_device_is_rotational(const char *devname)
   return false;
 }
 
+int block_device_io_ticks(const char *devname, uint64_t *ms)
+{
+  return -EOPNOTSUPP;
+}
+
 void get_dm_parents(const std::string& dev, std::set<std::string> *ls)
 {
 }
@@ -569,6 +591,11 @@ bool block_device_is_rotational(const char *devname)
   return false;
 }
 
+int block_device_io_ticks(const char *devname, uint64_t *ms)
+{
+  return -EOPNOTSUPP;
+}
+
 int get_device_by_fd(int fd, char *partition, char *device, size_t max)
 {
   return -EOPNOTSUPP;
@@ -626,6 +653,11 @@ bool block_device_is_rotational(const char *devname)
   return false;
 }
 
+int block_device_io_ticks(const char *devname, uint64_t *ms)
+{
+  return -EOPNOTSUPP;
+}
+
 int get_device_by_fd(int fd, char *partition, char *device, size_t max)
 {
   return -EOPNOTSUPP;
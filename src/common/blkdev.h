@@ -1,6 +1,7 @@
 #ifndef __CEPH_COMMON_BLKDEV_H
 #define __CEPH_COMMON_BLKDEV_H
 
+#include <cstdint>
 #include <set>
 #include <string>
 
@@ -27,6 +28,8 @@ extern bool block_device_is_rotational(const char *devname);
 extern int block_device_vendor(const char *devname, char *vendor, size_t max);
 extern int block_device_model(const char *devname, char *model, size_t max);
 extern int block_device_serial(const char *devname, char *serial, size_t max);
+/// cumulative time (ms) the device had IO in flight, from its stat file
+extern int block_device_io_ticks(const char *devname, uint64_t *ms);
 
 extern void get_dm_parents(const std::string& dev, std::set<std::string> *ls);
 extern std::string get_device_id(const std::string& devname);
@@ -20,6 +20,8 @@
 #include <list>
 #include <cmath>
 
+#include <boost/optional.hpp>
+
 #include "common/Formatter.h"
 #include "common/OpQueue.h"
 
@@ -318,11 +320,25 @@ namespace ceph {
       queue_front.emplace_front(std::pair<K,T>(cl, std::move(item)));
     }
 
+    // enqueue with the delta/rho counts the client sent along, so
+    // that its tags account for the service it got from other servers
+    void enqueue_distributed(K cl, unsigned priority, unsigned cost, T&& item,
+			     const dmc::ReqParams& req_params) {
+      // priority is ignored
+      queue.add_request(std::move(item), cl, req_params, cost);
+    }
+
     bool empty() const override final {
       return queue.empty() && high_queue.empty() && queue_front.empty();
     }
 
     T dequeue() override final {
+      return dequeue_distributed(nullptr);
+    }
+
+    // as dequeue(), and if the item came out of the mclock queue set
+    // *phase to the phase it was scheduled in
+    T dequeue_distributed(boost::optional<dmc::PhaseType> *phase) {
       ceph_assert(!empty());
 
       if (!high_queue.empty()) {
@@ -343,6 +359,9 @@ namespace ceph {
       auto pr = queue.pull_request();
       ceph_assert(pr.is_retn());
       auto& retn = pr.get_retn();
+      if (phase) {
+	*phase = retn.phase;
+      }
       return std::move(*(retn.request));
     }
 
@@ -59,6 +59,27 @@ public:
     pair<K, V> *next    ///< [out] first key after key
     ) = 0; ///< @return 0 on success, -ENOENT if there is no next
 
+  /// Returns up to max keys after begin and before end
+  virtual int get_range(
+    const K &begin,     ///< [in] key after which to start
+    const K &end,       ///< [in] first key not to return
+    unsigned max,       ///< [in] max keys to return
+    std::map<K, V> *out ///< [out] keys found
+    ) {
+    K key = begin;
+    while (out->size() < max) {
+      pair<K, V> next;
+      int r = get_next(key, &next);
+      if (r == -ENOENT || (r == 0 && !(next.first < end)))
+	break;
+      if (r < 0)
+	return r;
+      key = next.first;
+      out->insert(std::move(next));
+    }
+    return 0;
+  } ///< @return error value, 0 on success
+
   virtual ~StoreDriver() {}
 };
 
@@ -120,6 +141,41 @@ public:
     return -EINVAL;
   } ///< @return error value, 0 on success, -ENOENT if no more entries
 
+  /**
+   * Fetch the key/value pairs after begin and before end
+   *
+   * If more than max keys are stored in the range, returns at least max
+   * of them; callers must treat out->size() >= max as incomplete.
+   */
+  int get_range(
+    const K &begin,     ///< [in] key after which to start
+    const K &end,       ///< [in] first key not to return
+    unsigned max,       ///< [in] max keys to get
+    std::map<K, V> *out ///< [out] keys found
+    ) {
+    // snapshot unstable keys before reading the store so that a write
+    // becoming readable during the scan is seen in one or the other
+    std::map<K, boost::optional<V> > cached;
+    K key = begin;
+    pair<K, boost::optional<V> > next;
+    while (in_progress.get_next(key, &next) && next.first < end) {
+      key = next.first;
+      cached.insert(next);
+    }
+    int r = driver->get_range(begin, end, max, out);
+    if (r < 0)
+      return r;
+    if (out->size() >= max)
+      return 0;
+    for (auto &i : cached) {
+      if (i.second)
+	(*out)[i.first] = i.second.get();
+      else
+	out->erase(i.first);
+    }
+    return 0;
+  } ///< @return error value, 0 on success
+
   /// Adds operation setting keys to Transaction
   void set_keys(
     const map<K, V> &keys,  ///< [in] keys/values to set
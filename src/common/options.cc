@@ -1998,6 +1998,23 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_mclock_service_tracker", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("tag ops with dmclock delta and rho values")
+    .set_long_description("track the replies (and mclock phases) received from all OSDs and send the dmclock delta/rho counts with each op, so that OSDs running the 'mclock_client' queue enforce per-client reservations and weights across the whole cluster rather than per OSD")
+    .add_see_also("osd_op_queue_mclock_tenants"),
+
+    Option("objecter_op_batch_max_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_description("Maximum number of ops sent to an OSD in one batch message")
+    .set_long_description("Ops submitted together (e.g. with librados IoCtx::aio_operate_batch()) that map to the same PG are sent to its primary as a single MOSDOpBatch message of up to this many ops.  Each op is still executed and replied to on its own.  0 or 1 disables batching.")
+    .add_see_also("objecter_op_batch_max_bytes"),
+
+    Option("objecter_op_batch_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_description("Ops carrying more data than this are never batched")
+    .add_see_also("objecter_op_batch_max_ops"),
+
     Option("filer_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description("Max in-flight operations for purging a striped range (e.g., MDS journal)"),
@@ -2232,6 +2249,12 @@ std::vector<Option> get_global_options() {
     .set_description("")
     .add_see_also("osd_tier_default_cache_hit_set_type"),
 
+    Option("osd_pool_default_hit_set_counting_decay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.5)
+    .set_min_max(0.0, 1.0)
+    .set_description("Fraction of its hit counts a counting hit set keeps from one hit_set_period to the next")
+    .add_see_also("osd_tier_default_cache_hit_set_type"),
+
     Option("osd_pool_default_cache_target_dirty_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.4)
     .set_description(""),
@@ -2293,7 +2316,7 @@ std::vector<Option> get_global_options() {
 
     Option("osd_tier_default_cache_hit_set_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("bloom")
-    .set_enum_allowed({"bloom", "explicit_hash", "explicit_object"})
+    .set_enum_allowed({"bloom", "explicit_hash", "explicit_object", "counting"})
     .set_flag(Option::FLAG_RUNTIME)
     .set_description(""),
 
@@ -2363,10 +2386,56 @@ std::vector<Option> get_global_options() {
     .set_default(65536)
     .set_description(""),
 
+    Option("osd_op_cost_model", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("cost client ops by a model of the device")
+    .set_long_description("when enabled, the op queue cost of a client or replica op is its data length plus a per-op cost, in bytes, that reflects how many bytes the device transfers in the time of one random IO; otherwise it is the data length alone")
+    .add_see_also("osd_op_cost_per_io_hdd")
+    .add_see_also("osd_op_cost_per_io_ssd")
+    .add_see_also("osd_op_cost_calibrate_on_start"),
+
+    Option("osd_op_cost_per_io_hdd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_M)
+    .set_description("initial per-op cost, in bytes, for rotational devices")
+    .add_see_also("osd_op_cost_model"),
+
+    Option("osd_op_cost_per_io_ssd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(16_K)
+    .set_description("initial per-op cost, in bytes, for non-rotational devices")
+    .add_see_also("osd_op_cost_model"),
+
+    Option("osd_op_cost_calibrate_on_start", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("calibrate the op cost model with a short write benchmark when the OSD starts")
+    .set_long_description("the benchmark writes to the OSD's own device and delays startup; it is skipped on rotational devices, where small writes are deferred and would not measure a random IO")
+    .add_see_also("osd_op_cost_calibrate_small_ios")
+    .add_see_also("osd_op_cost_calibrate_large_ios"),
+
+    Option("osd_op_cost_calibrate_small_ios", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(256)
+    .set_description("number of 4 KiB writes of the startup calibration"),
+
+    Option("osd_op_cost_calibrate_large_ios", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(16)
+    .set_description("number of 4 MiB writes of the startup calibration"),
+
+    Option("osd_op_cost_model_decay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.9)
+    .set_min_max(0.0, 0.999)
+    .set_description("weight of past object store latency samples in the op cost model")
+    .set_long_description("every tick the OSD feeds the average size and commit latency of the writes the object store completed into the op cost model; lower values follow changes faster, higher values are less noisy")
+    .add_see_also("osd_op_cost_model"),
+
     Option("osd_recover_clone_overlap", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
 
+    Option("osd_txn_batch_max_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_description("Maximum number of PG writes submitted to the object store as one transaction batch")
+    .set_long_description("When a worker thread finishes a client write (or replica repop) and the next op already queued for the same PG is another write, it processes that op too, without dropping the PG lock, and submits the resulting transactions together with a single queue_transactions() call.  Each op is still acked individually.  Only applies to replicated pools; 0 or 1 disables batching.")
+    .add_see_also("osd_op_num_threads_per_shard"),
+
     Option("osd_op_num_threads_per_shard", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_flag(Option::FLAG_STARTUP)
@@ -2872,6 +2941,17 @@ std::vector<Option> get_global_options() {
     .add_see_also("osd_op_queue_mclock_scrub_res")
     .add_see_also("osd_op_queue_mclock_scrub_wgt"),
 
+    Option("osd_op_queue_mclock_tenants", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("per-client mclock reservation, weight and limit")
+    .set_long_description("comma-separated list of <entity>=<res>:<wgt>:<lim> (e.g. 'client.db=100:10:0,client.batch=0:1:200'); when osd_op_queue is 'mclock_client', ops from a listed client entity are scheduled as a single mclock client with these parameters, ahead of any qos_reservation/qos_weight/qos_limit set on the target pool")
+    .add_see_also("osd_op_queue")
+    .add_see_also("osd_op_queue_mclock_client_op_res")
+    .add_see_also("osd_op_queue_mclock_client_op_wgt")
+    .add_see_also("osd_op_queue_mclock_client_op_lim")
+    .add_see_also("objecter_mclock_service_tracker"),
+
     Option("osd_ignore_stale_divergent_priors", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -2892,6 +2972,13 @@ std::vector<Option> get_global_options() {
     .set_default(512)
     .set_description(""),
 
+    Option("osd_backfill_scan_prefetch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Scan the next range of backfill targets while pushing the current one")
+    .set_long_description("When enabled, the primary asks each backfill target for the digest of its next range of objects as soon as it starts on the current range, so that backfill does not stall on a scan round trip each time a range is exhausted.")
+    .add_see_also("osd_backfill_scan_max"),
+
     Option("osd_op_thread_timeout", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(15)
     .set_description(""),
@@ -2920,6 +3007,32 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("osd_snap_trim_client_latency_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Client op latency (seconds) above which snap trimming backs off")
+    .set_long_description("While recent client op latency is above this target the delay between snap trim batches doubles each second, up to osd_snap_trim_sleep_max; once latency falls below it the delay shrinks back toward osd_snap_trim_sleep.  0 disables the controller and always sleeps osd_snap_trim_sleep.")
+    .add_see_also("osd_snap_trim_sleep")
+    .add_see_also("osd_snap_trim_sleep_max"),
+
+    Option("osd_snap_trim_sleep_max", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(5.0)
+    .set_min(0)
+    .set_description("Longest delay between snap trim batches while clients are busy")
+    .add_see_also("osd_snap_trim_client_latency_target"),
+
+    Option("osd_snap_trim_batch_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_min(1)
+    .set_description("Number of clones trimmed by a single snap trim transaction")
+    .set_long_description("Each of the osd_pg_max_concurrent_snap_trims snap trim operations of a PG trims up to this many clones in one transaction and one replicated write.")
+    .add_see_also("osd_pg_max_concurrent_snap_trims"),
+
+    Option("osd_snap_mapper_index_max_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16384)
+    .set_description("Largest number of snapped objects per PG whose snap mappings are kept in memory")
+    .set_long_description("Each PG loads its object->snaps and snap->objects mappings from the OSD's snap mapper omap on first use and then serves lookups and snap trim listings from memory, writing only the changed keys back.  PGs with more mapped clones than this fall back to reading omap directly.  0 disables the in-memory index."),
+
     Option("osd_scrub_invalid_stats", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -2949,6 +3062,26 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_heartbeat_failure_detector", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("grace")
+    .set_enum_allowed({"grace", "phi"})
+    .set_description("How an osd decides that a heartbeat peer has failed")
+    .set_long_description("'grace' reports a peer whose pings go unanswered for osd_heartbeat_grace seconds.  'phi' tracks the spread of each peer's reply intervals and reports it once the current silence is unlikely enough, as set by osd_heartbeat_phi_threshold; peers with too short a history fall back to grace.  The monitor does not hold phi reports to osd_heartbeat_grace when every reporter of a peer used phi, only to its laggy adjustments.")
+    .add_see_also("osd_heartbeat_grace")
+    .add_see_also("osd_heartbeat_phi_threshold"),
+
+    Option("osd_heartbeat_phi_threshold", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_min(1)
+    .set_description("Suspicion level at which the phi failure detector reports a peer")
+    .set_long_description("A peer is reported once the probability of its current silence, given its reply history, drops below 10^-threshold.")
+    .add_see_also("osd_heartbeat_failure_detector"),
+
+    Option("osd_heartbeat_front_per_host", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Probe each peer host's front network through one of its osds")
+    .set_long_description("Each heartbeat round sends a front ping to a single osd of every peer host, rotating between them, and counts its reply for all osds on that host.  Back pings still go to every peer."),
+
     Option("osd_heartbeat_min_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(2000)
     .set_description("Minimum heartbeat packet size in bytes. Will add dummy payload if heartbeat packet is smaller than this."),
@@ -2985,6 +3118,12 @@ std::vector<Option> get_global_options() {
     .set_default(500)
     .set_description(""),
 
+    Option("osd_pg_stats_full_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(300)
+    .set_description("Seconds between PG stats reports to the mgr that include every PG")
+    .set_long_description("Reports in between only carry the PGs whose stats changed since the previous report.  A full report is always sent on a new mgr session.  0 sends every PG in every report.")
+    .add_see_also("mgr_stats_period"),
+
     Option("osd_mon_ack_timeout", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(30.0)
     .set_description(""),
@@ -3017,10 +3156,54 @@ std::vector<Option> get_global_options() {
     .set_default(3)
     .set_description(""),
 
+    Option("osd_recovery_client_latency_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Client op latency (seconds) above which recovery backs off")
+    .set_long_description("Together with osd_recovery_device_utilization_target this enables an adaptive recovery throttle.  Each second, while either target is exceeded, the number of recovery ops allowed in flight is halved and, once it is down to one, the delay between recovery ops doubles up to osd_recovery_sleep_max.  While neither is exceeded the delay shrinks back to the configured osd_recovery_sleep and recovery concurrency grows by one up to osd_recovery_max_active_max.  When both targets are 0 the static osd_recovery_max_active and osd_recovery_sleep apply.")
+    .add_see_also("osd_recovery_device_utilization_target")
+    .add_see_also("osd_recovery_max_active_max")
+    .add_see_also("osd_recovery_sleep_max"),
+
+    Option("osd_recovery_device_utilization_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(0.0, 1.0)
+    .set_description("Busy fraction of the busiest object store device above which recovery backs off")
+    .set_long_description("Device utilization is the share of time a device had IO in flight, as accounted by the kernel.  See osd_recovery_client_latency_target.")
+    .add_see_also("osd_recovery_client_latency_target"),
+
+    Option("osd_recovery_max_active_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Most recovery ops the adaptive recovery throttle allows in flight")
+    .add_see_also("osd_recovery_client_latency_target"),
+
+    Option("osd_recovery_sleep_max", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0)
+    .set_description("Longest delay between recovery ops the adaptive recovery throttle imposes")
+    .add_see_also("osd_recovery_client_latency_target"),
+
     Option("osd_recovery_max_single_start", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1)
     .set_description(""),
 
+    Option("osd_recovery_max_batch_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_min(1)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Number of small objects that may be recovered under a single recovery op")
+    .set_long_description("Objects no larger than osd_recovery_batch_max_object_size count as a fraction of a recovery op against osd_recovery_max_active, so many of them are pushed together in one message and applied in one transaction on the target.  1 disables batching.")
+    .add_see_also("osd_recovery_batch_max_object_size")
+    .add_see_also("osd_recovery_max_active")
+    .add_see_also("osd_max_push_objects"),
+
+    Option("osd_recovery_batch_max_object_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Largest object that recovery batches with other small objects")
+    .add_see_also("osd_recovery_max_batch_objects"),
+
     Option("osd_recovery_max_chunk", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(8_M)
     .set_description(""),
@@ -3033,6 +3216,11 @@ std::vector<Option> get_global_options() {
     .set_default(8_M)
     .set_description(""),
 
+    Option("osd_copy_from_local_clone", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Serve copy-from within a PG by cloning the source object in the object store")
+    .set_long_description("When the source of a copy-from is the head of an object in the same PG of a replicated, untiered pool, and every replica that applies the write has the source, the destination is created as an object store clone of the source.  The store can share the data rather than copy it, and nothing is read back through the objecter.  Other copies use the regular chunked read and write."),
+
     Option("osd_push_per_object_cost", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(1000)
     .set_description(""),
@@ -3079,6 +3267,28 @@ std::vector<Option> get_global_options() {
     .set_default(0.5)
     .set_description("Allow scrubbing when system load divided by number of CPUs is below this value"),
 
+    Option("osd_scrub_client_latency_threshold", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Only start scrubs when recent client op latency (seconds) is below this value")
+    .set_long_description("Client op latency is averaged over the last few seconds.  While it is above this value no new scrubs are started (unless a PG is past its scrub deadline), and running scrubs are slowed down by up to osd_scrub_busy_sleep per chunk.  0 disables the check.")
+    .add_see_also("osd_scrub_client_queue_threshold")
+    .add_see_also("osd_scrub_busy_sleep"),
+
+    Option("osd_scrub_client_queue_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Only start scrubs when fewer client ops than this are in progress")
+    .set_long_description("While the number of client ops in progress on the OSD is at or above this value no new scrubs are started (unless a PG is past its scrub deadline), and running scrubs are slowed down by up to osd_scrub_busy_sleep per chunk.  0 disables the check.")
+    .add_see_also("osd_scrub_client_latency_threshold")
+    .add_see_also("osd_scrub_busy_sleep"),
+
+    Option("osd_scrub_busy_sleep", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0)
+    .set_description("Additional delay between scrub chunks while client load is high")
+    .set_long_description("Added to osd_scrub_sleep in proportion to how far client load exceeds osd_scrub_client_latency_threshold or osd_scrub_client_queue_threshold, reaching the full value at twice the threshold.")
+    .add_see_also("osd_scrub_sleep"),
+
     Option("osd_scrub_min_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(1_day)
     .set_description("Scrub each PG no more often than this interval")
@@ -3176,6 +3386,24 @@ std::vector<Option> get_global_options() {
     .set_default("cephfs hello journal lock log numops " "otp rbd refcount rgw timeindex user version cas")
     .set_description(""),
 
+    Option("osd_cls_lua_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_description("Number of compiled Lua scripts cls_lua keeps per OSD")
+    .set_long_description("Scripts run through cls_lua are compiled once and the bytecode is kept in a per-OSD LRU cache, keyed by the script text or by the name the script was registered under. 0 disables the cache. Read when the lua class is loaded."),
+
+    Option("osd_cls_lua_max_instructions", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(100000000)
+    .set_description("Maximum number of Lua VM instructions a cls_lua call may execute")
+    .set_long_description("Calls exceeding the budget fail with ETIMEDOUT. 0 disables the limit. Read when the lua class is loaded.")
+    .add_see_also("osd_cls_lua_max_time"),
+
+    Option("osd_cls_lua_max_time", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(5.0)
+    .set_min(0.0)
+    .set_description("Maximum time in seconds a cls_lua call may run")
+    .set_long_description("Calls exceeding the budget fail with ETIMEDOUT. 0 disables the limit. Read when the lua class is loaded.")
+    .add_see_also("osd_cls_lua_max_instructions"),
+
     Option("osd_check_for_log_corruption", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -3214,6 +3442,15 @@ std::vector<Option> get_global_options() {
     .add_see_also("osd_min_pg_log_entries")
     .add_see_also("osd_pg_log_dups_tracked"),
 
+    Option("osd_pg_log_memory_target", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Target memory use of all PG logs on the OSD")
+    .set_long_description("When the osd_pglog mempool (log entries, dups and their indexes) grows past this target, healthy PGs trim their logs below osd_min_pg_log_entries and keep fewer than osd_pg_log_dups_tracked dups, down to a tenth of the configured lengths.  Only PGs that are active and clean, with no backfill or async recovery targets and no missing objects, are affected; degraded and recovering PGs keep their full logs and dups.  0 disables the budget.")
+    .add_service("osd")
+    .add_see_also("osd_min_pg_log_entries")
+    .add_see_also("osd_pg_log_dups_tracked"),
+
     Option("osd_pg_log_dups_tracked", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(3000)
     .set_description("how many versions back to track in order to detect duplicate ops; this is combined with both the regular pg log entries and additional minimal dup detection entries")
@@ -3277,6 +3514,11 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("osd_read_fast_path", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Serve simple reads of clean objects under a shared PG lock")
+    .set_long_description("Client ops made only of read, stat and getxattr on a cached, idle, non-degraded object in a replicated pool are executed while holding the PG lock in shared mode, so that such reads of one PG can run concurrently on all threads of its shard.  Anything else falls back to the normal, exclusively locked path."),
+
     Option("osd_backoff_on_degraded", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -3381,6 +3623,12 @@ std::vector<Option> get_global_options() {
     .set_default(10.0)
     .set_description(""),
 
+    Option("osd_op_trace_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Trace the stage latencies of one in this many client ops")
+    .set_long_description("Sampled client ops are stamped as they pass fixed points (dispatch, queueing, PG lock, execution, submit, commit and reply) and the time between points is accounted in the op_stage_* perf counters. This is independent of osd_enable_op_tracker. 0 disables sampling."),
+
     Option("osd_target_transaction_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(30)
     .set_description(""),
@@ -3393,9 +3641,20 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
-    Option("osd_pg_object_context_cache_count", Option::TYPE_INT, Option::LEVEL_ADVANCED)
-    .set_default(64)
-    .set_description(""),
+    Option("osd_object_context_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16384)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Number of object contexts cached per OSD")
+    .set_long_description("The object context cache is shared by all PGs on the OSD, so busy PGs can hold more entries than idle ones.")
+    .add_see_also("osd_object_context_cache_shards"),
+
+    Option("osd_object_context_cache_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32)
+    .set_min(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of independently locked shards in the object context cache")
+    .set_long_description("The objects of one PG are spread over at most 8 of the shards, so a single PG can hold at most 8 shards' share of osd_object_context_cache_size.")
+    .add_see_also("osd_object_context_cache_size"),
 
     Option("osd_tracing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
@@ -3581,6 +3840,20 @@ std::vector<Option> get_global_options() {
     .set_default(255)
     .set_description(""),
 
+    Option("osd_peering_batch_max_pgs", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Max number of PGs whose peering messages are batched before they are sent")
+    .set_long_description("Peering queries, notifies and infos that PGs of an op shard generate for the same peer OSD in the same map epoch are combined into one message per peer.  The batch is sent once the shard's op queue drains, osd_peering_batch_max_delay has passed, or this many PGs have contributed to it, and before any of its PGs handles another queued item, so that nothing those PGs send directly overtakes it.  0 sends each PG's peering messages right away.")
+    .add_see_also("osd_peering_batch_max_delay"),
+
+    Option("osd_peering_batch_max_delay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.01)
+    .set_min(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Max seconds peering messages are held back for batching")
+    .add_see_also("osd_peering_batch_max_pgs"),
+
     Option("osd_snap_trim_priority", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description(""),
@@ -129,6 +129,8 @@ struct ceph_dir_layout {
 #define CEPH_MSG_OSD_OP                 42
 #define CEPH_MSG_OSD_OPREPLY            43
 #define CEPH_MSG_WATCH_NOTIFY           44
+#define CEPH_MSG_OSD_OP_BATCH           54
+#define CEPH_MSG_WATCH_NOTIFY_BATCH     55
 #define CEPH_MSG_OSD_BACKOFF            61
 
 /* FSMap subscribers (see all MDS clusters at once) */
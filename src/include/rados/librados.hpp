@@ -1120,6 +1120,24 @@ namespace librados
         const blkin_trace_info *trace_info);
     int aio_operate(const std::string& oid, AioCompletion *c,
 		    ObjectReadOperation *op, bufferlist *pbl);
+    /**
+     * Schedule several async write operations at once
+     *
+     * The same as calling aio_operate(oids[i], cs[i], ops[i]) for each
+     * i in turn, except that operations on objects in the same PG may
+     * be sent to the OSD together (see objecter_op_batch_max_ops).
+     * Each operation still completes, with its own result, on its own
+     * completion, and operations on the same object are applied in
+     * order.
+     *
+     * @param oids the objects to operate on
+     * @param cs what to do when each operation is complete and safe
+     * @param ops which operations to perform on each object
+     * @returns 0 on success, -EINVAL if the vectors differ in length
+     */
+    int aio_operate_batch(const std::vector<std::string>& oids,
+			  const std::vector<AioCompletion*>& cs,
+			  const std::vector<ObjectWriteOperation*>& ops);
 
     int aio_operate(const std::string& oid, AioCompletion *c,
 		    ObjectReadOperation *op, snap_t snapid, int flags,
@@ -803,6 +803,41 @@ int librados::IoCtxImpl::aio_operate(const object_t& oid,
   return 0;
 }
 
+int librados::IoCtxImpl::aio_operate_batch(
+  const vector<object_t>& oids,
+  const vector<::ObjectOperation*>& ops,
+  const vector<AioCompletionImpl*>& cs,
+  const SnapContext& snap_context, int flags)
+{
+  FUNCTRACE(client->cct);
+  if (oids.size() != ops.size() || oids.size() != cs.size())
+    return -EINVAL;
+  /* can't write to a snapshot */
+  if (snap_seq != CEPH_NOSNAP)
+    return -EROFS;
+
+  auto ut = ceph::real_clock::now();
+  vector<Objecter::Op*> objecter_ops;
+  vector<ceph_tid_t*> ptids;
+  objecter_ops.reserve(ops.size());
+  ptids.reserve(ops.size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    AioCompletionImpl *c = cs[i];
+    Context *oncomplete = new C_aio_Complete(c);
+#if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
+    ((C_aio_Complete *) oncomplete)->oid = oids[i];
+#endif
+    c->io = this;
+    queue_aio_write(c);
+    objecter_ops.push_back(objecter->prepare_mutate_op(
+      oids[i], oloc, *ops[i], snap_context, ut, flags,
+      oncomplete, &c->objver));
+    ptids.push_back(&c->tid);
+  }
+  objecter->op_submit_batch(objecter_ops, ptids);
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  bufferlist *pbl, size_t len, uint64_t off,
 				  uint64_t snapid, const blkin_trace_info *info)
@@ -1542,6 +1542,22 @@ int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				  translate_flags(flags));
 }
 
+int librados::IoCtx::aio_operate_batch(
+  const std::vector<std::string>& oids,
+  const std::vector<AioCompletion*>& cs,
+  const std::vector<ObjectWriteOperation*>& ops)
+{
+  vector<object_t> objs(oids.begin(), oids.end());
+  vector<::ObjectOperation*> os;
+  vector<AioCompletionImpl*> pcs;
+  for (auto o : ops)
+    os.push_back(&o->impl->o);
+  for (auto c : cs)
+    pcs.push_back(c->pc);
+  return io_ctx_impl->aio_operate_batch(objs, os, pcs,
+					io_ctx_impl->snapc, 0);
+}
+
 int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				 librados::ObjectWriteOperation *o,
 				 snap_t snap_seq, std::vector<snap_t>& snaps)
@@ -31,6 +31,7 @@ private:
     FLAG_ALIVE = 0,      // use this on its own to mark as "I'm still alive"
     FLAG_FAILED = 1,     // if set, failure; if not, recovery
     FLAG_IMMEDIATE = 2,  // known failure, not a timeout
+    FLAG_PHI = 4,        // judged by the phi accrual detector, not the grace
   };
   
   uuid_d fsid;
@@ -70,6 +71,9 @@ public:
   bool is_immediate() const { 
     return flags & FLAG_IMMEDIATE; 
   }
+  bool is_phi() const {
+    return flags & FLAG_PHI;
+  }
   epoch_t get_epoch() const { return epoch; }
 
   void decode_payload() override {
@@ -118,7 +122,7 @@ public:
   void print(ostream& out) const override {
     out << "osd_failure("
 	<< (if_osd_failed() ? "failed " : "recovered ")
-	<< (is_immediate() ? "immediate " : "timeout ")
+	<< (is_immediate() ? "immediate " : (is_phi() ? "phi " : "timeout "))
 	<< "osd." << target_osd << " " << target_addrs
 	<< " for " << failed_for << "sec e" << epoch
 	<< " v" << version << ")";
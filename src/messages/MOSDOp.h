@@ -35,7 +35,7 @@ class MOSDOp : public MessageInstance<MOSDOp, MOSDFastDispatchOp> {
 public:
   friend factory;
 private:
-  static constexpr int HEAD_VERSION = 8;
+  static constexpr int HEAD_VERSION = 9;
   static constexpr int COMPAT_VERSION = 3;
 
 private:
@@ -64,6 +64,13 @@ private:
   bool bdata_encode;
   osd_reqid_t reqid; // reqid explicitly set by sender
 
+  // dmclock tags: replies (delta) and reservation-phase replies (rho)
+  // the client has received from all OSDs since its last op to this one
+  uint32_t qos_delta = 0;
+  uint32_t qos_rho = 0;
+  // phase the op was dequeued in by the mclock_client queue; not encoded
+  int8_t qos_phase = -1;
+
 public:
   friend class MOSDOpReply;
 
@@ -162,6 +169,15 @@ public:
   int get_retry_attempt() const {
     return retry_attempt;
   }
+
+  void set_qos_tags(uint32_t delta, uint32_t rho) {
+    qos_delta = delta;
+    qos_rho = rho;
+  }
+  uint32_t get_qos_delta() const { return qos_delta; }
+  uint32_t get_qos_rho() const { return qos_rho; }
+  void set_qos_phase(int8_t phase) { qos_phase = phase; }
+  int8_t get_qos_phase() const { return qos_phase; }
   uint64_t get_features() const {
     if (features)
       return features;
@@ -361,8 +377,9 @@ struct ceph_osd_request_head {
       encode(features, payload);
     } else {
       // latest v8 encoding with hobject_t hash separate from pgid, no
-      // reassert version
-      header.version = HEAD_VERSION;
+      // reassert version; v9 adds the dmclock tags
+      header.version = HAVE_FEATURE(features, SERVER_NAUTILUS) ?
+	HEAD_VERSION : 8;
 
       encode(pgid, payload);
       encode(hobj.get_hash(), payload);
@@ -370,6 +387,10 @@ struct ceph_osd_request_head {
       encode(flags, payload);
       encode(reqid, payload);
       encode_trace(payload, features);
+      if (header.version >= 9) {
+	encode(qos_delta, payload);
+	encode(qos_rho, payload);
+      }
 
       // -- above decoded up front; below decoded post-dispatch thread --
 
@@ -397,7 +418,7 @@ struct ceph_osd_request_head {
     p = std::cbegin(payload);
 
     // Always keep here the newest version of decoding order/rule
-    if (header.version == HEAD_VERSION) {
+    if (header.version >= 8) {
       decode(pgid, p);      // actual pgid
       uint32_t hash;
       decode(hash, p); // raw hash value
@@ -406,6 +427,10 @@ struct ceph_osd_request_head {
       decode(flags, p);
       decode(reqid, p);
       decode_trace(p);
+      if (header.version >= 9) {
+	decode(qos_delta, p);
+	decode(qos_rho, p);
+      }
     } else if (header.version == 7) {
       decode(pgid.pgid, p);      // raw pgid
       hobj.set_hash(pgid.pgid.ps());
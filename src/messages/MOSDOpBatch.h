@@ -0,0 +1,133 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#ifndef CEPH_MOSDOPBATCH_H
+#define CEPH_MOSDOPBATCH_H
+
+#include "msg/Message.h"
+#include "MOSDOp.h"
+
+/*
+ * independent client ops, usually on different objects, that map to
+ * the same pg.  each op travels as a complete encoded MOSDOp and is
+ * executed and replied to (with its own MOSDOpReply) exactly as if it
+ * had been sent on its own; the batch only saves the per-message cost
+ * on the wire and in dispatch.
+ */
+class MOSDOpBatch : public MessageInstance<MOSDOpBatch> {
+public:
+  friend factory;
+
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+  spg_t pgid;
+  epoch_t map_epoch = 0;
+  uint32_t num_ops = 0;   ///< encoded MOSDOps in the data segment
+
+  MOSDOpBatch()
+    : MessageInstance(CEPH_MSG_OSD_OP_BATCH, HEAD_VERSION, COMPAT_VERSION) {}
+  MOSDOpBatch(spg_t pgid_, epoch_t ep)
+    : MessageInstance(CEPH_MSG_OSD_OP_BATCH, HEAD_VERSION, COMPAT_VERSION),
+      pgid(pgid_),
+      map_epoch(ep) {}
+
+  /// append m, encoded for a peer with the given features; m is not put
+  void add_op(MOSDOp *m, uint64_t features) {
+    encode_message(m, features, data);
+    ++num_ops;
+  }
+
+  /**
+   * decode the batched ops
+   *
+   * The ops are given our connection, source and stamps, and each
+   * takes over the part of our byte throttle its own buffers account
+   * for; the rest (framing) is released right away.  Each op also holds
+   * a message throttle slot: the first takes over ours, the others take
+   * new ones, so a batch counts against the message cap as the ops it
+   * carries.  Stops at the first op that fails to decode.
+   */
+  std::vector<MOSDOp*> claim_ops(CephContext *cct) {
+    std::vector<MOSDOp*> ops;
+    uint64_t claimed = 0;
+    auto p = data.cbegin();
+    try {
+      for (uint32_t i = 0; i < num_ops; ++i) {
+	Message *m = decode_message(cct, 0, p);
+	if (!m) {
+	  break;
+	}
+	if (m->get_type() != CEPH_MSG_OSD_OP) {
+	  m->put();
+	  break;
+	}
+	m->set_src(get_source());
+	m->set_connection(get_connection());
+	m->set_recv_stamp(get_recv_stamp());
+	m->set_throttle_stamp(get_throttle_stamp());
+	m->set_recv_complete_stamp(get_recv_complete_stamp());
+	m->set_dispatch_stamp(get_dispatch_stamp());
+	if (byte_throttler) {
+	  claimed += m->get_payload().length() + m->get_middle().length() +
+	    m->get_data().length();
+	  m->set_byte_throttler(byte_throttler);
+	}
+	if (msg_throttler) {
+	  if (!ops.empty()) {
+	    msg_throttler->take();
+	  }
+	  m->set_message_throttler(msg_throttler);
+	}
+	ops.push_back(static_cast<MOSDOp*>(m));
+      }
+    } catch (const buffer::error&) {
+      // keep what decoded
+    }
+    if (byte_throttler) {
+      uint64_t total = payload.length() + middle.length() + data.length();
+      byte_throttler->put(total - std::min(total, claimed));
+      byte_throttler = nullptr;
+    }
+    if (msg_throttler && !ops.empty()) {
+      // handed to the first op
+      msg_throttler = nullptr;
+    }
+    return ops;
+  }
+
+private:
+  ~MOSDOpBatch() override {}
+
+public:
+  const char *get_type_name() const override { return "osd_op_batch"; }
+  void print(ostream& out) const override {
+    out << "osd_op_batch(" << pgid << " " << num_ops << " ops e"
+	<< map_epoch << ")";
+  }
+
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    encode(pgid, payload);
+    encode(map_epoch, payload);
+    encode(num_ops, payload);
+  }
+  void decode_payload() override {
+    auto p = payload.cbegin();
+    decode(pgid, p);
+    decode(map_epoch, p);
+    decode(num_ops, p);
+  }
+};
+
+#endif
@@ -33,7 +33,7 @@ class MOSDOpReply : public MessageInstance<MOSDOpReply> {
 public:
   friend factory;
 private:
-  static constexpr int HEAD_VERSION = 8;
+  static constexpr int HEAD_VERSION = 9;
   static constexpr int COMPAT_VERSION = 2;
 
   object_t oid;
@@ -49,6 +49,7 @@ private:
   int32_t retry_attempt = -1;
   bool do_redirect;
   request_redirect_t redirect;
+  int8_t qos_phase = -1;  // dmclock phase the op was served in, if any
 
 public:
   const object_t& get_oid() const { return oid; }
@@ -117,6 +118,16 @@ public:
   int get_retry_attempt() const {
     return retry_attempt;
   }
+
+  /**
+   * get the mclock phase the op was dequeued in
+   *
+   * 0 for reservation, 1 for priority (weight), or -1 if the op was not
+   * scheduled by the mclock_client queue.
+   */
+  int get_qos_phase() const {
+    return qos_phase;
+  }
   
   // osdmap
   epoch_t get_map_epoch() const { return osdmap_epoch; }
@@ -145,6 +156,7 @@ public:
     osdmap_epoch = e;
     user_version = 0;
     retry_attempt = req->get_retry_attempt();
+    qos_phase = req->get_qos_phase();
     do_redirect = false;
 
     // zero out ops payload_len and possibly out data
@@ -213,6 +225,9 @@ public:
         }
       }
       encode_trace(payload, features);
+      if (header.version >= 9) {
+	encode(qos_phase, payload);
+      }
     }
   }
   void decode_payload() override {
@@ -246,6 +261,7 @@ public:
       if (do_redirect)
 	decode(redirect, p);
       decode_trace(p);
+      decode(qos_phase, p);
     } else if (header.version < 2) {
       ceph_osd_reply_head head;
       decode(head, p);
@@ -308,6 +324,9 @@ public:
       if (header.version >= 8) {
         decode_trace(p);
       }
+      if (header.version >= 9) {
+	decode(qos_phase, p);
+      }
     }
   }
 
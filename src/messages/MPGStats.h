@@ -22,15 +22,21 @@ class MPGStats : public MessageInstance<MPGStats, PaxosServiceMessage> {
 public:
   friend factory;
 
+  static constexpr int HEAD_VERSION = 2;
+  static constexpr int COMPAT_VERSION = 1;
+
   uuid_d fsid;
   map<pg_t,pg_stat_t> pg_stat;
   osd_stat_t osd_stat;
   epoch_t epoch = 0;
   utime_t had_map_for;
-  
-  MPGStats() : MessageInstance(MSG_PGSTATS, 0) {}
+  /// true if pg_stat holds every pg the osd is primary for, false if
+  /// only those that changed since the previous report
+  bool full = true;
+
+  MPGStats() : MessageInstance(MSG_PGSTATS, 0, HEAD_VERSION, COMPAT_VERSION) {}
   MPGStats(const uuid_d& f, epoch_t e, utime_t had)
-    : MessageInstance(MSG_PGSTATS, 0),
+    : MessageInstance(MSG_PGSTATS, 0, HEAD_VERSION, COMPAT_VERSION),
       fsid(f),
       epoch(e),
       had_map_for(had)
@@ -42,7 +48,8 @@ private:
 public:
   const char *get_type_name() const override { return "pg_stats"; }
   void print(ostream& out) const override {
-    out << "pg_stats(" << pg_stat.size() << " pgs tid " << get_tid() << " v " << version << ")";
+    out << "pg_stats(" << pg_stat.size() << " pgs" << (full ? "" : " delta")
+	<< " tid " << get_tid() << " v " << version << ")";
   }
 
   void encode_payload(uint64_t features) override {
@@ -53,6 +60,7 @@ public:
     encode(pg_stat, payload);
     encode(epoch, payload);
     encode(had_map_for, payload);
+    encode(full, payload);
   }
   void decode_payload() override {
     auto p = payload.cbegin();
@@ -62,6 +70,9 @@ public:
     decode(pg_stat, p);
     decode(epoch, p);
     decode(had_map_for, p);
+    if (header.version >= 2) {
+      decode(full, p);
+    }
   }
 };
 
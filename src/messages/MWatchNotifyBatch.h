@@ -0,0 +1,87 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#ifndef CEPH_MWATCHNOTIFYBATCH_H
+#define CEPH_MWATCHNOTIFYBATCH_H
+
+#include "msg/Message.h"
+#include "MWatchNotify.h"
+
+/*
+ * one notify for several watches held over the same connection.  the
+ * payload is sent once; the client handles it as one
+ * CEPH_WATCH_EVENT_NOTIFY MWatchNotify per cookie.
+ */
+class MWatchNotifyBatch : public MessageInstance<MWatchNotifyBatch> {
+public:
+  friend factory;
+
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+  uint64_t ver = 0;           ///< unused, as in MWatchNotify
+  uint64_t notify_id = 0;     ///< osd unique id for the notify
+  uint64_t notifier_gid = 0;  ///< who sent the notify
+  bufferlist bl;              ///< notify payload
+  std::vector<uint64_t> cookies;  ///< watches being notified
+
+  MWatchNotifyBatch()
+    : MessageInstance(CEPH_MSG_WATCH_NOTIFY_BATCH, HEAD_VERSION,
+		      COMPAT_VERSION) {}
+  MWatchNotifyBatch(uint64_t v, uint64_t i, uint64_t gid,
+		    const bufferlist& b)
+    : MessageInstance(CEPH_MSG_WATCH_NOTIFY_BATCH, HEAD_VERSION,
+		      COMPAT_VERSION),
+      ver(v),
+      notify_id(i),
+      notifier_gid(gid),
+      bl(b) {}
+
+  /// the MWatchNotify the watch with the given cookie would have got
+  MWatchNotify::ref get_notify(uint64_t cookie) const {
+    auto m = MWatchNotify::create(cookie, ver, notify_id,
+				  CEPH_WATCH_EVENT_NOTIFY, bl);
+    m->notifier_gid = notifier_gid;
+    m->set_connection(get_connection());
+    return m;
+  }
+
+private:
+  ~MWatchNotifyBatch() override {}
+
+public:
+  const char *get_type_name() const override { return "watch-notify-batch"; }
+  void print(ostream& out) const override {
+    out << "watch-notify-batch(notify " << notify_id << " "
+	<< cookies.size() << " cookies)";
+  }
+
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    encode(ver, payload);
+    encode(notify_id, payload);
+    encode(notifier_gid, payload);
+    encode(bl, payload);
+    encode(cookies, payload);
+  }
+  void decode_payload() override {
+    auto p = payload.cbegin();
+    decode(ver, p);
+    decode(notify_id, p);
+    decode(notifier_gid, p);
+    decode(bl, p);
+    decode(cookies, p);
+  }
+};
+
+#endif
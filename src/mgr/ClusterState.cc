@@ -69,6 +69,11 @@ void ClusterState::ingest_pgstats(MPGStats *stats)
   Mutex::Locker l(lock);
 
   const int from = stats->get_orig_source().num();
+  // a delta report (!stats->full) only carries the pgs whose stats
+  // changed; pg_map keeps what the osd reported earlier for the rest
+  dout(10) << " osd." << from << (stats->full ? " full" : " delta")
+	   << " report of " << stats->pg_stat.size() << " pgs, "
+	   << stats->get_payload().length() << " bytes" << dendl;
 
   pending_inc.update_stat(from, std::move(stats->osd_stat));
 
@@ -366,7 +366,9 @@ void MgrClient::send_pgstats()
 void MgrClient::_send_pgstats()
 {
   if (pgstats_cb && session) {
-    session->con->send_message(pgstats_cb());
+    session->con->send_message(
+      pgstats_cb(session->con->get_features(), !session->pgstats_synced));
+    session->pgstats_synced = true;
   }
 }
 
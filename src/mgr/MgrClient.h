@@ -43,6 +43,9 @@ class MgrSessionState
 
   // Our connection to the mgr
   ConnectionRef con;
+
+  // Has this mgr received a full set of pg stats from us?
+  bool pgstats_synced = false;
 };
 
 class MgrCommand : public CommandOp
@@ -79,8 +82,9 @@ protected:
   Context *connect_retry_callback = nullptr;
 
   // If provided, use this to compose an MPGStats to send with
-  // our reports (hook for use by OSD)
-  std::function<MPGStats*()> pgstats_cb;
+  // our reports (hook for use by OSD).  Called with the session's
+  // features and whether the mgr needs every pg's stats.
+  std::function<MPGStats*(uint64_t, bool)> pgstats_cb;
   std::function<void(const std::list<OSDPerfMetricQuery> &)> set_perf_queries_cb;
   std::function<void(OSDPerfMetricReport *)> get_perf_report_cb;
 
@@ -131,7 +135,7 @@ public:
 
 
   void send_pgstats();
-  void set_pgstats_cb(std::function<MPGStats*()>&& cb_)
+  void set_pgstats_cb(std::function<MPGStats*(uint64_t, bool)>&& cb_)
   {
     Mutex::Locker l(lock);
     pgstats_cb = std::move(cb_);
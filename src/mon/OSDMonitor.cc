@@ -476,6 +476,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     OSDMap::Incremental inc(inc_bl);
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
+    mapping.note_incremental(inc);
 
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
@@ -610,7 +611,8 @@ void OSDMonitor::start_mapping()
     mapping_job = mapping.start_update(osdmap, mapper,
 				       g_conf()->mon_osd_mapping_pgs_per_chunk);
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
-	     << " at " << fin->start << dendl;
+	     << " at " << fin->start << " for " << mapping.get_num_update_pgs()
+	     << "/" << mapping.get_num_pgs() << " pgs" << dendl;
     mapping_job->set_finish_event(fin);
   } else {
     dout(10) << __func__ << " no pools, no mapping job" << dendl;
@@ -2549,6 +2551,18 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
   utime_t max_failed_since = fi.get_failed_since();
   utime_t failed_for = now - max_failed_since;
 
+  // reporters running the phi accrual detector have already judged the
+  // silence to be unusual for this peer; if all of them did, the fixed
+  // grace is theirs to replace and only the laggy corrections remain.
+  bool all_phi = std::all_of(
+    fi.reporters.begin(), fi.reporters.end(),
+    [](const pair<const int, failure_reporter_t>& p) {
+      return p.second.phi;
+    });
+  if (all_phi) {
+    orig_grace = utime_t();
+  }
+
   utime_t grace = orig_grace;
   double my_grace = 0, peer_grace = 0;
   double decay_k = 0;
@@ -2598,7 +2612,7 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
   }
 
   dout(10) << " osd." << target_osd << " has "
-	   << fi.reporters.size() << " reporters, "
+	   << fi.reporters.size() << (all_phi ? " phi" : "") << " reporters, "
 	   << grace << " grace (" << orig_grace << " + " << my_grace
 	   << " + " << peer_grace << "), max_failed_since " << max_failed_since
 	   << dendl;
@@ -2673,7 +2687,8 @@ bool OSDMonitor::prepare_failure(MonOpRequestRef op)
 		      << m->get_orig_source();
 
     failure_info_t& fi = failure_info[target_osd];
-    MonOpRequestRef old_op = fi.add_report(reporter, failed_since, op);
+    MonOpRequestRef old_op = fi.add_report(reporter, failed_since, op,
+					   m->is_phi());
     if (old_op) {
       mon->no_reply(old_op);
     }
@@ -3003,8 +3018,8 @@ bool OSDMonitor::prepare_boot(MonOpRequestRef op)
 	(g_conf()->mon_osd_auto_mark_new_in && (oldstate & CEPH_OSD_NEW)) ||
 	(g_conf()->mon_osd_auto_mark_in)) {
       if (can_mark_in(from)) {
-	if (osdmap.osd_xinfo[from].old_weight > 0) {
-	  pending_inc.new_weight[from] = osdmap.osd_xinfo[from].old_weight;
+	if (osdmap.get_xinfo(from).old_weight > 0) {
+	  pending_inc.new_weight[from] = osdmap.get_xinfo(from).old_weight;
 	  xi.old_weight = 0;
 	} else {
 	  pending_inc.new_weight[from] = CEPH_OSD_IN;
@@ -4371,7 +4386,7 @@ void OSDMonitor::tick()
 
 	  // remember previous weight
 	  if (pending_inc.new_xinfo.count(o) == 0)
-	    pending_inc.new_xinfo[o] = osdmap.osd_xinfo[o];
+	    pending_inc.new_xinfo[o] = osdmap.get_xinfo(o);
 	  pending_inc.new_xinfo[o].old_weight = osdmap.osd_weight[o];
 
 	  do_propose = true;
@@ -4389,8 +4404,8 @@ void OSDMonitor::tick()
   }
 
   // expire blacklisted items?
-  for (ceph::unordered_map<entity_addr_t,utime_t>::iterator p = osdmap.blacklist.begin();
-       p != osdmap.blacklist.end();
+  for (auto p = osdmap.blacklist->begin();
+       p != osdmap.blacklist->end();
        ++p) {
     if (p->second < now) {
       dout(10) << "expiring blacklist item " << p->first << " expired " << p->second << " < now " << now << dendl;
@@ -4499,7 +4514,8 @@ namespace {
     RECOVERY_PRIORITY, RECOVERY_OP_PRIORITY, SCRUB_PRIORITY,
     COMPRESSION_MODE, COMPRESSION_ALGORITHM, COMPRESSION_REQUIRED_RATIO,
     COMPRESSION_MAX_BLOB_SIZE, COMPRESSION_MIN_BLOB_SIZE,
-    CSUM_TYPE, CSUM_MAX_BLOCK, CSUM_MIN_BLOCK, FINGERPRINT_ALGORITHM };
+    CSUM_TYPE, CSUM_MAX_BLOCK, CSUM_MIN_BLOCK, FINGERPRINT_ALGORITHM,
+    QOS_RESERVATION, QOS_WEIGHT, QOS_LIMIT };
 
   std::set<osd_pool_get_choices>
     subtract_second_from_first(const std::set<osd_pool_get_choices>& first,
@@ -4957,8 +4973,8 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
     if (f)
       f->open_array_section("blacklist");
 
-    for (ceph::unordered_map<entity_addr_t,utime_t>::iterator p = osdmap.blacklist.begin();
-	 p != osdmap.blacklist.end();
+    for (auto p = osdmap.blacklist->begin();
+	 p != osdmap.blacklist->end();
 	 ++p) {
       if (f) {
 	f->open_object_section("entry");
@@ -4978,7 +4994,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       f->close_section();
       f->flush(rdata);
     }
-    ss << "listed " << osdmap.blacklist.size() << " entries";
+    ss << "listed " << osdmap.blacklist->size() << " entries";
 
   } else if (prefix == "osd pool ls") {
     string detail;
@@ -5090,6 +5106,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       {"csum_max_block", CSUM_MAX_BLOCK},
       {"csum_min_block", CSUM_MIN_BLOCK},
       {"fingerprint_algorithm", FINGERPRINT_ALGORITHM},
+      {"qos_reservation", QOS_RESERVATION},
+      {"qos_weight", QOS_WEIGHT},
+      {"qos_limit", QOS_LIMIT},
     };
 
     typedef std::set<osd_pool_get_choices> choices_set_t;
@@ -5297,6 +5316,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case CSUM_MAX_BLOCK:
 	  case CSUM_MIN_BLOCK:
 	  case FINGERPRINT_ALGORITHM:
+	  case QOS_RESERVATION:
+	  case QOS_WEIGHT:
+	  case QOS_LIMIT:
             pool_opts_t::key_t key = pool_opts_t::get_opt_desc(i->first).key;
             if (p->opts.is_set(key)) {
               if(*it == CSUM_TYPE) {
@@ -5446,6 +5468,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case CSUM_MAX_BLOCK:
 	  case CSUM_MIN_BLOCK:
 	  case FINGERPRINT_ALGORITHM:
+	  case QOS_RESERVATION:
+	  case QOS_WEIGHT:
+	  case QOS_LIMIT:
 	    for (i = ALL_CHOICES.begin(); i != ALL_CHOICES.end(); ++i) {
 	      if (i->second == *it)
 		break;
@@ -7095,7 +7120,16 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
 	p.hit_set_params = HitSet::Params(new ExplicitHashHitSet::Params);
       else if (val == "explicit_object")
 	p.hit_set_params = HitSet::Params(new ExplicitObjectHitSet::Params);
-      else {
+      else if (val == "counting") {
+	if (osdmap.require_osd_release < CEPH_RELEASE_NAUTILUS) {
+	  ss << "the counting hit_set type requires"
+	     << " require_osd_release >= nautilus";
+	  return -EPERM;
+	}
+	CountingHitSet::Params *csp = new CountingHitSet::Params;
+	csp->set_decay(g_conf().get_val<double>("osd_pool_default_hit_set_counting_decay"));
+	p.hit_set_params = HitSet::Params(csp);
+      } else {
 	ss << "unrecognized hit_set type '" << val << "'";
 	return -EINVAL;
       }
@@ -7301,6 +7335,22 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
 	  return -EINVAL;
         }
       }
+    } else if (var == "qos_reservation" ||
+               var == "qos_weight" ||
+               var == "qos_limit") {
+      if (floaterr.length()) {
+        ss << "error parsing float value '" << val << "': " << floaterr;
+        return -EINVAL;
+      }
+      if (var == "qos_weight") {
+        if (f <= 0) {
+          ss << var << " must be > 0: '" << val << "'";
+          return -EINVAL;
+        }
+      } else if (f < 0) {
+        ss << var << " must be >= 0: '" << val << "'";
+        return -EINVAL;
+      }
     }
 
     pool_opts_t::opt_desc_t desc = pool_opts_t::get_opt_desc(var);
@@ -10089,7 +10139,7 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
 	    pending_inc.new_weight[osd] = CEPH_OSD_OUT;
 	    if (osdmap.osd_weight[osd]) {
 	      if (pending_inc.new_xinfo.count(osd) == 0) {
-	        pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	        pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	      }
 	      pending_inc.new_xinfo[osd].old_weight = osdmap.osd_weight[osd];
 	    }
@@ -10113,10 +10163,10 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
             if (verbose)
 	      ss << "osd." << osd << " is already in. ";
 	  } else {
-	    if (osdmap.osd_xinfo[osd].old_weight > 0) {
-	      pending_inc.new_weight[osd] = osdmap.osd_xinfo[osd].old_weight;
+	    if (osdmap.get_xinfo(osd).old_weight > 0) {
+	      pending_inc.new_weight[osd] = osdmap.get_xinfo(osd).old_weight;
 	      if (pending_inc.new_xinfo.count(osd) == 0) {
-	        pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	        pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	      }
 	      pending_inc.new_xinfo[osd].old_weight = 0;
 	    } else {
@@ -12023,6 +12073,16 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
       hsp = HitSet::Params(new ExplicitHashHitSet::Params);
     } else if (cache_hit_set_type == "explicit_object") {
       hsp = HitSet::Params(new ExplicitObjectHitSet::Params);
+    } else if (cache_hit_set_type == "counting") {
+      if (osdmap.require_osd_release < CEPH_RELEASE_NAUTILUS) {
+	ss << "osd tier cache default hit set type 'counting' requires"
+	   << " require_osd_release >= nautilus";
+	err = -EPERM;
+	goto reply;
+      }
+      CountingHitSet::Params *csp = new CountingHitSet::Params;
+      csp->set_decay(g_conf().get_val<double>("osd_pool_default_hit_set_counting_decay"));
+      hsp = HitSet::Params(csp);
     } else {
       ss << "osd tier cache default hit set type '"
 	 << cache_hit_set_type << "' is not a known type";
@@ -12692,7 +12752,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap mappings for this pool
-  for (auto& p : osdmap.pg_upmap) {
+  for (auto& p : *osdmap.pg_upmap) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap "
@@ -12715,7 +12775,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap_items mappings for this pool
-  for (auto& p : osdmap.pg_upmap_items) {
+  for (auto& p : *osdmap.pg_upmap_items) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_items " << p.first
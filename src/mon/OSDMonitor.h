@@ -50,6 +50,7 @@ class MOSDMap;
 struct failure_reporter_t {
   utime_t failed_since;     ///< when they think it failed
   MonOpRequestRef op;       ///< failure op request
+  bool phi = false;         ///< judged by their phi detector, not the grace
 
   failure_reporter_t() {}
   explicit failure_reporter_t(utime_t s) : failed_since(s) {}
@@ -78,7 +79,7 @@ struct failure_info_t {
   // set the message for the latest report.  return any old op request we had,
   // if any, so we can discard it.
   MonOpRequestRef add_report(int who, utime_t failed_since,
-			     MonOpRequestRef op) {
+			     MonOpRequestRef op, bool phi = false) {
     map<int, failure_reporter_t>::iterator p = reporters.find(who);
     if (p == reporters.end()) {
       if (max_failed_since != utime_t() && max_failed_since < failed_since)
@@ -88,6 +89,7 @@ struct failure_info_t {
 
     MonOpRequestRef ret = p->second.op;
     p->second.op = op;
+    p->second.phi = phi;
     return ret;
   }
 
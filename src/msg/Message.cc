@@ -89,6 +89,7 @@
 #include "messages/MOSDPGScan.h"
 #include "messages/MOSDPGBackfill.h"
 #include "messages/MOSDBackoff.h"
+#include "messages/MOSDOpBatch.h"
 #include "messages/MOSDPGBackfillRemove.h"
 #include "messages/MOSDPGRecoveryDelete.h"
 #include "messages/MOSDPGRecoveryDeleteReply.h"
@@ -184,6 +185,7 @@
 #include "messages/MLock.h"
 
 #include "messages/MWatchNotify.h"
+#include "messages/MWatchNotifyBatch.h"
 #include "messages/MTimeCheck.h"
 #include "messages/MTimeCheck2.h"
 
@@ -494,6 +496,9 @@ Message *decode_message(CephContext *cct, int crcflags,
   case CEPH_MSG_OSD_BACKOFF:
     m = MOSDBackoff::create();
     break;
+  case CEPH_MSG_OSD_OP_BATCH:
+    m = MOSDOpBatch::create();
+    break;
 
   case CEPH_MSG_OSD_MAP:
     m = MOSDMap::create();
@@ -502,6 +507,9 @@ Message *decode_message(CephContext *cct, int crcflags,
   case CEPH_MSG_WATCH_NOTIFY:
     m = MWatchNotify::create();
     break;
+  case CEPH_MSG_WATCH_NOTIFY_BATCH:
+    m = MWatchNotifyBatch::create();
+    break;
 
   case MSG_OSD_PG_NOTIFY:
     m = MOSDPGNotify::create();
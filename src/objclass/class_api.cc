@@ -204,6 +204,13 @@ int cls_get_request_origin(cls_method_context_t hctx, entity_inst_t *origin)
   return 0;
 }
 
+int cls_get_request_object(cls_method_context_t hctx, hobject_t *obj)
+{
+  PrimaryLogPG::OpContext **pctx = static_cast<PrimaryLogPG::OpContext **>(hctx);
+  *obj = (*pctx)->obs->oi.soid;
+  return 0;
+}
+
 int cls_cxx_create(cls_method_context_t hctx, bool exclusive)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
@@ -224,21 +231,11 @@ int cls_cxx_remove(cls_method_context_t hctx)
 int cls_cxx_stat(cls_method_context_t hctx, uint64_t *size, time_t *mtime)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  int ret;
-  ops[0].op.op = CEPH_OSD_OP_STAT;
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
+  uint64_t s;
+  utime_t ut;
+  int ret = (*pctx)->pg->do_cls_stat(*pctx, &s, &ut);
   if (ret < 0)
     return ret;
-  auto iter = ops[0].outdata.cbegin();
-  utime_t ut;
-  uint64_t s;
-  try {
-    decode(s, iter);
-    decode(ut, iter);
-  } catch (buffer::error& err) {
-    return -EIO;
-  }
   if (size)
     *size = s;
   if (mtime)
@@ -249,25 +246,15 @@ int cls_cxx_stat(cls_method_context_t hctx, uint64_t *size, time_t *mtime)
 int cls_cxx_stat2(cls_method_context_t hctx, uint64_t *size, ceph::real_time *mtime)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  int ret;
-  ops[0].op.op = CEPH_OSD_OP_STAT;
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
+  uint64_t s;
+  utime_t ut;
+  int ret = (*pctx)->pg->do_cls_stat(*pctx, &s, &ut);
   if (ret < 0)
     return ret;
-  auto iter = ops[0].outdata.cbegin();
-  real_time ut;
-  uint64_t s;
-  try {
-    decode(s, iter);
-    decode(ut, iter);
-  } catch (buffer::error& err) {
-    return -EIO;
-  }
   if (size)
     *size = s;
   if (mtime)
-    *mtime = ut;
+    *mtime = ut.to_real_time();
   return 0;
 }
 
@@ -340,40 +327,24 @@ int cls_cxx_getxattr(cls_method_context_t hctx, const char *name,
                      bufferlist *outbl)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  bufferlist name_data;
-  vector<OSDOp> nops(1);
-  OSDOp& op = nops[0];
-  int r;
-
-  op.op.op = CEPH_OSD_OP_GETXATTR;
-  op.op.xattr.name_len = strlen(name);
-  op.indata.append(name, op.op.xattr.name_len);
-  r = (*pctx)->pg->do_osd_ops(*pctx, nops);
+  bufferlist bl;
+  int r = (*pctx)->pg->do_cls_getxattr(*pctx, name, &bl);
   if (r < 0)
     return r;
 
-  outbl->claim(op.outdata);
+  outbl->claim(bl);
   return outbl->length();
 }
 
 int cls_cxx_getxattrs(cls_method_context_t hctx, map<string, bufferlist> *attrset)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> nops(1);
-  OSDOp& op = nops[0];
-  int r;
-
-  op.op.op = CEPH_OSD_OP_GETXATTRS;
-  r = (*pctx)->pg->do_osd_ops(*pctx, nops);
+  map<string, bufferlist> out;
+  int r = (*pctx)->pg->do_cls_getxattrs(*pctx, &out);
   if (r < 0)
     return r;
 
-  auto iter = op.outdata.cbegin();
-  try {
-    decode(*attrset, iter);
-  } catch (buffer::error& err) {
-    return -EIO;
-  }
+  attrset->swap(out);
   return 0;
 }
 
@@ -408,104 +379,61 @@ int cls_cxx_snap_revert(cls_method_context_t hctx, snapid_t snapid)
 int cls_cxx_map_get_all_vals(cls_method_context_t hctx, map<string, bufferlist>* vals,
                              bool *more)
 {
-  PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  OSDOp& op = ops[0];
-  int ret;
-
-  string start_after;
-  string filter_prefix;
-  uint64_t max = (uint64_t)-1;
-
-  encode(start_after, op.indata);
-  encode(max, op.indata);
-  encode(filter_prefix, op.indata);
-
-  op.op.op = CEPH_OSD_OP_OMAPGETVALS;
-  
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
-  if (ret < 0)
-    return ret;
-
-  auto iter = op.outdata.cbegin();
-  try {
-    decode(*vals, iter);
-    decode(*more, iter);
-  } catch (buffer::error& err) {
-    return -EIO;
-  }
-  return vals->size();
+  return cls_cxx_map_get_vals(hctx, string(), string(), (uint64_t)-1,
+			      vals, more);
 }
 
 int cls_cxx_map_get_keys(cls_method_context_t hctx, const string &start_obj,
 			 uint64_t max_to_get, set<string> *keys,
                          bool *more)
 {
-  PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  OSDOp& op = ops[0];
-  int ret;
-
-  encode(start_obj, op.indata);
-  encode(max_to_get, op.indata);
-
-  op.op.op = CEPH_OSD_OP_OMAPGETKEYS;
-
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
-  if (ret < 0)
-    return ret;
-
-  auto iter = op.outdata.cbegin();
-  try {
-    decode(*keys, iter);
-    decode(*more, iter);
-  } catch (buffer::error& err) {
-    return -EIO;
-  }
-  return keys->size();
+  keys->clear();
+  return cls_cxx_map_iterate(
+    hctx, start_obj, string(), max_to_get, false,
+    [keys](const string& key, bufferlist& val) {
+      keys->insert(keys->end(), key);
+    },
+    more);
 }
 
 int cls_cxx_map_get_vals(cls_method_context_t hctx, const string &start_obj,
 			 const string &filter_prefix, uint64_t max_to_get,
 			 map<string, bufferlist> *vals, bool *more)
 {
-  PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  OSDOp& op = ops[0];
-  int ret;
-
-  encode(start_obj, op.indata);
-  encode(max_to_get, op.indata);
-  encode(filter_prefix, op.indata);
-
-  op.op.op = CEPH_OSD_OP_OMAPGETVALS;
-  
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
-  if (ret < 0)
-    return ret;
+  vals->clear();
+  return cls_cxx_map_iterate(
+    hctx, start_obj, filter_prefix, max_to_get, true,
+    [vals](const string& key, bufferlist& val) {
+      (*vals)[key].claim(val);
+    },
+    more);
+}
 
-  auto iter = op.outdata.cbegin();
-  try {
-    decode(*vals, iter);
-    decode(*more, iter);
-  } catch (buffer::error& err) {
-    return -EIO;
-  }
-  return vals->size();
+int cls_cxx_map_iterate(cls_method_context_t hctx, const string &start_after,
+			const string &filter_prefix, uint64_t max_to_get,
+			bool with_values,
+			const std::function<void(const string&, bufferlist&)>& f,
+			bool *more)
+{
+  PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
+  bool truncated = false;
+  int ret = (*pctx)->pg->do_cls_omap_iterate(
+    *pctx, start_after, filter_prefix, max_to_get, with_values, f,
+    &truncated);
+  if (more)
+    *more = truncated;
+  return ret;
 }
 
 int cls_cxx_map_read_header(cls_method_context_t hctx, bufferlist *outbl)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  OSDOp& op = ops[0];
-  int ret;
-  op.op.op = CEPH_OSD_OP_OMAPGETHEADER;
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
+  bufferlist bl;
+  int ret = (*pctx)->pg->do_cls_omap_get_header(*pctx, &bl);
   if (ret < 0)
     return ret;
 
-  outbl->claim(op.outdata);
+  outbl->claim(bl);
 
   return 0;
 }
@@ -514,35 +442,30 @@ int cls_cxx_map_get_val(cls_method_context_t hctx, const string &key,
 			bufferlist *outbl)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
-  vector<OSDOp> ops(1);
-  OSDOp& op = ops[0];
-  int ret;
-
   set<string> k;
   k.insert(key);
-  encode(k, op.indata);
-
-  op.op.op = CEPH_OSD_OP_OMAPGETVALSBYKEYS;
-  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
+  map<string, bufferlist> m;
+  int ret = (*pctx)->pg->do_cls_omap_get_vals_by_keys(*pctx, k, &m);
   if (ret < 0)
     return ret;
 
-  auto iter = op.outdata.cbegin();
-  try {
-    map<string, bufferlist> m;
-
-    decode(m, iter);
-    map<string, bufferlist>::iterator iter = m.begin();
-    if (iter == m.end())
-      return -ENOENT;
+  map<string, bufferlist>::iterator iter = m.begin();
+  if (iter == m.end())
+    return -ENOENT;
 
-    *outbl = iter->second;
-  } catch (buffer::error& e) {
-    return -EIO;
-  }
+  *outbl = iter->second;
   return 0;
 }
 
+int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
+				 const set<string> &keys,
+				 map<string, bufferlist> *vals)
+{
+  PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
+  vals->clear();
+  return (*pctx)->pg->do_cls_omap_get_vals_by_keys(*pctx, keys, vals);
+}
+
 int cls_cxx_map_set_val(cls_method_context_t hctx, const string &key,
 			bufferlist *inbl)
 {
@@ -698,6 +621,11 @@ int8_t cls_get_required_osd_release(cls_method_context_t hctx)
   return ctx->pg->get_osdmap()->require_osd_release;
 }
 
+int cls_get_config_value(const std::string &name, std::string *val)
+{
+  return ch->cct->_conf.get_val(name, val);
+}
+
 void cls_cxx_subop_version(cls_method_context_t hctx, string *s)
 {
   if (!s)
@@ -6,6 +6,8 @@
 
 #ifdef __cplusplus
 
+#include <functional>
+
 #include "../include/types.h"
 #include "msg/msg_types.h"
 #include "common/hobject.h"
@@ -45,6 +47,10 @@ extern int cls_setxattr(cls_method_context_t hctx, const char *name,
  * request which activated your class call. */
 extern int cls_get_request_origin(cls_method_context_t hctx,
                                   entity_inst_t *origin);
+/** This will fill in the passed obj pointer with the object (pool,
+ * namespace and name) your class call operates on. */
+extern int cls_get_request_object(cls_method_context_t hctx,
+                                  hobject_t *obj);
 
 /* class registration api */
 extern int cls_unregister(cls_handle_t);
@@ -143,6 +149,24 @@ extern int cls_cxx_map_set_vals(cls_method_context_t hctx,
 extern int cls_cxx_map_write_header(cls_method_context_t hctx, bufferlist *inbl);
 extern int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key);
 extern int cls_cxx_map_update(cls_method_context_t hctx, bufferlist *inbl);
+extern int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
+                                        const std::set<string> &keys,
+                                        std::map<string, bufferlist> *vals);
+/**
+ * Visit omap entries in place, without collecting them into a container
+ *
+ * Calls f with each key after start_after that begins with filter_prefix
+ * (and its value, if with_values), up to max_to_get entries.
+ *
+ * @returns number of entries visited, or negative error code
+ */
+extern int cls_cxx_map_iterate(cls_method_context_t hctx,
+                               const string &start_after,
+                               const string &filter_prefix,
+                               uint64_t max_to_get,
+                               bool with_values,
+                               const std::function<void(const string&, bufferlist&)>& f,
+                               bool *more);
 
 extern int cls_cxx_list_watchers(cls_method_context_t hctx,
 				 obj_list_watch_response_t *watchers);
@@ -157,6 +181,8 @@ extern int cls_current_subop_num(cls_method_context_t hctx);
 extern uint64_t cls_get_features(cls_method_context_t hctx);
 extern uint64_t cls_get_client_features(cls_method_context_t hctx);
 extern int8_t cls_get_required_osd_release(cls_method_context_t hctx);
+/** fetch the string value of the OSD config option name */
+extern int cls_get_config_value(const std::string &name, std::string *val);
 
 /* helpers */
 extern void cls_cxx_subop_version(cls_method_context_t hctx, string *s);
@@ -117,6 +117,34 @@ public:
    */
   virtual const PerfCounters* get_perf_counters() const = 0;
 
+  /**
+   * Fetch running totals of completed writes.
+   *
+   * Used by the OSD to model what an op costs on this store.
+   *
+   * @param ops [out] number of write transactions committed
+   * @param bytes [out] number of bytes written
+   * @param lat_ns [out] total commit latency of those transactions
+   * @return false if the store does not track them
+   */
+  virtual bool get_write_stats(uint64_t *ops, uint64_t *bytes,
+			       uint64_t *lat_ns) const {
+    return false;
+  }
+
+  /**
+   * Fetch how busy the devices backing the store are.
+   *
+   * Used by the OSD to throttle recovery against device saturation.
+   *
+   * @param util [out] fraction of the time since the previous call
+   *        that the busiest device had IO in flight
+   * @return false if the store does not know (or on the first call)
+   */
+  virtual bool get_device_utilization(double *util) {
+    return false;
+  }
+
   /**
    * a collection also orders transactions
    *
@@ -1686,6 +1714,39 @@ public:
      bufferlist& bl,
      uint32_t op_flags = 0) = 0;
 
+  /**
+   * verify_and_summarize -- verify object data and extend a digest over it
+   *
+   * Reads a byte range like read(), verifying it against whatever integrity
+   * metadata the store keeps, but rather than returning the data extends the
+   * crc32c in *digest over it.  The result is identical to
+   * bufferlist::crc32c(*digest) over the bytes read() would return; stores
+   * that keep crc32c checksums of their data may derive it from those
+   * instead of hashing the data a second time.
+   *
+   * @param c collection
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   * @param digest [in,out] crc32c seed, extended over the data on success
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @returns number of bytes summarized on success, or negative error code on failure.
+   */
+  virtual int verify_and_summarize(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *digest,
+    uint32_t op_flags = 0) {
+    bufferlist bl;
+    int r = read(c, oid, offset, len, bl, op_flags);
+    if (r > 0) {
+      *digest = bl.crc32c(*digest);
+    }
+    return r;
+  }
+
   /**
    * fiemap -- get extent map of data of an object
    *
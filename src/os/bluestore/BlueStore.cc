@@ -27,6 +27,7 @@
 #include "include/stringify.h"
 #include "include/str_map.h"
 #include "common/errno.h"
+#include "common/blkdev.h"
 #include "common/safe_io.h"
 #include "common/PriorityCache.h"
 #include "Allocator.h"
@@ -4317,6 +4318,12 @@ void BlueStore::_init_logger()
                     "Read operations that required at least one retry due to failed checksum validation");
   b.add_u64(l_bluestore_fragmentation, "bluestore_fragmentation_micros",
             "How fragmented bluestore free space is (free extents / max possible number of free extents) * 1000");
+  b.add_u64_counter(l_bluestore_summarize_csum_bytes,
+		    "bluestore_summarize_csum_bytes",
+		    "Bytes summarized for scrub from stored checksums");
+  b.add_u64_counter(l_bluestore_summarize_hashed_bytes,
+		    "bluestore_summarize_hashed_bytes",
+		    "Bytes summarized for scrub by hashing the data");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -7369,6 +7376,113 @@ int BlueStore::read(
   return r;
 }
 
+int BlueStore::verify_and_summarize(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  uint32_t *digest,
+  uint32_t op_flags)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  const coll_t &cid = c->get_cid();
+  dout(15) << __func__ << " " << cid << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << dendl;
+  if (!c->exists)
+    return -ENOENT;
+
+  uint32_t crc = *digest;
+  int r;
+  {
+    RWLock::RLocker l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      r = -ENOENT;
+      goto out;
+    }
+
+    // _do_read verifies every blob it reads from disk against its csums;
+    // summarize while we still hold the collection lock so that the
+    // extent map still describes the data we read.
+    bufferlist bl;
+    r = _do_read(c, o, offset, length, bl, op_flags);
+    if (r == -EIO) {
+      logger->inc(l_bluestore_read_eio);
+    } else if (r > 0) {
+      crc = _summarize_read(o, offset, bl, crc);
+    }
+  }
+
+ out:
+  if (r >= 0 && _debug_data_eio(oid)) {
+    r = -EIO;
+    derr << __func__ << " " << c->cid << " " << oid << " INJECT EIO" << dendl;
+  }
+  if (r >= 0) {
+    *digest = crc;
+  }
+  dout(10) << __func__ << " " << cid << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length
+	   << " digest 0x" << crc << std::dec
+	   << " = " << r << dendl;
+  return r;
+}
+
+uint32_t BlueStore::_summarize_read(
+  OnodeRef o,
+  uint64_t offset,
+  const bufferlist& bl,
+  uint32_t crc)
+{
+  // crc32c is linear in its seed, so for any buffer b of length n
+  //   crc32c(seed, b) = crc32c(-1, b) ^ crc32c(seed ^ -1, <n zeros>)
+  // and crc32c(-1, b) is exactly what a CSUM_CRC32C blob stores for each
+  // csum chunk.  Fold those in for every chunk the range covers whole and
+  // only hash the remainder.
+  uint64_t end = offset + bl.length();
+  uint64_t pos = offset;
+  uint64_t from_csum = 0;
+  auto p = bl.begin();
+  o->extent_map.fault_range(db, offset, bl.length());
+  for (auto lp = o->extent_map.seek_lextent(offset);
+       lp != o->extent_map.extent_map.end() && lp->logical_offset < end;
+       ++lp) {
+    const bluestore_blob_t& blob = lp->blob->get_blob();
+    if (blob.csum_type != Checksummer::CSUM_CRC32C || blob.is_compressed()) {
+      continue;
+    }
+    uint64_t chunk = blob.get_csum_chunk_size();
+    uint64_t l_start = std::max(pos, (uint64_t)lp->logical_offset);
+    uint64_t l_end = std::min(end, (uint64_t)lp->logical_end());
+    uint64_t b_start = p2roundup(
+      l_start - lp->logical_offset + lp->blob_offset, chunk);
+    uint64_t b_end = p2align(
+      l_end - lp->logical_offset + lp->blob_offset, chunk);
+    if (b_start >= b_end) {
+      continue;
+    }
+    uint64_t c_start = b_start - lp->blob_offset + lp->logical_offset;
+    if (c_start > pos) {
+      crc = p.crc32c(c_start - pos, crc);
+      pos = c_start;
+    }
+    for (uint64_t b = b_start; b < b_end; b += chunk) {
+      crc = (uint32_t)blob.get_csum_item(b / chunk) ^
+	ceph_crc32c_zeros(crc ^ (uint32_t)-1, chunk);
+    }
+    p.advance(b_end - b_start);
+    pos += b_end - b_start;
+    from_csum += b_end - b_start;
+  }
+  if (pos < end) {
+    crc = p.crc32c(end - pos, crc);
+  }
+  logger->inc(l_bluestore_summarize_csum_bytes, from_csum);
+  logger->inc(l_bluestore_summarize_hashed_bytes, bl.length() - from_csum);
+  return crc;
+}
+
 // --------------------------------------------------------
 // intermediate data structures used while reading
 struct region_t {
@@ -8855,6 +8969,46 @@ void BlueStore::_txc_write_nodes(TransContext *txc, KeyValueDB::Transaction t)
   }
 }
 
+bool BlueStore::get_write_stats(uint64_t *ops, uint64_t *bytes,
+				uint64_t *lat_ns) const
+{
+  auto [count, sum] = logger->get_tavg_ns(l_bluestore_commit_lat);
+  *ops = count;
+  *lat_ns = sum;
+  *bytes = logger->get(l_bluestore_write_big_bytes) +
+    logger->get(l_bluestore_write_small_bytes);
+  return true;
+}
+
+bool BlueStore::get_device_utilization(double *util)
+{
+  set<string> devs;
+  get_devices(&devs);
+  auto now = mono_clock::now();
+  bool have = false;
+  double busiest = 0;
+  std::lock_guard l(device_util_lock);
+  for (auto& dev : devs) {
+    uint64_t ticks;
+    if (block_device_io_ticks(dev.c_str(), &ticks) < 0) {
+      continue;
+    }
+    auto p = device_util_last.find(dev);
+    if (p != device_util_last.end() &&
+	now > p->second.first &&
+	ticks >= p->second.second) {
+      double elapsed =
+	std::chrono::duration<double>(now - p->second.first).count();
+      busiest = std::max(busiest,
+			 (ticks - p->second.second) / 1000.0 / elapsed);
+      have = true;
+    }
+    device_util_last[dev] = make_pair(now, ticks);
+  }
+  *util = std::min(1.0, busiest);
+  return have;
+}
+
 void BlueStore::BSPerfTracker::update_from_perfcounters(
   PerfCounters &logger)
 {
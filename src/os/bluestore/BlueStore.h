@@ -123,6 +123,8 @@ enum {
   l_bluestore_read_eio,
   l_bluestore_reads_with_retries,
   l_bluestore_fragmentation,
+  l_bluestore_summarize_csum_bytes,
+  l_bluestore_summarize_hashed_bytes,
   l_bluestore_last
 };
 
@@ -1970,6 +1972,10 @@ private:
   ceph::mutex vstatfs_lock = ceph::make_mutex("BlueStore::vstatfs_lock");
   volatile_statfs vstatfs;
 
+  /// device -> (sample time, io ticks) as of the last get_device_utilization()
+  ceph::mutex device_util_lock = ceph::make_mutex("BlueStore::device_util_lock");
+  map<string, pair<mono_time, uint64_t>> device_util_last;
+
   struct MempoolThread : public Thread {
   public:
     BlueStore *store;
@@ -2408,6 +2414,22 @@ public:
     bufferlist& bl,
     uint32_t op_flags = 0,
     uint64_t retry_count = 0);
+  int verify_and_summarize(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *digest,
+    uint32_t op_flags = 0) override;
+
+private:
+  /// extend crc over bl, the contents of o at offset, using stored csums
+  uint32_t _summarize_read(
+    OnodeRef o,
+    uint64_t offset,
+    const bufferlist& bl,
+    uint32_t crc);
+public:
 
 private:
   int _fiemap(CollectionHandle &c_, const ghobject_t& oid,
@@ -2517,6 +2539,9 @@ public:
   const PerfCounters* get_perf_counters() const override {
     return logger;
   }
+  bool get_write_stats(uint64_t *ops, uint64_t *bytes,
+		       uint64_t *lat_ns) const override;
+  bool get_device_utilization(double *util) override;
 
   int queue_transactions(
     CollectionHandle& ch,
@@ -16,6 +16,7 @@
 
 #include "common/config.h"
 #include "common/debug.h"
+#include "common/perf_counters.h"
 
 #define dout_subsys ceph_subsys_osd
 #undef dout_prefix
@@ -83,6 +84,7 @@ int ClassHandler::open_all_classes()
 void ClassHandler::shutdown()
 {
   for (auto& cls : classes) {
+    cls.second.destroy_logger();
     if (cls.second.handle) {
       dlclose(cls.second.handle);
     }
@@ -204,6 +206,7 @@ int ClassHandler::_load_class(ClassData *cls)
 
   ldout(cct, 10) << "_load_class " << cls->name << " success" << dendl;
   cls->status = ClassData::CLASS_OPEN;
+  cls->create_logger();
   return 0;
 }
 
@@ -281,6 +284,33 @@ ClassHandler::ClassMethod *ClassHandler::ClassData::_get_method(const char *mnam
   return &(iter->second);
 }
 
+void ClassHandler::ClassData::create_logger()
+{
+  if (logger || methods_map.empty())
+    return;
+  PerfCountersBuilder plb(handler->cct, "cls-" + name, 0,
+			  methods_map.size() + 1);
+  int idx = 1;
+  for (auto& p : methods_map) {
+    // the counter keeps a pointer to its name; methods are not
+    // unregistered while the class is open
+    p.second.perf_idx = idx;
+    plb.add_time_avg(idx++, p.second.name.c_str(),
+		     "Calls and latency of the method");
+  }
+  logger = plb.create_perf_counters();
+  handler->cct->get_perfcounters_collection()->add(logger);
+}
+
+void ClassHandler::ClassData::destroy_logger()
+{
+  if (!logger)
+    return;
+  handler->cct->get_perfcounters_collection()->remove(logger);
+  delete logger;
+  logger = nullptr;
+}
+
 int ClassHandler::ClassData::get_method_flags(const char *mname)
 {
   Mutex::Locker l(handler->mutex);
@@ -321,6 +351,7 @@ void ClassHandler::ClassFilter::unregister()
 int ClassHandler::ClassMethod::exec(cls_method_context_t ctx, bufferlist& indata, bufferlist& outdata)
 {
   int ret;
+  auto start = ceph::mono_clock::now();
   if (cxx_func) {
     // C++ call version
     ret = cxx_func(ctx, &indata, &outdata);
@@ -335,6 +366,9 @@ int ClassHandler::ClassMethod::exec(cls_method_context_t ctx, bufferlist& indata
       outdata.push_back(bp);
     }
   }
+  if (perf_idx && cls->logger) {
+    cls->logger->tinc(perf_idx, ceph::mono_clock::now() - start);
+  }
   return ret;
 }
 
@@ -9,6 +9,7 @@
 
 //forward declaration
 class CephContext;
+class PerfCounters;
 
 class ClassHandler
 {
@@ -23,6 +24,7 @@ public:
     int flags;
     cls_method_call_t func;
     cls_method_cxx_call_t cxx_func;
+    int perf_idx;  ///< index of the latency counter in cls->logger
 
     int exec(cls_method_context_t ctx, bufferlist& indata, bufferlist& outdata);
     void unregister();
@@ -32,7 +34,7 @@ public:
       return flags;
     }
 
-    ClassMethod() : cls(0), flags(0), func(0), cxx_func(0) {}
+    ClassMethod() : cls(0), flags(0), func(0), cxx_func(0), perf_idx(0) {}
   };
 
   struct ClassFilter {
@@ -67,7 +69,12 @@ public:
     set<ClassData *> dependencies;         /* our dependencies */
     set<ClassData *> missing_dependencies; /* only missing dependencies */
 
+    /// per-method call count and latency, set once the class is open
+    PerfCounters *logger = nullptr;
+
     ClassMethod *_get_method(const char *mname);
+    void create_logger();
+    void destroy_logger();
 
     ClassData() : status(CLASS_UNKNOWN), 
 		  handler(NULL),
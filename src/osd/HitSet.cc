@@ -12,6 +12,9 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "HitSet.h"
 #include "common/Formatter.h"
 
@@ -37,6 +40,10 @@ HitSet::HitSet(const HitSet::Params& params)
     impl.reset(new ExplicitObjectHitSet(static_cast<ExplicitObjectHitSet::Params*>(params.impl.get())));
     break;
 
+  case TYPE_COUNTING:
+    impl.reset(new CountingHitSet(static_cast<CountingHitSet::Params*>(params.impl.get())));
+    break;
+
   default:
     assert (0 == "unknown HitSet type");
   }
@@ -71,6 +78,9 @@ void HitSet::decode(bufferlist::const_iterator& bl)
   case TYPE_BLOOM:
     impl.reset(new BloomHitSet);
     break;
+  case TYPE_COUNTING:
+    impl.reset(new CountingHitSet);
+    break;
   case TYPE_NONE:
     impl.reset(NULL);
     break;
@@ -105,6 +115,10 @@ void HitSet::generate_test_instances(list<HitSet*>& o)
   o.back()->insert(hobject_t());
   o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
   o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+  o.push_back(new HitSet(new CountingHitSet(10, 1)));
+  o.back()->insert(hobject_t());
+  o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+  o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
 }
 
 HitSet::Params::Params(const Params& o)
@@ -158,6 +172,9 @@ bool HitSet::Params::create_impl(impl_type_t type)
   case TYPE_BLOOM:
     impl.reset(new BloomHitSet::Params);
     break;
+  case TYPE_COUNTING:
+    impl.reset(new CountingHitSet::Params);
+    break;
   case TYPE_NONE:
     impl.reset(NULL);
     break;
@@ -203,6 +220,8 @@ void HitSet::Params::generate_test_instances(list<HitSet::Params*>& o)
   loop_hitset_params(ExplicitHashHitSet);
   o.push_back(new Params(new ExplicitObjectHitSet::Params));
   loop_hitset_params(ExplicitObjectHitSet);
+  o.push_back(new Params(new CountingHitSet::Params));
+  loop_hitset_params(CountingHitSet);
 }
 
 ostream& operator<<(ostream& out, const HitSet::Params& p) {
@@ -250,3 +269,118 @@ void BloomHitSet::dump(Formatter *f) const {
   bloom.dump(f);
   f->close_section();
 }
+
+void CountingHitSet::Params::dump(Formatter *f) const {
+  f->dump_int("target_size", target_size);
+  f->dump_float("decay", get_decay());
+  f->dump_int("seed", seed);
+}
+
+void CountingHitSet::get_positions(const hobject_t& o, uint32_t *pos) const
+{
+  // spread the 32-bit object hash over 64 bits (murmur3 finalizer) and
+  // derive the counter positions by double hashing
+  uint64_t h = ((uint64_t)seed << 32) | o.get_hash();
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  uint32_t h1 = h;
+  uint32_t h2 = (h >> 32) | 1;
+  for (unsigned i = 0; i < NUM_HASHES; ++i) {
+    pos[i] = (h1 + i * h2) % counters.size();
+  }
+}
+
+uint8_t CountingHitSet::get_min(const uint32_t *pos) const
+{
+  uint8_t m = counters[pos[0]];
+  for (unsigned i = 1; i < NUM_HASHES; ++i) {
+    m = std::min(m, counters[pos[i]]);
+  }
+  return m;
+}
+
+void CountingHitSet::insert(const hobject_t& o)
+{
+  ++count;
+  if (counters.empty()) {
+    return;
+  }
+  uint32_t pos[NUM_HASHES];
+  get_positions(o, pos);
+  uint8_t m = get_min(pos);
+  if (m == UINT8_MAX) {
+    return;
+  }
+  for (unsigned i = 0; i < NUM_HASHES; ++i) {
+    if (counters[pos[i]] == m) {
+      ++counters[pos[i]];
+    }
+  }
+}
+
+unsigned CountingHitSet::get_count(const hobject_t& o) const
+{
+  if (counters.empty()) {
+    return 0;
+  }
+  uint32_t pos[NUM_HASHES];
+  get_positions(o, pos);
+  return get_min(pos);
+}
+
+void CountingHitSet::decay(double factor)
+{
+  ceph_assert(factor >= 0.0 && factor <= 1.0);
+  // counts that drop below one are forgotten
+  for (auto& c : counters) {
+    c = (uint8_t)(c * factor);
+  }
+  count = (uint64_t)(count * factor);
+}
+
+unsigned CountingHitSet::approx_unique_insert_count() const
+{
+  // linear counting: each unique object sets up to NUM_HASHES counters
+  size_t zero = std::count(counters.begin(), counters.end(), 0);
+  if (zero == 0) {
+    return count;
+  }
+  double m = counters.size();
+  return std::min<double>(count, -m / NUM_HASHES * std::log(zero / m));
+}
+
+void CountingHitSet::encode(bufferlist &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(count, bl);
+  encode(target_size, bl);
+  encode(seed, bl);
+  encode((uint32_t)counters.size(), bl);
+  bl.append((const char *)counters.data(), counters.size());
+  ENCODE_FINISH(bl);
+}
+
+void CountingHitSet::decode(bufferlist::const_iterator& bl)
+{
+  DECODE_START(1, bl);
+  decode(count, bl);
+  decode(target_size, bl);
+  decode(seed, bl);
+  uint32_t n;
+  decode(n, bl);
+  counters.resize(n);
+  bl.copy(n, (char *)counters.data());
+  DECODE_FINISH(bl);
+}
+
+void CountingHitSet::dump(Formatter *f) const {
+  f->dump_unsigned("insert_count", count);
+  f->dump_unsigned("target_size", target_size);
+  f->dump_unsigned("seed", seed);
+  f->dump_unsigned("counters", counters.size());
+  f->dump_unsigned("approx_unique_insert_count",
+		   approx_unique_insert_count());
+}
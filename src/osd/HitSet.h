@@ -36,7 +36,8 @@ public:
     TYPE_NONE = 0,
     TYPE_EXPLICIT_HASH = 1,
     TYPE_EXPLICIT_OBJECT = 2,
-    TYPE_BLOOM = 3
+    TYPE_BLOOM = 3,
+    TYPE_COUNTING = 4
   } impl_type_t;
 
   static const char *get_type_name(impl_type_t t) {
@@ -45,6 +46,7 @@ public:
     case TYPE_EXPLICIT_HASH: return "explicit_hash";
     case TYPE_EXPLICIT_OBJECT: return "explicit_object";
     case TYPE_BLOOM: return "bloom";
+    case TYPE_COUNTING: return "counting";
     default: return "???";
     }
   }
@@ -61,6 +63,10 @@ public:
     virtual bool is_full() const = 0;
     virtual void insert(const hobject_t& o) = 0;
     virtual bool contains(const hobject_t& o) const = 0;
+    /// approximate number of times o was inserted
+    virtual unsigned get_count(const hobject_t& o) const {
+      return contains(o) ? 1 : 0;
+    }
     virtual unsigned insert_count() const = 0;
     virtual unsigned approx_unique_insert_count() const = 0;
     virtual void encode(bufferlist &bl) const = 0;
@@ -145,6 +151,10 @@ public:
   bool contains(const hobject_t& o) const {
     return impl->contains(o);
   }
+  /// approximate number of hits on an object
+  unsigned get_count(const hobject_t& o) const {
+    return impl->get_count(o);
+  }
 
   unsigned insert_count() const {
     return impl->insert_count();
@@ -450,4 +460,141 @@ public:
 };
 WRITE_CLASS_ENCODER(BloomHitSet)
 
+/**
+ * count hits per object in a counting filter whose counts decay
+ *
+ * Each object maps to NUM_HASHES 8-bit counters of a single array and
+ * its count is the smallest of them.  An insert only bumps the counters
+ * that hold that minimum (conservative update), which keeps the
+ * overestimate caused by collisions small.
+ *
+ * Rather than starting empty every period, the set is carried over
+ * into the next one with its counts scaled by the decay factor, so a
+ * single set tracks how often and how recently objects were accessed.
+ */
+class CountingHitSet : public HitSet::Impl {
+public:
+  /// counters per object the set is sized for
+  static const unsigned COUNTERS_PER_OBJECT = 4;
+  static const unsigned NUM_HASHES = 3;
+
+  HitSet::impl_type_t get_type() const override {
+    return HitSet::TYPE_COUNTING;
+  }
+
+  class Params : public HitSet::Params::Impl {
+  public:
+    HitSet::impl_type_t get_type() const override {
+      return HitSet::TYPE_COUNTING;
+    }
+    HitSet::Impl *get_new_impl() const override {
+      return new CountingHitSet(this);
+    }
+
+    uint64_t target_size;  ///< number of unique objects we expect to track
+    uint32_t decay_micro;  ///< fraction of a count kept per period / 1M
+    uint64_t seed;         ///< seed for the counter hashes
+
+    Params()
+      : target_size(0), decay_micro(0), seed(0) {}
+    Params(uint64_t t, double d, uint64_t s)
+      : target_size(t), decay_micro(d * 1000000.0), seed(s) {}
+    Params(const Params &o)
+      : target_size(o.target_size),
+	decay_micro(o.decay_micro),
+	seed(o.seed) {}
+    ~Params() override {}
+
+    double get_decay() const {
+      return (double)decay_micro / 1000000.0;
+    }
+    void set_decay(double d) {
+      decay_micro = (unsigned)(llrintl(d * 1000000.0));
+    }
+
+    void encode(bufferlist& bl) const override {
+      ENCODE_START(1, 1, bl);
+      encode(target_size, bl);
+      encode(decay_micro, bl);
+      encode(seed, bl);
+      ENCODE_FINISH(bl);
+    }
+    void decode(bufferlist::const_iterator& bl) override {
+      DECODE_START(1, bl);
+      decode(target_size, bl);
+      decode(decay_micro, bl);
+      decode(seed, bl);
+      DECODE_FINISH(bl);
+    }
+    void dump(Formatter *f) const override;
+    void dump_stream(ostream& o) const override {
+      o << "target_size: " << target_size
+	<< ", decay: " << get_decay()
+	<< ", seed: " << seed;
+    }
+    static void generate_test_instances(list<Params*>& o) {
+      o.push_back(new Params);
+      o.push_back(new Params(300, .5, 99));
+    }
+  };
+
+private:
+  uint64_t count = 0;        ///< inserts, scaled down along with the counters
+  uint64_t target_size = 0;
+  uint32_t seed = 0;
+  std::vector<uint8_t> counters;
+
+  void get_positions(const hobject_t& o, uint32_t *pos) const;
+  uint8_t get_min(const uint32_t *pos) const;
+
+public:
+  CountingHitSet() {}
+  CountingHitSet(uint64_t target, uint32_t s)
+    : target_size(target),
+      seed(s),
+      counters(std::max<uint64_t>(target, 1) * COUNTERS_PER_OBJECT)
+  {}
+  explicit CountingHitSet(const CountingHitSet::Params *p)
+    : CountingHitSet(p->target_size, p->seed)
+  {}
+  CountingHitSet(const CountingHitSet &o) = default;
+
+  HitSet::Impl *clone() const override {
+    return new CountingHitSet(*this);
+  }
+
+  uint64_t get_target_size() const {
+    return target_size;
+  }
+  /// scale all counts by factor, in [0, 1]
+  void decay(double factor);
+
+  bool is_full() const override {
+    // counts age out through decay(); the set never needs replacing
+    return false;
+  }
+  void insert(const hobject_t& o) override;
+  bool contains(const hobject_t& o) const override {
+    return get_count(o) > 0;
+  }
+  unsigned get_count(const hobject_t& o) const override;
+  unsigned insert_count() const override {
+    return count;
+  }
+  unsigned approx_unique_insert_count() const override;
+
+  void encode(bufferlist &bl) const override;
+  void decode(bufferlist::const_iterator& bl) override;
+  void dump(Formatter *f) const override;
+  static void generate_test_instances(list<CountingHitSet*>& o) {
+    o.push_back(new CountingHitSet);
+    o.push_back(new CountingHitSet(10, 1));
+    o.back()->insert(hobject_t());
+    o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+    o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+    o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+  }
+};
+WRITE_CLASS_ENCODER(CountingHitSet)
+
 #endif
@@ -72,6 +72,7 @@
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "messages/MOSDBackoff.h"
+#include "messages/MOSDOpBatch.h"
 #include "messages/MOSDBeacon.h"
 #include "messages/MOSDRepOp.h"
 #include "messages/MOSDRepOpReply.h"
@@ -221,6 +222,7 @@ OSDService::OSDService(OSD *osd) :
   class_handler(osd->class_handler),
   osd_max_object_size(cct->_conf, "osd_max_object_size"),
   osd_skip_data_digest(cct->_conf, "osd_skip_data_digest"),
+  osd_op_cost_model(cct->_conf, "osd_op_cost_model"),
   publish_lock("OSDService::publish_lock"),
   pre_publish_lock("OSDService::pre_publish_lock"),
   max_oldest_map(0),
@@ -264,6 +266,11 @@ OSDService::OSDService(OSD *osd) :
   map_cache(cct, cct->_conf->osd_map_cache_size),
   map_bl_cache(cct->_conf->osd_map_cache_size),
   map_bl_inc_cache(cct->_conf->osd_map_cache_size),
+  obc_cache(cct,
+	    cct->_conf.get_val<uint64_t>("osd_object_context_cache_size"),
+	    cct->_conf.get_val<uint64_t>("osd_object_context_cache_shards")),
+  qos_tenants(cct),
+  op_cost_model(0),
   stat_lock("OSDService::stat_lock"),
   full_status_lock("OSDService::full_status_lock"),
   cur_state(NONE),
@@ -1263,6 +1270,110 @@ void OSDService::dec_scrubs_active()
   sched_scrub_lock.Unlock();
 }
 
+void OSDService::update_client_load(pair<uint64_t, uint64_t> op_lat,
+				    uint64_t op_wip)
+{
+  double lat_threshold =
+    cct->_conf.get_val<double>("osd_scrub_client_latency_threshold");
+  uint64_t wip_threshold =
+    cct->_conf.get_val<uint64_t>("osd_scrub_client_queue_threshold");
+  double trim_lat_target =
+    cct->_conf.get_val<double>("osd_snap_trim_client_latency_target");
+  double trim_sleep_min = cct->_conf->osd_snap_trim_sleep;
+  double trim_sleep_max =
+    cct->_conf.get_val<double>("osd_snap_trim_sleep_max");
+
+  Mutex::Locker l(sched_scrub_lock);
+  // latency of the ops completed since the last sample; an idle interval
+  // counts as zero latency so that the average decays
+  double lat = 0;
+  if (op_lat.second > client_last_op_lat.second &&
+      op_lat.first >= client_last_op_lat.first) {
+    lat = (double)(op_lat.first - client_last_op_lat.first) /
+      (op_lat.second - client_last_op_lat.second) / 1000000000.0;
+  }
+  client_last_op_lat = op_lat;
+  client_op_lat = (client_op_lat + lat) / 2;
+  client_op_wip = op_wip;
+
+  scrub_client_load = 0;
+  if (lat_threshold > 0) {
+    scrub_client_load = std::max(scrub_client_load,
+				 client_op_lat / lat_threshold);
+  }
+  if (wip_threshold > 0) {
+    scrub_client_load = std::max(scrub_client_load,
+				 (double)client_op_wip / wip_threshold);
+  }
+
+  // back off snap trimming quickly while clients see high latency and
+  // speed it back up gradually once they do not
+  if (trim_lat_target > 0) {
+    snap_trim_sleep = RecoveryThrottle::step_sleep(
+      client_op_lat > trim_lat_target, snap_trim_sleep,
+      trim_sleep_min, trim_sleep_max);
+  } else {
+    snap_trim_sleep = trim_sleep_min;
+  }
+}
+
+double OSDService::get_snap_trim_sleep_time()
+{
+  Mutex::Locker l(sched_scrub_lock);
+  return snap_trim_sleep;
+}
+
+void OSDService::update_pg_log_budget()
+{
+  // never shrink healthy logs below this fraction of the configured lengths
+  const double min_ratio = 0.1;
+  uint64_t target =
+    cct->_conf.get_val<Option::size_t>("osd_pg_log_memory_target");
+  if (!target) {
+    pg_log_budget_ratio = 1.0;
+    return;
+  }
+  uint64_t bytes = mempool::osd_pglog::allocated_bytes();
+  double ratio = pg_log_budget_ratio;
+  if (bytes > target) {
+    ratio *= (double)target / bytes;
+  } else if (bytes < target * 0.9) {
+    // give memory back slowly so that we do not oscillate
+    ratio *= 1.1;
+  }
+  ratio = std::min(1.0, std::max(min_ratio, ratio));
+  if (ratio != pg_log_budget_ratio) {
+    dout(10) << __func__ << " pg log " << byte_u_t(bytes)
+	     << " target " << byte_u_t(target)
+	     << " ratio " << pg_log_budget_ratio << " -> " << ratio << dendl;
+    pg_log_budget_ratio = ratio;
+  }
+}
+
+bool OSDService::scrub_client_load_permits()
+{
+  Mutex::Locker l(sched_scrub_lock);
+  if (scrub_client_load < 1.0) {
+    return true;
+  }
+  dout(20) << __func__ << " client op latency " << client_op_lat
+	   << " ops in progress " << client_op_wip
+	   << " (load " << scrub_client_load << ") = no" << dendl;
+  return false;
+}
+
+double OSDService::get_scrub_sleep_time()
+{
+  double sleep = cct->_conf->osd_scrub_sleep;
+  Mutex::Locker l(sched_scrub_lock);
+  if (scrub_client_load > 1.0) {
+    // ramp up to the full busy sleep as load reaches twice the threshold
+    sleep += cct->_conf.get_val<double>("osd_scrub_busy_sleep") *
+      std::min(scrub_client_load - 1.0, 1.0);
+  }
+  return sleep;
+}
+
 void OSDService::retrieve_epochs(epoch_t *_boot_epoch, epoch_t *_up_epoch,
                                  epoch_t *_bind_epoch) const
 {
@@ -1558,6 +1669,7 @@ void OSDService::reply_op_error(OpRequestRef op, int err, eversion_t v,
   MOSDOpReply *reply = new MOSDOpReply(m, err, osdmap->get_epoch(), flags, true);
   reply->set_reply_versions(v, uv);
   m->get_connection()->send_message(reply);
+  op->trace_point(OpRequest::TRACE_REPLIED);
 }
 
 void OSDService::handle_misdirected_op(PG *pg, OpRequestRef op)
@@ -2334,6 +2446,24 @@ will start to track new ops received afterwards.";
     }
 
     f->close_section(); //watchers
+  } else if (admin_command == "dump_heartbeat_peers") {
+    Mutex::Locker l(heartbeat_lock);
+    utime_t now = ceph_clock_now();
+    f->open_array_section("peers");
+    for (auto& [osd, hi] : heartbeat_peers) {
+      f->open_object_section("peer");
+      hi.dump(f, now);
+      f->close_section();
+    }
+    f->close_section();
+  } else if (admin_command == "dump_watched_objects") {
+    vector<PGRef> pgs;
+    _get_pgs(&pgs);
+    f->open_array_section("objects");
+    for (auto& pg : pgs) {
+      pg->dump_watched_objects(f);
+    }
+    f->close_section(); //objects
   } else if (admin_command == "dump_reservations") {
     f->open_object_section("reservations");
     f->open_object_section("local_reservations");
@@ -2765,6 +2895,15 @@ int OSD::init()
 
   create_logger();
 
+  service.op_cost_model.set_per_io_cost(
+    store_is_rotational ?
+    cct->_conf.get_val<Option::size_t>("osd_op_cost_per_io_hdd") :
+    cct->_conf.get_val<Option::size_t>("osd_op_cost_per_io_ssd"));
+  if (cct->_conf.get_val<bool>("osd_op_cost_model") &&
+      cct->_conf.get_val<bool>("osd_op_cost_calibrate_on_start")) {
+    calibrate_op_cost();
+  }
+
   // prime osd stats
   {
     struct store_statfs_t stbuf;
@@ -2790,7 +2929,9 @@ int OSD::init()
   if (r < 0)
     goto out;
 
-  mgrc.set_pgstats_cb([this](){ return collect_pg_stats(); });
+  mgrc.set_pgstats_cb([this](uint64_t features, bool resync) {
+      return collect_pg_stats(features, resync);
+    });
   mgrc.set_perf_metric_query_cb(
       [this](const std::list<OSDPerfMetricQuery> &queries){ set_perf_queries(queries);},
       [this](OSDPerfMetricReport *report){ get_perf_report(report);
@@ -2980,6 +3121,18 @@ void OSD::final_init()
 				     "show clients which have active watches,"
 				     " and on which objects");
   ceph_assert(r == 0);
+  r = admin_socket->register_command("dump_heartbeat_peers",
+				     "dump_heartbeat_peers",
+				     asok_hook,
+				     "show heartbeat round trip times and"
+				     " failure suspicion per peer");
+  ceph_assert(r == 0);
+  r = admin_socket->register_command("dump_watched_objects",
+				     "dump_watched_objects",
+				     asok_hook,
+				     "show watcher counts and notify latency"
+				     " of watched objects");
+  ceph_assert(r == 0);
   r = admin_socket->register_command("dump_reservations", "dump_reservations",
 				     asok_hook,
 				     "show recovery reservations");
@@ -3281,6 +3434,64 @@ void OSD::create_logger()
   osd_plb.add_time_avg(l_osd_op_before_dequeue_op_lat, "op_before_dequeue_op_lat",
     "Latency of IO before calling dequeue_op(already dequeued and get PG lock)"); // client io before dequeue_op latency
 
+  // Stage latencies of sampled client ops, see osd_op_trace_sample_rate
+  static_assert(l_osd_op_stage_done_lat - l_osd_op_stage_msgr_lat + 1 ==
+		OpRequest::TRACE_MAX, "one counter per trace point");
+  osd_plb.add_time_avg(
+    l_osd_op_stage_msgr_lat, "op_stage_msgr_latency",
+    "Sampled client ops: receive to dispatch", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_dispatch_lat, "op_stage_dispatch_latency",
+    "Sampled client ops: dispatch to queued for PG", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_queue_lat, "op_stage_queue_latency",
+    "Sampled client ops: queued to dequeued", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_pg_lat, "op_stage_pg_latency",
+    "Sampled client ops: dequeued to PG locked", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_prepare_lat, "op_stage_prepare_latency",
+    "Sampled client ops: PG locked to started", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_execute_lat, "op_stage_execute_latency",
+    "Sampled client ops: started to transaction submitted", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_commit_lat, "op_stage_commit_latency",
+    "Sampled client ops: submitted to committed", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_reply_lat, "op_stage_reply_latency",
+    "Sampled client ops: committed (or started, for reads) to reply sent",
+    NULL, PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_time_avg(
+    l_osd_op_stage_done_lat, "op_stage_done_latency",
+    "Sampled client ops: reply sent to op released", NULL,
+    PerfCountersBuilder::PRIO_USEFUL);
+  PerfHistogramCommon::axis_config_d stage_hist_x_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+    0,                               ///< Start at 0
+    1000,                            ///< Quantization unit is 1usec
+    24,                              ///< Enough to cover several seconds
+  };
+  PerfHistogramCommon::axis_config_d stage_hist_y_axis_config{
+    "Stage (msgr, dispatch, queue, pg, prepare, execute, commit, reply, done)",
+    PerfHistogramCommon::SCALE_LINEAR, ///< One bucket per stage
+    0,                                 ///< Start at 0
+    1,                                 ///< Quantization unit is 1
+    OpRequest::TRACE_MAX + 2,          ///< Stages plus under/overflow
+  };
+  osd_plb.add_u64_counter_histogram(
+    l_osd_op_stage_lat_hist, "op_stage_latency_histogram",
+    stage_hist_x_axis_config, stage_hist_y_axis_config,
+    "Histogram of stage latencies of sampled client ops");
+
   osd_plb.add_u64_counter(
     l_osd_sop, "subop", "Suboperations");
   osd_plb.add_u64_counter(
@@ -3311,6 +3522,83 @@ void OSD::create_logger()
     l_osd_rop, "recovery_ops",
     "Started recovery operations",
     "rop", PerfCountersBuilder::PRIO_INTERESTING);
+  osd_plb.add_u64_counter(
+    l_osd_recovery_objects, "recovery_objects",
+    "Objects recovered on all replicas");
+  osd_plb.add_u64_avg(
+    l_osd_push_batch_objects, "push_batch_objects",
+    "Objects per push message");
+  osd_plb.add_time_avg(
+    l_osd_backfill_scan_wait_lat, "backfill_scan_wait_latency",
+    "Backfill time blocked waiting for target scans");
+  osd_plb.add_time_avg(
+    l_osd_backfill_scan_local_lat, "backfill_scan_local_latency",
+    "Latency of listing local objects for backfill scans");
+  osd_plb.add_u64_counter(
+    l_osd_backfill_scan_prefetch_hit, "backfill_scan_prefetch_hit",
+    "Target backfill scans answered ahead of need");
+  osd_plb.add_u64_counter(
+    l_osd_scrub_load_deferred, "scrub_load_deferred",
+    "Scrub scheduling passes that deferred due scrubs because of load");
+  osd_plb.add_u64(
+    l_osd_pg_log_bytes, "pg_log_bytes",
+    "Memory used by PG logs, dups and their indexes", NULL, 0,
+    unit_t(UNIT_BYTES));
+  osd_plb.add_u64(
+    l_osd_pg_log_budget_pct, "pg_log_budget_pct",
+    "Percentage of configured PG log lengths kept under osd_pg_log_memory_target");
+  osd_plb.add_u64_counter(
+    l_osd_snap_trim_objects, "snap_trim_objects",
+    "Clones trimmed");
+  osd_plb.add_u64_counter(
+    l_osd_snap_trim_batches, "snap_trim_batches",
+    "Snap trim transactions");
+  osd_plb.add_u64_counter(
+    l_osd_notify, "notify",
+    "Notifies sent to watchers");
+  osd_plb.add_u64_counter(
+    l_osd_notify_watchers, "notify_watchers",
+    "Watchers included in notifies");
+  osd_plb.add_time_avg(
+    l_osd_notify_lat, "notify_latency",
+    "Time from notify until all watchers acked or it timed out");
+  osd_plb.add_u64_counter(
+    l_osd_notify_timeout, "notify_timeout",
+    "Notifies that timed out waiting for watchers");
+  osd_plb.add_u64_avg(
+    l_osd_notify_batch, "notify_batch",
+    "Notify messages sent for several watches on one connection");
+  osd_plb.add_u64_counter(
+    l_osd_pg_stats_full, "pg_stats_full",
+    "Full PG stats reports sent to the mgr");
+  osd_plb.add_u64_counter(
+    l_osd_pg_stats_delta, "pg_stats_delta",
+    "Delta PG stats reports sent to the mgr");
+  osd_plb.add_u64_counter(
+    l_osd_pg_stats_pgs, "pg_stats_pgs",
+    "PG stats sent to the mgr");
+  osd_plb.add_u64_avg(
+    l_osd_pg_stats_bytes, "pg_stats_bytes",
+    "Size of PG stats reports sent to the mgr", NULL, 0,
+    unit_t(UNIT_BYTES));
+  osd_plb.add_u64_counter(
+    l_osd_op_fast_read, "op_fast_read",
+    "Client reads served under a shared PG lock");
+  osd_plb.add_u64_counter(
+    l_osd_op_fast_read_fallback, "op_fast_read_fallback",
+    "Fast path read candidates that fell back to the locked path");
+  osd_plb.add_u64_counter(
+    l_osd_txn_batch, "txn_batch",
+    "PG write batches submitted to the object store");
+  osd_plb.add_u64_avg(
+    l_osd_txn_batch_ops, "txn_batch_ops",
+    "PG writes per submitted batch");
+  osd_plb.add_u64_counter(
+    l_osd_op_batch, "op_batch",
+    "Client op batch messages received");
+  osd_plb.add_u64_avg(
+    l_osd_op_batch_ops, "op_batch_ops",
+    "Client ops per received batch message");
 
   osd_plb.add_u64_counter(
    l_osd_rbytes, "recovery_bytes",
@@ -3346,6 +3634,11 @@ void OSD::create_logger()
     PerfCountersBuilder::PRIO_USEFUL);
   osd_plb.add_u64(
     l_osd_hb_to, "heartbeat_to_peers", "Heartbeat (ping) peers we send to");
+  osd_plb.add_time_avg(
+    l_osd_hb_rtt, "heartbeat_rtt", "Heartbeat ping round trip time");
+  osd_plb.add_u64_counter(
+    l_osd_hb_front_skipped, "heartbeat_front_skipped",
+    "Front pings left out because another osd on the peer host was probed");
   osd_plb.add_u64_counter(l_osd_map, "map_messages", "OSD map messages");
   osd_plb.add_u64_counter(l_osd_mape, "map_message_epochs", "OSD map epochs");
   osd_plb.add_u64_counter(
@@ -3370,6 +3663,34 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(
     l_osd_map_bl_cache_miss, "osd_map_bl_cache_miss",
     "OSDMap buffer cache misses");
+  osd_plb.add_u64(
+    l_osd_map_cache_maps, "osd_map_cache_maps",
+    "OSDMaps pinned by the osdmap cache");
+  osd_plb.add_u64(
+    l_osd_map_cache_bytes, "osd_map_cache_bytes",
+    "Memory used by OSDMaps (shared structures counted once)",
+    NULL, 0, unit_t(UNIT_BYTES));
+
+  osd_plb.add_u64(
+    l_osd_op_cost_per_io, "op_cost_per_io",
+    "Queue cost of one op beyond its data, from the op cost model",
+    NULL, 0, unit_t(UNIT_BYTES));
+
+  osd_plb.add_u64(
+    l_osd_recovery_max_active, "recovery_max_active",
+    "Recovery ops allowed in flight");
+  osd_plb.add_time(
+    l_osd_recovery_sleep, "recovery_sleep",
+    "Delay between recovery ops");
+  osd_plb.add_u64(
+    l_osd_recovery_dev_util_pct, "recovery_dev_util_pct",
+    "Busy percentage of the busiest store device");
+  osd_plb.add_u64_counter(
+    l_osd_recovery_throttle_up, "recovery_throttle_up",
+    "Recovery limits raised by the adaptive recovery throttle");
+  osd_plb.add_u64_counter(
+    l_osd_recovery_throttle_down, "recovery_throttle_down",
+    "Recovery limits lowered by the adaptive recovery throttle");
 
   osd_plb.add_u64(
     l_osd_stat_bytes, "stat_bytes", "OSD size", "size",
@@ -3381,6 +3702,13 @@ void OSD::create_logger()
 
   osd_plb.add_u64_counter(
     l_osd_copyfrom, "copyfrom", "Rados \"copy-from\" operations");
+  osd_plb.add_u64_counter(
+    l_osd_copyfrom_bytes_copied, "copyfrom_bytes_copied",
+    "Bytes read and rewritten by copy-from", NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64_counter(
+    l_osd_copyfrom_bytes_shared, "copyfrom_bytes_shared",
+    "Bytes copy-from cloned within the store instead of copying",
+    NULL, 0, unit_t(UNIT_BYTES));
 
   osd_plb.add_u64_counter(l_osd_tier_promote, "tier_promote", "Tier promotions");
   osd_plb.add_u64_counter(l_osd_tier_flush, "tier_flush", "Tier flushes");
@@ -3417,8 +3745,16 @@ void OSD::create_logger()
 
   osd_plb.add_u64_counter(
     l_osd_object_ctx_cache_hit, "object_ctx_cache_hit", "Object context cache hits");
+  osd_plb.add_u64_counter(
+    l_osd_object_ctx_cache_miss, "object_ctx_cache_miss", "Object context cache misses");
   osd_plb.add_u64_counter(
     l_osd_object_ctx_cache_total, "object_ctx_cache_total", "Object context cache lookups");
+  osd_plb.add_u64(
+    l_osd_object_ctx_cache_pinned, "object_ctx_cache_pinned",
+    "Object contexts pinned in the OSD-wide cache");
+  osd_plb.add_u64_counter(
+    l_osd_object_ctx_cache_evict, "object_ctx_cache_evict",
+    "Object contexts evicted from the OSD-wide cache");
 
   osd_plb.add_u64_counter(l_osd_op_cache_hit, "op_cache_hit");
   osd_plb.add_time_avg(
@@ -3478,6 +3814,26 @@ void OSD::create_recoverystate_perf()
   rs_perf.add_time_avg(rs_waitupthru_latency, "waitupthru_latency", "Waitupthru recovery state latency");
   rs_perf.add_time_avg(rs_notrecovering_latency, "notrecovering_latency", "Notrecovering recovery state latency");
 
+  // Peering latency by what started the interval, see PG::peering_cause_t
+  PerfHistogramCommon::axis_config_d peering_hist_x_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+    0,                               ///< Start at 0
+    1000000,                         ///< Quantization unit is 1ms
+    24,                              ///< Enough to cover over an hour
+  };
+  PerfHistogramCommon::axis_config_d peering_hist_y_axis_config{
+    "Cause (start, primary, acting, up, other)",
+    PerfHistogramCommon::SCALE_LINEAR, ///< One bucket per cause
+    0,                                 ///< Start at 0
+    1,                                 ///< Quantization unit is 1
+    PG::PEERING_CAUSE_MAX + 2,         ///< Causes plus under/overflow
+  };
+  rs_perf.add_u64_counter_histogram(
+    rs_peering_latency_cause_hist, "peering_latency_cause_histogram",
+    peering_hist_x_axis_config, peering_hist_y_axis_config,
+    "Histogram of peering latency by cause of the new interval");
+
   recoverystate_perf = rs_perf.create_perf_counters();
   cct->get_perfcounters_collection()->add(recoverystate_perf);
 }
@@ -4481,6 +4837,34 @@ void OSD::_add_heartbeat_peer(int p)
   hi->epoch = osdmap->get_epoch();
 }
 
+void OSD::HeartbeatInfo::dump(Formatter *f, utime_t now) const
+{
+  f->dump_int("osd", peer);
+  f->dump_stream("back_addr") << (con_back ? con_back->get_peer_addr()
+				  : entity_addr_t());
+  f->dump_stream("front_addr") << (con_front ? con_front->get_peer_addr()
+				   : entity_addr_t());
+  f->dump_stream("last_rx_back") << last_rx_back;
+  f->dump_stream("last_rx_front") << last_rx_front;
+  f->dump_unsigned("pings_in_flight", ping_history.size());
+  f->dump_float("ack_interval_mean", acks.mean);
+  f->dump_float("ack_interval_stddev", acks.stddev());
+  if (acks.ready()) {
+    f->dump_float("phi", acks.phi(now));
+  }
+  auto dump_rtt = [f](const char *name,
+		      const std::array<uint64_t, RTT_BUCKETS>& h) {
+    // bucket i holds round trips of [2^(i-1), 2^i) ms, bucket 0 < 1 ms
+    f->open_array_section(name);
+    for (auto n : h) {
+      f->dump_unsigned("count", n);
+    }
+    f->close_section();
+  };
+  dump_rtt("rtt_back_ms_log2", rtt_back);
+  dump_rtt("rtt_front_ms_log2", rtt_front);
+}
+
 void OSD::_remove_heartbeat_peer(int n)
 {
   map<int,HeartbeatInfo>::iterator q = heartbeat_peers.find(n);
@@ -4625,6 +5009,7 @@ void OSD::reset_heartbeat_peers()
     heartbeat_peers.erase(heartbeat_peers.begin());
   }
   failure_queue.clear();
+  failure_by_phi.clear();
 }
 
 void OSD::handle_osd_ping(MOSDPing *m)
@@ -4719,8 +5104,11 @@ void OSD::handle_osd_ping(MOSDPing *m)
         auto acked = i->second.ping_history.find(m->stamp);
         if (acked != i->second.ping_history.end()) {
           utime_t now = ceph_clock_now();
+          utime_t rtt = now - m->stamp;
+          logger->tinc(l_osd_hb_rtt, rtt);
           int &unacknowledged = acked->second.second;
           if (m->get_connection() == i->second.con_back) {
+            HeartbeatInfo::note_rtt(i->second.rtt_back, rtt);
             dout(25) << "handle_osd_ping got reply from osd." << from
                      << " first_tx " << i->second.first_tx
                      << " last_tx " << i->second.last_tx
@@ -4746,9 +5134,22 @@ void OSD::handle_osd_ping(MOSDPing *m)
             i->second.last_rx_front = now;
             ceph_assert(unacknowledged > 0);
             --unacknowledged;
+            HeartbeatInfo::note_rtt(i->second.rtt_front, rtt);
+            if (cct->_conf.get_val<bool>("osd_heartbeat_front_per_host")) {
+              // this peer stood in for its host's front network; compare
+              // by ip only, the peers differ in port and nonce
+              const entity_addr_t& host = i->second.con_front->get_peer_addr();
+              for (auto& [osd, hi] : heartbeat_peers) {
+                if (osd == from || !hi.con_front)
+                  continue;
+                if (hi.con_front->get_peer_addr().is_same_host(host))
+                  hi.last_rx_front = now;
+              }
+            }
           }
 
           if (unacknowledged == 0) {
+            i->second.acks.note_ack(now);
             // succeeded in getting all replies
             dout(25) << "handle_osd_ping got all replies from osd." << from
                      << " , erase pending ping(sent at " << m->stamp << ")"
@@ -4775,6 +5176,7 @@ void OSD::handle_osd_ping(MOSDPing *m)
                                failure_pending_entry->second.second);
               failure_pending.erase(failure_pending_entry);
             }
+            failure_by_phi.erase(from);
           }
         } else {
           // old replies, deprecated by newly sent pings.
@@ -4832,6 +5234,10 @@ void OSD::heartbeat_check()
 {
   ceph_assert(heartbeat_lock.is_locked());
   utime_t now = ceph_clock_now();
+  bool use_phi = cct->_conf.get_val<std::string>(
+    "osd_heartbeat_failure_detector") == "phi";
+  double phi_threshold =
+    cct->_conf.get_val<double>("osd_heartbeat_phi_threshold");
 
   // check for incoming heartbeats (move me elsewhere?)
   for (map<int,HeartbeatInfo>::iterator p = heartbeat_peers.begin();
@@ -4850,7 +5256,25 @@ void OSD::heartbeat_check()
 	     << " last_rx_back " << p->second.last_rx_back
 	     << " last_rx_front " << p->second.last_rx_front
 	     << dendl;
-    if (p->second.is_unhealthy(now)) {
+    bool unhealthy;
+    bool by_phi = use_phi && p->second.acks.ready();
+    if (by_phi) {
+      // judge by how unusual the silence is for this peer rather than
+      // by a fixed grace; until we have a history, fall back to grace
+      double phi = p->second.acks.phi(now);
+      dout(25) << "heartbeat_check osd." << p->first << " phi " << phi
+	       << dendl;
+      unhealthy = phi > phi_threshold && !p->second.ping_history.empty();
+    } else {
+      unhealthy = p->second.is_unhealthy(now);
+    }
+    if (unhealthy) {
+      // tell the mon not to hold the report to its own grace
+      if (by_phi) {
+	failure_by_phi.insert(p->first);
+      } else {
+	failure_by_phi.erase(p->first);
+      }
       utime_t oldest_deadline = p->second.ping_history.begin()->second.first;
       if (p->second.last_rx_back == utime_t() ||
 	  p->second.last_rx_front == utime_t()) {
@@ -4917,15 +5341,47 @@ void OSD::heartbeat()
   utime_t deadline = now;
   deadline += cct->_conf->osd_heartbeat_grace;
 
+  // With osd_heartbeat_front_per_host, the front (public) network of a
+  // peer host is probed through one of its osds per round, in turn;
+  // every osd on the host still gets a back ping.
+  set<int> front_targets;
+  bool front_per_host = cct->_conf.get_val<bool>("osd_heartbeat_front_per_host");
+  if (front_per_host) {
+    // group by front ip; addresses of osds on one host differ in port
+    // and nonce, so they cannot be compared or ordered as a whole
+    vector<pair<entity_addr_t, vector<int>>> hosts;
+    for (auto& [osd, hi] : heartbeat_peers) {
+      if (!hi.con_front)
+	continue;
+      const entity_addr_t& a = hi.con_front->get_peer_addr();
+      auto h = std::find_if(hosts.begin(), hosts.end(),
+			    [&a](const auto& e) {
+			      return e.first.is_same_host(a);
+			    });
+      if (h == hosts.end()) {
+	hosts.emplace_back(a, vector<int>());
+	h = std::prev(hosts.end());
+      }
+      h->second.push_back(osd);
+    }
+    for (auto& [host, osds] : hosts) {
+      front_targets.insert(osds[heartbeat_round % osds.size()]);
+    }
+    ++heartbeat_round;
+  }
+
   // send heartbeats
   for (map<int,HeartbeatInfo>::iterator i = heartbeat_peers.begin();
        i != heartbeat_peers.end();
        ++i) {
     int peer = i->first;
+    bool send_front = i->second.con_front &&
+      (!front_per_host || front_targets.count(peer));
     i->second.last_tx = now;
     if (i->second.first_tx == utime_t())
       i->second.first_tx = now;
     i->second.ping_history[now] = make_pair(deadline,
+      (i->second.con_front && !send_front) ? 1 :
       HeartbeatInfo::HEARTBEAT_MAX_CONN);
     dout(30) << "heartbeat sending ping to osd." << peer << dendl;
     i->second.con_back->send_message(new MOSDPing(monc->get_fsid(),
@@ -4933,11 +5389,14 @@ void OSD::heartbeat()
 					  MOSDPing::PING, now,
 					  cct->_conf->osd_heartbeat_min_size));
 
-    if (i->second.con_front)
+    if (send_front) {
       i->second.con_front->send_message(new MOSDPing(monc->get_fsid(),
 					     service.get_osdmap_epoch(),
 					     MOSDPing::PING, now,
 					  cct->_conf->osd_heartbeat_min_size));
+    } else if (i->second.con_front) {
+      logger->inc(l_osd_hb_front_skipped);
+    }
   }
 
   logger->set(l_osd_hb_to, heartbeat_peers.size());
@@ -5044,6 +5503,34 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc, buffer::get_cached_crc());
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, buffer::get_missed_crc());
+  logger->set(l_osd_object_ctx_cache_pinned, service.obc_cache.get_count());
+  logger->set(l_osd_object_ctx_cache_evict, service.obc_cache.get_evictions());
+  service.update_client_load(logger->get_tavg_ns(l_osd_op_lat),
+			     logger->get(l_osd_op_wip));
+  service.update_pg_log_budget();
+  logger->set(l_osd_pg_log_bytes, mempool::osd_pglog::allocated_bytes());
+  logger->set(l_osd_map_cache_maps, service.get_map_cache_count());
+  logger->set(l_osd_map_cache_bytes, mempool::osdmap::allocated_bytes());
+  logger->set(l_osd_pg_log_budget_pct,
+	      service.get_pg_log_budget_ratio() * 100);
+  {
+    uint64_t ops, bytes, lat_ns;
+    if (store->get_write_stats(&ops, &bytes, &lat_ns)) {
+      service.op_cost_model.update(
+	ops, bytes, lat_ns,
+	cct->_conf.get_val<double>("osd_op_cost_model_decay"));
+    }
+  }
+  logger->set(l_osd_op_cost_per_io, service.op_cost_model.get_per_io_cost());
+  {
+    double util;
+    if (store->get_device_utilization(&util)) {
+      logger->set(l_osd_recovery_dev_util_pct, util * 100);
+    } else {
+      util = -1;
+    }
+    service.update_recovery_throttle(util, get_osd_recovery_sleep());
+  }
 
   // refresh osd stats
   struct store_statfs_t stbuf;
@@ -5837,13 +6324,18 @@ void OSD::send_failures()
     int osd = failure_queue.begin()->first;
     if (!failure_pending.count(osd)) {
       int failed_for = (int)(double)(now - failure_queue.begin()->second);
+      __u8 flags = MOSDFailure::FLAG_FAILED;
+      if (failure_by_phi.count(osd)) {
+	flags |= MOSDFailure::FLAG_PHI;
+      }
       monc->send_mon_message(
 	new MOSDFailure(
 	  monc->get_fsid(),
 	  osd,
 	  osdmap->get_addrs(osd),
 	  failed_for,
-	  osdmap->get_epoch()));
+	  osdmap->get_epoch(),
+	  flags));
       failure_pending[osd] = make_pair(failure_queue.begin()->second,
 				       osdmap->get_addrs(osd));
     }
@@ -5968,6 +6460,11 @@ COMMAND("perf histogram dump "
         "name=counter,type=CephString,req=false",
 	"Get histogram data",
 	"osd", "r", "cli,rest")
+COMMAND("perf dump "
+        "name=logger,type=CephString,req=false "
+        "name=counter,type=CephString,req=false",
+	"Get perf counter data",
+	"osd", "r", "cli,rest")
 
 // tell <osd.n> commands.  Validation of osd.n must be special-cased in client
 COMMAND("version", "report version of OSD", "osd", "r", "cli,rest")
@@ -6074,6 +6571,190 @@ void OSD::do_command(
   }
 }
 
+int OSD::check_osd_bench_args(int64_t count, int64_t bsize, ostream &ss)
+{
+  uint32_t duration = cct->_conf->osd_bench_duration;
+
+  if (bsize > (int64_t) cct->_conf->osd_bench_max_block_size) {
+    // let us limit the block size because the next checks rely on it
+    // having a sane value.  If we allow any block size to be set things
+    // can still go sideways.
+    ss << "block 'size' values are capped at "
+       << byte_u_t(cct->_conf->osd_bench_max_block_size) << ". If you wish to use"
+       << " a higher value, please adjust 'osd_bench_max_block_size'";
+    return -EINVAL;
+  } else if (bsize < (int64_t) (1 << 20)) {
+    // entering the realm of small block sizes.
+    // limit the count to a sane value, assuming a configurable amount of
+    // IOPS and duration, so that the OSD doesn't get hung up on this,
+    // preventing timeouts from going off
+    int64_t max_count =
+      bsize * duration * cct->_conf->osd_bench_small_size_max_iops;
+    if (count > max_count) {
+      ss << "'count' values greater than " << max_count
+         << " for a block size of " << byte_u_t(bsize) << ", assuming "
+         << cct->_conf->osd_bench_small_size_max_iops << " IOPS,"
+         << " for " << duration << " seconds,"
+         << " can cause ill effects on osd. "
+         << " Please adjust 'osd_bench_small_size_max_iops' with a higher"
+         << " value if you wish to use a higher 'count'.";
+      return -EINVAL;
+    }
+  } else {
+    // 1MB block sizes are big enough so that we get more stuff done.
+    // However, to avoid the osd from getting hung on this and having
+    // timers being triggered, we are going to limit the count assuming
+    // a configurable throughput and duration.
+    // NOTE: max_count is the total amount of bytes that we believe we
+    //       will be able to write during 'duration' for the given
+    //       throughput.  The block size hardly impacts this unless it's
+    //       way too big.  Given we already check how big the block size
+    //       is, it's safe to assume everything will check out.
+    int64_t max_count =
+      cct->_conf->osd_bench_large_size_max_throughput * duration;
+    if (count > max_count) {
+      ss << "'count' values greater than " << max_count
+         << " for a block size of " << byte_u_t(bsize) << ", assuming "
+         << byte_u_t(cct->_conf->osd_bench_large_size_max_throughput) << "/s,"
+         << " for " << duration << " seconds,"
+         << " can cause ill effects on osd. "
+         << " Please adjust 'osd_bench_large_size_max_throughput'"
+         << " with a higher value if you wish to use a higher 'count'.";
+      return -EINVAL;
+    }
+  }
+  return 0;
+}
+
+int OSD::run_osd_bench_test(
+  int64_t count,
+  int64_t bsize,
+  int64_t osize,
+  int64_t onum,
+  double *elapsed,
+  ostream &ss)
+{
+  dout(1) << " bench count " << count
+          << " bsize " << byte_u_t(bsize) << dendl;
+
+  ObjectStore::Transaction cleanupt;
+
+  if (osize && onum) {
+    bufferlist bl;
+    bufferptr bp(osize);
+    bp.zero();
+    bl.push_back(std::move(bp));
+    bl.rebuild_page_aligned();
+    for (int i=0; i<onum; ++i) {
+      char nm[30];
+      snprintf(nm, sizeof(nm), "disk_bw_test_%d", i);
+      object_t oid(nm);
+      hobject_t soid(sobject_t(oid, 0));
+      ObjectStore::Transaction t;
+      t.write(coll_t(), ghobject_t(soid), 0, osize, bl);
+      store->queue_transaction(service.meta_ch, std::move(t), NULL);
+      cleanupt.remove(coll_t(), ghobject_t(soid));
+    }
+  }
+
+  bufferlist bl;
+  bufferptr bp(bsize);
+  bp.zero();
+  bl.push_back(std::move(bp));
+  bl.rebuild_page_aligned();
+
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+
+  utime_t start = ceph_clock_now();
+  for (int64_t pos = 0; pos < count; pos += bsize) {
+    char nm[30];
+    unsigned offset = 0;
+    if (onum && osize) {
+      snprintf(nm, sizeof(nm), "disk_bw_test_%d", (int)(rand() % onum));
+      offset = rand() % (osize / bsize) * bsize;
+    } else {
+      snprintf(nm, sizeof(nm), "disk_bw_test_%lld", (long long)pos);
+    }
+    object_t oid(nm);
+    hobject_t soid(sobject_t(oid, 0));
+    ObjectStore::Transaction t;
+    t.write(coll_t::meta(), ghobject_t(soid), offset, bsize, bl);
+    store->queue_transaction(service.meta_ch, std::move(t), NULL);
+    if (!onum || !osize)
+      cleanupt.remove(coll_t::meta(), ghobject_t(soid));
+  }
+
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+  utime_t end = ceph_clock_now();
+
+  // clean up
+  store->queue_transaction(service.meta_ch, std::move(cleanupt), NULL);
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+
+  *elapsed = end - start;
+  return 0;
+}
+
+void OSD::calibrate_op_cost()
+{
+  // a small-write and a large-write run give the per-op and per-byte
+  // terms of the model
+  const int64_t small = 4 << 10, large = 4 << 20;
+  const int64_t small_ios =
+    cct->_conf.get_val<uint64_t>("osd_op_cost_calibrate_small_ios");
+  const int64_t large_ios =
+    cct->_conf.get_val<uint64_t>("osd_op_cost_calibrate_large_ios");
+  if (!small_ios || !large_ios) {
+    return;
+  }
+  if (store_is_rotational) {
+    // small writes to a rotational device are deferred (bluestore) or
+    // journaled (filestore), so their latency is that of a sequential
+    // log append, not of a random IO, and would make the per-op cost
+    // far too low
+    dout(1) << __func__ << " skipped on rotational device; per-op cost "
+	    << byte_u_t(service.op_cost_model.get_per_io_cost()) << dendl;
+    return;
+  }
+  double small_sec = 0.0, large_sec = 0.0;
+  stringstream ss;
+  if (check_osd_bench_args(small * small_ios, small, ss) < 0 ||
+      check_osd_bench_args(large * large_ios, large, ss) < 0 ||
+      run_osd_bench_test(small * small_ios, small, 0, 0, &small_sec, ss) < 0 ||
+      run_osd_bench_test(large * large_ios, large, 0, 0, &large_sec, ss) < 0) {
+    derr << __func__ << " benchmark failed: " << ss.str() << dendl;
+    return;
+  }
+  small_sec /= small_ios;
+  large_sec /= large_ios;
+  if (!service.op_cost_model.calibrate(small, small_sec, large, large_sec)) {
+    dout(1) << __func__ << " " << byte_u_t(small) << " writes took "
+	    << small_sec << "s, " << byte_u_t(large) << " writes "
+	    << large_sec << "s; keeping per-op cost "
+	    << byte_u_t(service.op_cost_model.get_per_io_cost()) << dendl;
+    return;
+  }
+  dout(1) << __func__ << " " << byte_u_t(small) << " writes took "
+	  << small_sec << "s, " << byte_u_t(large) << " writes "
+	  << large_sec << "s; per-op cost "
+	  << byte_u_t(service.op_cost_model.get_per_io_cost()) << dendl;
+}
+
 int OSD::_do_command(
   Connection *con, cmdmap_t& cmdmap, ceph_tid_t tid, bufferlist& data,
   bufferlist& odata, stringstream& ss, stringstream& ds)
@@ -6261,136 +6942,20 @@ int OSD::_do_command(
     cmd_getval(cct, cmdmap, "object_size", osize, (int64_t)0);
     cmd_getval(cct, cmdmap, "object_num", onum, (int64_t)0);
 
-    uint32_t duration = cct->_conf->osd_bench_duration;
-
-    if (bsize > (int64_t) cct->_conf->osd_bench_max_block_size) {
-      // let us limit the block size because the next checks rely on it
-      // having a sane value.  If we allow any block size to be set things
-      // can still go sideways.
-      ss << "block 'size' values are capped at "
-         << byte_u_t(cct->_conf->osd_bench_max_block_size) << ". If you wish to use"
-         << " a higher value, please adjust 'osd_bench_max_block_size'";
-      r = -EINVAL;
+    // validate what was asked for, before clamping to the object size
+    r = check_osd_bench_args(count, bsize, ss);
+    if (r < 0) {
       goto out;
-    } else if (bsize < (int64_t) (1 << 20)) {
-      // entering the realm of small block sizes.
-      // limit the count to a sane value, assuming a configurable amount of
-      // IOPS and duration, so that the OSD doesn't get hung up on this,
-      // preventing timeouts from going off
-      int64_t max_count =
-        bsize * duration * cct->_conf->osd_bench_small_size_max_iops;
-      if (count > max_count) {
-        ss << "'count' values greater than " << max_count
-           << " for a block size of " << byte_u_t(bsize) << ", assuming "
-           << cct->_conf->osd_bench_small_size_max_iops << " IOPS,"
-           << " for " << duration << " seconds,"
-           << " can cause ill effects on osd. "
-           << " Please adjust 'osd_bench_small_size_max_iops' with a higher"
-           << " value if you wish to use a higher 'count'.";
-        r = -EINVAL;
-        goto out;
-      }
-    } else {
-      // 1MB block sizes are big enough so that we get more stuff done.
-      // However, to avoid the osd from getting hung on this and having
-      // timers being triggered, we are going to limit the count assuming
-      // a configurable throughput and duration.
-      // NOTE: max_count is the total amount of bytes that we believe we
-      //       will be able to write during 'duration' for the given
-      //       throughput.  The block size hardly impacts this unless it's
-      //       way too big.  Given we already check how big the block size
-      //       is, it's safe to assume everything will check out.
-      int64_t max_count =
-        cct->_conf->osd_bench_large_size_max_throughput * duration;
-      if (count > max_count) {
-        ss << "'count' values greater than " << max_count
-           << " for a block size of " << byte_u_t(bsize) << ", assuming "
-           << byte_u_t(cct->_conf->osd_bench_large_size_max_throughput) << "/s,"
-           << " for " << duration << " seconds,"
-           << " can cause ill effects on osd. "
-           << " Please adjust 'osd_bench_large_size_max_throughput'"
-           << " with a higher value if you wish to use a higher 'count'.";
-        r = -EINVAL;
-        goto out;
-      }
     }
 
     if (osize && bsize > osize)
       bsize = osize;
 
-    dout(1) << " bench count " << count
-            << " bsize " << byte_u_t(bsize) << dendl;
-
-    ObjectStore::Transaction cleanupt;
-
-    if (osize && onum) {
-      bufferlist bl;
-      bufferptr bp(osize);
-      bp.zero();
-      bl.push_back(std::move(bp));
-      bl.rebuild_page_aligned();
-      for (int i=0; i<onum; ++i) {
-	char nm[30];
-	snprintf(nm, sizeof(nm), "disk_bw_test_%d", i);
-	object_t oid(nm);
-	hobject_t soid(sobject_t(oid, 0));
-	ObjectStore::Transaction t;
-	t.write(coll_t(), ghobject_t(soid), 0, osize, bl);
-	store->queue_transaction(service.meta_ch, std::move(t), NULL);
-	cleanupt.remove(coll_t(), ghobject_t(soid));
-      }
-    }
-
-    bufferlist bl;
-    bufferptr bp(bsize);
-    bp.zero();
-    bl.push_back(std::move(bp));
-    bl.rebuild_page_aligned();
-
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-
-    utime_t start = ceph_clock_now();
-    for (int64_t pos = 0; pos < count; pos += bsize) {
-      char nm[30];
-      unsigned offset = 0;
-      if (onum && osize) {
-	snprintf(nm, sizeof(nm), "disk_bw_test_%d", (int)(rand() % onum));
-	offset = rand() % (osize / bsize) * bsize;
-      } else {
-	snprintf(nm, sizeof(nm), "disk_bw_test_%lld", (long long)pos);
-      }
-      object_t oid(nm);
-      hobject_t soid(sobject_t(oid, 0));
-      ObjectStore::Transaction t;
-      t.write(coll_t::meta(), ghobject_t(soid), offset, bsize, bl);
-      store->queue_transaction(service.meta_ch, std::move(t), NULL);
-      if (!onum || !osize)
-	cleanupt.remove(coll_t::meta(), ghobject_t(soid));
-    }
-
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-    utime_t end = ceph_clock_now();
-
-    // clean up
-    store->queue_transaction(service.meta_ch, std::move(cleanupt), NULL);
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
+    double elapsed = 0.0;
+    r = run_osd_bench_test(count, bsize, osize, onum, &elapsed, ss);
+    if (r != 0) {
+      goto out;
     }
-
-    double elapsed = end - start;
     double rate = count / elapsed;
     double iops = rate / bsize;
     if (f) {
@@ -6490,6 +7055,19 @@ int OSD::_do_command(
     }
   }
 
+  else if (prefix == "perf dump") {
+    std::string logger;
+    std::string counter;
+    cmd_getval(cct, cmdmap, "logger", logger);
+    cmd_getval(cct, cmdmap, "counter", counter);
+    if (!f) {
+      f.reset(new JSONFormatter(true));
+    }
+    cct->get_perfcounters_collection()->dump_formatted(
+      f.get(), false, logger, counter);
+    f->flush(ds);
+  }
+
   else if (prefix == "compact") {
     dout(1) << "triggering manual compaction" << dendl;
     auto start = ceph::coarse_mono_clock::now();
@@ -6526,15 +7104,11 @@ int OSD::_do_command(
   }
 
   else if (prefix == "cache status") {
-    int obj_ctx_count = 0;
-    vector<PGRef> pgs;
-    _get_pgs(&pgs);
-    for (auto& pg: pgs) {
-      obj_ctx_count += pg->get_cache_obj_count();
-    }
+    int obj_ctx_count = service.obc_cache.get_count();
     if (f) {
       f->open_object_section("cache_status");
       f->dump_int("object_ctx", obj_ctx_count);
+      service.obc_cache.dump(f.get());
       store->dump_cache_stats(f.get());
       f->close_section();
       f->flush(ds);
@@ -6715,6 +7289,15 @@ void OSD::dispatch_session_waiting(SessionRef session, OSDMapRef osdmap)
   }
 }
 
+void OSD::maybe_trace_op(OpRequestRef& op)
+{
+  static thread_local uint64_t n = 0;
+  const uint64_t rate = cct->_conf->osd_op_trace_sample_rate;
+  if (rate && ++n % rate == 0) {
+    op->start_trace(logger, l_osd_op_stage_msgr_lat, l_osd_op_stage_lat_hist);
+  }
+}
+
 void OSD::ms_fast_dispatch(Message *m)
 {
   FUNCTRACE(cct);
@@ -6738,6 +7321,9 @@ void OSD::ms_fast_dispatch(Message *m)
   case MSG_OSD_SCRUB2:
     handle_fast_scrub(static_cast<MOSDScrub2*>(m));
     return;
+  case CEPH_MSG_OSD_OP_BATCH:
+    handle_fast_op_batch(static_cast<MOSDOpBatch*>(m));
+    return;
 
   case MSG_OSD_PG_CREATE2:
     return handle_fast_pg_create(static_cast<MOSDPGCreate2*>(m));
@@ -6768,6 +7354,9 @@ void OSD::ms_fast_dispatch(Message *m)
   }
 
   OpRequestRef op = op_tracker.create_request<OpRequest, Message*>(m);
+  if (m->get_type() == CEPH_MSG_OSD_OP) {
+    maybe_trace_op(op);
+  }
   {
 #ifdef WITH_LTTNG
     osd_reqid_t reqid = op->get_reqid();
@@ -6810,6 +7399,25 @@ void OSD::ms_fast_dispatch(Message *m)
   OID_EVENT_TRACE_WITH_MSG(m, "MS_FAST_DISPATCH_END", false); 
 }
 
+void OSD::handle_fast_op_batch(MOSDOpBatch *m)
+{
+  dout(10) << __func__ << " " << *m << " from " << m->get_source() << dendl;
+  // the ops go through the usual path one after the other, so ops for
+  // the same pg land back to back in its shard and writes can share a
+  // transaction batch (see dequeue_op_batch)
+  vector<MOSDOp*> ops = m->claim_ops(cct);
+  if (ops.size() != m->num_ops) {
+    derr << __func__ << " " << *m << " from " << m->get_source()
+	 << ": decoded only " << ops.size() << " ops" << dendl;
+  }
+  logger->inc(l_osd_op_batch);
+  logger->inc(l_osd_op_batch_ops, ops.size());
+  m->put();
+  for (auto op : ops) {
+    ms_fast_dispatch(op);
+  }
+}
+
 void OSD::ms_fast_preprocess(Message *m)
 {
   if (m->get_connection()->get_peer_type() == CEPH_ENTITY_TYPE_OSD) {
@@ -7183,9 +7791,11 @@ void OSD::sched_scrub()
 
   utime_t now = ceph_clock_now();
   bool time_permit = scrub_time_permit(now);
-  bool load_is_low = scrub_load_below_threshold();
+  bool load_is_low = scrub_load_below_threshold() &&
+    service.scrub_client_load_permits();
   dout(20) << "sched_scrub load_is_low=" << (int)load_is_low << dendl;
 
+  bool load_deferred = false;
   OSDService::ScrubJob scrub;
   if (service.first_scrub_stamp(&scrub)) {
     do {
@@ -7201,6 +7811,9 @@ void OSD::sched_scrub()
       if ((scrub.deadline.is_zero() || scrub.deadline >= now) && !(time_permit && load_is_low)) {
         dout(10) << __func__ << " not scheduling scrub for " << scrub.pgid << " due to "
                  << (!time_permit ? "time not permit" : "high load") << dendl;
+        if (time_permit) {
+          load_deferred = true;
+        }
         continue;
       }
 
@@ -7218,24 +7831,37 @@ void OSD::sched_scrub()
       pg->unlock();
     } while (service.next_scrub_stamp(scrub, &scrub));
   }
+  if (load_deferred) {
+    logger->inc(l_osd_scrub_load_deferred);
+  }
   dout(20) << "sched_scrub done" << dendl;
 }
 
-MPGStats* OSD::collect_pg_stats()
+MPGStats* OSD::collect_pg_stats(uint64_t features, bool resync)
 {
-  // This implementation unconditionally sends every is_primary PG's
-  // stats every time we're called.  This has equivalent cost to the
-  // previous implementation's worst case where all PGs are busy and
-  // their stats are always enqueued for sending.
+  // A full report carries every is_primary PG's stats.  In between, we
+  // only send PGs whose stats were republished since the last report;
+  // the mgr keeps the rest.  A new mgr session (resync) and every
+  // osd_pg_stats_full_interval seconds get a full report.
   RWLock::RLocker l(map_lock);
 
-  utime_t had_for = ceph_clock_now() - had_map_since;
+  utime_t now = ceph_clock_now();
+  utime_t had_for = now - had_map_since;
   osd_stat_t cur_stat = service.get_osd_stat();
   cur_stat.os_perf_stat = store->get_cur_stats();
 
   auto m = new MPGStats(monc->get_fsid(), osdmap->get_epoch(), had_for);
   m->osd_stat = cur_stat;
 
+  double full_interval =
+    cct->_conf.get_val<double>("osd_pg_stats_full_interval");
+  m->full = resync || full_interval <= 0 ||
+    (double)(now - last_pg_stats_full) >= full_interval;
+  if (m->full) {
+    last_pg_stats_full = now;
+  }
+  map<pg_t, pair<epoch_t, version_t>> reported;
+
   Mutex::Locker lec{min_last_epoch_clean_lock};
   min_last_epoch_clean = osdmap->get_epoch();
   min_last_epoch_clean_pgs.clear();
@@ -7246,12 +7872,31 @@ MPGStats* OSD::collect_pg_stats()
       continue;
     }
     pg->get_pg_stats([&](const pg_stat_t& s, epoch_t lec) {
-	m->pg_stat[pg->pg_id.pgid] = s;
+	const pg_t& pgid = pg->pg_id.pgid;
+	auto v = s.get_version_pair();
+	if (m->full) {
+	  m->pg_stat[pgid] = s;
+	} else {
+	  auto p = pg_stats_reported.find(pgid);
+	  if (p == pg_stats_reported.end() || p->second != v) {
+	    m->pg_stat[pgid] = s;
+	  }
+	}
+	reported[pgid] = v;
 	min_last_epoch_clean = min(min_last_epoch_clean, lec);
-	min_last_epoch_clean_pgs.push_back(pg->pg_id.pgid);
+	min_last_epoch_clean_pgs.push_back(pgid);
       });
   }
+  pg_stats_reported.swap(reported);
 
+  // encode now so we can account for the report size
+  m->encode_payload(features);
+  logger->inc(m->full ? l_osd_pg_stats_full : l_osd_pg_stats_delta);
+  logger->inc(l_osd_pg_stats_pgs, m->pg_stat.size());
+  logger->inc(l_osd_pg_stats_bytes, m->get_payload().length());
+  dout(20) << __func__ << (m->full ? " full" : " delta") << " report of "
+	   << m->pg_stat.size() << "/" << pg_stats_reported.size() << " pgs, "
+	   << m->get_payload().length() << " bytes" << dendl;
   return m;
 }
 
@@ -7330,6 +7975,7 @@ void OSD::note_down_osd(int peer)
   heartbeat_lock.Lock();
   failure_queue.erase(peer);
   failure_pending.erase(peer);
+  failure_by_phi.erase(peer);
   map<int,HeartbeatInfo>::iterator p = heartbeat_peers.find(peer);
   if (p != heartbeat_peers.end()) {
     p->second.con_back->mark_down();
@@ -8281,6 +8927,10 @@ void OSD::consume_map()
   service.await_reserved_maps();
   service.publish_map(osdmap);
 
+  if (op_queue == io_queue::mclock_client) {
+    service.qos_tenants.set_pool_tenants(*osdmap);
+  }
+
   // prime splits and merges
   set<pair<spg_t,epoch_t>> newly_split;  // splits, and when
   set<pair<spg_t,epoch_t>> merge_pgs;    // merge participants, and when
@@ -8738,6 +9388,114 @@ void OSD::discard_context(PG::RecoveryCtx& ctx)
   delete ctx.transaction;
 }
 
+/** queue_peering_messages
+ * Move the peering messages of a PG's event into its shard's batch so
+ * that PGs peering with the same OSDs share messages.  They are sent
+ * once the shard has no more queued work (see flush_peering_batch),
+ * after osd_peering_batch_max_delay, once the batch is full, or before
+ * the PG's next queued item runs.
+ */
+void OSD::queue_peering_messages(OSDShard *sdata, spg_t pgid,
+				 PG::RecoveryCtx &ctx, OSDMapRef curmap)
+{
+  if (ctx.query_map->empty() &&
+      ctx.notify_list->empty() &&
+      ctx.info_map->empty()) {
+    return;
+  }
+  uint64_t max_pgs = cct->_conf.get_val<uint64_t>("osd_peering_batch_max_pgs");
+  if (max_pgs == 0) {
+    return;  // dispatch_context sends them
+  }
+  double max_delay =
+    cct->_conf.get_val<double>("osd_peering_batch_max_delay");
+
+  PeeringBatch prev, full;
+  Mutex::Locker l(sdata->peering_send_lock);
+  sdata->shard_lock.Lock();
+  auto& batch = sdata->peering_batch;
+  if (batch.must_split(pgid, curmap->get_epoch())) {
+    prev.swap(batch);
+  }
+  utime_t now = ceph_clock_now();
+  batch.add(pgid, curmap, now,
+	    *ctx.query_map, *ctx.notify_list, *ctx.info_map);
+  if (batch.ready(now, sdata->pqueue->empty(), max_pgs, max_delay)) {
+    full.swap(batch);
+  }
+  sdata->peering_batch_pending = !batch.empty();
+  sdata->shard_lock.Unlock();
+
+  if (!prev.empty()) {
+    send_peering_batch(prev);
+  }
+  if (!full.empty()) {
+    send_peering_batch(full);
+  }
+}
+
+void OSD::flush_peering_batch(OSDShard *sdata)
+{
+  if (!sdata->peering_batch_pending) {
+    return;
+  }
+  PeeringBatch batch;
+  Mutex::Locker l(sdata->peering_send_lock);
+  sdata->shard_lock.Lock();
+  auto& pending = sdata->peering_batch;
+  if (pending.ready(ceph_clock_now(), sdata->pqueue->empty(),
+		    cct->_conf.get_val<uint64_t>("osd_peering_batch_max_pgs"),
+		    cct->_conf.get_val<double>("osd_peering_batch_max_delay"))) {
+    batch.swap(pending);
+    sdata->peering_batch_pending = false;
+  }
+  sdata->shard_lock.Unlock();
+  if (!batch.empty()) {
+    send_peering_batch(batch);
+  }
+}
+
+/*
+ * Send the shard's batch now if pgid has messages in it.  Called with
+ * the pg locked before it handles a queued item, so that nothing it
+ * sends directly (e.g. an MOSDPGLog) overtakes them.
+ */
+void OSD::flush_peering_batch(OSDShard *sdata, spg_t pgid)
+{
+  if (!sdata->peering_batch_pending) {
+    return;
+  }
+  PeeringBatch batch;
+  Mutex::Locker l(sdata->peering_send_lock);
+  sdata->shard_lock.Lock();
+  if (sdata->peering_batch.has(pgid)) {
+    batch.swap(sdata->peering_batch);
+    sdata->peering_batch_pending = false;
+  }
+  sdata->shard_lock.Unlock();
+  if (!batch.empty()) {
+    dout(20) << __func__ << " " << pgid << " has messages batched" << dendl;
+    send_peering_batch(batch);
+  }
+}
+
+void OSD::send_peering_batch(PeeringBatch& batch)
+{
+  if (!service.get_osdmap()->is_up(whoami)) {
+    dout(20) << __func__ << " not up in osdmap" << dendl;
+    return;
+  }
+  if (!is_active()) {
+    dout(20) << __func__ << " not active" << dendl;
+    return;
+  }
+  dout(20) << __func__ << " " << batch.pgs.size() << " pgs at epoch "
+	   << batch.osdmap->get_epoch() << dendl;
+  do_notifies(batch.notify_list, batch.osdmap);
+  do_queries(batch.query_map, batch.osdmap);
+  do_infos(batch.info_map, batch.osdmap);
+}
+
 
 /** do_notifies
  * Send an MOSDPGNotify to a primary, with a list of PGs that I have
@@ -9104,7 +9862,7 @@ bool OSDService::_recover_now(uint64_t *available_pushes)
     return false;
   }
 
-  uint64_t max = cct->_conf->osd_recovery_max_active;
+  uint64_t max = _get_recovery_max_active();
   if (max <= recovery_ops_active + recovery_ops_reserved) {
     dout(15) << __func__ << " active " << recovery_ops_active
 	     << " + reserved " << recovery_ops_reserved
@@ -9118,6 +9876,15 @@ bool OSDService::_recover_now(uint64_t *available_pushes)
   return true;
 }
 
+uint64_t OSDService::_get_recovery_max_active()
+{
+  ceph_assert(recovery_lock.is_locked_by_me());
+  if (recovery_throttle_enabled) {
+    return recovery_throttle.max_active;
+  }
+  return cct->_conf->osd_recovery_max_active;
+}
+
 void OSD::do_recovery(
   PG *pg, epoch_t queued, uint64_t reserved_pushes,
   ThreadPool::TPHandle &handle)
@@ -9131,7 +9898,8 @@ void OSD::do_recovery(
    * recovery_requeue_callback event, which re-queues the recovery op using
    * queue_recovery_after_sleep.
    */
-  float recovery_sleep = get_osd_recovery_sleep();
+  float recovery_sleep =
+    service.get_recovery_sleep_time(get_osd_recovery_sleep());
   {
     Mutex::Locker l(service.sleep_lock);
     if (recovery_sleep > 0 && service.recovery_needs_sleep) {
@@ -9197,7 +9965,7 @@ void OSDService::start_recovery_op(PG *pg, const hobject_t& soid)
   Mutex::Locker l(recovery_lock);
   dout(10) << "start_recovery_op " << *pg << " " << soid
 	   << " (" << recovery_ops_active << "/"
-	   << cct->_conf->osd_recovery_max_active << " rops)"
+	   << _get_recovery_max_active() << " rops)"
 	   << dendl;
   recovery_ops_active++;
 
@@ -9213,7 +9981,7 @@ void OSDService::finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue)
   Mutex::Locker l(recovery_lock);
   dout(10) << "finish_recovery_op " << *pg << " " << soid
 	   << " dequeue=" << dequeue
-	   << " (" << recovery_ops_active << "/" << cct->_conf->osd_recovery_max_active << " rops)"
+	   << " (" << recovery_ops_active << "/" << _get_recovery_max_active() << " rops)"
 	   << dendl;
 
   // adjust count
@@ -9245,6 +10013,76 @@ void OSDService::release_reserved_pushes(uint64_t pushes)
   _maybe_queue_recovery();
 }
 
+void OSDService::update_recovery_throttle(double dev_util, double base_sleep)
+{
+  double lat_target =
+    cct->_conf.get_val<double>("osd_recovery_client_latency_target");
+  double util_target =
+    cct->_conf.get_val<double>("osd_recovery_device_utilization_target");
+  uint64_t active_max = std::max<uint64_t>(
+    1, cct->_conf.get_val<uint64_t>("osd_recovery_max_active_max"));
+  double sleep_max = std::max(
+    base_sleep, cct->_conf.get_val<double>("osd_recovery_sleep_max"));
+  double lat;
+  {
+    Mutex::Locker l(sched_scrub_lock);
+    lat = client_op_lat;
+  }
+
+  Mutex::Locker l(recovery_lock);
+  if (lat_target <= 0 && util_target <= 0) {
+    recovery_throttle_enabled = false;
+  } else {
+    if (!recovery_throttle_enabled) {
+      // start from the static limits
+      recovery_throttle_enabled = true;
+      recovery_throttle = RecoveryThrottle(cct->_conf->osd_recovery_max_active,
+					   base_sleep);
+    }
+    uint64_t old_max = recovery_throttle.max_active;
+    double old_sleep = recovery_throttle.sleep;
+
+    bool over = (lat_target > 0 && lat > lat_target) ||
+      (util_target > 0 && dev_util > util_target);
+    int r = recovery_throttle.step(
+      over, !awaiting_throttle.empty(),
+      recovery_ops_active + recovery_ops_reserved,
+      active_max, base_sleep, sleep_max);
+    if (r < 0) {
+      logger->inc(l_osd_recovery_throttle_down);
+    } else if (r > 0) {
+      logger->inc(l_osd_recovery_throttle_up);
+    }
+    if (recovery_throttle.max_active != old_max ||
+	recovery_throttle.sleep != old_sleep) {
+      dout(10) << __func__ << " client op latency " << lat
+	       << " (target " << lat_target << ")"
+	       << " device utilization " << dev_util
+	       << " (target " << util_target << ")"
+	       << " max active " << old_max << " -> "
+	       << recovery_throttle.max_active
+	       << " sleep " << old_sleep << " -> " << recovery_throttle.sleep
+	       << dendl;
+    }
+  }
+
+  logger->set(l_osd_recovery_max_active, _get_recovery_max_active());
+  utime_t sleep;
+  sleep.set_from_double(recovery_throttle_enabled ?
+			recovery_throttle.sleep : base_sleep);
+  logger->tset(l_osd_recovery_sleep, sleep);
+  _maybe_queue_recovery();
+}
+
+double OSDService::get_recovery_sleep_time(double base_sleep)
+{
+  Mutex::Locker l(recovery_lock);
+  if (!recovery_throttle_enabled) {
+    return base_sleep;
+  }
+  return std::max(base_sleep, recovery_throttle.sleep);
+}
+
 // =========================================================
 // OPS
 
@@ -9263,9 +10101,21 @@ void OSD::enqueue_op(spg_t pg, OpRequestRef&& op, epoch_t epoch)
   const utime_t stamp = op->get_req()->get_recv_stamp();
   const utime_t latency = ceph_clock_now() - stamp;
   const unsigned priority = op->get_req()->get_priority();
-  const int cost = op->get_req()->get_cost();
+  const int cost = service.osd_op_cost_model ?
+    service.op_cost_model.get_cost(op->get_req()->get_cost()) :
+    op->get_req()->get_cost();
   const uint64_t owner = op->get_req()->get_source().num();
 
+  if (op_queue == io_queue::mclock_client &&
+      op->get_req()->get_type() == CEPH_MSG_OSD_OP &&
+      !service.qos_tenants.empty()) {
+    auto priv = op->get_req()->get_connection()->get_priv();
+    if (auto session = static_cast<Session*>(priv.get()); session) {
+      op->qos_tenant = service.qos_tenants.get_tenant(session->entity_name,
+						       pg.pool());
+    }
+  }
+
   dout(15) << "enqueue_op " << op << " prio " << priority
 	   << " cost " << cost
 	   << " latency " << latency
@@ -9348,6 +10198,99 @@ void OSD::dequeue_op(
 }
 
 
+/*
+ * Try to serve op with the pg lock held shared.  On failure the op is
+ * marked so that it is not tried again and the caller requeues it for
+ * the normal path.
+ */
+bool OSD::dequeue_fast_read(
+  PGRef pg, OpRequestRef op, OSDMapRef osdmap)
+{
+  utime_t now = ceph_clock_now();
+  op->set_dequeued_time(now);
+  if (!pg->do_fast_read(op)) {
+    dout(20) << __func__ << " " << op << " declined, requeueing" << dendl;
+    op->no_fast_read = true;
+    logger->inc(l_osd_op_fast_read_fallback);
+    return false;
+  }
+  logger->tinc(l_osd_op_before_dequeue_op_lat,
+	       now - op->get_req()->get_recv_stamp());
+  logger->inc(l_osd_op_fast_read);
+
+  auto priv = op->get_req()->get_connection()->get_priv();
+  if (auto session = static_cast<Session *>(priv.get()); session) {
+    maybe_share_map(session, op, osdmap);
+  }
+  return true;
+}
+
+// writes whose transactions may be submitted together with those of
+// neighbouring writes to the same pg
+static bool is_txn_batch_candidate(const OpQueueItem& qi)
+{
+  boost::optional<OpRequestRef> op = qi.maybe_get_op();
+  if (!op) {
+    return false;
+  }
+  const Message *m = (*op)->get_req();
+  switch (m->get_type()) {
+  case CEPH_MSG_OSD_OP:
+    return static_cast<const MOSDOp*>(m)->has_flag(CEPH_OSD_FLAG_WRITE);
+  case MSG_OSD_REPOP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/*
+ * Run op, then keep running the ops queued right behind it for the same
+ * pg (they are on the slot's to_process list while their own workers
+ * wait for the pg lock) for as long as they are writes, so that their
+ * transactions reach the store as one batch.  Unlocks the pg.
+ */
+void OSD::dequeue_op_batch(
+  OSDShard *sdata, PGRef pg, OpRequestRef op,
+  ThreadPool::TPHandle &handle)
+{
+  const unsigned max_ops = cct->_conf->osd_txn_batch_max_ops;
+  pg->begin_txn_batch();
+  for (unsigned n = 1; ; ++n) {
+    dequeue_op(pg, op, handle);
+    if (n >= max_ops) {
+      break;
+    }
+    sdata->shard_lock.Lock();
+    auto q = sdata->pg_slots.find(pg->pg_id);
+    if (q == sdata->pg_slots.end() ||
+	q->second->pg != pg ||
+	q->second->to_process.empty() ||
+	!is_txn_batch_candidate(q->second->to_process.front())) {
+      sdata->shard_lock.Unlock();
+      break;
+    }
+    // this skips _process's requeue_seq check on purpose.  that check
+    // catches a requeue (_wake_pg_slot) that ran while a worker waited
+    // for the pg lock, after it last looked at to_process.  here we
+    // already hold the pg lock, and we look at to_process and pop from
+    // it under one shard_lock, so a requeue either happened before
+    // (and to_process no longer has the op) or happens after (and
+    // only moves what is left).  the slot->pg check above covers pg
+    // removal.  client ops need none of the epoch checks, which are for
+    // peering events and pg-less items.  the worker that queued the op
+    // will find to_process empty, or its requeue_seq stale, and return.
+    OSDShardPGSlot *slot = q->second.get();
+    op = *slot->to_process.front().maybe_get_op();
+    slot->to_process.pop_front();
+    sdata->shard_lock.Unlock();
+    dout(20) << __func__ << " " << pg->pg_id << " batching " << op << dendl;
+    handle.reset_tp_timeout();
+  }
+  pg->end_txn_batch();
+  pg->unlock();
+}
+
 void OSD::dequeue_peering_evt(
   OSDShard *sdata,
   PG *pg,
@@ -9357,6 +10300,7 @@ void OSD::dequeue_peering_evt(
   PG::RecoveryCtx rctx = create_context();
   auto curmap = sdata->get_osdmap();
   epoch_t need_up_thru = 0, same_interval_since = 0;
+  spg_t pgid;
   if (!pg) {
     if (const MQuery *q = dynamic_cast<const MQuery*>(evt->evt.get())) {
       handle_pg_query_nopg(*q);
@@ -9375,12 +10319,14 @@ void OSD::dequeue_peering_evt(
     dispatch_context_transaction(rctx, pg, &handle);
     need_up_thru = pg->get_need_up_thru();
     same_interval_since = pg->get_same_interval_since();
+    pgid = pg->pg_id;
     pg->unlock();
   }
 
   if (need_up_thru) {
     queue_want_up_thru(same_interval_since);
   }
+  queue_peering_messages(sdata, pgid, rctx, curmap);
   dispatch_context(rctx, pg, curmap, &handle);
 
   service.send_pg_temp();
@@ -9420,6 +10366,8 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_slow_op_threshold",
     "osd_enable_op_tracker",
     "osd_map_cache_size",
+    "osd_object_context_cache_size",
+    "osd_op_queue_mclock_tenants",
     "osd_pg_epoch_max_lag_factor",
     "osd_pg_epoch_persisted_max_stale",
     // clog & admin clog
@@ -9480,6 +10428,17 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_inc_cache.set_size(cct->_conf->osd_map_cache_size);
   }
+  if (changed.count("osd_object_context_cache_size")) {
+    service.obc_cache.set_size(
+      conf.get_val<uint64_t>("osd_object_context_cache_size"));
+  }
+  if (changed.count("osd_op_queue_mclock_tenants")) {
+    ostringstream err;
+    if (service.qos_tenants.set_entity_tenants(
+	  conf.get_val<std::string>("osd_op_queue_mclock_tenants"), &err) < 0) {
+      clog->error() << "osd_op_queue_mclock_tenants: " << err.str();
+    }
+  }
   if (changed.count("clog_to_monitors") ||
       changed.count("clog_to_syslog") ||
       changed.count("clog_to_syslog_level") ||
@@ -10201,6 +11160,10 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   // to do oncommit callback.
   bool is_smallest_thread_index = thread_index < osd->num_shards;
 
+  // send peering messages held back for batching once the shard runs
+  // out of work or they have waited long enough
+  osd->flush_peering_batch(sdata);
+
   // peek at spg_t
   sdata->shard_lock.Lock();
   if (sdata->pqueue->empty() &&
@@ -10248,6 +11211,9 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     sdata->shard_lock.Unlock();
     return;    // OSD shutdown, discard.
   }
+  if (boost::optional<OpRequestRef> _op = item.maybe_get_op()) {
+    (*_op)->trace_point(OpRequest::TRACE_DEQUEUED);
+  }
 
   const auto token = item.get_ordering_token();
   auto r = sdata->pg_slots.emplace(token, nullptr);
@@ -10268,6 +11234,59 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
  retry_pg:
   PGRef pg = slot->pg;
 
+  // simple client reads may run concurrently under a shared pg lock.
+  // writers (and everything else) take the pg lock exclusively, so
+  // a fast read never overtakes an op queued ahead of it.
+  if (pg && osd->cct->_conf->osd_read_fast_path &&
+      slot->to_process.front().is_fast_read_candidate()) {
+    uint64_t requeue_seq = slot->requeue_seq;
+    ++slot->num_running;
+
+    sdata->shard_lock.Unlock();
+    pg->lock_shared();
+    sdata->shard_lock.Lock();
+
+    auto q = sdata->pg_slots.find(token);
+    if (q == sdata->pg_slots.end()) {
+      dout(20) << __func__ << " slot " << token << " no longer there" << dendl;
+      pg->unlock_shared();
+      sdata->shard_lock.Unlock();
+      handle_oncommits(oncommits);
+      return;
+    }
+    slot = q->second.get();
+    --slot->num_running;
+    if (slot->to_process.empty() ||
+	requeue_seq != slot->requeue_seq) {
+      dout(20) << __func__ << " " << token
+	       << " raced with _wake_pg_slot or consume_map" << dendl;
+      pg->unlock_shared();
+      sdata->shard_lock.Unlock();
+      handle_oncommits(oncommits);
+      return;
+    }
+    if (slot->pg != pg ||
+	!slot->to_process.front().is_fast_read_candidate()) {
+      pg->unlock_shared();
+      goto retry_pg;
+    }
+
+    auto qi = std::move(slot->to_process.front());
+    slot->to_process.pop_front();
+    OSDMapRef osdmap = sdata->shard_osdmap;
+    sdata->shard_lock.Unlock();
+    dout(20) << __func__ << " " << qi << " pg " << pg << " (fast read)"
+	     << dendl;
+
+    if (!osd->dequeue_fast_read(pg, *qi.maybe_get_op(), osdmap)) {
+      // back ahead of anything queued behind it, for the locked path
+      osd->service.enqueue_front(std::move(qi));
+    }
+    pg->unlock_shared();
+    handle_oncommits(oncommits);
+    return;
+  }
+
   // lock pg (if we have it)
   if (pg) {
     // note the requeue seq now...
@@ -10457,7 +11476,16 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   delete f;
   *_dout << dendl;
 
-  qi.run(osd, sdata, pg, tp_handle);
+  if (pg) {
+    // anything the pg sends now must follow its batched peering messages
+    osd->flush_peering_batch(sdata, pg->pg_id);
+  }
+  if (pg && osd->cct->_conf->osd_txn_batch_max_ops > 1 &&
+      is_txn_batch_candidate(qi)) {
+    osd->dequeue_op_batch(sdata, pg, *qi.maybe_get_op(), tp_handle);
+  } else {
+    qi.run(osd, sdata, pg, tp_handle);
+  }
 
   {
 #ifdef WITH_LTTNG
@@ -10511,9 +11539,7 @@ void OSD::ShardedOpWQ::_enqueue_front(OpQueueItem&& item)
     // from pqueue, put it on to_process, and is now busy taking the
     // pg lock.  ensure this old requeued item is ordered before any
     // such newer item in to_process.
-    p->second->to_process.push_front(std::move(item));
-    item = std::move(p->second->to_process.back());
-    p->second->to_process.pop_back();
+    item = p->second->requeue_front(std::move(item));
     dout(20) << __func__
 	     << " " << p->second->to_process.front()
 	     << " shuffled w/ " << item << dendl;
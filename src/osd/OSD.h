@@ -42,8 +42,15 @@
 #include "Session.h"
 
 #include "osd/OpQueueItem.h"
+#include "osd/ObjectContextCache.h"
+#include "osd/OpCostModel.h"
+#include "osd/RecoveryThrottle.h"
+#include "osd/PhiAccrual.h"
+#include "osd/PeeringBatch.h"
 
+#include <array>
 #include <atomic>
+#include <cmath>
 #include <map>
 #include <memory>
 
@@ -104,6 +111,18 @@ enum {
   l_osd_op_before_queue_op_lat,
   l_osd_op_before_dequeue_op_lat,
 
+  // stage latencies of sampled client ops, see OpRequest::trace_point_t
+  l_osd_op_stage_msgr_lat,
+  l_osd_op_stage_dispatch_lat,
+  l_osd_op_stage_queue_lat,
+  l_osd_op_stage_pg_lat,
+  l_osd_op_stage_prepare_lat,
+  l_osd_op_stage_execute_lat,
+  l_osd_op_stage_commit_lat,
+  l_osd_op_stage_reply_lat,
+  l_osd_op_stage_done_lat,
+  l_osd_op_stage_lat_hist,
+
   l_osd_sop,
   l_osd_sop_inb,
   l_osd_sop_lat,
@@ -122,6 +141,31 @@ enum {
 
   l_osd_rop,
   l_osd_rbytes,
+  l_osd_recovery_objects,
+  l_osd_push_batch_objects,
+  l_osd_backfill_scan_wait_lat,
+  l_osd_backfill_scan_local_lat,
+  l_osd_backfill_scan_prefetch_hit,
+  l_osd_scrub_load_deferred,
+  l_osd_pg_log_bytes,
+  l_osd_pg_log_budget_pct,
+  l_osd_snap_trim_objects,
+  l_osd_snap_trim_batches,
+  l_osd_notify,
+  l_osd_notify_watchers,
+  l_osd_notify_lat,
+  l_osd_notify_timeout,
+  l_osd_notify_batch,
+  l_osd_pg_stats_full,
+  l_osd_pg_stats_delta,
+  l_osd_pg_stats_pgs,
+  l_osd_pg_stats_bytes,
+  l_osd_op_fast_read,
+  l_osd_op_fast_read_fallback,
+  l_osd_txn_batch,
+  l_osd_txn_batch_ops,
+  l_osd_op_batch,
+  l_osd_op_batch_ops,
 
   l_osd_loadavg,
   l_osd_buf,
@@ -137,6 +181,8 @@ enum {
   l_osd_pg_stray,
   l_osd_pg_removing,
   l_osd_hb_to,
+  l_osd_hb_rtt,
+  l_osd_hb_front_skipped,
   l_osd_map,
   l_osd_mape,
   l_osd_mape_dup,
@@ -149,12 +195,24 @@ enum {
   l_osd_map_cache_miss_low_avg,
   l_osd_map_bl_cache_hit,
   l_osd_map_bl_cache_miss,
+  l_osd_map_cache_maps,
+  l_osd_map_cache_bytes,
+
+  l_osd_op_cost_per_io,
+
+  l_osd_recovery_max_active,
+  l_osd_recovery_sleep,
+  l_osd_recovery_dev_util_pct,
+  l_osd_recovery_throttle_up,
+  l_osd_recovery_throttle_down,
 
   l_osd_stat_bytes,
   l_osd_stat_bytes_used,
   l_osd_stat_bytes_avail,
 
   l_osd_copyfrom,
+  l_osd_copyfrom_bytes_copied,
+  l_osd_copyfrom_bytes_shared,
 
   l_osd_tier_promote,
   l_osd_tier_flush,
@@ -175,7 +233,10 @@ enum {
   l_osd_agent_evict,
 
   l_osd_object_ctx_cache_hit,
+  l_osd_object_ctx_cache_miss,
   l_osd_object_ctx_cache_total,
+  l_osd_object_ctx_cache_pinned,
+  l_osd_object_ctx_cache_evict,
 
   l_osd_op_cache_hit,
   l_osd_tier_flush_lat,
@@ -223,6 +284,7 @@ enum {
   rs_getmissing_latency,
   rs_waitupthru_latency,
   rs_notrecovering_latency,
+  rs_peering_latency_cause_hist,
   rs_last,
 };
 
@@ -279,6 +341,7 @@ public:
 
   md_config_cacher_t<Option::size_t> osd_max_object_size;
   md_config_cacher_t<bool> osd_skip_data_digest;
+  md_config_cacher_t<bool> osd_op_cost_model;
 
   void enqueue_back(OpQueueItem&& qi);
   void enqueue_front(OpQueueItem&& qi);
@@ -442,6 +505,15 @@ private:
   int scrubs_pending;
   int scrubs_active;
 
+  // client load, sampled from the op perf counters each tick
+  pair<uint64_t, uint64_t> client_last_op_lat;  ///< op_latency (sum ns, count)
+  double client_op_lat = 0;   ///< smoothed client op latency (s)
+  uint64_t client_op_wip = 0; ///< client ops in progress
+  /// client load relative to the scrub thresholds; >= 1 means too busy
+  double scrub_client_load = 0;
+  /// current delay between snap trims, adapted to client latency
+  double snap_trim_sleep = 0;
+
 public:
   struct ScrubJob {
     CephContext* cct;
@@ -521,6 +593,16 @@ public:
   void dec_scrubs_pending();
   void dec_scrubs_active();
 
+  /// feed the current op_latency avg (sum ns, count) and op_wip gauge
+  void update_client_load(pair<uint64_t, uint64_t> op_lat,
+			  uint64_t op_wip);
+  /// true if client load is low enough to start a scrub
+  bool scrub_client_load_permits();
+  /// delay between scrub chunks, stretched while clients are busy
+  double get_scrub_sleep_time();
+  /// delay between snap trim batches
+  double get_snap_trim_sleep_time();
+
   void reply_op_error(OpRequestRef op, int err);
   void reply_op_error(OpRequestRef op, int err, eversion_t v, version_t uv);
   void handle_misdirected_op(PG *pg, OpRequestRef op);
@@ -771,10 +853,15 @@ private:
   uint64_t recovery_ops_active;
   uint64_t recovery_ops_reserved;
   bool recovery_paused;
+  // recovery limits adapted to client and device load, see
+  // update_recovery_throttle(); unused while the controller is off
+  bool recovery_throttle_enabled = false;
+  RecoveryThrottle recovery_throttle;
 #ifdef DEBUG_RECOVERY_OIDS
   map<spg_t, set<hobject_t> > recovery_oids;
 #endif
   bool _recover_now(uint64_t *available_pushes);
+  uint64_t _get_recovery_max_active();
   void _maybe_queue_recovery();
   void _queue_for_recovery(
     pair<epoch_t, PGRef> p, uint64_t reserved_pushes);
@@ -783,6 +870,17 @@ public:
   void finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue);
   bool is_recovery_active();
   void release_reserved_pushes(uint64_t pushes);
+  /**
+   * adapt recovery concurrency and sleep to client and device load;
+   * called once per tick
+   *
+   * @param dev_util busy fraction of the busiest store device, < 0 if
+   *        unknown
+   * @param base_sleep configured recovery sleep for our devices
+   */
+  void update_recovery_throttle(double dev_util, double base_sleep);
+  /// delay between recovery ops, given the configured one
+  double get_recovery_sleep_time(double base_sleep);
   void defer_recovery(float defer_for) {
     defer_recovery_until = ceph_clock_now();
     defer_recovery_until += defer_for;
@@ -833,6 +931,30 @@ public:
   SimpleLRU<epoch_t, bufferlist> map_bl_cache;
   SimpleLRU<epoch_t, bufferlist> map_bl_inc_cache;
 
+  // object contexts, shared by all PGs
+  ObjectContextCache obc_cache;
+
+  // mclock qos tenants (client entities and pools)
+  ceph::mclock::TenantInfoMgr qos_tenants;
+
+  // queue cost of client and replica ops
+  OpCostModel op_cost_model;
+
+  // -- pg log memory budget --
+private:
+  /// fraction of the configured log and dup lengths healthy PGs keep
+  std::atomic<double> pg_log_budget_ratio = {1.0};
+public:
+  /// adjust pg_log_budget_ratio toward osd_pg_log_memory_target
+  void update_pg_log_budget();
+  double get_pg_log_budget_ratio() const {
+    return pg_log_budget_ratio;
+  }
+  /// scale a configured pg log length by the current budget
+  uint64_t get_pg_log_budget(uint64_t n) const {
+    return std::max<uint64_t>(1, n * pg_log_budget_ratio);
+  }
+
   /// final pg_num values for recently deleted pools
   map<int64_t,int> deleted_pool_pg_nums;
 
@@ -847,6 +969,11 @@ public:
     return _add_map(o);
   }
   OSDMapRef _add_map(OSDMap *o);
+  /// number of OSDMaps pinned by map_cache
+  int get_map_cache_count() {
+    Mutex::Locker l(map_cache_lock);
+    return map_cache.get_count();
+  }
 
   void add_map_bl(epoch_t e, bufferlist& bl) {
     Mutex::Locker l(map_cache_lock);
@@ -1121,6 +1248,17 @@ struct OSDShardPGSlot {
 
   /// waiting for a merge (source or target) by this epoch
   epoch_t waiting_for_merge_epoch = 0;
+
+  /// put back an item taken off the front of a non-empty to_process,
+  /// ahead of what was queued since.  to_process keeps its length:
+  /// its newest item is displaced and returned, for the front of the
+  /// shard's pqueue.
+  OpQueueItem requeue_front(OpQueueItem&& item) {
+    to_process.push_front(std::move(item));
+    OpQueueItem displaced = std::move(to_process.back());
+    to_process.pop_back();
+    return displaced;
+  }
 };
 
 struct OSDShard {
@@ -1175,6 +1313,14 @@ struct OSDShard {
 
   ContextQueue context_queue;
 
+  /// peering messages of this shard's PGs that have not been sent yet
+  PeeringBatch peering_batch;
+  /// peering_batch is not empty; read without shard_lock
+  std::atomic<bool> peering_batch_pending = {false};
+
+  string peering_send_lock_name;
+  Mutex peering_send_lock;  ///< keeps batches taken from peering_batch in order
+
   void _enqueue_front(OpQueueItem&& item, unsigned cutoff) {
     unsigned priority = item.get_priority();
     unsigned cost = item.get_cost();
@@ -1233,7 +1379,9 @@ struct OSDShard {
       osdmap_lock(osdmap_lock_name.c_str(), false, false),
       shard_lock_name(shard_name + "::shard_lock"),
       shard_lock(shard_lock_name.c_str(), false, true, false),
-      context_queue(sdata_wait_lock, sdata_cond) {
+      context_queue(sdata_wait_lock, sdata_cond),
+      peering_send_lock_name(shard_name + "::peering_send_lock"),
+      peering_send_lock(peering_send_lock_name.c_str(), false, false) {
     if (opqueue == io_queue::weightedpriority) {
       pqueue = std::make_unique<
 	WeightedPriorityQueue<OpQueueItem,uint64_t>>(
@@ -1570,6 +1718,21 @@ private:
       }
       return !is_unhealthy(now);
     }
+
+    /// inter-arrival times of fully acked pings, for the phi detector
+    PhiAccrual acks;
+
+    /// ping round trip times, in power of two millisecond buckets
+    static constexpr int RTT_BUCKETS = 16;
+    std::array<uint64_t, RTT_BUCKETS> rtt_back = {};
+    std::array<uint64_t, RTT_BUCKETS> rtt_front = {};
+    static void note_rtt(std::array<uint64_t, RTT_BUCKETS> &h, utime_t rtt) {
+      uint64_t ms = rtt.to_msec();
+      int b = ms ? std::min(RTT_BUCKETS - 1, 64 - __builtin_clzll(ms)) : 0;
+      ++h[b];
+    }
+
+    void dump(Formatter *f, utime_t now) const;
   };
   /// state attached to outgoing heartbeat connections
   struct HeartbeatSession : public RefCountedObject {
@@ -1604,6 +1767,7 @@ private:
   void heartbeat_clear_peers_need_update() {
     heartbeat_need_update.store(false);
   }
+  uint64_t heartbeat_round = 0;  ///< picks each host's front ping target
   void heartbeat();
   void heartbeat_check();
   void heartbeat_entry();
@@ -1811,6 +1975,11 @@ protected:
   void dequeue_op(
     PGRef pg, OpRequestRef op,
     ThreadPool::TPHandle &handle);
+  bool dequeue_fast_read(
+    PGRef pg, OpRequestRef op, OSDMapRef osdmap);
+  void dequeue_op_batch(
+    OSDShard *sdata, PGRef pg, OpRequestRef op,
+    ThreadPool::TPHandle &handle);
 
   void enqueue_peering_evt(
     spg_t pgid,
@@ -2004,6 +2173,8 @@ protected:
   // -- failures --
   map<int,utime_t> failure_queue;
   map<int,pair<utime_t,entity_addrvec_t> > failure_pending;
+  /// peers in failure_queue/failure_pending reported by the phi detector
+  set<int> failure_by_phi;
 
   void requeue_failures();
   void send_failures();
@@ -2027,6 +2198,11 @@ protected:
   void dispatch_context_transaction(PG::RecoveryCtx &ctx, PG *pg,
                                     ThreadPool::TPHandle *handle = NULL);
   void discard_context(PG::RecoveryCtx &ctx);
+  void queue_peering_messages(OSDShard *sdata, spg_t pgid,
+			      PG::RecoveryCtx &ctx, OSDMapRef curmap);
+  void flush_peering_batch(OSDShard *sdata);
+  void flush_peering_batch(OSDShard *sdata, spg_t pgid);
+  void send_peering_batch(PeeringBatch& batch);
   void do_notifies(map<int,
 		       vector<pair<pg_notify_t, PastIntervals> > >&
 		       notify_list,
@@ -2130,6 +2306,10 @@ protected:
   int _do_command(
     Connection *con, cmdmap_t& cmdmap, ceph_tid_t tid, bufferlist& data,
     bufferlist& odata, stringstream& ss, stringstream& ds);
+  int check_osd_bench_args(int64_t count, int64_t bsize, ostream& ss);
+  int run_osd_bench_test(int64_t count, int64_t bsize, int64_t osize,
+			 int64_t onum, double *elapsed, ostream& ss);
+  void calibrate_op_cost();
 
 
   // -- pg recovery --
@@ -2144,7 +2324,11 @@ protected:
   bool scrub_time_permit(utime_t now);
 
   // -- status reporting --
-  MPGStats *collect_pg_stats();
+  // only touched by collect_pg_stats(), which MgrClient serializes
+  /// (reported_epoch, reported_seq) of each pg in the last report
+  map<pg_t, pair<epoch_t, version_t>> pg_stats_reported;
+  utime_t last_pg_stats_full;
+  MPGStats *collect_pg_stats(uint64_t features, bool resync);
   std::vector<DaemonHealthMetric> get_health_metrics();
 
 
@@ -2154,6 +2338,7 @@ private:
     switch (m->get_type()) {
     case CEPH_MSG_PING:
     case CEPH_MSG_OSD_OP:
+    case CEPH_MSG_OSD_OP_BATCH:
     case CEPH_MSG_OSD_BACKOFF:
     case MSG_OSD_SCRUB2:
     case MSG_OSD_FORCE_RECOVERY:
@@ -2191,6 +2376,8 @@ private:
       return false;
     }
   }
+  /// start a stage latency trace for every osd_op_trace_sample_rate'th op
+  void maybe_trace_op(OpRequestRef& op);
   void ms_fast_dispatch(Message *m) override;
   void ms_fast_preprocess(Message *m) override;
   bool ms_dispatch(Message *m) override;
@@ -2279,6 +2466,7 @@ private:
 
   void handle_scrub(struct MOSDScrub *m);
   void handle_fast_scrub(struct MOSDScrub2 *m);
+  void handle_fast_op_batch(class MOSDOpBatch *m);
   void handle_osd_ping(class MOSDPing *m);
 
   int init_op_flags(OpRequestRef& op);
@@ -1196,11 +1196,11 @@ void OSDMap::set_epoch(epoch_t e)
 
 bool OSDMap::is_blacklisted(const entity_addr_t& a) const
 {
-  if (blacklist.empty())
+  if (blacklist->empty())
     return false;
 
   // this specific instance?
-  if (blacklist.count(a))
+  if (blacklist->count(a))
     return true;
 
   // is entire ip blacklisted?
@@ -1208,7 +1208,7 @@ bool OSDMap::is_blacklisted(const entity_addr_t& a) const
     entity_addr_t b = a;
     b.set_port(0);
     b.set_nonce(0);
-    if (blacklist.count(b)) {
+    if (blacklist->count(b)) {
       return true;
     }
   }
@@ -1218,12 +1218,12 @@ bool OSDMap::is_blacklisted(const entity_addr_t& a) const
 
 bool OSDMap::is_blacklisted(const entity_addrvec_t& av) const
 {
-  if (blacklist.empty())
+  if (blacklist->empty())
     return false;
 
   for (auto& a : av.v) {
     // this specific instance?
-    if (blacklist.count(a))
+    if (blacklist->count(a))
       return true;
 
     // is entire ip blacklisted?
@@ -1231,7 +1231,7 @@ bool OSDMap::is_blacklisted(const entity_addrvec_t& av) const
       entity_addr_t b = a;
       b.set_port(0);
       b.set_nonce(0);
-      if (blacklist.count(b)) {
+      if (blacklist->count(b)) {
 	return true;
       }
     }
@@ -1242,12 +1242,12 @@ bool OSDMap::is_blacklisted(const entity_addrvec_t& av) const
 
 void OSDMap::get_blacklist(list<pair<entity_addr_t,utime_t> > *bl) const
 {
-   std::copy(blacklist.begin(), blacklist.end(), std::back_inserter(*bl));
+   std::copy(blacklist->begin(), blacklist->end(), std::back_inserter(*bl));
 }
 
 void OSDMap::get_blacklist(std::set<entity_addr_t> *bl) const
 {
-  for (const auto &i : blacklist) {
+  for (const auto &i : *blacklist) {
     bl->insert(i.first);
   }
 }
@@ -1262,15 +1262,29 @@ void OSDMap::set_max_osd(int m)
     osd_state[o] = 0;
     osd_weight[o] = CEPH_OSD_OUT;
   }
-  osd_info.resize(m);
-  osd_xinfo.resize(m);
-  osd_addrs->client_addrs.resize(m);
-  osd_addrs->cluster_addrs.resize(m);
-  osd_addrs->hb_back_addrs.resize(m);
-  osd_addrs->hb_front_addrs.resize(m);
-  osd_uuid->resize(m);
-  if (osd_primary_affinity)
+  if (osd_info->size() != (size_t)m) {
+    unshare(osd_info);
+    osd_info->resize(m);
+  }
+  if (osd_xinfo->size() != (size_t)m) {
+    unshare(osd_xinfo);
+    osd_xinfo->resize(m);
+  }
+  if (osd_addrs->client_addrs.size() != (size_t)m) {
+    unshare(osd_addrs);
+    osd_addrs->client_addrs.resize(m);
+    osd_addrs->cluster_addrs.resize(m);
+    osd_addrs->hb_back_addrs.resize(m);
+    osd_addrs->hb_front_addrs.resize(m);
+  }
+  if (osd_uuid->size() != (size_t)m) {
+    unshare(osd_uuid);
+    osd_uuid->resize(m);
+  }
+  if (osd_primary_affinity && osd_primary_affinity->size() != (size_t)m) {
+    unshare(osd_primary_affinity);
     osd_primary_affinity->resize(m, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
+  }
 
   calc_num_osds();
 }
@@ -1463,7 +1477,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
   }
   mask |= CEPH_FEATURES_CRUSH;
 
-  if (!pg_upmap.empty() || !pg_upmap_items.empty())
+  if (!pg_upmap->empty() || !pg_upmap_items->empty())
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
 
@@ -1596,10 +1610,13 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
 
   int diff = 0;
 
-  // do addrs match?
+  // do addrs match?  (the per-osd entries are only worth comparing when
+  // the containers differ)
   if (o->max_osd != n->max_osd)
     diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+  for (int i = 0;
+       o->osd_addrs != n->osd_addrs && i < o->max_osd && i < n->max_osd;
+       i++) {
     if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
 	*n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
       n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
@@ -1627,27 +1644,50 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   }
 
   // does crush match?
-  bufferlist oc, nc;
-  encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (o->crush != n->crush) {
+    bufferlist oc, nc;
+    encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    if (oc.contents_equal(nc)) {
+      n->crush = o->crush;
+    }
   }
 
   // does pg_temp match?
-  if (*o->pg_temp == *n->pg_temp)
+  if (o->pg_temp != n->pg_temp &&
+      *o->pg_temp == *n->pg_temp)
     n->pg_temp = o->pg_temp;
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
-    if (*o->primary_temp == *n->primary_temp)
-      n->primary_temp = o->primary_temp;
-  }
+  if (o->primary_temp != n->primary_temp &&
+      o->primary_temp->size() == n->primary_temp->size() &&
+      *o->primary_temp == *n->primary_temp)
+    n->primary_temp = o->primary_temp;
+
+  // do upmaps match?
+  if (o->pg_upmap != n->pg_upmap &&
+      *o->pg_upmap == *n->pg_upmap)
+    n->pg_upmap = o->pg_upmap;
+  if (o->pg_upmap_items != n->pg_upmap_items &&
+      *o->pg_upmap_items == *n->pg_upmap_items)
+    n->pg_upmap_items = o->pg_upmap_items;
 
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (o->osd_uuid != n->osd_uuid &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
+
+  // does the blacklist match?
+  if (o->blacklist != n->blacklist &&
+      *o->blacklist == *n->blacklist)
+    n->blacklist = o->blacklist;
+
+  // do primary affinities match?
+  if (o->osd_primary_affinity && n->osd_primary_affinity &&
+      o->osd_primary_affinity != n->osd_primary_affinity &&
+      *o->osd_primary_affinity == *n->osd_primary_affinity)
+    n->osd_primary_affinity = o->osd_primary_affinity;
 }
 
 void OSDMap::clean_temps(CephContext *cct,
@@ -1741,10 +1781,10 @@ void OSDMap::maybe_remove_pg_upmaps(CephContext *cct,
   set<pg_t> to_cancel;
   map<int, map<int, float>> rule_weight_map;
 
-  for (auto& p : nextmap.pg_upmap) {
+  for (auto& p : *nextmap.pg_upmap) {
     to_check.insert(p.first);
   }
-  for (auto& p : nextmap.pg_upmap_items) {
+  for (auto& p : *nextmap.pg_upmap_items) {
     to_check.insert(p.first);
   }
   for (auto& p : pending_inc->new_pg_upmap) {
@@ -1831,10 +1871,10 @@ void OSDMap::maybe_remove_pg_upmaps(CephContext *cct,
                        << dendl;
         pending_inc->new_pg_upmap.erase(it);
       }
-      if (oldmap.pg_upmap.count(pg)) {
+      if (oldmap.pg_upmap->count(pg)) {
         ldout(cct, 10) << __func__ << " cancel invalid pg_upmap entry "
-                       << oldmap.pg_upmap.find(pg)->first << "->"
-                       << oldmap.pg_upmap.find(pg)->second
+                       << oldmap.pg_upmap->find(pg)->first << "->"
+                       << oldmap.pg_upmap->find(pg)->second
                        << dendl;
         pending_inc->old_pg_upmap.insert(pg);
       }
@@ -1848,11 +1888,11 @@ void OSDMap::maybe_remove_pg_upmaps(CephContext *cct,
                        << dendl;
         pending_inc->new_pg_upmap_items.erase(it);
       }
-      if (oldmap.pg_upmap_items.count(pg)) {
+      if (oldmap.pg_upmap_items->count(pg)) {
         ldout(cct, 10) << __func__ << " cancel invalid "
                        << "pg_upmap_items entry "
-                       << oldmap.pg_upmap_items.find(pg)->first << "->"
-                       << oldmap.pg_upmap_items.find(pg)->second
+                       << oldmap.pg_upmap_items->find(pg)->first << "->"
+                       << oldmap.pg_upmap_items->find(pg)->second
                        << dendl;
         pending_inc->old_pg_upmap_items.insert(pg);
       }
@@ -1958,7 +1998,10 @@ int OSDMap::apply_incremental(const Incremental &inc)
     // xinfo old_weight.
     if (weight.second) {
       osd_state[weight.first] &= ~(CEPH_OSD_AUTOOUT | CEPH_OSD_NEW);
-      osd_xinfo[weight.first].old_weight = 0;
+      if ((*osd_xinfo)[weight.first].old_weight) {
+	unshare(osd_xinfo);
+	(*osd_xinfo)[weight.first].old_weight = 0;
+      }
     }
   }
 
@@ -1980,15 +2023,21 @@ int OSDMap::apply_incremental(const Incremental &inc)
     int s = state.second ? state.second : CEPH_OSD_UP;
     if ((osd_state[osd] & CEPH_OSD_UP) &&
 	(s & CEPH_OSD_UP)) {
-      osd_info[osd].down_at = epoch;
-      osd_xinfo[osd].down_stamp = modified;
+      unshare(osd_info);
+      unshare(osd_xinfo);
+      (*osd_info)[osd].down_at = epoch;
+      (*osd_xinfo)[osd].down_stamp = modified;
     }
     if ((osd_state[osd] & CEPH_OSD_EXISTS) &&
 	(s & CEPH_OSD_EXISTS)) {
       // osd is destroyed; clear out anything interesting.
+      unshare(osd_uuid);
+      unshare(osd_addrs);
+      unshare(osd_info);
+      unshare(osd_xinfo);
       (*osd_uuid)[osd] = uuid_d();
-      osd_info[osd] = osd_info_t();
-      osd_xinfo[osd] = osd_xinfo_t();
+      (*osd_info)[osd] = osd_info_t();
+      (*osd_xinfo)[osd] = osd_xinfo_t();
       set_primary_affinity(osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
       osd_addrs->client_addrs[osd].reset(new entity_addrvec_t());
       osd_addrs->cluster_addrs[osd].reset(new entity_addrvec_t());
@@ -2000,6 +2049,13 @@ int OSDMap::apply_incremental(const Incremental &inc)
     }
   }
 
+  if (!inc.new_up_client.empty() || !inc.new_up_cluster.empty()) {
+    unshare(osd_addrs);
+  }
+  if (!inc.new_up_client.empty() || !inc.new_up_thru.empty() ||
+      !inc.new_last_clean_interval.empty() || !inc.new_lost.empty()) {
+    unshare(osd_info);
+  }
   for (const auto &client : inc.new_up_client) {
     osd_state[client.first] |= CEPH_OSD_EXISTS | CEPH_OSD_UP;
     osd_addrs->client_addrs[client.first].reset(
@@ -2009,7 +2065,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
     osd_addrs->hb_front_addrs[client.first].reset(
       new entity_addrvec_t(inc.new_hb_front_up.find(client.first)->second));
 
-    osd_info[client.first].up_from = epoch;
+    (*osd_info)[client.first].up_from = epoch;
   }
 
   for (const auto &cluster : inc.new_up_cluster)
@@ -2018,25 +2074,31 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   // info
   for (const auto &thru : inc.new_up_thru)
-    osd_info[thru.first].up_thru = thru.second;
+    (*osd_info)[thru.first].up_thru = thru.second;
   
   for (const auto &interval : inc.new_last_clean_interval) {
-    osd_info[interval.first].last_clean_begin = interval.second.first;
-    osd_info[interval.first].last_clean_end = interval.second.second;
+    (*osd_info)[interval.first].last_clean_begin = interval.second.first;
+    (*osd_info)[interval.first].last_clean_end = interval.second.second;
   }
   
   for (const auto &lost : inc.new_lost)
-    osd_info[lost.first].lost_at = lost.second;
+    (*osd_info)[lost.first].lost_at = lost.second;
 
   // xinfo
+  if (!inc.new_xinfo.empty())
+    unshare(osd_xinfo);
   for (const auto &xinfo : inc.new_xinfo)
-    osd_xinfo[xinfo.first] = xinfo.second;
+    (*osd_xinfo)[xinfo.first] = xinfo.second;
 
   // uuid
+  if (!inc.new_uuid.empty())
+    unshare(osd_uuid);
   for (const auto &uuid : inc.new_uuid)
     (*osd_uuid)[uuid.first] = uuid.second;
 
   // pg rebuild
+  if (!inc.new_pg_temp.empty())
+    unshare(pg_temp);
   for (const auto &pg : inc.new_pg_temp) {
     if (pg.second.empty())
       pg_temp->erase(pg.first);
@@ -2048,6 +2110,8 @@ int OSDMap::apply_incremental(const Incremental &inc)
     pg_temp->rebuild();
   }
 
+  if (!inc.new_primary_temp.empty())
+    unshare(primary_temp);
   for (const auto &pg : inc.new_primary_temp) {
     if (pg.second == -1)
       primary_temp->erase(pg.first);
@@ -2055,26 +2119,32 @@ int OSDMap::apply_incremental(const Incremental &inc)
       (*primary_temp)[pg.first] = pg.second;
   }
 
+  if (!inc.new_pg_upmap.empty() || !inc.old_pg_upmap.empty())
+    unshare(pg_upmap);
   for (auto& p : inc.new_pg_upmap) {
-    pg_upmap[p.first] = p.second;
+    (*pg_upmap)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap) {
-    pg_upmap.erase(pg);
+    pg_upmap->erase(pg);
   }
+  if (!inc.new_pg_upmap_items.empty() || !inc.old_pg_upmap_items.empty())
+    unshare(pg_upmap_items);
   for (auto& p : inc.new_pg_upmap_items) {
-    pg_upmap_items[p.first] = p.second;
+    (*pg_upmap_items)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap_items) {
-    pg_upmap_items.erase(pg);
+    pg_upmap_items->erase(pg);
   }
 
   // blacklist
+  if (!inc.new_blacklist.empty() || !inc.old_blacklist.empty())
+    unshare(blacklist);
   if (!inc.new_blacklist.empty()) {
-    blacklist.insert(inc.new_blacklist.begin(),inc.new_blacklist.end());
+    blacklist->insert(inc.new_blacklist.begin(),inc.new_blacklist.end());
     new_blacklist_entries = true;
   }
   for (const auto &addr : inc.old_blacklist)
-    blacklist.erase(addr);
+    blacklist->erase(addr);
 
   // cluster snapshot?
   if (inc.cluster_snapshot.length()) {
@@ -2228,8 +2298,8 @@ int OSDMap::_pick_primary(const vector<int>& osds) const
 void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) const
 {
   pg_t pg = pi.raw_pg_to_pg(raw_pg);
-  auto p = pg_upmap.find(pg);
-  if (p != pg_upmap.end()) {
+  auto p = pg_upmap->find(pg);
+  if (p != pg_upmap->end()) {
     // make sure targets aren't marked out
     for (auto osd : p->second) {
       if (osd != CRUSH_ITEM_NONE && osd < max_osd && osd >= 0 &&
@@ -2242,8 +2312,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
     // continue to check and apply pg_upmap_items if any
   }
 
-  auto q = pg_upmap_items.find(pg);
-  if (q != pg_upmap_items.end()) {
+  auto q = pg_upmap_items->find(pg);
+  if (q != pg_upmap_items->end()) {
     // NOTE: this approach does not allow a bidirectional swap,
     // e.g., [[1,2],[2,1]] applied to [0,1,2] -> [0,2,1].
     for (auto& r : q->second) {
@@ -2271,6 +2341,39 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
   }
 }
 
+void OSDMap::get_explicit_mappings(const set<int>& osds, set<pg_t> *pgs) const
+{
+  for (auto p : *pg_temp) {
+    for (auto osd : p.second) {
+      if (osds.count(osd)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  for (auto& p : *primary_temp) {
+    if (osds.count(p.second)) {
+      pgs->insert(p.first);
+    }
+  }
+  for (auto& p : *pg_upmap) {
+    for (auto osd : p.second) {
+      if (osds.count(osd)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  for (auto& p : *pg_upmap_items) {
+    for (auto& q : p.second) {
+      if (osds.count(q.first) || osds.count(q.second)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+}
+
 // pg -> (up osd list)
 void OSDMap::_raw_to_up_osds(const pg_pool_t& pool, const vector<int>& raw,
                              vector<int> *up) const
@@ -2629,13 +2732,13 @@ void OSDMap::encode_classic(bufferlist& bl, uint64_t features) const
   __u16 ev = 10;
   encode(ev, bl);
   encode(osd_addrs->hb_back_addrs, bl, features);
-  encode(osd_info, bl);
-  encode(blacklist, bl, features);
+  encode(*osd_info, bl);
+  encode(*blacklist, bl, features);
   encode(osd_addrs->cluster_addrs, bl, features);
   encode(cluster_snapshot_epoch, bl);
   encode(cluster_snapshot, bl);
   encode(*osd_uuid, bl);
-  encode(osd_xinfo, bl);
+  encode(*osd_xinfo, bl);
   encode(osd_addrs->hb_front_addrs, bl, features);
 }
 
@@ -2729,11 +2832,11 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     encode(erasure_code_profiles, bl);
 
     if (v >= 4) {
-      encode(pg_upmap, bl);
-      encode(pg_upmap_items, bl);
+      encode(*pg_upmap, bl);
+      encode(*pg_upmap_items, bl);
     } else {
-      ceph_assert(pg_upmap.empty());
-      ceph_assert(pg_upmap_items.empty());
+      ceph_assert(pg_upmap->empty());
+      ceph_assert(pg_upmap_items->empty());
     }
     if (v >= 6) {
       encode(crush_version, bl);
@@ -2766,12 +2869,12 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     } else {
       encode(osd_addrs->hb_back_addrs, bl, features);
     }
-    encode(osd_info, bl);
+    encode(*osd_info, bl);
     {
       // put this in a sorted, ordered map<> so that we encode in a
       // deterministic order.
       map<entity_addr_t,utime_t> blacklist_map;
-      for (const auto &addr : blacklist)
+      for (const auto &addr : *blacklist)
 	blacklist_map.insert(make_pair(addr.first, addr.second));
       encode(blacklist_map, bl, features);
     }
@@ -2783,7 +2886,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     encode(cluster_snapshot_epoch, bl);
     encode(cluster_snapshot, bl);
     encode(*osd_uuid, bl);
-    encode(osd_xinfo, bl);
+    encode(*osd_xinfo, bl);
     if (target_v < 7) {
       encode_addrvec_pvec_as_addr(osd_addrs->hb_front_addrs, bl, features);
     } else {
@@ -2919,11 +3022,11 @@ void OSDMap::decode_classic(bufferlist::const_iterator& p)
   if (v >= 5)
     decode(ev, p);
   decode(osd_addrs->hb_back_addrs, p);
-  decode(osd_info, p);
+  decode(*osd_info, p);
   if (v < 5)
     decode(pool_name, p);
 
-  decode(blacklist, p);
+  decode(*blacklist, p);
   if (ev >= 6)
     decode(osd_addrs->cluster_addrs, p);
   else
@@ -2940,9 +3043,9 @@ void OSDMap::decode_classic(bufferlist::const_iterator& p)
     osd_uuid->resize(max_osd);
   }
   if (ev >= 9)
-    decode(osd_xinfo, p);
+    decode(*osd_xinfo, p);
   else
-    osd_xinfo.resize(max_osd);
+    osd_xinfo->resize(max_osd);
 
   if (ev >= 10)
     decode(osd_addrs->hb_front_addrs, p);
@@ -2968,6 +3071,19 @@ void OSDMap::decode(bufferlist::const_iterator& bl)
   size_t tail_offset = 0;
   bufferlist crc_front, crc_tail;
 
+  // never decode into structures shared with another map
+  osd_addrs = std::make_shared<addrs_s>();
+  pg_temp = std::make_shared<PGTempMap>();
+  primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
+  pg_upmap = std::make_shared<pg_upmap_t>();
+  pg_upmap_items = std::make_shared<pg_upmap_items_t>();
+  osd_uuid = std::make_shared<mempool::osdmap::vector<uuid_d>>();
+  osd_info = std::make_shared<mempool::osdmap::vector<osd_info_t>>();
+  osd_xinfo = std::make_shared<mempool::osdmap::vector<osd_xinfo_t>>();
+  blacklist = std::make_shared<blacklist_t>();
+  osd_primary_affinity.reset();
+  crush = std::make_shared<CrushWrapper>();
+
   DECODE_START_LEGACY_COMPAT_LEN(8, 7, 7, bl); // wrapper
   if (struct_v < 7) {
     int struct_v_size = sizeof(struct_v);
@@ -3028,11 +3144,11 @@ void OSDMap::decode(bufferlist::const_iterator& bl)
       erasure_code_profiles.clear();
     }
     if (struct_v >= 4) {
-      decode(pg_upmap, bl);
-      decode(pg_upmap_items, bl);
+      decode(*pg_upmap, bl);
+      decode(*pg_upmap_items, bl);
     } else {
-      pg_upmap.clear();
-      pg_upmap_items.clear();
+      pg_upmap->clear();
+      pg_upmap_items->clear();
     }
     if (struct_v >= 6) {
       decode(crush_version, bl);
@@ -3051,13 +3167,13 @@ void OSDMap::decode(bufferlist::const_iterator& bl)
   {
     DECODE_START(7, bl); // extended, osd-only data
     decode(osd_addrs->hb_back_addrs, bl);
-    decode(osd_info, bl);
-    decode(blacklist, bl);
+    decode(*osd_info, bl);
+    decode(*blacklist, bl);
     decode(osd_addrs->cluster_addrs, bl);
     decode(cluster_snapshot_epoch, bl);
     decode(cluster_snapshot, bl);
     decode(*osd_uuid, bl);
-    decode(osd_xinfo, bl);
+    decode(*osd_xinfo, bl);
     decode(osd_addrs->hb_front_addrs, bl);
     if (struct_v >= 2) {
       decode(nearfull_ratio, bl);
@@ -3241,14 +3357,14 @@ void OSDMap::dump(Formatter *f) const
     if (exists(i)) {
       f->open_object_section("xinfo");
       f->dump_int("osd", i);
-      osd_xinfo[i].dump(f);
+      (*osd_xinfo)[i].dump(f);
       f->close_section();
     }
   }
   f->close_section();
 
   f->open_array_section("pg_upmap");
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("osds");
@@ -3260,7 +3376,7 @@ void OSDMap::dump(Formatter *f) const
   }
   f->close_section();
   f->open_array_section("pg_upmap_items");
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("mappings");
@@ -3286,7 +3402,7 @@ void OSDMap::dump(Formatter *f) const
   f->close_section(); // primary_temp
 
   f->open_object_section("blacklist");
-  for (const auto &addr : blacklist) {
+  for (const auto &addr : *blacklist) {
     stringstream ss;
     ss << addr.first;
     f->dump_stream(ss.str().c_str()) << addr.second;
@@ -3351,7 +3467,7 @@ void OSDMap::generate_test_instances(list<OSDMap*>& o)
   uuid_d fsid;
   o.back()->build_simple(cct, 1, fsid, 16);
   o.back()->created = o.back()->modified = utime_t(1, 2);  // fix timestamp
-  o.back()->blacklist[entity_addr_t()] = utime_t(5, 6);
+  (*o.back()->blacklist)[entity_addr_t()] = utime_t(5, 6);
   cct->put();
 }
 
@@ -3486,10 +3602,10 @@ void OSDMap::print(ostream& out) const
   }
   out << std::endl;
 
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     out << "pg_upmap " << p.first << " " << p.second << "\n";
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     out << "pg_upmap_items " << p.first << " " << p.second << "\n";
   }
 
@@ -3499,7 +3615,7 @@ void OSDMap::print(ostream& out) const
   for (const auto pg : *primary_temp)
     out << "primary_temp " << pg.first << " " << pg.second << "\n";
 
-  for (const auto &addr : blacklist)
+  for (const auto &addr : *blacklist)
     out << "blacklist " << addr.first << " expires " << addr.second << "\n";
 }
 
@@ -4190,7 +4306,7 @@ int OSDMap::clean_pg_upmaps(
 {
   ldout(cct, 10) << __func__ << dendl;
   int changed = 0;
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     vector<int> raw;
     int primary;
     pg_to_raw_osds(p.first, &raw, &primary);
@@ -4201,7 +4317,7 @@ int OSDMap::clean_pg_upmaps(
       ++changed;
     }
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     vector<int> raw;
     int primary;
     pg_to_raw_osds(p.first, &raw, &primary);
@@ -4288,6 +4404,7 @@ int OSDMap::calc_pg_upmaps(
   }
   OSDMap tmp;
   tmp.deepish_copy_from(*this);
+  unshare(tmp.pg_upmap_items);
   float start_deviation = 0;
   float end_deviation = 0;
   int num_changed = 0;
@@ -4408,8 +4525,8 @@ int OSDMap::calc_pg_upmaps(
 
       // look for remaps we can un-remap
       for (auto pg : pgs) {
-	auto p = tmp.pg_upmap_items.find(pg);
-	if (p != tmp.pg_upmap_items.end()) {
+	auto p = tmp.pg_upmap_items->find(pg);
+	if (p != tmp.pg_upmap_items->end()) {
 	  for (auto q : p->second) {
 	    if (q.second == osd) {
 	      ldout(cct, 10) << "  dropping pg_upmap_items " << pg
@@ -4418,7 +4535,7 @@ int OSDMap::calc_pg_upmaps(
                 pgs_by_osd[i.second].erase(pg);
                 pgs_by_osd[i.first].insert(pg);
               }
-	      tmp.pg_upmap_items.erase(p);
+	      tmp.pg_upmap_items->erase(p);
 	      pending_inc->old_pg_upmap_items.insert(pg);
 	      ++num_changed;
 	      restart = true;
@@ -4432,8 +4549,8 @@ int OSDMap::calc_pg_upmaps(
 	break;
 
       for (auto pg : pgs) {
-	if (tmp.pg_upmap.count(pg) ||
-	    tmp.pg_upmap_items.count(pg)) {
+	if (tmp.pg_upmap->count(pg) ||
+	    tmp.pg_upmap_items->count(pg)) {
 	  ldout(cct, 20) << "  already remapped " << pg << dendl;
 	  continue;
 	}
@@ -4447,7 +4564,7 @@ int OSDMap::calc_pg_upmaps(
 	  continue;
 	}
 	ceph_assert(orig != out);
-	auto& rmi = tmp.pg_upmap_items[pg];
+	auto& rmi = (*tmp.pg_upmap_items)[pg];
 	for (unsigned i = 0; i < out.size(); ++i) {
 	  if (orig[i] != out[i]) {
 	    rmi.push_back(make_pair(orig[i], out[i]));
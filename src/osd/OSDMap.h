@@ -538,14 +538,16 @@ private:
   entity_addrvec_t _blank_addrvec;
 
   mempool::osdmap::vector<__u32>   osd_weight;   // 16.16 fixed point, 0x10000 = "in", 0 = "out"
-  mempool::osdmap::vector<osd_info_t> osd_info;
+  std::shared_ptr< mempool::osdmap::vector<osd_info_t> > osd_info;
   std::shared_ptr<PGTempMap> pg_temp;  // temp pg mapping (e.g. while we rebuild)
   std::shared_ptr< mempool::osdmap::map<pg_t,int32_t > > primary_temp;  // temp primary mapping (e.g. while we rebuild)
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
+  typedef mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap_t;
+  typedef mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>> pg_upmap_items_t;
+  std::shared_ptr<pg_upmap_t> pg_upmap; ///< remap pg
+  std::shared_ptr<pg_upmap_items_t> pg_upmap_items; ///< remap osds in up set
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,string> pool_name;
@@ -553,9 +555,10 @@ private:
   mempool::osdmap::map<string,int64_t> name_pool;
 
   std::shared_ptr< mempool::osdmap::vector<uuid_d> > osd_uuid;
-  mempool::osdmap::vector<osd_xinfo_t> osd_xinfo;
+  std::shared_ptr< mempool::osdmap::vector<osd_xinfo_t> > osd_xinfo;
 
-  mempool::osdmap::unordered_map<entity_addr_t,utime_t> blacklist;
+  typedef mempool::osdmap::unordered_map<entity_addr_t,utime_t> blacklist_t;
+  std::shared_ptr<blacklist_t> blacklist;
 
   /// queue of snaps to remove
   mempool::osdmap::map<int64_t, snap_interval_set_t> removed_snaps_queue;
@@ -604,9 +607,14 @@ private:
 	     num_osd(0), num_up_osd(0), num_in_osd(0),
 	     max_osd(0),
 	     osd_addrs(std::make_shared<addrs_s>()),
+	     osd_info(std::make_shared<mempool::osdmap::vector<osd_info_t>>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<pg_upmap_t>()),
+	     pg_upmap_items(std::make_shared<pg_upmap_items_t>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
+	     osd_xinfo(std::make_shared<mempool::osdmap::vector<osd_xinfo_t>>()),
+	     blacklist(std::make_shared<blacklist_t>()),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
 	     cached_up_osd_features(0),
@@ -626,20 +634,30 @@ public:
 
   uint64_t get_encoding_features() const;
 
+private:
+  /// give this map its own copy of *p before modifying it
+  template<typename T>
+  static void unshare(std::shared_ptr<T>& p) {
+    // only maps under construction are modified, so nobody can take
+    // a new reference to p behind our back
+    if (p && p.use_count() > 1) {
+      p = std::make_shared<T>(*p);
+    }
+  }
+public:
+
+  /**
+   * copy o, sharing the large sub-structures (addrs, osd info and
+   * xinfo, temps, upmaps, uuids, primary affinity, blacklist and crush)
+   * with it.  anything that modifies one of them goes through unshare()
+   * first, so o is never affected, and a map derived from an incremental
+   * keeps sharing whatever the incremental did not touch.
+   *
+   * pools are still copied: nearly every incremental touches some
+   * pg_pool_t, and OSDMonitor edits them in place.
+   */
   void deepish_copy_from(const OSDMap& o) {
     *this = o;
-    primary_temp.reset(new mempool::osdmap::map<pg_t,int32_t>(*o.primary_temp));
-    pg_temp.reset(new PGTempMap(*o.pg_temp));
-    osd_uuid.reset(new mempool::osdmap::vector<uuid_d>(*o.osd_uuid));
-
-    if (o.osd_primary_affinity)
-      osd_primary_affinity.reset(new mempool::osdmap::vector<__u32>(*o.osd_primary_affinity));
-
-    // NOTE: this still references shared entity_addrvec_t's.
-    osd_addrs.reset(new addrs_s(*o.osd_addrs));
-
-    // NOTE: we do not copy crush.  note that apply_incremental will
-    // allocate a new CrushWrapper, though.
   }
 
   // map info
@@ -755,6 +773,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
+    unshare(osd_primary_affinity);
     (*osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
@@ -929,24 +948,24 @@ public:
 
   const epoch_t& get_up_from(int osd) const {
     ceph_assert(exists(osd));
-    return osd_info[osd].up_from;
+    return (*osd_info)[osd].up_from;
   }
   const epoch_t& get_up_thru(int osd) const {
     ceph_assert(exists(osd));
-    return osd_info[osd].up_thru;
+    return (*osd_info)[osd].up_thru;
   }
   const epoch_t& get_down_at(int osd) const {
     ceph_assert(exists(osd));
-    return osd_info[osd].down_at;
+    return (*osd_info)[osd].down_at;
   }
   const osd_info_t& get_info(int osd) const {
     ceph_assert(osd < max_osd);
-    return osd_info[osd];
+    return (*osd_info)[osd];
   }
 
   const osd_xinfo_t& get_xinfo(int osd) const {
     ceph_assert(osd < max_osd);
-    return osd_xinfo[osd];
+    return (*osd_xinfo)[osd];
   }
   
   int get_next_up_osd_after(int n) const {
@@ -1016,7 +1035,7 @@ public:
 
   int apply_incremental(const Incremental &inc);
 
-  /// try to re-use/reference addrs in oldmap from newmap
+  /// make newmap reference any sub-structure it has in common with oldmap
   static void dedup(const OSDMap *oldmap, OSDMap *newmap);
 
   static void clean_temps(CephContext *cct,
@@ -1177,6 +1196,8 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /// pgs whose pg_temp, primary_temp or upmap entry names any of osds
+  void get_explicit_mappings(const set<int>& osds, set<pg_t> *pgs) const;
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
@@ -1426,8 +1447,8 @@ public:
   int validate_crush_rules(CrushWrapper *crush, ostream *ss) const;
 
   void clear_temp() {
-    pg_temp->clear();
-    primary_temp->clear();
+    pg_temp = std::make_shared<PGTempMap>();
+    primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
   }
 
 private:
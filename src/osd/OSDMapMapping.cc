@@ -12,8 +12,10 @@ MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
 			      osdmap_mapping);
 
 // ensure that we have a PoolMappings for each pool and that
-// the dimensions (pg_num and size) match up.
-void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
+// the dimensions (pg_num and size) match up.  pools whose mapping
+// had to be (re)created are added to *created.
+void OSDMapMapping::_init_mappings(const OSDMap& osdmap,
+				   std::set<int64_t> *created)
 {
   num_pgs = 0;
   auto q = pools.begin();
@@ -37,16 +39,149 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
     pools.emplace(p.first, PoolMapping(p.second.get_size(),
 				       p.second.get_pg_num(),
 				       p.second.is_erasure()));
+    created->insert(p.first);
   }
   pools.erase(q, pools.end());
   ceph_assert(pools.size() == osdmap.get_pools().size());
 }
 
+void OSDMapMapping::note_incremental(const OSDMap::Incremental& inc)
+{
+  if (pending.size() >= MAX_PENDING) {
+    // leaves a gap after epoch, so the next update maps everything
+    pending.clear();
+  }
+  Changes& c = pending[inc.epoch];
+  if (inc.fullmap.length() || inc.crush.length() || inc.new_max_osd >= 0) {
+    c.all = true;
+    return;
+  }
+  for (auto& p : inc.new_pools) {
+    c.pools.insert(p.first);
+  }
+
+  // anything that changes whether (or how) crush, the temps or the
+  // upmaps may use an osd
+  for (auto& p : inc.new_state) {
+    c.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_up_client) {
+    c.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_weight) {
+    c.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    c.osds.insert(p.first);
+  }
+
+  for (auto& p : inc.new_pg_temp) {
+    c.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    c.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    c.pgs.insert(p.first);
+  }
+  c.pgs.insert(inc.old_pg_upmap.begin(), inc.old_pg_upmap.end());
+  for (auto& p : inc.new_pg_upmap_items) {
+    c.pgs.insert(p.first);
+  }
+  c.pgs.insert(inc.old_pg_upmap_items.begin(), inc.old_pg_upmap_items.end());
+}
+
+void OSDMapMapping::_prepare_update(const OSDMap& osdmap)
+{
+  update_pools.clear();
+  update_pgs.clear();
+  _init_mappings(osdmap, &update_pools);
+
+  // collect the changes between the mapped epoch and osdmap; they
+  // are only usable if we saw every incremental in between
+  pending.erase(pending.begin(), pending.upper_bound(epoch));
+  Changes c;
+  epoch_t last = epoch;
+  for (auto& p : pending) {
+    if (p.first > osdmap.get_epoch()) {
+      break;
+    }
+    if (p.first != last + 1) {
+      break;
+    }
+    c.merge(p.second);
+    last = p.first;
+  }
+  if (epoch == 0 || last == epoch || last != osdmap.get_epoch()) {
+    // never mapped, asked to remap the mapped epoch, or missed an
+    // incremental
+    c.all = true;
+  }
+
+  if (c.all) {
+    for (auto& p : osdmap.get_pools()) {
+      update_pools.insert(p.first);
+    }
+  } else {
+    for (auto pool : c.pools) {
+      if (pools.count(pool)) {
+	update_pools.insert(pool);
+      }
+    }
+    if (!c.osds.empty()) {
+      // crush can only place a pg of a pool on osds below the roots
+      // its rule takes
+      std::map<int,bool> rule_affected;
+      for (auto& p : osdmap.get_pools()) {
+	if (update_pools.count(p.first)) {
+	  continue;
+	}
+	int rule = p.second.get_crush_rule();
+	auto r = rule_affected.find(rule);
+	if (r == rule_affected.end()) {
+	  std::map<int,float> wmap;
+	  bool affected =
+	    osdmap.crush->get_rule_weight_osd_map(rule, &wmap) < 0;
+	  for (auto osd : c.osds) {
+	    if (affected || wmap.count(osd)) {
+	      affected = true;
+	      break;
+	    }
+	  }
+	  r = rule_affected.emplace(rule, affected).first;
+	}
+	if (r->second) {
+	  update_pools.insert(p.first);
+	}
+      }
+      // ... but temps and upmaps can put it anywhere
+      osdmap.get_explicit_mappings(c.osds, &c.pgs);
+    }
+    for (auto pgid : c.pgs) {
+      auto p = pools.find(pgid.pool());
+      if (p == pools.end() ||
+	  pgid.ps() >= p->second.pg_num ||
+	  update_pools.count(pgid.pool())) {
+	continue;
+      }
+      update_pgs.push_back(pgid);
+    }
+  }
+
+  num_update_pgs = update_pgs.size();
+  for (auto pool : update_pools) {
+    num_update_pgs += pools.at(pool).pg_num;
+  }
+}
+
 void OSDMapMapping::update(const OSDMap& osdmap)
 {
   _start(osdmap);
-  for (auto& p : osdmap.get_pools()) {
-    _update_range(osdmap, p.first, 0, p.second.get_pg_num());
+  for (auto pool : update_pools) {
+    _update_range(osdmap, pool, 0, pools.at(pool).pg_num);
+  }
+  for (auto pgid : update_pgs) {
+    _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
   }
   _finish(osdmap);
   //_dump();  // for debugging
@@ -147,9 +282,15 @@ void ParallelPGMapper::Job::finish_one()
 
 void ParallelPGMapper::WQ::_process(Item *i, ThreadPool::TPHandle &h)
 {
-  ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
-		    << " [" << i->begin << "," << i->end << ")" << dendl;
-  i->job->process(i->pool, i->begin, i->end);
+  if (!i->pgs.empty()) {
+    ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pgs.size()
+		      << " pgs" << dendl;
+    i->job->process(i->pgs);
+  } else {
+    ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
+		      << " [" << i->begin << "," << i->end << ")" << dendl;
+    i->job->process(i->pool, i->begin, i->end);
+  }
   i->job->finish_one();
   delete i;
 }
@@ -158,16 +299,45 @@ void ParallelPGMapper::queue(
   Job *job,
   unsigned pgs_per_item)
 {
-  bool any = false;
+  std::set<int64_t> pools;
   for (auto& p : job->osdmap->get_pools()) {
-    for (unsigned ps = 0; ps < p.second.get_pg_num(); ps += pgs_per_item) {
-      unsigned ps_end = std::min(ps + pgs_per_item, p.second.get_pg_num());
+    pools.insert(p.first);
+  }
+  ceph_assert(!pools.empty());
+  queue(job, pgs_per_item, pools, {});
+}
+
+void ParallelPGMapper::queue(
+  Job *job,
+  unsigned pgs_per_item,
+  const std::set<int64_t>& pools,
+  const std::vector<pg_t>& pgids)
+{
+  bool any = false;
+  for (auto pool : pools) {
+    const pg_pool_t *pi = job->osdmap->get_pg_pool(pool);
+    ceph_assert(pi);
+    for (unsigned ps = 0; ps < pi->get_pg_num(); ps += pgs_per_item) {
+      unsigned ps_end = std::min(ps + pgs_per_item, pi->get_pg_num());
       job->start_one();
-      wq.queue(new Item(job, p.first, ps, ps_end));
-      ldout(cct, 20) << __func__ << " " << job << " " << p.first << " [" << ps
+      wq.queue(new Item(job, pool, ps, ps_end));
+      ldout(cct, 20) << __func__ << " " << job << " " << pool << " [" << ps
 		     << "," << ps_end << ")" << dendl;
       any = true;
     }
   }
-  ceph_assert(any);
+  for (auto p = pgids.begin(); p != pgids.end(); ) {
+    auto end = p + std::min<size_t>(pgs_per_item, pgids.end() - p);
+    job->start_one();
+    wq.queue(new Item(job, std::vector<pg_t>(p, end)));
+    ldout(cct, 20) << __func__ << " " << job << " " << (end - p) << " pgs"
+		   << dendl;
+    p = end;
+    any = true;
+  }
+  if (!any) {
+    // nothing changed; the job is done already
+    job->finish = ceph_clock_now();
+    job->complete();
+  }
 }
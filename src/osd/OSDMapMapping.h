@@ -7,12 +7,12 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -35,6 +35,13 @@ public:
     virtual void process(int64_t poolid, unsigned ps_begin, unsigned ps_end) = 0;
     virtual void complete() = 0;
 
+    /// process an arbitrary set of pgs; by default, one at a time
+    virtual void process(const std::vector<pg_t>& pgs) {
+      for (auto pgid : pgs) {
+	process(pgid.pool(), pgid.ps(), pgid.ps() + 1);
+      }
+    }
+
     void set_finish_event(Context *fin) {
       lock.Lock();
       if (shards == 0) {
@@ -102,12 +109,19 @@ protected:
     Job *job;
     int64_t pool;
     unsigned begin, end;
+    std::vector<pg_t> pgs;  ///< if non-empty, process these instead
 
     Item(Job *j, int64_t p, unsigned b, unsigned e)
       : job(j),
 	pool(p),
 	begin(b),
 	end(e) {}
+    Item(Job *j, std::vector<pg_t>&& pgs)
+      : job(j),
+	pool(-1),
+	begin(0),
+	end(0),
+	pgs(std::move(pgs)) {}
   };
   std::deque<Item*> q;
 
@@ -158,6 +172,12 @@ public:
   void queue(
     Job *job,
     unsigned pgs_per_item);
+  /// process every pg of the given pools, plus the individual pgids
+  void queue(
+    Job *job,
+    unsigned pgs_per_item,
+    const std::set<int64_t>& pools,
+    const std::vector<pg_t>& pgids);
 
   void drain() {
     wq.drain();
@@ -251,7 +271,32 @@ private:
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
 
-  void _init_mappings(const OSDMap& osdmap);
+  /// what an incremental may have remapped
+  struct Changes {
+    bool all = false;
+    std::set<int64_t> pools;  ///< every pg of these pools
+    std::set<pg_t> pgs;
+    std::set<int> osds;       ///< pgs that can map to these osds
+
+    void merge(const Changes& o) {
+      all = all || o.all;
+      pools.insert(o.pools.begin(), o.pools.end());
+      pgs.insert(o.pgs.begin(), o.pgs.end());
+      osds.insert(o.osds.begin(), o.osds.end());
+    }
+  };
+  /// changes noted since epoch, by incremental epoch
+  std::map<epoch_t,Changes> pending;
+  /// past this many unmapped incrementals, just remap everything
+  static constexpr unsigned MAX_PENDING = 500;
+
+  // work for the update in progress
+  std::set<int64_t> update_pools;
+  std::vector<pg_t> update_pgs;
+  uint64_t num_update_pgs = 0;
+
+  void _init_mappings(const OSDMap& osdmap, std::set<int64_t> *created);
+  void _prepare_update(const OSDMap& osdmap);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
@@ -260,7 +305,7 @@ private:
   void _build_rmap(const OSDMap& osdmap);
 
   void _start(const OSDMap& osdmap) {
-    _init_mappings(osdmap);
+    _prepare_update(osdmap);
   }
   void _finish(const OSDMap& osdmap);
 
@@ -321,6 +366,15 @@ public:
     return acting_rmap[osd];
   }
 
+  /**
+   * note an incremental applied on top of the mapped map
+   *
+   * If every incremental since the last update has been noted, the next
+   * update only remaps the pools and pgs they could have affected;
+   * otherwise it remaps everything.
+   */
+  void note_incremental(const OSDMap::Incremental& inc);
+
   void update(const OSDMap& map);
   void update(const OSDMap& map, pg_t pgid);
 
@@ -329,10 +383,15 @@ public:
     ParallelPGMapper& mapper,
     unsigned pgs_per_item) {
     std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item);
+    mapper.queue(job.get(), pgs_per_item, update_pools, update_pgs);
     return job;
   }
 
+  /// number of pgs the last (or current) update had to remap
+  uint64_t get_num_update_pgs() const {
+    return num_update_pgs;
+  }
+
   epoch_t get_epoch() const {
     return epoch;
   }
@@ -0,0 +1,307 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ObjectContextCache.h"
+#include "common/dout.h"
+
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "obc_cache "
+
+void ObjectContextCache::Shard::lru_touch(
+  entry_map_t::iterator i,
+  const ObjectContextRef& ref,
+  std::vector<ObjectContextRef> *to_release)
+{
+  if (i->second.in_lru) {
+    lru.splice(lru.begin(), lru, i->second.lru_pos);
+    return;
+  }
+  lru.emplace_front(i->first, ref);
+  i->second.in_lru = true;
+  i->second.lru_pos = lru.begin();
+  ++pg_lru_count[i->first.first];
+  trim(to_release);
+}
+
+void ObjectContextCache::Shard::lru_remove(
+  entry_map_t::iterator i,
+  std::vector<ObjectContextRef> *to_release)
+{
+  if (!i->second.in_lru)
+    return;
+  to_release->push_back(std::move(i->second.lru_pos->second));
+  lru.erase(i->second.lru_pos);
+  i->second.in_lru = false;
+  auto p = pg_lru_count.find(i->first.first);
+  ceph_assert(p != pg_lru_count.end());
+  if (--p->second == 0)
+    pg_lru_count.erase(p);
+}
+
+void ObjectContextCache::Shard::trim(std::vector<ObjectContextRef> *to_release)
+{
+  while (lru.size() > max_size) {
+    auto i = entries.find(lru.back().first);
+    ceph_assert(i != entries.end());
+    lru_remove(i, to_release);
+  }
+}
+
+void ObjectContextCache::Cleanup::operator()(ObjectContext *ptr)
+{
+  {
+    std::lock_guard l{shard->lock};
+    auto i = shard->entries.find(key);
+    if (i != shard->entries.end() && i->second.ptr == ptr) {
+      ceph_assert(!i->second.in_lru);
+      shard->entries.erase(i);
+    }
+    shard->cond.notify_all();
+  }
+  delete ptr;
+}
+
+ObjectContextCache::ObjectContextCache(
+  CephContext *cct,
+  size_t max_size,
+  unsigned num_shards)
+  : cct(cct)
+{
+  ceph_assert(num_shards > 0);
+  for (unsigned i = 0; i < num_shards; ++i) {
+    shards.emplace_back(new Shard);
+  }
+  set_size(max_size);
+}
+
+ObjectContextCache::~ObjectContextCache()
+{
+  clear();
+  for (auto& shard : shards) {
+    if (!shard->entries.empty()) {
+      lderr(cct) << "leaked refs:" << dendl;
+      for (auto& [key, entry] : shard->entries) {
+	lderr(cct) << "  " << key.first << " " << key.second
+		   << " = " << entry.ptr
+		   << " with " << entry.weak.use_count() << " refs" << dendl;
+      }
+      if (cct->_conf.get_val<bool>("debug_asserts_on_shutdown")) {
+	ceph_assert(shard->entries.empty());
+      }
+    }
+  }
+}
+
+void ObjectContextCache::set_size(size_t max_size)
+{
+  size_t per_shard = std::max<size_t>(1, max_size / shards.size());
+  for (auto& shard : shards) {
+    std::vector<ObjectContextRef> to_release;
+    uint64_t evicted;
+    {
+      std::lock_guard l{shard->lock};
+      shard->max_size = per_shard;
+      shard->trim(&to_release);
+      evicted = to_release.size();
+    }
+    evictions += evicted;
+  }
+}
+
+ObjectContextRef ObjectContextCache::lookup(
+  const spg_t& pgid,
+  const hobject_t& oid)
+{
+  Shard& shard = get_shard(pgid, oid);
+  const key_t key{pgid, oid};
+  ObjectContextRef val;
+  std::vector<ObjectContextRef> to_release;
+  {
+    std::unique_lock l{shard.lock};
+    shard.cond.wait(l, [&] {
+      auto i = shard.entries.find(key);
+      if (i == shard.entries.end()) {
+	return true;
+      }
+      // an expired entry belongs to an ObjectContext whose destructor is
+      // running; wait for Cleanup to remove it
+      if (val = i->second.weak.lock(); val) {
+	shard.lru_touch(i, val, &to_release);
+	return true;
+      }
+      return false;
+    });
+  }
+  evictions += to_release.size();
+  return val;
+}
+
+ObjectContextRef ObjectContextCache::lookup_or_create(
+  const spg_t& pgid,
+  const hobject_t& oid)
+{
+  Shard& shard = get_shard(pgid, oid);
+  const key_t key{pgid, oid};
+  ObjectContextRef val;
+  std::vector<ObjectContextRef> to_release;
+  {
+    std::unique_lock l{shard.lock};
+    entry_map_t::iterator i;
+    shard.cond.wait(l, [&] {
+      i = shard.entries.find(key);
+      if (i == shard.entries.end()) {
+	return true;
+      }
+      val = i->second.weak.lock();
+      return bool(val);
+    });
+    if (!val) {
+      val = ObjectContextRef(new ObjectContext{}, Cleanup{&shard, key});
+      i = shard.entries.emplace(key, Entry()).first;
+      i->second.weak = val;
+      i->second.ptr = val.get();
+    }
+    shard.lru_touch(i, val, &to_release);
+  }
+  evictions += to_release.size();
+  return val;
+}
+
+bool ObjectContextCache::get_next(
+  const spg_t& pgid,
+  const hobject_t& oid,
+  std::pair<hobject_t, ObjectContextRef> *next)
+{
+  // each of the PG's shards holds a subset of its objects; the next
+  // entry is the smallest of the per-shard successors
+  bool found = false;
+  std::pair<hobject_t, ObjectContextRef> r;
+  for (unsigned n = 0; n < get_pg_span(); ++n) {
+    Shard& shard = get_pg_shard(pgid, n);
+    // declared before the lock so that a ref we drop is released after
+    // the shard lock
+    std::pair<hobject_t, ObjectContextRef> cand;
+    {
+      std::lock_guard l{shard.lock};
+      for (auto i = shard.entries.upper_bound(key_t{pgid, oid});
+	   i != shard.entries.end() && i->first.first == pgid;
+	   ++i) {
+	if (found && !(i->first.second < r.first)) {
+	  break;
+	}
+	if (auto ref = i->second.weak.lock(); ref) {
+	  cand = std::make_pair(i->first.second, std::move(ref));
+	  break;
+	}
+      }
+    }
+    if (cand.second) {
+      std::swap(r, cand);
+      found = true;
+    }
+  }
+  if (found && next) {
+    *next = std::move(r);
+  }
+  return found;
+}
+
+void ObjectContextCache::clear(const spg_t& pgid)
+{
+  for (unsigned n = 0; n < get_pg_span(); ++n) {
+    Shard& shard = get_pg_shard(pgid, n);
+    // release any refs we have after we drop the lock
+    std::vector<ObjectContextRef> to_release;
+    std::lock_guard l{shard.lock};
+    if (!shard.pg_lru_count.count(pgid)) {
+      continue;
+    }
+    for (auto i = shard.entries.lower_bound(key_t{pgid, hobject_t()});
+	 i != shard.entries.end() && i->first.first == pgid;
+	 ++i) {
+      shard.lru_remove(i, &to_release);
+    }
+  }
+}
+
+void ObjectContextCache::clear()
+{
+  for (auto& shard : shards) {
+    lru_t to_release;
+    std::lock_guard l{shard->lock};
+    for (auto& [key, ref] : shard->lru) {
+      auto i = shard->entries.find(key);
+      ceph_assert(i != shard->entries.end());
+      i->second.in_lru = false;
+    }
+    to_release.swap(shard->lru);
+    shard->pg_lru_count.clear();
+  }
+}
+
+bool ObjectContextCache::empty(const spg_t& pgid)
+{
+  for (unsigned n = 0; n < get_pg_span(); ++n) {
+    Shard& shard = get_pg_shard(pgid, n);
+    std::lock_guard l{shard.lock};
+    auto i = shard.entries.lower_bound(key_t{pgid, hobject_t()});
+    if (i != shard.entries.end() && i->first.first == pgid) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ObjectContextCache::get_count(const spg_t& pgid)
+{
+  int count = 0;
+  for (unsigned n = 0; n < get_pg_span(); ++n) {
+    Shard& shard = get_pg_shard(pgid, n);
+    std::lock_guard l{shard.lock};
+    if (auto p = shard.pg_lru_count.find(pgid);
+	p != shard.pg_lru_count.end()) {
+      count += p->second;
+    }
+  }
+  return count;
+}
+
+uint64_t ObjectContextCache::get_count()
+{
+  uint64_t count = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard->lock};
+    count += shard->lru.size();
+  }
+  return count;
+}
+
+void ObjectContextCache::dump(ceph::Formatter *f)
+{
+  uint64_t pinned = 0, live = 0, max_size = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard->lock};
+    pinned += shard->lru.size();
+    live += shard->entries.size();
+    max_size += shard->max_size;
+  }
+  f->open_object_section("object_context_cache");
+  f->dump_unsigned("shards", shards.size());
+  f->dump_unsigned("max_size", max_size);
+  f->dump_unsigned("pinned", pinned);
+  f->dump_unsigned("live", live);
+  f->dump_unsigned("hits", hits);
+  f->dump_unsigned("misses", misses);
+  f->dump_unsigned("evictions", evictions);
+  f->close_section();
+}
@@ -0,0 +1,186 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_OBJECTCONTEXTCACHE_H
+#define CEPH_OSD_OBJECTCONTEXTCACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/Formatter.h"
+#include "common/hobject.h"
+#include "osd/osd_types.h"
+#include "osd/osd_internal_types.h"
+
+/**
+ * ObjectContextCache
+ *
+ * OSD-wide cache of ObjectContexts shared by all PGs on the OSD.
+ *
+ * Like SharedLRU, the cache tracks every live ObjectContext through a
+ * weak reference (so that two lookups of the same object always yield
+ * the same ObjectContext) and pins the most recently used ones with a
+ * strong reference.  Unlike the old per-PG SharedLRU, the LRU capacity
+ * is an OSD-wide budget (osd_object_context_cache_size), so hot PGs keep
+ * more entries than idle ones, and the key space is striped across
+ * osd_object_context_cache_shards independently locked shards so that
+ * ops on different PGs do not contend on a single mutex.
+ *
+ * PGs access the cache through a PGHandle, which mimics the subset of
+ * the SharedLRU interface PrimaryLogPG relies on.
+ */
+class ObjectContextCache {
+public:
+  using key_t = std::pair<spg_t, hobject_t>;
+
+private:
+  using lru_t = std::list<std::pair<key_t, ObjectContextRef>>;
+
+  struct Entry {
+    std::weak_ptr<ObjectContext> weak;
+    ObjectContext *ptr = nullptr;
+    bool in_lru = false;
+    lru_t::iterator lru_pos;
+  };
+  using entry_map_t = std::map<key_t, Entry>;
+
+  struct Shard {
+    ceph::mutex lock = ceph::make_mutex("ObjectContextCache::Shard::lock");
+    ceph::condition_variable cond;
+    entry_map_t entries;
+    lru_t lru;
+    size_t max_size = 0;
+    std::map<spg_t, unsigned> pg_lru_count;
+
+    void lru_touch(entry_map_t::iterator i, const ObjectContextRef& ref,
+		   std::vector<ObjectContextRef> *to_release);
+    void lru_remove(entry_map_t::iterator i,
+		    std::vector<ObjectContextRef> *to_release);
+    void trim(std::vector<ObjectContextRef> *to_release);
+  };
+
+  class Cleanup {
+    Shard *shard;
+    key_t key;
+  public:
+    Cleanup(Shard *shard, const key_t& key) : shard(shard), key(key) {}
+    void operator()(ObjectContext *ptr);
+  };
+
+  CephContext *cct;
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  std::atomic<uint64_t> hits = {0};
+  std::atomic<uint64_t> misses = {0};
+  std::atomic<uint64_t> evictions = {0};
+
+  /// number of consecutive shards the objects of one PG are spread over
+  static constexpr unsigned pg_shard_span = 8;
+
+  unsigned get_pg_span() const {
+    return std::min<size_t>(pg_shard_span, shards.size());
+  }
+  /// the n-th of the get_pg_span() shards holding pgid's objects
+  Shard& get_pg_shard(const spg_t& pgid, unsigned n) {
+    size_t first = (pgid.ps() * 0x9e3779b97f4a7c15ull) ^ pgid.pool();
+    return *shards[(first + n) % shards.size()];
+  }
+  Shard& get_shard(const spg_t& pgid, const hobject_t& oid) {
+    // a single PG spreads over a few shards only, so that per-PG walks
+    // (get_next, clear, empty) need not lock them all
+    return get_pg_shard(pgid, std::hash<hobject_t>()(oid) % get_pg_span());
+  }
+
+public:
+  ObjectContextCache(CephContext *cct, size_t max_size, unsigned num_shards);
+  ~ObjectContextCache();
+
+  /// adjust the OSD-wide number of pinned ObjectContexts
+  void set_size(size_t max_size);
+
+  ObjectContextRef lookup(const spg_t& pgid, const hobject_t& oid);
+  ObjectContextRef lookup_or_create(const spg_t& pgid, const hobject_t& oid);
+
+  /// next live entry of pgid strictly after oid, in hobject_t order
+  bool get_next(const spg_t& pgid, const hobject_t& oid,
+		std::pair<hobject_t, ObjectContextRef> *next);
+
+  /// drop the pins held on pgid's entries; live references are untouched
+  void clear(const spg_t& pgid);
+  /// drop every pin held by the cache
+  void clear();
+
+  /// true iff no ObjectContext of pgid is referenced anywhere
+  bool empty(const spg_t& pgid);
+
+  /// number of ObjectContexts of pgid pinned by the LRU
+  int get_count(const spg_t& pgid);
+  /// number of ObjectContexts pinned by the LRU, across all PGs
+  uint64_t get_count();
+
+  uint64_t get_hits() const { return hits; }
+  uint64_t get_misses() const { return misses; }
+  uint64_t get_evictions() const { return evictions; }
+  void note_hit() { ++hits; }
+  void note_miss() { ++misses; }
+
+  void dump(ceph::Formatter *f);
+
+  /**
+   * PGHandle
+   *
+   * View of the cache restricted to a single PG.
+   */
+  class PGHandle {
+    ObjectContextCache *cache;
+    spg_t pgid;
+  public:
+    PGHandle(ObjectContextCache *cache, spg_t pgid)
+      : cache(cache), pgid(pgid) {}
+    ~PGHandle() {
+      clear();
+    }
+
+    ObjectContextRef lookup(const hobject_t& oid) {
+      return cache->lookup(pgid, oid);
+    }
+    ObjectContextRef lookup_or_create(const hobject_t& oid) {
+      return cache->lookup_or_create(pgid, oid);
+    }
+    bool get_next(const hobject_t& oid,
+		  std::pair<hobject_t, ObjectContextRef> *next) {
+      return cache->get_next(pgid, oid, next);
+    }
+    void clear() {
+      cache->clear(pgid);
+    }
+    bool empty() {
+      return cache->empty(pgid);
+    }
+    int get_count() {
+      return cache->get_count(pgid);
+    }
+    void note_hit() {
+      cache->note_hit();
+    }
+    void note_miss() {
+      cache->note_miss();
+    }
+  };
+};
+
+#endif
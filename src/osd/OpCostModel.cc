@@ -0,0 +1,119 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "OpCostModel.h"
+
+// number of update() samples before the regression is trusted
+static constexpr double MIN_SAMPLE_WEIGHT = 3.0;
+
+void OpCostModel::_set_model(double io, double byte)
+{
+  t_io = io;
+  t_byte = byte;
+  per_io_cost = std::max<uint64_t>(1, std::llround(io / byte));
+}
+
+void OpCostModel::set_per_io_cost(uint64_t cost)
+{
+  std::lock_guard l{lock};
+  t_io = t_byte = 0.0;
+  sw = sx = sy = sxx = sxy = 0.0;
+  per_io_cost = cost;
+}
+
+bool OpCostModel::calibrate(uint64_t small_bytes, double small_sec,
+			    uint64_t large_bytes, double large_sec)
+{
+  if (large_bytes <= small_bytes || large_sec <= small_sec) {
+    return false;
+  }
+  double byte = (large_sec - small_sec) / (large_bytes - small_bytes);
+  double io = small_sec - small_bytes * byte;
+  if (!(byte > 0.0) || !(io > 0.0)) {
+    return false;
+  }
+  std::lock_guard l{lock};
+  sw = sx = sy = sxx = sxy = 0.0;
+  _set_model(io, byte);
+  return true;
+}
+
+void OpCostModel::update(uint64_t ops, uint64_t bytes, uint64_t lat_ns,
+			 double decay)
+{
+  std::lock_guard l{lock};
+  if (!have_last ||
+      ops < last_ops || bytes < last_bytes || lat_ns < last_lat_ns) {
+    // first call, or the store's counters were reset
+    have_last = true;
+    last_ops = ops;
+    last_bytes = bytes;
+    last_lat_ns = lat_ns;
+    return;
+  }
+  uint64_t dops = ops - last_ops;
+  if (dops == 0) {
+    return;
+  }
+  double x = double(bytes - last_bytes) / dops;
+  double y = double(lat_ns - last_lat_ns) / 1e9 / dops;
+  last_ops = ops;
+  last_bytes = bytes;
+  last_lat_ns = lat_ns;
+
+  sw = sw * decay + 1.0;
+  sx = sx * decay + x;
+  sy = sy * decay + y;
+  sxx = sxx * decay + x * x;
+  sxy = sxy * decay + x * y;
+  if (sw < MIN_SAMPLE_WEIGHT) {
+    return;
+  }
+
+  double mx = sx / sw;
+  double my = sy / sw;
+  double var = sxx / sw - mx * mx;
+  double cov = sxy / sw - mx * my;
+  if (mx > 0.0 && var > 0.25 * mx * mx && cov > 0.0) {
+    double byte = cov / var;
+    double io = my - byte * mx;
+    if (io > 0.0) {
+      _set_model(io, byte);
+      return;
+    }
+  }
+  if (t_byte > 0.0) {
+    // op sizes are too uniform to separate the two terms; keep the
+    // bandwidth we have and refit the per-op time
+    double io = my - t_byte * mx;
+    if (io > 0.0) {
+      _set_model(io, t_byte);
+    }
+  }
+}
+
+void OpCostModel::dump(ceph::Formatter *f) const
+{
+  std::lock_guard l{lock};
+  f->open_object_section("op_cost_model");
+  f->dump_unsigned("per_io_cost", per_io_cost);
+  f->dump_bool("calibrated", t_byte > 0.0);
+  if (t_byte > 0.0) {
+    f->dump_float("sec_per_op", t_io);
+    f->dump_float("bytes_per_sec", 1.0 / t_byte);
+  }
+  f->dump_float("sample_weight", sw);
+  f->close_section();
+}
@@ -0,0 +1,95 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_OPCOSTMODEL_H
+#define CEPH_OSD_OPCOSTMODEL_H
+
+#include <atomic>
+
+#include "common/ceph_mutex.h"
+#include "common/Formatter.h"
+
+/**
+ * OpCostModel
+ *
+ * Estimates the device time an op takes so that the op queue weighs
+ * small random IOs against large sequential ones (and against
+ * recovery, scrub and snap trim, whose costs are configured in bytes)
+ * the way the underlying device does.  The service time of an op is
+ * modelled as
+ *
+ *   t(op) = t_io + bytes * t_byte
+ *
+ * and its queue cost is that time expressed in bytes, i.e.
+ * bytes + per_io_cost with per_io_cost = t_io / t_byte.  On an HDD a
+ * 4K op thus costs about as much as a megabyte of transfer, on flash
+ * only a few kilobytes.
+ *
+ * The model starts from a configured per_io_cost, is calibrated by a
+ * short write benchmark when the OSD starts, and is refined from the
+ * write latencies the object store reports while serving.
+ */
+class OpCostModel {
+  mutable ceph::mutex lock = ceph::make_mutex("OpCostModel::lock");
+
+  // model parameters; t_byte == 0 until calibrated
+  double t_io = 0.0;    ///< seconds per op
+  double t_byte = 0.0;  ///< seconds per byte
+
+  // exponentially decayed sums for the regression of per-op latency
+  // (y) against per-op bytes (x) of the samples seen by update()
+  double sw = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+
+  // store totals at the previous update()
+  bool have_last = false;
+  uint64_t last_ops = 0, last_bytes = 0, last_lat_ns = 0;
+
+  std::atomic<uint64_t> per_io_cost;
+
+  void _set_model(double io, double byte);
+
+public:
+  explicit OpCostModel(uint64_t per_io_cost) : per_io_cost(per_io_cost) {}
+
+  /// queue cost of an op moving bytes
+  uint64_t get_cost(uint64_t bytes) const {
+    return bytes + per_io_cost.load(std::memory_order_relaxed);
+  }
+  uint64_t get_per_io_cost() const {
+    return per_io_cost.load(std::memory_order_relaxed);
+  }
+  /// reset to an uncalibrated model with the given per_io_cost
+  void set_per_io_cost(uint64_t cost);
+
+  /**
+   * calibrate from two measurements
+   *
+   * @param small_bytes, small_sec size and time per op of the small-op run
+   * @param large_bytes, large_sec size and time per op of the large-op run
+   * @return false (and leaves the model alone) if the runs do not fit
+   */
+  bool calibrate(uint64_t small_bytes, double small_sec,
+		 uint64_t large_bytes, double large_sec);
+
+  /**
+   * refine the model from the store's running totals
+   *
+   * @param ops, bytes, lat_ns cumulative ops written, bytes written and
+   *        op latency
+   * @param decay weight of past samples, in [0, 1)
+   */
+  void update(uint64_t ops, uint64_t bytes, uint64_t lat_ns, double decay);
+
+  void dump(ceph::Formatter *f) const;
+};
+
+#endif
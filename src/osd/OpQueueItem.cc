@@ -15,6 +15,27 @@
 #include "OpQueueItem.h"
 #include "OSD.h"
 
+bool OpQueueItem::is_fast_read_candidate() const
+{
+  boost::optional<OpRequestRef> op = maybe_get_op();
+  if (!op ||
+      (*op)->no_fast_read ||
+      (*op)->get_req()->get_type() != CEPH_MSG_OSD_OP) {
+    return false;
+  }
+  auto m = static_cast<const MOSDOp*>((*op)->get_req());
+  return m->has_flag(CEPH_OSD_FLAG_READ) &&
+    !(m->get_flags() & (CEPH_OSD_FLAG_WRITE |
+			CEPH_OSD_FLAG_RWORDERED |
+			CEPH_OSD_FLAG_PARALLELEXEC |
+			CEPH_OSD_FLAG_BALANCE_READS |
+			CEPH_OSD_FLAG_LOCALIZE_READS |
+			CEPH_OSD_FLAG_IGNORE_CACHE |
+			CEPH_OSD_FLAG_IGNORE_OVERLAY |
+			CEPH_OSD_FLAG_FLUSH |
+			CEPH_OSD_FLAG_MAP_SNAP_CLONE));
+}
+
 void PGOpItem::run(
   OSD *osd,
   OSDShard *sdata,
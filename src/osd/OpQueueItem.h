@@ -151,6 +151,10 @@ public:
     return qitem->peering_requires_pg();
   }
 
+  /// a read that may be tried under a shared pg lock, judged only on
+  /// what is known before the op is fully decoded
+  bool is_fast_read_candidate() const;
+
   friend ostream& operator<<(ostream& out, const OpQueueItem& item) {
      out << "OpQueueItem("
 	 << item.get_ordering_token() << " " << *item.qitem
@@ -6,6 +6,7 @@
 #include <vector>
 #include "common/debug.h"
 #include "common/config.h"
+#include "common/perf_counters.h"
 #include "msg/Message.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDRepOp.h"
@@ -72,7 +73,47 @@ void OpRequest::_dump_op_descriptor_unlocked(ostream& stream) const
   get_req()->print(stream);
 }
 
+void OpRequest::start_trace(PerfCounters *logger, int lat_idx, int hist_idx)
+{
+  trace.reset(new Trace);
+  trace->logger = logger;
+  trace->lat_idx = lat_idx;
+  trace->hist_idx = hist_idx;
+  utime_t recv = request->get_recv_stamp();
+  utime_t dispatch = request->get_dispatch_stamp();
+  trace->msgr_lat = dispatch > recv ?
+    ceph::timespan((dispatch - recv).to_nsec()) : ceph::timespan::zero();
+  trace_point(TRACE_DISPATCHED);
+}
+
+void OpRequest::finish_trace()
+{
+  trace_point(TRACE_DONE);
+  ceph::timespan lat = trace->msgr_lat;
+  const ceph::mono_time *prev = &trace->stamp[TRACE_DISPATCHED];
+  for (int p = TRACE_DISPATCHED; p < TRACE_MAX; ++p) {
+    const ceph::mono_time& stamp = trace->stamp[p];
+    if (p != TRACE_DISPATCHED) {
+      if (stamp == ceph::mono_time() || stamp < *prev) {
+	// skipped, or passed out of order after a requeue
+	continue;
+      }
+      lat = stamp - *prev;
+      prev = &stamp;
+    }
+    trace->logger->tinc(trace->lat_idx + p, lat);
+    trace->logger->hinc(
+      trace->hist_idx,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(lat).count(),
+      p);
+  }
+  trace.reset();
+}
+
 void OpRequest::_unregistered() {
+  if (trace) {
+    finish_trace();
+  }
   request->clear_data();
   request->clear_payload();
   request->release_message_throttle();
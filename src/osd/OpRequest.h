@@ -14,8 +14,17 @@
 #ifndef OPREQUEST_H_
 #define OPREQUEST_H_
 
+#include <memory>
+
 #include "osd/osd_types.h"
 #include "common/TrackedOp.h"
+#include "common/ceph_time.h"
+
+class PerfCounters;
+
+namespace ceph::mclock {
+  struct TenantInfo;
+}
 
 /**
  * The OpRequest takes in a Message* and takes over a single reference
@@ -93,6 +102,39 @@ private:
 
   std::vector<ClassInfo> classes_;
 
+public:
+  /**
+   * points a sampled op is stamped at, in the order ops pass them
+   *
+   * The stage ending at a point is accounted under that point; stage 0
+   * runs from the message's receive stamp to dispatch.  A point an op
+   * skips folds its stage into the next one.
+   */
+  enum trace_point_t {
+    TRACE_DISPATCHED = 0, ///< OpRequest created
+    TRACE_QUEUED,         ///< queued for its PG's shard
+    TRACE_DEQUEUED,       ///< taken off the shard queue
+    TRACE_REACHED_PG,     ///< PG locked, op handed to the PG
+    TRACE_STARTED,        ///< op executing
+    TRACE_SUBMITTED,      ///< transaction submitted to the backend
+    TRACE_COMMITTED,      ///< committed on all shards
+    TRACE_REPLIED,        ///< reply sent
+    TRACE_DONE,           ///< last reference dropped
+    TRACE_MAX
+  };
+
+private:
+  struct Trace {
+    PerfCounters *logger;
+    int lat_idx;   ///< time avg counter of stage 0, one per stage
+    int hist_idx;  ///< (latency, stage) histogram counter
+    ceph::timespan msgr_lat;
+    ceph::mono_time stamp[TRACE_MAX];
+  };
+  std::unique_ptr<Trace> trace;  ///< only for sampled ops
+
+  void finish_trace();
+
   OpRequest(Message *req, OpTracker *tracker);
 
 protected:
@@ -110,6 +152,9 @@ public:
   epoch_t min_epoch = 0;      ///< min epoch needed to handle this msg
 
   bool hitset_inserted;
+  bool no_fast_read = false;  ///< declined by PG::do_fast_read()
+  /// mclock tenant the op is scheduled under, if any
+  std::shared_ptr<const ceph::mclock::TenantInfo> qos_tenant;
   const Message *get_req() const { return request; }
   Message *get_nonconst_req() { return request; }
 
@@ -135,21 +180,25 @@ public:
   }
 
   void mark_queued_for_pg() {
+    trace_point(TRACE_QUEUED);
     mark_flag_point(flag_queued_for_pg, "queued_for_pg");
   }
   void mark_reached_pg() {
+    trace_point(TRACE_REACHED_PG);
     mark_flag_point(flag_reached_pg, "reached_pg");
   }
   void mark_delayed(const string& s) {
     mark_flag_point_string(flag_delayed, s);
   }
   void mark_started() {
+    trace_point(TRACE_STARTED);
     mark_flag_point(flag_started, "started");
   }
   void mark_sub_op_sent(const string& s) {
     mark_flag_point_string(flag_sub_op_sent, s);
   }
   void mark_commit_sent() {
+    trace_point(TRACE_REPLIED);
     mark_flag_point(flag_commit_sent, "commit_sent");
   }
 
@@ -164,6 +213,14 @@ public:
     return reqid;
   }
 
+  /// sample this op's stage latencies into logger
+  void start_trace(PerfCounters *logger, int lat_idx, int hist_idx);
+  void trace_point(trace_point_t p) {
+    if (trace && trace->stamp[p] == ceph::mono_time()) {
+      trace->stamp[p] = ceph::mono_clock::now();
+    }
+  }
+
   typedef boost::intrusive_ptr<OpRequest> Ref;
 
 private:
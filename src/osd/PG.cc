@@ -376,6 +376,7 @@ PG::~PG()
 void PG::lock(bool no_lockdep) const
 {
   _lock.Lock(no_lockdep);
+  fast_read_lock.get_write(false);
   // if we have unrecorded dirty state with the lock dropped, there is a bug
   ceph_assert(!dirty_info);
   ceph_assert(!dirty_big_info);
@@ -2537,19 +2538,45 @@ void PG::_finish_recovery(Context *c)
   unlock();
 }
 
-void PG::start_recovery_op(const hobject_t& soid)
+/*
+ * Small objects are cheap to recover individually but each one used to
+ * hold a whole OSD recovery op (osd_recovery_max_active), so recovery of
+ * pools with millions of tiny objects was bound by per-op round trips.
+ * Batchable objects are instead packed osd_recovery_max_batch_objects to
+ * an OSD recovery op; their pushes travel together in the same
+ * MOSDPGPush and are applied in one transaction on the peer.
+ */
+unsigned PG::recovery_op_slots_wanted() const
+{
+  uint64_t batch = std::max<uint64_t>(
+    1, cct->_conf.get_val<uint64_t>("osd_recovery_max_batch_objects"));
+  unsigned batched = recovering_batched.size();
+  return (recovery_ops_active - batched) + (batched + batch - 1) / batch;
+}
+
+bool PG::start_recovery_op(const hobject_t& soid, bool batchable)
 {
   dout(10) << "start_recovery_op " << soid
+	   << (batchable ? " (batched)" : "")
 #ifdef DEBUG_RECOVERY_OIDS
 	   << " (" << recovering_oids << ")"
 #endif
 	   << dendl;
   ceph_assert(recovery_ops_active >= 0);
   recovery_ops_active++;
+  if (batchable) {
+    recovering_batched.insert(soid);
+  }
 #ifdef DEBUG_RECOVERY_OIDS
   recovering_oids.insert(soid);
 #endif
-  osd->start_recovery_op(this, soid);
+  bool started = false;
+  while (recovery_op_slots_wanted() > recovery_op_slots.size()) {
+    recovery_op_slots.push_back(soid);
+    osd->start_recovery_op(this, soid);
+    started = true;
+  }
+  return started;
 }
 
 void PG::finish_recovery_op(const hobject_t& soid, bool dequeue)
@@ -2561,11 +2588,17 @@ void PG::finish_recovery_op(const hobject_t& soid, bool dequeue)
 	   << dendl;
   ceph_assert(recovery_ops_active > 0);
   recovery_ops_active--;
+  recovering_batched.erase(soid);
 #ifdef DEBUG_RECOVERY_OIDS
   ceph_assert(recovering_oids.count(soid));
   recovering_oids.erase(recovering_oids.find(soid));
 #endif
-  osd->finish_recovery_op(this, soid, dequeue);
+  while (recovery_op_slots_wanted() < recovery_op_slots.size()) {
+    // the OSD tracks the oid the op was started with
+    hobject_t slot_oid = recovery_op_slots.front();
+    recovery_op_slots.pop_front();
+    osd->finish_recovery_op(this, slot_oid, dequeue);
+  }
 
   if (!dequeue) {
     queue_recovery();
@@ -2933,14 +2966,21 @@ void PG::clear_recovery_state()
   while (recovery_ops_active > 0) {
 #ifdef DEBUG_RECOVERY_OIDS
     soid = *recovering_oids.begin();
+#else
+    // batched ops must be closed by name to keep the op slot count right
+    soid = recovering_batched.empty() ? hobject_t() : *recovering_batched.begin();
 #endif
     finish_recovery_op(soid, true);
   }
+  ceph_assert(recovering_batched.empty());
+  ceph_assert(recovery_op_slots.empty());
 
   async_recovery_targets.clear();
   backfill_targets.clear();
   backfill_info.clear();
   peer_backfill_info.clear();
+  peer_backfill_prefetch.clear();
+  peer_backfill_prefetching.clear();
   waiting_on_backfill.clear();
   _clear_recovery_state();  // pg impl specific hook
 }
@@ -3349,11 +3389,43 @@ void PG::_update_blocked_by()
   }
 }
 
+void PG::begin_txn_batch()
+{
+  ceph_assert(!txn_batch.is_open());
+  // erasure coded writes read from the store for read-modify-write
+  if (pool.info.is_replicated()) {
+    txn_batch.begin();
+  }
+}
+
+void PG::end_txn_batch()
+{
+  flush_txn_batch();
+  txn_batch.end();
+}
+
+void PG::flush_txn_batch()
+{
+  if (txn_batch.empty()) {
+    return;
+  }
+  unsigned ops = txn_batch.get_ops();
+  vector<ObjectStore::Transaction> tls;
+  OpRequestRef op = txn_batch.take(&tls);
+  dout(20) << __func__ << " " << ops << " ops in "
+	   << tls.size() << " transactions" << dendl;
+  osd->logger->inc(l_osd_txn_batch);
+  osd->logger->inc(l_osd_txn_batch_ops, ops);
+  osd->store->queue_transactions(ch, tls, op, NULL);
+}
+
 void PG::publish_stats_to_osd()
 {
   if (!is_primary())
     return;
 
+  fold_fast_read_stats();
+
   pg_stats_publish_lock.Lock();
 
   if (info.stats.stats.sum.num_scrub_errors)
@@ -3659,6 +3731,7 @@ void PG::_init(ObjectStore::Transaction& t, spg_t pgid, const pg_pool_t *pool)
 
 void PG::prepare_write_info(map<string,bufferlist> *km)
 {
+  fold_fast_read_stats();
   info.stats.stats.add(unstable_stats);
   unstable_stats.clear();
 
@@ -3843,6 +3916,15 @@ void PG::append_log(
   if (!transaction_applied || async)
     dout(10) << __func__ << " " << pg_whoami
              << " is async_recovery or backfill target" << dendl;
+  // only clean PGs give back dups under memory pressure; degraded and
+  // recovering ones need them all to detect resent ops
+  if (is_active() && (!is_primary() || is_clean()) &&
+      backfill_targets.empty() && async_recovery_targets.empty()) {
+    pg_log.set_dups_tracked(
+      osd->get_pg_log_budget(cct->_conf->osd_pg_log_dups_tracked));
+  } else {
+    pg_log.set_dups_tracked(0);
+  }
   pg_log.trim(trim_to, info, transaction_applied, async);
 
   // update the local pg, pg log
@@ -4888,7 +4970,8 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (cct->_conf->osd_scrub_sleep > 0 &&
+  double scrub_sleep = osd->get_scrub_sleep_time();
+  if (scrub_sleep > 0 &&
       (scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
        scrubber.needs_sleep) {
@@ -4921,7 +5004,7 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
           pg->unlock();
         });
     Mutex::Locker l(osd->sleep_lock);
-    osd->sleep_timer.add_event_after(cct->_conf->osd_scrub_sleep,
+    osd->sleep_timer.add_event_after(scrub_sleep,
                                            scrub_requeue_callback);
     scrubber.sleeping = true;
     scrubber.sleep_start = ceph_clock_now();
@@ -6097,6 +6180,18 @@ void PG::start_peering_interval(
   else
     set_role(-1);
 
+  if (!lastmap) {
+    peering_cause = PEERING_CAUSE_START;
+  } else if (old_acting_primary.osd != new_acting_primary) {
+    peering_cause = PEERING_CAUSE_PRIMARY;
+  } else if (oldacting != acting) {
+    peering_cause = PEERING_CAUSE_ACTING;
+  } else if (oldup != up) {
+    peering_cause = PEERING_CAUSE_UP;
+  } else {
+    peering_cause = PEERING_CAUSE_OTHER;
+  }
+
   // did acting, up, primary|acker change?
   if (!lastmap) {
     dout(10) << " no lastmap" << dendl;
@@ -7216,6 +7311,8 @@ void PG::RecoveryState::Peering::exit()
 
   utime_t dur = ceph_clock_now() - enter_time;
   pg->osd->recoverystate_perf->tinc(rs_peering_latency, dur);
+  pg->osd->recoverystate_perf->hinc(rs_peering_latency_cause_hist,
+				    dur.to_nsec(), pg->peering_cause);
 }
 
 
@@ -7259,6 +7356,10 @@ void PG::RecoveryState::Backfilling::cancel_backfill()
 {
   PG *pg = context< RecoveryMachine >().pg;
   backfill_release_reservations();
+  // a too-full peer drops scan requests, so we may never hear back about
+  // an outstanding prefetch
+  pg->peer_backfill_prefetch.clear();
+  pg->peer_backfill_prefetching.clear();
   if (!pg->waiting_on_backfill.empty()) {
     pg->waiting_on_backfill.clear();
     pg->finish_recovery_op(hobject_t::get_max());
@@ -37,6 +37,7 @@
 #include "SnapMapper.h"
 #include "Session.h"
 #include "common/Timer.h"
+#include "common/RWLock.h"
 
 #include "PGLog.h"
 #include "OSDMap.h"
@@ -44,6 +45,7 @@
 #include "include/str_list.h"
 #include "PGBackend.h"
 #include "PGPeeringEvent.h"
+#include "TxnBatch.h"
 
 #include <atomic>
 #include <list>
@@ -285,8 +287,16 @@ public:
     //generic_dout(0) << this << " " << info.pgid << " unlock" << dendl;
     ceph_assert(!dirty_info);
     ceph_assert(!dirty_big_info);
+    fast_read_lock.unlock(false);
     _lock.Unlock();
   }
+  /// shared counterpart of lock(), for the read fast path
+  void lock_shared() const {
+    fast_read_lock.get_read();
+  }
+  void unlock_shared() const {
+    fast_read_lock.put_read();
+  }
   bool is_locked() const {
     return _lock.is_locked();
   }
@@ -440,6 +450,7 @@ public:
   void find_unfound(epoch_t queued, RecoveryCtx *rctx);
 
   virtual void get_watchers(std::list<obj_watch_item_t> *ls) = 0;
+  virtual void dump_watched_objects(Formatter *f) = 0;
 
   void dump_pgstate_history(Formatter *f);
   void dump_missing(Formatter *f);
@@ -459,8 +470,14 @@ public:
     OpRequestRef& op,
     ThreadPool::TPHandle &handle
   ) = 0;
+  /// serve op under a shared pg lock; false if it needs do_request()
+  virtual bool do_fast_read(OpRequestRef& op) = 0;
+
+  /// hold back transactions of the following writes; see txn_batch
+  void begin_txn_batch();
+  /// submit what was held back since begin_txn_batch()
+  void end_txn_batch();
   virtual void clear_cache() = 0;
-  virtual int get_cache_obj_count() = 0;
 
   virtual void snap_trimmer(epoch_t epoch_queued) = 0;
   virtual int do_command(
@@ -525,6 +542,11 @@ protected:
   // put() should be called on destruction of some previously copied pointer.
   // unlock() when done with the current pointer (_most common_).
   mutable Mutex _lock = {"PG::_lock"};
+  // taken exclusively by lock() (after _lock) and shared by fast path
+  // readers, which never take _lock.  Writer-preferring, so that a stream
+  // of fast reads cannot starve lock().  No lockdep: every pg shares the
+  // name, and _lock already covers the nested pg locking of split/merge.
+  mutable RWLock fast_read_lock{"PG::fast_read_lock", false, false, true};
 
   std::atomic<unsigned int> ref{0};
 
@@ -938,6 +960,10 @@ protected:
   bool recovery_queued;
 
   int recovery_ops_active;
+  /// in-flight small objects that share OSD recovery ops (see start_recovery_op)
+  set<hobject_t> recovering_batched;
+  /// OSD recovery ops held by this PG, and the oid each was opened with
+  list<hobject_t> recovery_op_slots;
   set<pg_shard_t> waiting_on_backfill;
 #ifdef DEBUG_RECOVERY_OIDS
   multiset<hobject_t> recovering_oids;
@@ -1092,6 +1118,18 @@ protected:
     return last_peering_reset;
   }
 
+  /// what started the current interval; the peering latency histogram
+  /// is broken down by it
+  enum peering_cause_t : uint8_t {
+    PEERING_CAUSE_START = 0,  ///< pg was created or loaded
+    PEERING_CAUSE_PRIMARY,    ///< acting primary changed
+    PEERING_CAUSE_ACTING,     ///< acting set changed
+    PEERING_CAUSE_UP,         ///< up set changed
+    PEERING_CAUSE_OTHER,      ///< pool, pg_num or min_size change
+    PEERING_CAUSE_MAX
+  };
+  peering_cause_t peering_cause = PEERING_CAUSE_START;
+
   /* heartbeat peers */
   void set_probe_targets(const set<pg_shard_t> &probe_set);
   void clear_probe_targets();
@@ -1188,6 +1226,12 @@ public:
 protected:
   BackfillInterval backfill_info;
   map<pg_shard_t, BackfillInterval> peer_backfill_info;
+  /// peer intervals following peer_backfill_info, scanned ahead of need
+  map<pg_shard_t, BackfillInterval> peer_backfill_prefetch;
+  /// peers with an outstanding prefetch scan, and where it starts
+  map<pg_shard_t, hobject_t> peer_backfill_prefetching;
+  /// when we started blocking on waiting_on_backfill
+  utime_t backfill_scan_wait_start;
   bool backfill_reserved;
   bool backfill_reserving;
 
@@ -1291,6 +1335,23 @@ protected:
 
   // stats that persist lazily
   object_stat_collection_t unstable_stats;
+  // transactions of writes processed back-to-back under one pg lock
+  // (OSD::dequeue_op_batch), submitted to the store as one batch
+  TxnBatch txn_batch;
+
+  /// submit any held back transactions, keeping the batch open
+  void flush_txn_batch();
+
+  // reads served by do_fast_read() not yet in unstable_stats
+  std::atomic<unsigned> fast_read_num_rd = {0};
+  std::atomic<uint64_t> fast_read_num_rd_kb = {0};
+  /// move the fast read counts into unstable_stats; needs the pg lock
+  void fold_fast_read_stats() {
+    if (unsigned n = fast_read_num_rd.exchange(0); n) {
+      unstable_stats.sum.num_rd += n;
+      unstable_stats.sum.num_rd_kb += fast_read_num_rd_kb.exchange(0);
+    }
+  }
 
   // publish stats
   Mutex pg_stats_publish_lock;
@@ -1522,8 +1583,9 @@ protected:
   void clear_recovery_state();
   virtual void _clear_recovery_state() = 0;
   virtual void check_recovery_sources(const OSDMapRef& newmap) = 0;
-  void start_recovery_op(const hobject_t& soid);
+  bool start_recovery_op(const hobject_t& soid, bool batchable=false);
   void finish_recovery_op(const hobject_t& soid, bool dequeue=false);
+  unsigned recovery_op_slots_wanted() const;
 
   virtual void _split_into(pg_t child_pgid, PG *child, unsigned split_bits) = 0;
 
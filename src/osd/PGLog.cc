@@ -48,16 +48,19 @@ void PGLog::IndexedLog::trim(
   eversion_t s,
   set<eversion_t> *trimmed,
   set<string>* trimmed_dups,
-  eversion_t *write_from_dups)
+  eversion_t *write_from_dups,
+  uint64_t dups_tracked)
 {
   ceph_assert(s <= can_rollback_to);
   if (complete_to != log.end())
     lgeneric_subdout(cct, osd, 20) << " complete_to " << complete_to->version << dendl;
 
+  if (!dups_tracked)
+    dups_tracked = cct->_conf->osd_pg_log_dups_tracked;
   auto earliest_dup_version =
-    log.rbegin()->version.version < cct->_conf->osd_pg_log_dups_tracked
+    log.rbegin()->version.version < dups_tracked
     ? 0u
-    : log.rbegin()->version.version - cct->_conf->osd_pg_log_dups_tracked;
+    : log.rbegin()->version.version - dups_tracked;
 
   while (!log.empty()) {
     const pg_log_entry_t &e = *log.begin();
@@ -183,8 +186,13 @@ void PGLog::trim(
     if (transaction_applied && !async && (missing.num_missing() == 0))
       ceph_assert(trim_to <= info.last_complete);
 
+    // a log with missing items, or one of an async recovery or backfill
+    // target, keeps the full dup window whatever the memory budget
+    bool budgeted = transaction_applied && !async &&
+      missing.num_missing() == 0;
     dout(10) << "trim " << log << " to " << trim_to << dendl;
-    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &write_from_dups);
+    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &write_from_dups,
+	     budgeted ? dups_tracked : 0);
     info.log_tail = log.tail;
     if (log.complete_to != log.log.end())
       dout(10) << " after trim complete_to " << log.complete_to->version << dendl;
@@ -79,10 +79,11 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
-    mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    // indexes are accounted to the osd_pglog mempool along with the log
+    mutable mempool::osd_pglog::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
+    mutable mempool::osd_pglog::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
+    mutable mempool::osd_pglog::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+    mutable mempool::osd_pglog::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
 
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -270,7 +271,7 @@ public:
       ceph_assert(version);
       ceph_assert(user_version);
       ceph_assert(return_code);
-      ceph::unordered_map<osd_reqid_t,pg_log_entry_t*>::const_iterator p;
+      decltype(caller_ops)::const_iterator p;
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
       }
@@ -461,8 +462,7 @@ public:
         for (auto j = e.extra_reqids.begin();
              j != e.extra_reqids.end();
              ++j) {
-          for (ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*>::iterator k =
-		 extra_caller_ops.find(j->first);
+          for (auto k = extra_caller_ops.find(j->first);
                k != extra_caller_ops.end() && k->first == j->first;
                ++k) {
             if (k->second == &e) {
@@ -532,12 +532,14 @@ public:
       }
     } // add
 
+    /// @param dups_tracked versions to keep dups for, 0 for osd_pg_log_dups_tracked
     void trim(
       CephContext* cct,
       eversion_t s,
       set<eversion_t> *trimmed,
       set<string>* trimmed_dups,
-      eversion_t *write_from_dups);
+      eversion_t *write_from_dups,
+      uint64_t dups_tracked = 0);
 
     ostream& print(ostream& out) const;
   }; // IndexedLog
@@ -557,6 +559,7 @@ protected:
   eversion_t dirty_from_dups;  ///< must clear/writeout all dups >= dirty_from_dups
   eversion_t write_from_dups;  ///< must write keys >= write_from_dups
   set<string> trimmed_dups;    ///< must clear keys in trimmed_dups
+  uint64_t dups_tracked = 0;   ///< 0 means osd_pg_log_dups_tracked
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
@@ -708,6 +711,16 @@ public:
     bool transaction_applied = true,
     bool async = false);
 
+  /**
+   * limit how far back future trims keep dups, e.g. under memory
+   * pressure; 0 for osd_pg_log_dups_tracked.  Ignored while there are
+   * missing items or the trim is for an async recovery or backfill
+   * target.
+   */
+  void set_dups_tracked(uint64_t n) {
+    dups_tracked = n;
+  }
+
   void roll_forward_to(
     eversion_t roll_forward_to,
     LogEntryHandler *h) {
@@ -930,8 +943,7 @@ protected:
 		       << " last_divergent_update: " << last_divergent_update
 		       << dendl;
 
-    ceph::unordered_map<hobject_t, pg_log_entry_t*>::const_iterator objiter =
-      log.objects.find(hoid);
+    auto objiter = log.objects.find(hoid);
     if (objiter != log.objects.end() &&
 	objiter->second->version >= first_divergent_update) {
       /// Case 1)
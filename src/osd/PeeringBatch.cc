@@ -0,0 +1,44 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "PeeringBatch.h"
+
+void PeeringBatch::add(
+  spg_t pgid, OSDMapRef map, utime_t now,
+  std::map<int, std::map<spg_t,pg_query_t>>& queries,
+  std::map<int, std::vector<std::pair<pg_notify_t,PastIntervals>>>& notifies,
+  std::map<int, std::vector<std::pair<pg_notify_t,PastIntervals>>>& infos)
+{
+  if (empty()) {
+    osdmap = map;
+    start = now;
+  }
+  pgs.insert(pgid);
+  for (auto& [peer, q] : queries) {
+    query_map[peer].insert(q.begin(), q.end());
+  }
+  for (auto& [peer, n] : notifies) {
+    auto& v = notify_list[peer];
+    v.insert(v.end(),
+	     std::make_move_iterator(n.begin()),
+	     std::make_move_iterator(n.end()));
+  }
+  for (auto& [peer, i] : infos) {
+    auto& v = info_map[peer];
+    v.insert(v.end(),
+	     std::make_move_iterator(i.begin()),
+	     std::make_move_iterator(i.end()));
+  }
+  queries.clear();
+  notifies.clear();
+  infos.clear();
+}
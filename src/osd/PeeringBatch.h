@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_PEERINGBATCH_H
+#define CEPH_OSD_PEERINGBATCH_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "osd/OSDMap.h"
+
+/**
+ * PeeringBatch
+ *
+ * Peering messages of an op shard's PGs that have not been sent yet,
+ * so that those for the same peer OSD go out as one message.  One
+ * batch holds at most one peering event's worth of messages per PG,
+ * all generated against the same map epoch: a message carries a
+ * single epoch, and a PG's messages from successive events must not
+ * be reordered by merging them (see must_split()).  Nor may anything
+ * a PG sends directly overtake its messages in the batch, so the OSD
+ * sends the batch first whenever has() the PG.
+ */
+struct PeeringBatch {
+  OSDMapRef osdmap;
+  utime_t start;        ///< when the first PG was added
+  std::set<spg_t> pgs;  ///< PGs with messages in the batch
+  std::map<int, std::map<spg_t,pg_query_t>> query_map;
+  std::map<int, std::vector<std::pair<pg_notify_t,PastIntervals>>> notify_list;
+  std::map<int, std::vector<std::pair<pg_notify_t,PastIntervals>>> info_map;
+
+  bool empty() const {
+    return pgs.empty();
+  }
+  bool has(spg_t pgid) const {
+    return pgs.count(pgid);
+  }
+  void swap(PeeringBatch& o) {
+    osdmap.swap(o.osdmap);
+    std::swap(start, o.start);
+    pgs.swap(o.pgs);
+    query_map.swap(o.query_map);
+    notify_list.swap(o.notify_list);
+    info_map.swap(o.info_map);
+  }
+
+  /// whether an event of pgid at epoch must start a new batch
+  bool must_split(spg_t pgid, epoch_t epoch) const {
+    return !empty() && (osdmap->get_epoch() != epoch || has(pgid));
+  }
+
+  /// move the messages of an event of pgid into the batch
+  void add(spg_t pgid, OSDMapRef map, utime_t now,
+	   std::map<int, std::map<spg_t,pg_query_t>>& queries,
+	   std::map<int, std::vector<std::pair<pg_notify_t,PastIntervals>>>& notifies,
+	   std::map<int, std::vector<std::pair<pg_notify_t,PastIntervals>>>& infos);
+
+  /**
+   * whether to send the batch now: once the shard has no more queued
+   * work, max_pgs PGs have contributed to it, or its first messages
+   * have waited max_delay seconds
+   */
+  bool ready(utime_t now, bool queue_empty, uint64_t max_pgs,
+	     double max_delay) const {
+    return !empty() &&
+      (queue_empty ||
+       pgs.size() >= max_pgs ||
+       (double)(now - start) >= max_delay);
+  }
+};
+
+#endif
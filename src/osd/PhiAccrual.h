@@ -0,0 +1,75 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_PHIACCRUAL_H
+#define CEPH_OSD_PHIACCRUAL_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "include/utime.h"
+
+/**
+ * PhiAccrual
+ *
+ * phi accrual failure detector for one heartbeat peer.  It tracks the
+ * inter-arrival times of fully acked pings as an EWMA of their mean
+ * and variance, and turns the current silence into a suspicion level
+ * phi = -log10(P(silence this long)).  Until MIN_SAMPLES intervals
+ * have been seen the estimate is not trusted (ready() is false) and
+ * the caller falls back to the fixed grace.
+ */
+struct PhiAccrual {
+  static constexpr unsigned MIN_SAMPLES = 10;
+
+  utime_t last_ack;        ///< last time a ping got all its replies
+  double mean = 0;         ///< EWMA of the ack interval, seconds
+  double var = 0;          ///< EWMA of its variance
+  unsigned intervals = 0;  ///< intervals seen so far
+
+  void note_ack(utime_t now) {
+    if (last_ack != utime_t()) {
+      double d = now - last_ack;
+      if (intervals == 0) {
+	mean = d;
+      } else {
+	const double alpha = .1;
+	double diff = d - mean;
+	mean += alpha * diff;
+	var = (1 - alpha) * (var + alpha * diff * diff);
+      }
+      ++intervals;
+    }
+    last_ack = now;
+  }
+
+  /// whether there is enough history for phi() to mean anything
+  bool ready() const {
+    return intervals >= MIN_SAMPLES;
+  }
+
+  double stddev() const {
+    return sqrt(var);
+  }
+
+  /// suspicion that the peer is down, -log10(P(silence this long))
+  double phi(utime_t now) const {
+    // floor the deviation so that a very regular peer is not
+    // declared down by a single late reply
+    double sd = std::max(stddev(), mean / 4);
+    double t = now - last_ack;
+    double p = .5 * erfc((t - mean) / (sd * M_SQRT2));
+    return p > 0 ? -log10(p) : 308;  // ~ -log10(DBL_MIN)
+  }
+};
+
+#endif
@@ -190,6 +190,17 @@ Context *PrimaryLogPG::bless_context(Context *c) {
   return new BlessedContext(this, c, get_osdmap()->get_epoch());
 }
 
+void PrimaryLogPG::queue_transactions(vector<ObjectStore::Transaction>& tls,
+				      OpRequestRef op)
+{
+  if (!txn_batch.add(tls, op)) {
+    // internal writes are not ordered by the op queue; keep them behind
+    // anything held back
+    flush_txn_batch();
+    osd->store->queue_transactions(ch, tls, op, NULL);
+  }
+}
+
 class PrimaryLogPG::C_PG_ObjectContext : public Context {
   PrimaryLogPGRef pg;
   ObjectContext *obc;
@@ -460,6 +471,7 @@ void PrimaryLogPG::on_global_recover(
   info.stats.stats.sum.add(stat_diff);
   missing_loc.recovered(soid);
   publish_stats_to_osd();
+  osd->logger->inc(l_osd_recovery_objects);
   dout(10) << "pushed " << soid << " to all replicas" << dendl;
   map<hobject_t, ObjectContextRef>::iterator i = recovering.find(soid);
   ceph_assert(i != recovering.end());
@@ -1611,7 +1623,9 @@ int PrimaryLogPG::do_scrub_ls(MOSDOp *m, OSDOp *osd_op)
 
 void PrimaryLogPG::calc_trim_to()
 {
-  size_t target = cct->_conf->osd_min_pg_log_entries;
+  // healthy PGs give back log under OSD memory pressure; degraded ones
+  // keep the full log so that peers can still recover from it
+  size_t target = osd->get_pg_log_budget(cct->_conf->osd_min_pg_log_entries);
   if (is_degraded() ||
       state_test(PG_STATE_RECOVERING |
 		 PG_STATE_RECOVERY_WAIT |
@@ -1673,7 +1687,7 @@ PrimaryLogPG::PrimaryLogPG(OSDService *o, OSDMapRef curmap,
   pgbackend(
     PGBackend::build_pg_backend(
       _pool.info, ec_profile, this, coll_t(p), ch, o->store, cct)),
-  object_contexts(o->cct, o->cct->_conf->osd_pg_object_context_cache_count),
+  object_contexts(&o->obc_cache, p),
   snapset_contexts_lock("PrimaryLogPG::snapset_contexts_lock"),
   new_backfill(false),
   temp_seq(0),
@@ -1905,6 +1919,175 @@ hobject_t PrimaryLogPG::earliest_backfill() const
  * pg lock will be held (if multithreaded)
  * osd_lock NOT held.
  */
+/*
+ * Serve a client read made only of READ, STAT and GETXATTR ops on a
+ * cached, idle head object.  The caller holds the pg lock shared only,
+ * so this may look at but never modify pg state, and it must not use
+ * anything that asserts the pg lock (get_osdmap()).  Anything that
+ * would have to wait, block or fail declines (returns false) without
+ * side effects and the op is requeued for do_request().
+ */
+bool PrimaryLogPG::do_fast_read(OpRequestRef& op)
+{
+  MOSDOp *m = static_cast<MOSDOp*>(op->get_nonconst_req());
+  ceph_assert(m->get_type() == CEPH_MSG_OSD_OP);
+  if (m->finish_decode()) {
+    op->reset_desc();   // for TrackedOp
+    m->clear_payload();
+  }
+
+  // a clean pg has no missing, degraded or backfilling objects
+  if (!is_primary() || !is_active() || !is_clean() || is_deleting() ||
+      !pool.info.is_replicated() ||
+      pool.info.is_tier() || pool.info.has_tiers() ||
+      hit_set || agent_state ||
+      flushes_in_progress > 0 ||
+      op->min_epoch > get_osdmap_epoch()) {
+    return false;
+  }
+  // ops parked on the pg (or on any object) may be ordered before this one
+  if (!waiting_for_map.empty() ||
+      !waiting_for_peered.empty() ||
+      !waiting_for_active.empty() ||
+      !waiting_for_flush.empty() ||
+      !waiting_for_unreadable_object.empty() ||
+      !waiting_for_degraded_object.empty() ||
+      !waiting_for_blocked_object.empty()) {
+    return false;
+  }
+  if (m->get_snapid() != CEPH_NOSNAP ||
+      m->ops.empty() ||
+      can_discard_request(op)) {
+    return false;
+  }
+  for (auto& osd_op : m->ops) {
+    if (osd_op.soid.oid.name.length()) {
+      return false;
+    }
+    switch (osd_op.op.op) {
+    case CEPH_OSD_OP_READ:
+      if (osd_op.op.extent.truncate_seq) {
+	return false;
+      }
+      break;
+    case CEPH_OSD_OP_STAT:
+    case CEPH_OSD_OP_GETXATTR:
+      break;
+    default:
+      return false;
+    }
+  }
+
+  if (op->rmw_flags == 0 && osd->osd->init_op_flags(op)) {
+    return false;
+  }
+  if (op->may_write() || op->may_cache() || op->rwordered() ||
+      !op_has_sufficient_caps(op)) {
+    return false;
+  }
+
+  SessionRef session{
+    static_cast<Session*>(m->get_connection()->get_priv().get())};
+  if (!session || session->backoff_count.load()) {
+    return false;
+  }
+  if (osdmap_ref->is_blacklisted(m->get_source_addr())) {
+    return false;
+  }
+
+  const hobject_t& soid = m->get_hobj();
+  ObjectContextRef obc = object_contexts.lookup(soid);
+  if (!obc ||
+      obc->obs.oi.soid != soid ||
+      !obc->obs.exists ||
+      obc->obs.oi.is_whiteout() ||
+      obc->obs.oi.has_manifest() ||
+      obc->is_blocked() ||
+      obc->rwstate.state != ObjectContext::RWState::RWNONE ||
+      !obc->rwstate.waiters.empty() ||
+      m->get_object_locator() != object_locator_t(soid)) {
+    return false;
+  }
+
+  // work on a copy so that declining leaves the op untouched
+  const object_info_t& oi = obc->obs.oi;
+  vector<OSDOp> ops = m->ops;
+  uint64_t bytes_read = 0, num_rd_kb = 0;
+  boost::optional<uint64_t> data_off;
+  for (auto& osd_op : ops) {
+    auto& o = osd_op.op;
+    switch (o.op) {
+    case CEPH_OSD_OP_READ:
+      {
+	if (!data_off) {
+	  data_off = o.extent.offset;
+	}
+	if (o.extent.length == 0 ||
+	    o.extent.offset + o.extent.length > oi.size) {
+	  o.extent.length =
+	    o.extent.offset >= oi.size ? 0 : oi.size - o.extent.offset;
+	}
+	if (o.extent.length) {
+	  int r = pgbackend->objects_read_sync(
+	    soid, o.extent.offset, o.extent.length, o.flags, &osd_op.outdata);
+	  if (r < 0) {
+	    return false;
+	  }
+	  // whole object: verify it; a mismatch needs the repair path
+	  if (o.extent.offset == 0 && (uint64_t)r == oi.size &&
+	      oi.is_data_digest() &&
+	      oi.data_digest != osd_op.outdata.crc32c(-1)) {
+	    return false;
+	  }
+	  o.extent.length = r;
+	}
+	num_rd_kb += shift_round_up(o.extent.length, 10);
+      }
+      break;
+    case CEPH_OSD_OP_STAT:
+      encode(oi.size, osd_op.outdata);
+      encode(oi.mtime, osd_op.outdata);
+      break;
+    case CEPH_OSD_OP_GETXATTR:
+      {
+	string aname;
+	auto bp = osd_op.indata.cbegin();
+	bp.copy(o.xattr.name_len, aname);
+	if (pgbackend->objects_get_attr(soid, "_" + aname,
+					&osd_op.outdata) < 0) {
+	  return false;
+	}
+	o.xattr.value_len = osd_op.outdata.length();
+	num_rd_kb += shift_round_up(osd_op.outdata.length(), 10);
+      }
+      break;
+    }
+    osd_op.rval = 0;
+    bytes_read += osd_op.outdata.length();
+  }
+
+  dout(10) << __func__ << " " << *m << " on " << soid << dendl;
+  op->mark_reached_pg();
+  op->mark_started();
+  op->osd_trace.event("fast read");
+
+  m->ops.swap(ops);
+  MOSDOpReply *reply = new MOSDOpReply(m, 0, get_osdmap_epoch(), 0, false);
+  reply->claim_op_out_data(m->ops);
+  reply->get_header().data_off = data_off ? *data_off : 0;
+  reply->set_reply_versions(eversion_t(), oi.user_version);
+  reply->set_result(0);
+  reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
+  osd->send_message_osd_client(reply, m->get_connection());
+  op->trace_point(OpRequest::TRACE_REPLIED);
+
+  // folded into unstable_stats by the next op under the pg lock
+  fast_read_num_rd += m->ops.size();
+  fast_read_num_rd_kb += num_rd_kb;
+  log_op_stats(*op, 0, bytes_read);
+  return true;
+}
+
 void PrimaryLogPG::do_op(OpRequestRef& op)
 {
   FUNCTRACE(cct);
@@ -1922,6 +2105,11 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
   hobject_t head = m->get_hobj();
   head.snap = CEPH_NOSNAP;
 
+  // reads from the store must see writes held back in txn_batch
+  if (txn_batch.conflicts(head, m->ops)) {
+    flush_txn_batch();
+  }
+
   if (!info.pgid.pgid.contains(
 	info.pgid.pgid.get_split_bits(pool.info.get_pg_num()), head)) {
     derr << __func__ << " " << info.pgid.pgid << " does not contain "
@@ -2988,18 +3176,25 @@ bool PrimaryLogPG::maybe_promote(ObjectContextRef obc,
     {
       unsigned count = (int)in_hit_set;
       if (count) {
-	// Check if in other hit sets
 	const hobject_t& oid = obc.get() ? obc->obs.oi.soid : missing_oid;
-	for (map<time_t,HitSetRef>::reverse_iterator itor =
-	       agent_state->hit_set_map.rbegin();
-	     itor != agent_state->hit_set_map.rend();
-	     ++itor) {
-	  if (!itor->second->contains(oid)) {
-	    break;
-	  }
-	  ++count;
-	  if (count >= recency) {
-	    break;
+	if (hit_set && hit_set->impl->get_type() == HitSet::TYPE_COUNTING) {
+	  // the decayed count covers past periods too; leave out the
+	  // access we are handling
+	  unsigned hits = hit_set->get_count(oid);
+	  count = hits > 0 ? hits - 1 : 0;
+	} else {
+	  // Check if in other hit sets
+	  for (map<time_t,HitSetRef>::reverse_iterator itor =
+		 agent_state->hit_set_map.rbegin();
+	       itor != agent_state->hit_set_map.rend();
+	       ++itor) {
+	    if (!itor->second->contains(oid)) {
+	      break;
+	    }
+	    ++count;
+	    if (count >= recency) {
+	      break;
+	    }
 	  }
 	}
       }
@@ -4196,23 +4391,42 @@ void PrimaryLogPG::do_scan(
       // Check that from is in backfill_targets vector
       ceph_assert(is_backfill_targets(from));
 
-      BackfillInterval& bi = peer_backfill_info[from];
+      BackfillInterval bi;
       bi.begin = m->begin;
       bi.end = m->end;
       auto p = m->get_data().cbegin();
 
       // take care to preserve ordering!
-      bi.clear_objects();
       ::decode_noclear(bi.objects, p);
 
+      auto pf = peer_backfill_prefetching.find(from);
+      if (pf != peer_backfill_prefetching.end() && pf->second == bi.begin) {
+	peer_backfill_prefetching.erase(pf);
+      }
+
+      // every scan we send starts where the peer's current interval ends
+      BackfillInterval& pbi = peer_backfill_info[from];
+      if (bi.begin != pbi.end) {
+	dout(10) << __func__ << " ignoring stale scan " << bi.begin
+		 << "-" << bi.end << " from " << from
+		 << ", interval is " << pbi.begin << "-" << pbi.end << dendl;
+	break;
+      }
+
       if (waiting_on_backfill.erase(from)) {
+	pbi = std::move(bi);
 	if (waiting_on_backfill.empty()) {
 	  ceph_assert(peer_backfill_info.size() == backfill_targets.size());
+	  osd->logger->tinc(l_osd_backfill_scan_wait_lat,
+			    ceph_clock_now() - backfill_scan_wait_start);
 	  finish_recovery_op(hobject_t::get_max());
 	}
+	maybe_prefetch_backfill_scan(from);
       } else {
-	// we canceled backfill for a while due to a too full, and this
-	// is an extra response from a non-too-full peer
+	// a prefetch, or an extra response from a non-too-full peer after
+	// we canceled backfill for a while due to a too full; either way it
+	// is the interval that follows pbi
+	peer_backfill_prefetch[from] = std::move(bi);
       }
     }
     break;
@@ -4293,8 +4507,6 @@ void PrimaryLogPG::do_backfill_remove(OpRequestRef op)
 int PrimaryLogPG::trim_object(
   bool first, const hobject_t &coid, PrimaryLogPG::OpContextUPtr *ctxp)
 {
-  *ctxp = NULL;
-
   // load clone info
   bufferlist bl;
   ObjectContextRef obc = get_object_context(coid, false, NULL);
@@ -4352,30 +4564,41 @@ int PrimaryLogPG::trim_object(
     }
   }
 
-  OpContextUPtr ctx = simple_opc_create(obc);
-  ctx->head_obc = head_obc;
-
-  if (!ctx->lock_manager.get_snaptrimmer_write(
+  ObcLockManager lock_manager;
+  if (!lock_manager.get_snaptrimmer_write(
 	coid,
 	obc,
 	first)) {
-    close_op_ctx(ctx.release());
+    release_object_locks(lock_manager);
     dout(10) << __func__ << ": Unable to get a wlock on " << coid << dendl;
     return -ENOLCK;
   }
 
-  if (!ctx->lock_manager.get_snaptrimmer_write(
+  if (!lock_manager.get_snaptrimmer_write(
 	head_oid,
 	head_obc,
 	first)) {
-    close_op_ctx(ctx.release());
+    release_object_locks(lock_manager);
     dout(10) << __func__ << ": Unable to get a wlock on " << head_oid << dendl;
     return -ENOLCK;
   }
 
-  ctx->at_version = get_next_version();
+  // append to the caller's context, if any, so that several clones are
+  // trimmed in a single repop
+  OpContext *ctx = ctxp->get();
+  if (!ctx) {
+    *ctxp = simple_opc_create(obc);
+    ctx = ctxp->get();
+    ctx->head_obc = head_obc;
+    ctx->at_version = get_next_version();
+  } else {
+    ctx->at_version.version++;
+  }
+  ctx->lock_manager.merge(std::move(lock_manager));
 
   PGTransaction *t = ctx->op_t.get();
+  t->add_obc(obc);
+  t->add_obc(head_obc);
  
   if (new_snaps.empty()) {
     // remove clone
@@ -4430,7 +4653,7 @@ int PrimaryLogPG::trim_object(
 	pg_log_entry_t::DELETE,
 	coid,
 	ctx->at_version,
-	ctx->obs->oi.version,
+	coi.version,
 	0,
 	osd_reqid_t(),
 	ctx->mtime,
@@ -4553,7 +4776,6 @@ int PrimaryLogPG::trim_object(
     t->setattrs(head_oid, attrs);
   }
 
-  *ctxp = std::move(ctx);
   return 0;
 }
 
@@ -7294,23 +7516,18 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	tracepoint(osd, do_osd_op_pre_omapgetkeys, soid.oid.name.c_str(), soid.snap.val, start_after.c_str(), max_return);
 
 	bufferlist bl;
-	uint32_t num = 0;
 	bool truncated = false;
-	if (oi.is_omap()) {
-	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
-	    );
-	  ceph_assert(iter);
-	  iter->upper_bound(start_after);
-	  for (num = 0; iter->valid(); ++num, iter->next(false)) {
-	    if (num >= max_return ||
-		bl.length() >= cct->_conf->osd_max_omap_bytes_per_request) {
-	      truncated = true;
-	      break;
-	    }
-	    encode(iter->key(), bl);
-	  }
-	} // else return empty out_set
+	int r = do_omap_iterate(
+	  ctx, start_after, string(), max_return, false,
+	  [&bl](const string& key, bufferlist& val) {
+	    encode(key, bl);
+	  },
+	  &truncated, nullptr);
+	if (r < 0) {
+	  result = r;
+	  goto fail;
+	}
+	uint32_t num = r;
 	encode(num, osd_op.outdata);
 	osd_op.outdata.claim_append(bl);
 	encode(truncated, osd_op.outdata);
@@ -7340,33 +7557,20 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	}
 	tracepoint(osd, do_osd_op_pre_omapgetvals, soid.oid.name.c_str(), soid.snap.val, start_after.c_str(), max_return, filter_prefix.c_str());
 
-	uint32_t num = 0;
 	bool truncated = false;
 	bufferlist bl;
-	if (oi.is_omap()) {
-	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
-	    );
-          if (!iter) {
-            result = -ENOENT;
-            goto fail;
-          }
-	  iter->upper_bound(start_after);
-	  if (filter_prefix > start_after) iter->lower_bound(filter_prefix);
-	  for (num = 0;
-	       iter->valid() &&
-		 iter->key().substr(0, filter_prefix.size()) == filter_prefix;
-	       ++num, iter->next(false)) {
-	    dout(20) << "Found key " << iter->key() << dendl;
-	    if (num >= max_return ||
-		bl.length() >= cct->_conf->osd_max_omap_bytes_per_request) {
-	      truncated = true;
-	      break;
-	    }
-	    encode(iter->key(), bl);
-	    encode(iter->value(), bl);
-	  }
-	} // else return empty out_set
+	int r = do_omap_iterate(
+	  ctx, start_after, filter_prefix, max_return, true,
+	  [&bl](const string& key, bufferlist& val) {
+	    encode(key, bl);
+	    encode(val, bl);
+	  },
+	  &truncated, nullptr);
+	if (r < 0) {
+	  result = r;
+	  goto fail;
+	}
+	uint32_t num = r;
 	encode(num, osd_op.outdata);
 	osd_op.outdata.claim_append(bl);
 	encode(truncated, osd_op.outdata);
@@ -7652,6 +7856,11 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	    result = -EINVAL;
 	    break;
 	  }
+	  if (copy_from_local_clone(ctx, src, src_version,
+				    op.copy_from.flags)) {
+	    result = 0;
+	    break;
+	  }
 	  CopyFromCallback *cb = new CopyFromCallback(ctx, osd_op);
           ctx->op_finishers[ctx->current_osd_subop_num].reset(
             new CopyFromFinisher(cb));
@@ -7693,6 +7902,165 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
   return result;
 }
 
+int PrimaryLogPG::do_omap_iterate(
+  OpContext *ctx,
+  const string& start_after,
+  const string& filter_prefix,
+  uint64_t max_return,
+  bool with_values,
+  const std::function<void(const string&, bufferlist&)>& f,
+  bool *truncated,
+  uint64_t *bytes)
+{
+  const object_info_t& oi = ctx->new_obs.oi;
+  *truncated = false;
+  if (bytes)
+    *bytes = 0;
+  if (!oi.is_omap()) {
+    // no entries
+    return 0;
+  }
+  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
+    ch, ghobject_t(oi.soid));
+  if (!iter) {
+    return -ENOENT;
+  }
+  iter->upper_bound(start_after);
+  if (filter_prefix > start_after)
+    iter->lower_bound(filter_prefix);
+  int num = 0;
+  uint64_t len = 0;
+  bufferlist empty;
+  for (;
+       iter->valid() &&
+	 iter->key().compare(0, filter_prefix.size(), filter_prefix) == 0;
+       ++num, iter->next(false)) {
+    dout(20) << "Found key " << iter->key() << dendl;
+    if ((uint64_t)num >= max_return ||
+	len >= cct->_conf->osd_max_omap_bytes_per_request) {
+      *truncated = true;
+      break;
+    }
+    // as encoded: length-prefixed key and value
+    string key = iter->key();
+    len += sizeof(uint32_t) + key.size();
+    if (with_values) {
+      bufferlist val = iter->value();
+      len += sizeof(uint32_t) + val.length();
+      f(key, val);
+    } else {
+      f(key, empty);
+    }
+  }
+  if (bytes)
+    *bytes = len;
+  return num;
+}
+
+int PrimaryLogPG::do_cls_stat(OpContext *ctx, uint64_t *size, utime_t *mtime)
+{
+  // note: stat does not require RD
+  const ObjectState& obs = ctx->new_obs;
+  ctx->delta_stats.num_rd++;
+  if (!obs.exists || obs.oi.is_whiteout()) {
+    return -ENOENT;
+  }
+  ++ctx->processed_subop_count;
+  *size = obs.oi.size;
+  *mtime = obs.oi.mtime;
+  return 0;
+}
+
+int PrimaryLogPG::do_cls_getxattr(OpContext *ctx, const string& name,
+				  bufferlist *out)
+{
+  ++ctx->num_read;
+  ctx->delta_stats.num_rd++;
+  int r = getattr_maybe_cache(ctx->obc, "_" + name, out);
+  if (r < 0)
+    return r;
+  ++ctx->processed_subop_count;
+  ctx->delta_stats.num_rd_kb += shift_round_up(out->length(), 10);
+  return 0;
+}
+
+int PrimaryLogPG::do_cls_getxattrs(OpContext *ctx,
+				   map<string, bufferlist> *out)
+{
+  ++ctx->num_read;
+  ctx->delta_stats.num_rd++;
+  int r = getattrs_maybe_cache(ctx->obc, out);
+  uint64_t len = sizeof(uint32_t);
+  for (auto& p : *out) {
+    len += 2 * sizeof(uint32_t) + p.first.size() + p.second.length();
+  }
+  ctx->delta_stats.num_rd_kb += shift_round_up(len, 10);
+  if (r < 0)
+    return r;
+  ++ctx->processed_subop_count;
+  return 0;
+}
+
+int PrimaryLogPG::do_cls_omap_get_header(OpContext *ctx, bufferlist *out)
+{
+  const object_info_t& oi = ctx->new_obs.oi;
+  ++ctx->processed_subop_count;
+  if (!oi.is_omap()) {
+    // empty header
+    return 0;
+  }
+  ++ctx->num_read;
+  osd->store->omap_get_header(ch, ghobject_t(oi.soid), out);
+  ctx->delta_stats.num_rd_kb += shift_round_up(out->length(), 10);
+  ctx->delta_stats.num_rd++;
+  return 0;
+}
+
+int PrimaryLogPG::do_cls_omap_get_vals_by_keys(OpContext *ctx,
+					       const set<string>& keys,
+					       map<string, bufferlist> *out)
+{
+  const object_info_t& oi = ctx->new_obs.oi;
+  ++ctx->num_read;
+  ++ctx->processed_subop_count;
+  if (oi.is_omap()) {
+    osd->store->omap_get_values(ch, ghobject_t(oi.soid), keys, out);
+  }
+  uint64_t len = sizeof(uint32_t);
+  for (auto& p : *out) {
+    len += 2 * sizeof(uint32_t) + p.first.size() + p.second.length();
+  }
+  ctx->delta_stats.num_rd_kb += shift_round_up(len, 10);
+  ctx->delta_stats.num_rd++;
+  return 0;
+}
+
+int PrimaryLogPG::do_cls_omap_iterate(
+  OpContext *ctx,
+  const string& start_after,
+  const string& filter_prefix,
+  uint64_t max_return,
+  bool with_values,
+  const std::function<void(const string&, bufferlist&)>& f,
+  bool *more)
+{
+  ++ctx->num_read;
+  if (max_return > cct->_conf->osd_max_omap_entries_per_request) {
+    max_return = cct->_conf->osd_max_omap_entries_per_request;
+  }
+  uint64_t bytes = 0;
+  int r = do_omap_iterate(ctx, start_after, filter_prefix, max_return,
+			  with_values, f, more, &bytes);
+  if (r < 0)
+    return r;
+  ++ctx->processed_subop_count;
+  // count and truncated flag as the op would encode them
+  bytes += sizeof(uint32_t) + 1;
+  ctx->delta_stats.num_rd_kb += shift_round_up(bytes, 10);
+  ctx->delta_stats.num_rd++;
+  return r;
+}
+
 int PrimaryLogPG::_get_tmap(OpContext *ctx, bufferlist *header, bufferlist *vals)
 {
   if (ctx->new_obs.oi.size == 0) {
@@ -8277,6 +8645,8 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
        ++p) {
     dout(10) << "do_osd_op_effects, notify " << *p << dendl;
     ConnectionRef conn(ctx->op->get_req()->get_connection());
+    if (!ctx->obc->notify_stats)
+      ctx->obc->notify_stats = std::make_shared<NotifyStats>();
     NotifyRef notif(
       Notify::makeNotifyRef(
 	conn,
@@ -8286,14 +8656,17 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
 	p->cookie,
 	p->notify_id,
 	ctx->obc->obs.oi.user_version,
-	osd));
+	osd,
+	ctx->obc->notify_stats));
+    NotifyBatch batch(notif);
     for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
 	   ctx->obc->watchers.begin();
 	 i != ctx->obc->watchers.end();
 	 ++i) {
       dout(10) << "starting notify on watch " << i->first << dendl;
-      i->second->start_notify(notif);
+      i->second->start_notify(notif, &batch);
     }
+    batch.send();
     notif->init();
   }
 
@@ -8304,6 +8677,16 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
       dout(10) << "notify_ack " << make_pair(p->watch_cookie.get(), p->notify_id) << dendl;
     else
       dout(10) << "notify_ack " << make_pair("NULL", p->notify_id) << dendl;
+    if (p->watch_cookie) {
+      // watchers are keyed by (cookie, entity); don't scan them all
+      auto i = ctx->obc->watchers.find(
+	make_pair(p->watch_cookie.get(), entity));
+      if (i != ctx->obc->watchers.end()) {
+	dout(10) << "acking notify on watch " << i->first << dendl;
+	i->second->notify_ack(p->notify_id, p->reply_bl);
+      }
+      continue;
+    }
     for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
 	   ctx->obc->watchers.begin();
 	 i != ctx->obc->watchers.end();
@@ -8366,8 +8749,10 @@ int PrimaryLogPG::prepare_transaction(OpContext *ctx)
 
   // read-op?  write-op noop? done?
   if (ctx->op_t->empty() && !ctx->modify) {
-    if (ctx->pending_async_reads.empty())
+    if (ctx->pending_async_reads.empty()) {
+      fold_fast_read_stats();
       unstable_stats.add(ctx->delta_stats);
+    }
     if (ctx->op->may_write() &&
 	get_osdmap()->require_osd_release >= CEPH_RELEASE_KRAKEN) {
       ctx->update_log_only = true;
@@ -8570,6 +8955,7 @@ void PrimaryLogPG::complete_read_ctx(int result, OpContext *ctx)
   reply->set_result(result);
   reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
   osd->send_message_osd_client(reply, m->get_connection());
+  ctx->op->trace_point(OpRequest::TRACE_REPLIED);
   close_op_ctx(ctx);
 }
 
@@ -9494,6 +9880,115 @@ void PrimaryLogPG::finish_copyfrom(CopyFromCallback *cb)
   ctx->delta_stats.num_wr_kb += shift_round_up(obs.oi.size, 10);
 
   osd->logger->inc(l_osd_copyfrom);
+  osd->logger->inc(l_osd_copyfrom_bytes_copied, obs.oi.size);
+}
+
+bool PrimaryLogPG::copy_from_local_clone(
+  OpContext *ctx, const hobject_t& src, version_t src_version,
+  unsigned flags)
+{
+  // the source must be the head of an object in this pg that every
+  // shard applying the transaction has, so that the store can clone it
+  // (sharing its data, xattrs and omap) rather than us reading it back
+  // through the objecter and rewriting it.  tiering has its own rules
+  // for where the current copy of an object is.
+  const hobject_t& dest = ctx->obs->oi.soid;
+  if (!cct->_conf->osd_copy_from_local_clone ||
+      !pool.info.is_replicated() ||
+      pool.info.is_tier() || pool.info.has_tiers() ||
+      (flags & (CEPH_OSD_COPY_FROM_FLAG_FLUSH |
+		CEPH_OSD_COPY_FROM_FLAG_MAP_SNAP_CLONE)) ||
+      src.snap != CEPH_NOSNAP ||
+      src.pool != (int64_t)info.pgid.pool() ||
+      !info.pgid.pgid.contains(
+	info.pgid.pgid.get_split_bits(pool.info.get_pg_num()), src) ||
+      copy_ops.count(dest) ||
+      is_missing_object(src) ||
+      is_degraded_or_backfilling_object(src) ||
+      is_degraded_on_async_recovery_target(src)) {
+    return false;
+  }
+  for (auto& peer : backfill_targets) {
+    if (should_send_op(peer, dest) &&
+	peer_info[peer].last_backfill <= src) {
+      return false;
+    }
+  }
+  ObjectContextRef src_obc = get_object_context(src, false);
+  if (!src_obc ||
+      !src_obc->obs.exists ||
+      src_obc->obs.oi.is_whiteout() ||
+      src_obc->obs.oi.has_manifest() ||
+      src_obc->is_blocked() ||
+      (src_version && src_version != src_obc->obs.oi.user_version)) {
+    // let the regular path sort out errors
+    return false;
+  }
+  // hold the source's read lock until the copy is applied so that no
+  // write to it runs underneath the clone.  if a write holds it, the
+  // regular path reads the source in order behind that write.
+  if (!ctx->lock_manager.is_locked(src) &&
+      !ctx->lock_manager.try_get_read_lock(src, src_obc)) {
+    dout(20) << __func__ << " " << src << " is locked: " << *src_obc
+	     << dendl;
+    return false;
+  }
+  const object_info_t& src_oi = src_obc->obs.oi;
+  dout(10) << __func__ << " " << dest << " from " << src << " v"
+	   << src_oi.version << dendl;
+
+  ObjectState& obs = ctx->new_obs;
+  if (obs.exists) {
+    ctx->op_t->remove(dest);
+  } else {
+    ctx->delta_stats.num_objects++;
+    obs.exists = true;
+  }
+  ctx->op_t->clone(dest, src);
+
+  ctx->user_at_version = src_oi.user_version;
+  obs.oi.user_version = ctx->user_at_version;
+  if (src_oi.is_data_digest()) {
+    obs.oi.set_data_digest(src_oi.data_digest);
+  } else {
+    obs.oi.clear_data_digest();
+  }
+  if (src_oi.is_omap_digest()) {
+    obs.oi.set_omap_digest(src_oi.omap_digest);
+  } else {
+    obs.oi.clear_omap_digest();
+  }
+  obs.oi.truncate_seq = src_oi.truncate_seq;
+  obs.oi.truncate_size = src_oi.truncate_size;
+
+  if (obs.oi.is_whiteout()) {
+    obs.oi.clear_flag(object_info_t::FLAG_WHITEOUT);
+    --ctx->delta_stats.num_whiteouts;
+  }
+  if (src_oi.is_omap()) {
+    obs.oi.set_flag(object_info_t::FLAG_OMAP);
+  } else {
+    obs.oi.clear_flag(object_info_t::FLAG_OMAP);
+  }
+
+  interval_set<uint64_t> ch;
+  if (obs.oi.size > 0)
+    ch.insert(0, obs.oi.size);
+  ctx->modified_ranges.union_of(ch);
+
+  if (src_oi.size != obs.oi.size) {
+    ctx->delta_stats.num_bytes -= obs.oi.size;
+    obs.oi.size = src_oi.size;
+    ctx->delta_stats.num_bytes += obs.oi.size;
+  }
+  ctx->delta_stats.num_rd++;
+  ctx->delta_stats.num_rd_kb += shift_round_up(src_oi.size, 10);
+  ctx->delta_stats.num_wr++;
+  ctx->delta_stats.num_wr_kb += shift_round_up(obs.oi.size, 10);
+
+  osd->logger->inc(l_osd_copyfrom);
+  osd->logger->inc(l_osd_copyfrom_bytes_shared, obs.oi.size);
+  return true;
 }
 
 void PrimaryLogPG::finish_promote(int r, CopyResults *results,
@@ -10314,6 +10809,9 @@ void PrimaryLogPG::repop_all_committed(RepGather *repop)
   dout(10) << __func__ << ": repop tid " << repop->rep_tid << " all committed "
 	   << dendl;
   repop->all_committed = true;
+  if (repop->op) {
+    repop->op->trace_point(OpRequest::TRACE_COMMITTED);
+  }
   if (!repop->rep_aborted) {
     if (repop->v != eversion_t()) {
       last_update_ondisk = repop->v;
@@ -10462,6 +10960,9 @@ void PrimaryLogPG::issue_repop(RepGather *repop, OpContext *ctx)
     }
   }
 
+  if (ctx->op) {
+    ctx->op->trace_point(OpRequest::TRACE_SUBMITTED);
+  }
   pgbackend->submit_transaction(
     soid,
     ctx->delta_stats,
@@ -10574,6 +11075,7 @@ void PrimaryLogPG::submit_log_entries(
 {
   dout(10) << __func__ << " " << entries << dendl;
   ceph_assert(is_primary());
+  flush_txn_batch();
 
   eversion_t version;
   if (!entries.empty()) {
@@ -10697,6 +11199,26 @@ void PrimaryLogPG::get_watchers(list<obj_watch_item_t> *ls)
   unlock();
 }
 
+void PrimaryLogPG::dump_watched_objects(Formatter *f)
+{
+  lock();
+  pair<hobject_t, ObjectContextRef> i;
+  while (object_contexts.get_next(i.first, &i)) {
+    ObjectContextRef obc(i.second);
+    if (obc->watchers.empty() && !obc->notify_stats)
+      continue;
+    f->open_object_section("object");
+    f->dump_stream("pgid") << info.pgid;
+    f->dump_string("namespace", obc->obs.oi.soid.get_namespace());
+    f->dump_string("object", obc->obs.oi.soid.oid.name);
+    f->dump_unsigned("watchers", obc->watchers.size());
+    if (obc->notify_stats)
+      obc->notify_stats->dump(f);
+    f->close_section();
+  }
+  unlock();
+}
+
 void PrimaryLogPG::get_obc_watchers(ObjectContextRef obc, list<obj_watch_item_t> &pg_watchers)
 {
   for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator j =
@@ -10881,9 +11403,12 @@ ObjectContextRef PrimaryLogPG::get_object_context(
   osd->logger->inc(l_osd_object_ctx_cache_total);
   if (obc) {
     osd->logger->inc(l_osd_object_ctx_cache_hit);
+    object_contexts.note_hit();
     dout(10) << __func__ << ": found obc in cache: " << obc
 	     << dendl;
   } else {
+    osd->logger->inc(l_osd_object_ctx_cache_miss);
+    object_contexts.note_miss();
     dout(10) << __func__ << ": obc NOT found in cache: " << soid << dendl;
     // check disk
     bufferlist bv;
@@ -12679,6 +13204,17 @@ int PrimaryLogPG::prep_object_replica_deletes(
   return 1;
 }
 
+bool PrimaryLogPG::is_recovery_batchable(const ObjectContextRef& obc) const
+{
+  // only the replicated backend ships a whole small object in one push
+  if (pool.info.is_erasure() ||
+      cct->_conf.get_val<uint64_t>("osd_recovery_max_batch_objects") <= 1) {
+    return false;
+  }
+  return obc->obs.oi.size <=
+    cct->_conf.get_val<Option::size_t>("osd_recovery_batch_max_object_size");
+}
+
 int PrimaryLogPG::prep_object_replica_pushes(
   const hobject_t& soid, eversion_t v,
   PGBackend::RecoveryHandle *h,
@@ -12704,7 +13240,7 @@ int PrimaryLogPG::prep_object_replica_pushes(
 	     << dendl;
   }
 
-  start_recovery_op(soid);
+  bool new_op = start_recovery_op(soid, is_recovery_batchable(obc));
   ceph_assert(!recovering.count(soid));
   recovering.insert(make_pair(soid, obc));
 
@@ -12725,7 +13261,8 @@ int PrimaryLogPG::prep_object_replica_pushes(
     primary_error(soid, v);
     return 0;
   }
-  return 1;
+  // objects batched into an op that is already running are free
+  return new_op ? 1 : 0;
 }
 
 uint64_t PrimaryLogPG::recover_replicas(uint64_t max, ThreadPool::TPHandle &handle,
@@ -12924,6 +13461,8 @@ uint64_t PrimaryLogPG::recover_backfill(
 	 ++i) {
       peer_backfill_info[*i].reset(peer_info[*i].last_backfill);
     }
+    peer_backfill_prefetch.clear();
+    peer_backfill_prefetching.clear();
     backfill_info.reset(last_backfill_started);
 
     backfills_in_flight.clear();
@@ -12980,13 +13519,29 @@ uint64_t PrimaryLogPG::recover_backfill(
       dout(20) << " peer shard " << bt << " backfill " << pbi << dendl;
       if (pbi.begin <= backfill_info.begin &&
 	  !pbi.extends_to_end() && pbi.empty()) {
-	dout(10) << " scanning peer osd." << bt << " from " << pbi.end << dendl;
-	epoch_t e = get_osdmap()->get_epoch();
-	MOSDPGScan *m = new MOSDPGScan(
-	  MOSDPGScan::OP_SCAN_GET_DIGEST, pg_whoami, e, last_peering_reset,
-	  spg_t(info.pgid.pgid, bt.shard),
-	  pbi.end, hobject_t());
-	osd->send_message_osd_cluster(bt.osd, m, get_osdmap()->get_epoch());
+	auto pf = peer_backfill_prefetch.find(bt);
+	if (pf != peer_backfill_prefetch.end() && pf->second.begin == pbi.end) {
+	  dout(10) << " using prefetched scan of peer osd." << bt
+		   << " from " << pbi.end << dendl;
+	  osd->logger->inc(l_osd_backfill_scan_prefetch_hit);
+	  pbi = std::move(pf->second);
+	  peer_backfill_prefetch.erase(pf);
+	  maybe_prefetch_backfill_scan(bt);
+	  continue;
+	}
+	auto pfi = peer_backfill_prefetching.find(bt);
+	if (pfi != peer_backfill_prefetching.end() && pfi->second == pbi.end) {
+	  dout(10) << " waiting on prefetch scan of peer osd." << bt
+		   << " from " << pbi.end << dendl;
+	} else {
+	  dout(10) << " scanning peer osd." << bt << " from " << pbi.end << dendl;
+	  epoch_t e = get_osdmap()->get_epoch();
+	  MOSDPGScan *m = new MOSDPGScan(
+	    MOSDPGScan::OP_SCAN_GET_DIGEST, pg_whoami, e, last_peering_reset,
+	    spg_t(info.pgid.pgid, bt.shard),
+	    pbi.end, hobject_t());
+	  osd->send_message_osd_cluster(bt.osd, m, get_osdmap()->get_epoch());
+	}
 	ceph_assert(waiting_on_backfill.find(bt) == waiting_on_backfill.end());
 	waiting_on_backfill.insert(bt);
         sent_scan = true;
@@ -12995,6 +13550,7 @@ uint64_t PrimaryLogPG::recover_backfill(
 
     // Count simultaneous scans as a single op and let those complete
     if (sent_scan) {
+      backfill_scan_wait_start = ceph_clock_now();
       ops++;
       start_recovery_op(hobject_t::get_max()); // XXX: was pbi.end
       break;
@@ -13101,7 +13657,7 @@ uint64_t PrimaryLogPG::recover_backfill(
 	    dout(0) << __func__ << " Error " << r << " trying to backfill " << backfill_info.begin << dendl;
 	    break;
 	  }
-	  ops++;
+	  ops += r;
 	} else {
 	  *work_started = true;
 	  dout(20) << "backfill blocking on " << backfill_info.begin
@@ -13275,7 +13831,7 @@ int PrimaryLogPG::prep_backfill_object_push(
 
   ceph_assert(!recovering.count(oid));
 
-  start_recovery_op(oid);
+  bool new_op = start_recovery_op(oid, is_recovery_batchable(obc));
   recovering.insert(make_pair(oid, obc));
 
   // We need to take the read_lock here in order to flush in-progress writes
@@ -13291,8 +13847,33 @@ int PrimaryLogPG::prep_backfill_object_push(
     primary_error(oid, v);
     backfills_in_flight.erase(oid);
     missing_loc.add_missing(oid, v, eversion_t());
+    return r;
   }
-  return r;
+  return new_op ? 1 : 0;
+}
+
+void PrimaryLogPG::maybe_prefetch_backfill_scan(pg_shard_t bt)
+{
+  // Ask the peer for the interval after pbi while we push the objects in
+  // it, so that we do not stall on the scan round trip once pbi is done.
+  // Peer objects beyond pbi.end are not touched by backfill until pbi is
+  // consumed, and the peer does not apply client writes past its
+  // last_backfill, so the result stays valid until we need it.
+  const BackfillInterval& pbi = peer_backfill_info[bt];
+  if (!cct->_conf.get_val<bool>("osd_backfill_scan_prefetch") ||
+      pbi.extends_to_end() ||
+      peer_backfill_prefetch.count(bt) ||
+      peer_backfill_prefetching.count(bt)) {
+    return;
+  }
+  dout(10) << __func__ << " prefetching peer osd." << bt
+	   << " from " << pbi.end << dendl;
+  MOSDPGScan *m = new MOSDPGScan(
+    MOSDPGScan::OP_SCAN_GET_DIGEST, pg_whoami, get_osdmap()->get_epoch(),
+    last_peering_reset, spg_t(info.pgid.pgid, bt.shard),
+    pbi.end, hobject_t());
+  osd->send_message_osd_cluster(bt.osd, m, get_osdmap()->get_epoch());
+  peer_backfill_prefetching[bt] = pbi.end;
 }
 
 void PrimaryLogPG::update_range(
@@ -13364,6 +13945,7 @@ void PrimaryLogPG::scan_range(
 {
   ceph_assert(is_locked());
   dout(10) << "scan_range from " << bi->begin << dendl;
+  utime_t start = ceph_clock_now();
   bi->clear_objects();
 
   vector<hobject_t> ls;
@@ -13398,6 +13980,7 @@ void PrimaryLogPG::scan_range(
       dout(20) << "  " << *p << " " << oi.version << dendl;
     }
   }
+  osd->logger->tinc(l_osd_backfill_scan_local_lat, ceph_clock_now() - start);
 }
 
 
@@ -13504,6 +14087,19 @@ void PrimaryLogPG::hit_set_setup()
     return;
   }
 
+  if (pool.info.hit_set_params.get_type() == HitSet::TYPE_COUNTING) {
+    // a counting set holds the access history of many periods; keep it
+    // across peering, or pick it up from the newest archive when we
+    // become primary
+    if (hit_set && hit_set->impl->get_type() == HitSet::TYPE_COUNTING) {
+      return;
+    }
+    if (hit_set_load_counting()) {
+      hit_set_apply_log();
+      return;
+    }
+  }
+
   // FIXME: discard any previous data for now
   hit_set_create();
 
@@ -13588,11 +14184,94 @@ void PrimaryLogPG::hit_set_create()
 
     dout(10) << __func__ << " target_size " << p->target_size
 	     << " fpp " << p->get_fpp() << dendl;
+  } else if (pool.info.hit_set_params.get_type() == HitSet::TYPE_COUNTING) {
+    CountingHitSet::Params *p =
+      static_cast<CountingHitSet::Params*>(params.impl.get());
+    CountingHitSet *prev = nullptr;
+    if (hit_set && hit_set->impl->get_type() == HitSet::TYPE_COUNTING) {
+      prev = static_cast<CountingHitSet*>(hit_set->impl.get());
+    }
+
+    uint64_t target_size = p->target_size;
+    if (target_size == 0 && prev) {
+      // the set holds every object whose count has not decayed away,
+      // not just those of the last period
+      target_size = prev->approx_unique_insert_count();
+    } else if (target_size == 0 && hit_set) {
+      utime_t dur = now - hit_set_start_stamp;
+      target_size = (double)hit_set->approx_unique_insert_count() *
+	(double)pool.info.hit_set_period / (double)dur;
+    }
+    target_size = std::max<uint64_t>(target_size,
+				     cct->_conf->osd_hit_set_min_size);
+    target_size = std::min<uint64_t>(target_size,
+				     cct->_conf->osd_hit_set_max_size);
+
+    if (prev &&
+	prev->get_target_size() * 2 >= target_size &&
+	target_size * 2 >= prev->get_target_size()) {
+      // carry the counts over into the new period
+      CountingHitSet *next = static_cast<CountingHitSet*>(prev->clone());
+      next->decay(p->get_decay());
+      dout(10) << __func__ << " carrying over " << next->insert_count()
+	       << " hits, target_size " << next->get_target_size()
+	       << " decay " << p->get_decay() << dendl;
+      hit_set.reset(new HitSet(next));
+      hit_set_start_stamp = now;
+      return;
+    }
+    // counters can not be rehashed into a set of another size; start over
+    p->target_size = target_size;
+    p->seed = now.sec();
+    dout(10) << __func__ << " target_size " << p->target_size
+	     << " decay " << p->get_decay() << dendl;
   }
   hit_set.reset(new HitSet(params));
   hit_set_start_stamp = now;
 }
 
+/**
+ * seed a counting HitSet from the newest archive
+ *
+ * @return false if there is none or it can not be read yet
+ */
+bool PrimaryLogPG::hit_set_load_counting()
+{
+  if (info.hit_set.history.empty() || !pool.info.is_replicated()) {
+    return false;
+  }
+  const pg_hit_set_info_t& last = info.hit_set.history.back();
+  hobject_t oid = get_hit_set_archive_object(last.begin, last.end,
+					     last.using_gmt);
+  if (is_unreadable_object(oid)) {
+    dout(10) << __func__ << " unreadable " << oid << dendl;
+    return false;
+  }
+  bufferlist bl;
+  int r = osd->store->read(ch, ghobject_t(oid), 0, 0, bl);
+  if (r < 0) {
+    dout(10) << __func__ << " could not read " << oid << ": "
+	     << cpp_strerror(r) << dendl;
+    return false;
+  }
+  HitSet hs;
+  try {
+    auto p = bl.cbegin();
+    decode(hs, p);
+  } catch (buffer::error& e) {
+    derr << __func__ << " could not decode " << oid << dendl;
+    return false;
+  }
+  if (!hs.impl || hs.impl->get_type() != HitSet::TYPE_COUNTING) {
+    return false;
+  }
+  dout(10) << __func__ << " loaded " << hs.insert_count() << " hits from "
+	   << oid << dendl;
+  hit_set.reset(new HitSet(hs.impl->clone()));
+  hit_set_start_stamp = ceph_clock_now();
+  return true;
+}
+
 /**
  * apply log entries to set
  *
@@ -13683,7 +14362,10 @@ void PrimaryLogPG::hit_set_persist()
   encode(*hit_set, bl);
   dout(20) << __func__ << " archive " << oid << dendl;
 
-  if (agent_state) {
+  // a counting set carries its history into the next one; the agent
+  // has no use for the archived copies
+  if (agent_state &&
+      hit_set->impl->get_type() != HitSet::TYPE_COUNTING) {
     agent_state->add_hit_set(new_hset.begin, hit_set);
     uint32_t size = agent_state->hit_set_map.size();
     if (size >= pool.info.hit_set_count) {
@@ -14015,6 +14697,9 @@ void PrimaryLogPG::agent_load_hit_sets()
   if (agent_state->evict_mode == TierAgentState::EVICT_MODE_IDLE) {
     return;
   }
+  if (pool.info.hit_set_params.get_type() == HitSet::TYPE_COUNTING) {
+    return;  // the current set already holds the history
+  }
 
   if (agent_state->hit_set_map.size() < info.hit_set.history.size()) {
     dout(10) << __func__ << dendl;
@@ -14488,6 +15173,11 @@ void PrimaryLogPG::agent_estimate_temp(const hobject_t& oid, int *temp)
   ceph_assert(hit_set);
   ceph_assert(temp);
   *temp = 0;
+  if (hit_set->impl->get_type() == HitSet::TYPE_COUNTING) {
+    // decayed hit count over the past periods
+    *temp = hit_set->get_count(oid);
+    return;
+  }
   if (hit_set->contains(oid))
     *temp = 1000000;
   unsigned i = 0;
@@ -15085,6 +15775,7 @@ int PrimaryLogPG::rep_repair_primary_object(const hobject_t& soid, OpContext *ct
   // Only supports replicated pools
   ceph_assert(!pool.info.is_erasure());
   ceph_assert(is_primary());
+  flush_txn_batch();
 
   dout(10) << __func__ << " " << soid
 	   << " peers osd.{" << acting_recovery_backfill << "}" << dendl;
@@ -15235,10 +15926,12 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
 
   vector<hobject_t> to_trim;
   unsigned max = pg->cct->_conf->osd_pg_max_concurrent_snap_trims;
-  to_trim.reserve(max);
+  unsigned batch = pg->cct->_conf.get_val<uint64_t>(
+    "osd_snap_trim_batch_objects");
+  to_trim.reserve(max * batch);
   int r = pg->snap_mapper.get_next_objects_to_trim(
     snap_to_trim,
-    max,
+    max * batch,
     &to_trim);
   if (r != 0 && r != -ENOENT) {
     lderr(pg->cct) << "get_next_objects_to_trim returned "
@@ -15269,12 +15962,42 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   }
   ceph_assert(!to_trim.empty());
 
+  // up to batch clones are trimmed by each repop
+  OpContextUPtr ctx;
+  vector<hobject_t> batched;
+  auto submit = [&]() {
+    for (auto &object: batched) {
+      in_flight.insert(object);
+    }
+    pg->osd->logger->inc(l_osd_snap_trim_objects, batched.size());
+    pg->osd->logger->inc(l_osd_snap_trim_batches);
+    ctx->register_on_success(
+      [pg, batched, &in_flight]() {
+	for (auto &object: batched) {
+	  ceph_assert(in_flight.find(object) != in_flight.end());
+	  in_flight.erase(object);
+	}
+	if (in_flight.empty()) {
+	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
+	    pg->snap_trimmer_machine.process_event(Reset());
+	  } else {
+	    pg->snap_trimmer_machine.process_event(RepopsComplete());
+	  }
+	}
+      });
+    batched.clear();
+    pg->simple_opc_submit(std::move(ctx));
+  };
+
   for (auto &&object: to_trim) {
     // Get next
     ldout(pg->cct, 10) << "AwaitAsyncWork react trimming " << object << dendl;
-    OpContextUPtr ctx;
-    int error = pg->trim_object(in_flight.empty(), object, &ctx);
+    int error = pg->trim_object(in_flight.empty() && !ctx, object, &ctx);
     if (error) {
+      if (ctx) {
+	// the clones already in the batch have been trimmed in memory
+	submit();
+      }
       if (error == -ENOLCK) {
 	ldout(pg->cct, 10) << "could not get write lock on obj "
 			   << object << dendl;
@@ -15295,21 +16018,13 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
       }
     }
 
-    in_flight.insert(object);
-    ctx->register_on_success(
-      [pg, object, &in_flight]() {
-	ceph_assert(in_flight.find(object) != in_flight.end());
-	in_flight.erase(object);
-	if (in_flight.empty()) {
-	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
-	    pg->snap_trimmer_machine.process_event(Reset());
-	  } else {
-	    pg->snap_trimmer_machine.process_event(RepopsComplete());
-	  }
-	}
-      });
-
-    pg->simple_opc_submit(std::move(ctx));
+    batched.push_back(object);
+    if (batched.size() >= batch) {
+      submit();
+    }
+  }
+  if (ctx) {
+    submit();
   }
 
   return transit< WaitRepops >();
@@ -316,12 +316,11 @@ public:
   }
   void queue_transaction(ObjectStore::Transaction&& t,
 			 OpRequestRef op) override {
+    flush_txn_batch();
     osd->store->queue_transaction(ch, std::move(t), op);
   }
   void queue_transactions(vector<ObjectStore::Transaction>& tls,
-			  OpRequestRef op) override {
-    osd->store->queue_transactions(ch, tls, op, NULL);
-  }
+			  OpRequestRef op) override;
   epoch_t get_epoch() const override {
     return get_osdmap()->get_epoch();
   }
@@ -908,6 +907,7 @@ protected:
   void hit_set_clear();     ///< discard any HitSet state
   void hit_set_setup();     ///< initialize HitSet state
   void hit_set_create();    ///< create a new HitSet
+  bool hit_set_load_counting(); ///< load a counting HitSet from its archive
   void hit_set_persist();   ///< persist hit info
   bool hit_set_apply_log(); ///< apply log entries to update in-memory HitSet
   void hit_set_trim(OpContextUPtr &ctx, unsigned max); ///< discard old HitSets
@@ -956,7 +956,7 @@ protected:
   bool already_ack(eversion_t v);
 
   // projected object info
-  SharedLRU<hobject_t, ObjectContext> object_contexts;
+  ObjectContextCache::PGHandle object_contexts;
   // map from oid.snapdir() to SnapSetContext *
   map<hobject_t, SnapSetContext*> snapset_contexts;
   Mutex snapset_contexts_lock;
@@ -968,6 +968,7 @@ protected:
   void check_blacklisted_obc_watchers(ObjectContextRef obc);
   void check_blacklisted_watchers() override;
   void get_watchers(list<obj_watch_item_t> *ls) override;
+  void dump_watched_objects(Formatter *f) override;
   void get_obc_watchers(ObjectContextRef obc, list<obj_watch_item_t> &pg_watchers);
 public:
   void handle_watch_timeout(WatchRef watch);
@@ -1091,6 +1092,7 @@ protected:
   hobject_t last_backfill_started;
   bool new_backfill;
 
+  bool is_recovery_batchable(const ObjectContextRef& obc) const;
   int prep_object_replica_pushes(const hobject_t& soid, eversion_t v,
 				 PGBackend::RecoveryHandle *h,
 				 bool *work_started);
@@ -1247,6 +1249,9 @@ protected:
     ThreadPool::TPHandle &handle
     );
 
+  /// Ask backfill target bt for the interval after its current one
+  void maybe_prefetch_backfill_scan(pg_shard_t bt);
+
   /// Update a hash range to reflect changes since the last scan
   void update_range(
     BackfillInterval *bi,        ///< [in,out] interval to update
@@ -1306,6 +1311,9 @@ protected:
   }
   void _copy_some(ObjectContextRef obc, CopyOpRef cop);
   void finish_copyfrom(CopyFromCallback *cb);
+  /// copy-from within this pg by cloning in the store; false if not possible
+  bool copy_from_local_clone(OpContext *ctx, const hobject_t& src,
+			     version_t src_version, unsigned flags);
   void finish_promote(int r, CopyResults *results, ObjectContextRef obc);
   void cancel_copy(CopyOpRef cop, bool requeue, vector<ceph_tid_t> *tids);
   void cancel_copy_ops(bool requeue, vector<ceph_tid_t> *tids);
@@ -1436,12 +1444,10 @@ public:
     ceph_tid_t tid) override;
 
   void clear_cache();
-  int get_cache_obj_count() {
-    return object_contexts.get_count();
-  }
   void do_request(
     OpRequestRef& op,
     ThreadPool::TPHandle &handle) override;
+  bool do_fast_read(OpRequestRef& op) override;
   void do_op(OpRequestRef& op);
   void record_write_error(OpRequestRef op, const hobject_t &soid,
 			  MOSDOpReply *orig_reply, int r);
@@ -1454,12 +1460,51 @@ public:
 
   void handle_backoff(OpRequestRef& op);
 
+  /// trim coid, appending to *ctxp if it is already set
   int trim_object(bool first, const hobject_t &coid, OpContextUPtr *ctxp);
   void snap_trimmer(epoch_t e) override;
   void kick_snap_trim() override;
   void snap_trimmer_scrub_complete() override;
   int do_osd_ops(OpContext *ctx, vector<OSDOp>& ops);
 
+  /**
+   * visit omap entries of the object in ctx
+   *
+   * Visits the keys after start_after that begin with filter_prefix,
+   * stopping after max_return entries or once the visited entries
+   * would encode to osd_max_omap_bytes_per_request.
+   *
+   * @param f called with each key and, if with_values, its value
+   * @param truncated [out] whether entries were left unvisited
+   * @param bytes [out] encoded size of the visited entries, if not null
+   * @return number of entries visited, or -ENOENT
+   */
+  int do_omap_iterate(OpContext *ctx,
+		      const string& start_after,
+		      const string& filter_prefix,
+		      uint64_t max_return,
+		      bool with_values,
+		      const std::function<void(const string&, bufferlist&)>& f,
+		      bool *truncated,
+		      uint64_t *bytes);
+
+  // direct reads for object class methods (see objclass/class_api.cc),
+  // accounted in ctx like the equivalent op through do_osd_ops
+  int do_cls_stat(OpContext *ctx, uint64_t *size, utime_t *mtime);
+  int do_cls_getxattr(OpContext *ctx, const string& name, bufferlist *out);
+  int do_cls_getxattrs(OpContext *ctx, map<string, bufferlist> *out);
+  int do_cls_omap_get_header(OpContext *ctx, bufferlist *out);
+  int do_cls_omap_get_vals_by_keys(OpContext *ctx, const set<string>& keys,
+				   map<string, bufferlist> *out);
+  int do_cls_omap_iterate(
+    OpContext *ctx,
+    const string& start_after,
+    const string& filter_prefix,
+    uint64_t max_return,
+    bool with_values,
+    const std::function<void(const string&, bufferlist&)>& f,
+    bool *more);
+
   int _get_tmap(OpContext *ctx, bufferlist *header, bufferlist *vals);
   int do_tmap2omap(OpContext *ctx, unsigned flags);
   int do_tmapup(OpContext *ctx, bufferlist::const_iterator& bp, OSDOp& osd_op);
@@ -1612,10 +1657,11 @@ private:
 	}
       };
       auto *pg = context< SnapTrimmer >().pg;
-      if (pg->cct->_conf->osd_snap_trim_sleep > 0) {
+      double sleep = pg->osd->get_snap_trim_sleep_time();
+      if (sleep > 0) {
 	Mutex::Locker l(pg->osd->sleep_lock);
 	wakeup = pg->osd->sleep_timer.add_event_after(
-	  pg->cct->_conf->osd_snap_trim_sleep,
+	  sleep,
 	  new OnTimer{pg, pg->get_osdmap()->get_epoch()});
       } else {
 	post_event(SnapTrimTimerReady());
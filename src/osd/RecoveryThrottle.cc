@@ -0,0 +1,71 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+
+#include "RecoveryThrottle.h"
+
+// smallest sleep to start from when backing off from no sleep at all
+static constexpr double MIN_BACKOFF_SLEEP = 0.01;
+
+int RecoveryThrottle::step(bool over, bool waiting, uint64_t in_use,
+			   uint64_t active_max, double base_sleep,
+			   double sleep_max)
+{
+  active_max = std::max<uint64_t>(1, active_max);
+  sleep_max = std::max(base_sleep, sleep_max);
+
+  // the bounds may have been changed since the last step
+  max_active = std::min(active_max, std::max<uint64_t>(1, max_active));
+  sleep = std::min(sleep_max, std::max(base_sleep, sleep));
+  uint64_t old_max = max_active;
+  double old_sleep = sleep;
+
+  // only probe for more concurrency while recovery uses what it has
+  bool limited = waiting || in_use >= old_max;
+  if (over) {
+    // back off quickly: halve the concurrency, then stretch the sleep
+    if (max_active > 1) {
+      max_active /= 2;
+    } else {
+      sleep = step_sleep(true, sleep, base_sleep, sleep_max);
+    }
+  } else if (sleep > base_sleep) {
+    // and speed back up gradually, in the reverse order
+    sleep = step_sleep(false, sleep, base_sleep, sleep_max);
+  } else if (limited && max_active < active_max) {
+    ++max_active;
+  }
+
+  if (max_active < old_max || sleep > old_sleep) {
+    return -1;
+  }
+  if (max_active > old_max || sleep < old_sleep) {
+    return 1;
+  }
+  return 0;
+}
+
+double RecoveryThrottle::step_sleep(bool over, double sleep,
+				    double base_sleep, double sleep_max)
+{
+  sleep_max = std::max(base_sleep, sleep_max);
+  sleep = std::min(sleep_max, std::max(base_sleep, sleep));
+  if (over) {
+    return std::min(sleep_max, std::max(sleep * 2, MIN_BACKOFF_SLEEP));
+  }
+  sleep *= 0.75;
+  if (sleep < base_sleep + 0.001) {
+    sleep = base_sleep;
+  }
+  return sleep;
+}
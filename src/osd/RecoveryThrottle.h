@@ -0,0 +1,63 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_RECOVERYTHROTTLE_H
+#define CEPH_OSD_RECOVERYTHROTTLE_H
+
+#include <cstdint>
+
+/**
+ * RecoveryThrottle
+ *
+ * The recovery concurrency and sleep adapted to client and device
+ * load.  Once per tick, step() backs off quickly while the load is
+ * over target (halving max_active down to 1, then doubling the sleep)
+ * and speeds back up gradually in the reverse order (shrinking the
+ * sleep by a quarter back to the configured one, then raising
+ * max_active by one while recovery uses all of it).  It holds no lock;
+ * OSDService calls it under recovery_lock.
+ */
+struct RecoveryThrottle {
+  uint64_t max_active = 0;
+  double sleep = 0;
+
+  RecoveryThrottle() = default;
+  RecoveryThrottle(uint64_t max_active, double sleep)
+    : max_active(max_active), sleep(sleep) {}
+
+  /**
+   * take one control step
+   *
+   * @param over client op latency or device utilization is over target
+   * @param waiting pgs are waiting for recovery slots
+   * @param in_use recovery ops active or reserved
+   * @param active_max upper bound for max_active
+   * @param base_sleep configured sleep, the lower bound for sleep
+   * @param sleep_max upper bound for sleep
+   * @return < 0 if recovery was slowed down, > 0 if it was sped up,
+   *         0 if nothing changed
+   */
+  int step(bool over, bool waiting, uint64_t in_use,
+	   uint64_t active_max, double base_sleep, double sleep_max);
+
+  /**
+   * one step of the sleep alone: doubled while over target, shrunk by
+   * a quarter back towards base_sleep otherwise.  Shared with other
+   * background work paced the same way, e.g. snap trimming.
+   *
+   * @return the new sleep, within [base_sleep, max(base_sleep, sleep_max)]
+   */
+  static double step_sleep(bool over, double sleep, double base_sleep,
+			   double sleep_max);
+};
+
+#endif
@@ -612,13 +612,13 @@ int ReplicatedBackend::be_deep_scrub(
       pos.data_hash = bufferhash(-1);
     }
 
-    bufferlist bl;
-    r = store->read(
+    uint32_t digest = pos.data_hash.digest();
+    r = store->verify_and_summarize(
       ch,
       ghobject_t(
 	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
       pos.data_pos,
-      cct->_conf->osd_deep_scrub_stride, bl,
+      cct->_conf->osd_deep_scrub_stride, &digest,
       fadvise_flags);
     if (r < 0) {
       dout(20) << __func__ << "  " << poid << " got "
@@ -626,9 +626,7 @@ int ReplicatedBackend::be_deep_scrub(
       o.read_error = true;
       return 0;
     }
-    if (r > 0) {
-      pos.data_hash << bl;
-    }
+    pos.data_hash = bufferhash(digest);
     pos.data_pos += r;
     if (r == cct->_conf->osd_deep_scrub_stride) {
       dout(20) << __func__ << "  " << poid << " more data, digest so far 0x"
@@ -1779,6 +1777,7 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
 	msg->pushes.push_back(*j);
       }
       msg->set_cost(cost);
+      get_parent()->get_logger()->inc(l_osd_push_batch_objects, pushes);
       get_parent()->send_message_osd_cluster(msg, con);
     }
   }
@@ -13,6 +13,7 @@
  */
 
 #include "SnapMapper.h"
+#include "common/errno.h"
 
 #define dout_context cct
 #define dout_subsys ceph_subsys_osd
@@ -51,6 +52,26 @@ int OSDriver::get_next(
   }
 }
 
+int OSDriver::get_range(
+  const std::string &begin,
+  const std::string &end,
+  unsigned max,
+  std::map<std::string, bufferlist> *out)
+{
+  ObjectMap::ObjectMapIterator iter =
+    os->get_omap_iterator(ch, hoid);
+  if (!iter) {
+    ceph_abort();
+    return -EINVAL;
+  }
+  for (iter->upper_bound(begin);
+       iter->valid() && iter->key() < end && out->size() < max;
+       iter->next()) {
+    out->insert(make_pair(iter->key(), iter->value()));
+  }
+  return 0;
+}
+
 struct Mapping {
   snapid_t snap;
   hobject_t hoid;
@@ -150,6 +171,23 @@ int SnapMapper::get_snaps(
   object_snaps *out)
 {
   ceph_assert(check(oid));
+  if (use_index(oid.pool)) {
+    auto p = object_index.find(oid);
+    if (p == object_index.end()) {
+      dout(20) << __func__ << " " << oid << " not in index" << dendl;
+      return -ENOENT;
+    }
+    if (out) {
+      *out = object_snaps(
+	oid, std::set<snapid_t>(p->second.begin(), p->second.end()));
+      dout(20) << __func__ << " " << oid << " " << out->snaps << dendl;
+      if (out->snaps.empty()) {
+	dout(1) << __func__ << " " << oid << " empty snapset" << dendl;
+	ceph_assert(!cct->_conf->osd_debug_verify_snaps);
+      }
+    }
+    return 0;
+  }
   set<string> keys;
   map<string, bufferlist> got;
   keys.insert(to_object_key(oid));
@@ -178,37 +216,42 @@ int SnapMapper::get_snaps(
 
 void SnapMapper::clear_snaps(
   const hobject_t &oid,
-  MapCacher::Transaction<std::string, bufferlist> *t)
+  set<string> *to_remove)
 {
   dout(20) << __func__ << " " << oid << dendl;
   ceph_assert(check(oid));
-  set<string> to_remove;
-  to_remove.insert(to_object_key(oid));
-  if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
-    for (auto& i : to_remove) {
-      dout(20) << __func__ << " rm " << i << dendl;
-    }
-  }
-  backend.remove_keys(to_remove, t);
+  to_remove->insert(to_object_key(oid));
 }
 
 void SnapMapper::set_snaps(
   const hobject_t &oid,
   const object_snaps &in,
-  MapCacher::Transaction<std::string, bufferlist> *t)
+  map<string, bufferlist> *to_set)
 {
   ceph_assert(check(oid));
-  map<string, bufferlist> to_set;
   bufferlist bl;
   encode(in, bl);
-  to_set[to_object_key(oid)] = bl;
+  (*to_set)[to_object_key(oid)] = bl;
   dout(20) << __func__ << " " << oid << " " << in.snaps << dendl;
+}
+
+void SnapMapper::apply_keys(
+  const map<string, bufferlist> &to_set,
+  const set<string> &to_remove,
+  MapCacher::Transaction<std::string, bufferlist> *t)
+{
   if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
     for (auto& i : to_set) {
       dout(20) << __func__ << " set " << i.first << dendl;
     }
+    for (auto& i : to_remove) {
+      dout(20) << __func__ << " rm " << i << dendl;
+    }
   }
-  backend.set_keys(to_set, t);
+  if (!to_remove.empty())
+    backend.remove_keys(to_remove, t);
+  if (!to_set.empty())
+    backend.set_keys(to_set, t);
 }
 
 int SnapMapper::update_snaps(
@@ -231,23 +274,23 @@ int SnapMapper::update_snaps(
   if (old_snaps_check)
     ceph_assert(out.snaps == *old_snaps_check);
 
-  object_snaps in(oid, new_snaps);
-  set_snaps(oid, in, t);
-
+  map<string, bufferlist> to_set;
   set<string> to_remove;
-  for (set<snapid_t>::iterator i = out.snaps.begin();
-       i != out.snaps.end();
-       ++i) {
-    if (!new_snaps.count(*i)) {
-      to_remove.insert(to_raw_key(make_pair(*i, oid)));
+  object_snaps in(oid, new_snaps);
+  set_snaps(oid, in, &to_set);
+  for (auto i : out.snaps) {
+    if (!new_snaps.count(i)) {
+      to_remove.insert(to_raw_key(make_pair(i, oid)));
     }
   }
-  if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
-    for (auto& i : to_remove) {
-      dout(20) << __func__ << " rm " << i << dendl;
+  for (auto i : new_snaps) {
+    if (!out.snaps.count(i)) {
+      to_set.insert(to_raw(make_pair(i, oid)));
     }
   }
-  backend.remove_keys(to_remove, t);
+  apply_keys(to_set, to_remove, t);
+  if (use_index(oid.pool))
+    index_set(oid, new_snaps);
   return 0;
 }
 
@@ -270,21 +313,15 @@ void SnapMapper::add_oid(
     }
   }
 
+  map<string, bufferlist> to_set;
   object_snaps _snaps(oid, snaps);
-  set_snaps(oid, _snaps, t);
-
-  map<string, bufferlist> to_add;
-  for (set<snapid_t>::iterator i = snaps.begin();
-       i != snaps.end();
-       ++i) {
-    to_add.insert(to_raw(make_pair(*i, oid)));
-  }
-  if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
-    for (auto& i : to_add) {
-      dout(20) << __func__ << " set " << i.first << dendl;
-    }
+  set_snaps(oid, _snaps, &to_set);
+  for (auto i : snaps) {
+    to_set.insert(to_raw(make_pair(i, oid)));
   }
-  backend.set_keys(to_add, t);
+  apply_keys(to_set, set<string>(), t);
+  if (use_index(oid.pool))
+    index_set(oid, snaps);
 }
 
 int SnapMapper::get_next_objects_to_trim(
@@ -294,6 +331,19 @@ int SnapMapper::get_next_objects_to_trim(
 {
   ceph_assert(out);
   ceph_assert(out->empty());
+  if (use_index(pool)) {
+    auto p = snap_index.find(snap);
+    if (p != snap_index.end()) {
+      for (auto i = p->second.begin();
+	   i != p->second.end() && out->size() < max;
+	   ++i) {
+	out->push_back(*i);
+      }
+    }
+    dout(20) << __func__ << " " << snap << " got " << *out
+	     << " from index" << dendl;
+    return out->empty() ? -ENOENT : 0;
+  }
   int r = 0;
   for (set<string>::iterator i = prefixes.begin();
        i != prefixes.end() && out->size() < max && r == 0;
@@ -352,20 +402,16 @@ int SnapMapper::_remove_oid(
   if (r < 0)
     return r;
 
-  clear_snaps(oid, t);
-
   set<string> to_remove;
+  clear_snaps(oid, &to_remove);
   for (set<snapid_t>::iterator i = out.snaps.begin();
        i != out.snaps.end();
        ++i) {
     to_remove.insert(to_raw_key(make_pair(*i, oid)));
   }
-  if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
-    for (auto& i : to_remove) {
-      dout(20) << __func__ << " rm " << i << dendl;
-    }
-  }
-  backend.remove_keys(to_remove, t);
+  apply_keys(map<string, bufferlist>(), to_remove, t);
+  if (use_index(oid.pool))
+    index_erase(oid);
   return 0;
 }
 
@@ -382,3 +428,102 @@ int SnapMapper::get_snaps(
     snaps->swap(out.snaps);
   return 0;
 }
+
+void SnapMapper::reset_index()
+{
+  index_loaded = false;
+  index_disabled = false;
+  object_index.clear();
+  snap_index.clear();
+}
+
+bool SnapMapper::use_index(int64_t oid_pool)
+{
+  // a mapper may be asked about objects outside the prefixes it indexes,
+  // e.g. the bits=0 mapper OSD::recursive_remove_collection() uses
+  if (oid_pool != pool)
+    return false;
+  if (!index_loaded && !index_disabled) {
+    int r = load_index();
+    if (r < 0) {
+      derr << __func__ << " failed to load index: " << cpp_strerror(r)
+	   << dendl;
+      reset_index();
+      index_disabled = true;
+    }
+  }
+  return index_loaded;
+}
+
+int SnapMapper::load_index()
+{
+  ceph_assert(!index_loaded);
+  if (index_max_objects == 0) {
+    index_disabled = true;
+    return 0;
+  }
+  for (auto &prefix : prefixes) {
+    string begin = OBJECT_PREFIX + prefix;
+    string end = begin;
+    ++end.back();
+    map<string, bufferlist> got;
+    uint64_t left = index_max_objects - object_index.size();
+    int r = backend.get_range(begin, end, left + 1, &got);
+    if (r < 0)
+      return r;
+    if (got.size() > left) {
+      dout(10) << __func__ << " more than " << index_max_objects
+	       << " objects, not indexing" << dendl;
+      reset_index();
+      index_disabled = true;
+      return 0;
+    }
+    for (auto &i : got) {
+      object_snaps os;
+      auto bp = i.second.cbegin();
+      decode(os, bp);
+      ceph_assert(check(os.oid));
+      for (auto snap : os.snaps) {
+	snap_index[snap].insert(os.oid);
+      }
+      object_index[os.oid].insert(os.snaps.begin(), os.snaps.end());
+    }
+  }
+  dout(10) << __func__ << " indexed " << object_index.size() << " objects in "
+	   << snap_index.size() << " snaps" << dendl;
+  index_loaded = true;
+  return 0;
+}
+
+void SnapMapper::index_set(
+  const hobject_t &oid,
+  const std::set<snapid_t> &snaps)
+{
+  index_erase(oid);
+  if (object_index.size() >= index_max_objects) {
+    dout(10) << __func__ << " more than " << index_max_objects
+	     << " objects, dropping index" << dendl;
+    reset_index();
+    index_disabled = true;
+    return;
+  }
+  for (auto snap : snaps) {
+    snap_index[snap].insert(oid);
+  }
+  object_index[oid].insert(snaps.begin(), snaps.end());
+}
+
+void SnapMapper::index_erase(const hobject_t &oid)
+{
+  auto p = object_index.find(oid);
+  if (p == object_index.end())
+    return;
+  for (auto snap : p->second) {
+    auto q = snap_index.find(snap);
+    ceph_assert(q != snap_index.end());
+    q->second.erase(oid);
+    if (q->second.empty())
+      snap_index.erase(q);
+  }
+  object_index.erase(p);
+}
@@ -16,6 +16,7 @@
 #define SNAPMAPPER_H
 
 #include <string>
+#include <map>
 #include <set>
 #include <utility>
 #include <string.h>
@@ -24,6 +25,7 @@
 #include "common/hobject.h"
 #include "include/buffer.h"
 #include "include/encoding.h"
+#include "include/mempool.h"
 #include "include/object.h"
 #include "os/ObjectStore.h"
 
@@ -74,6 +76,11 @@ public:
   int get_next(
     const std::string &key,
     pair<std::string, bufferlist> *next) override;
+  int get_range(
+    const std::string &begin,
+    const std::string &end,
+    unsigned max,
+    std::map<std::string, bufferlist> *out) override;
 };
 
 /**
@@ -97,6 +104,12 @@ public:
  * The 2) mapping is arranged such that all objects in a particular
  * snap will sort together, and so that all objects in a pg for a
  * particular snap will group under up to 8 prefixes.
+ *
+ * Both mappings are also kept in memory once the pg's object keys have
+ * been read (see load_index()), so lookups and snap trim listings do
+ * not touch the store and updates only write the keys that change.
+ * The index covers at most osd_snap_mapper_index_max_objects objects;
+ * larger pgs go to the store for every lookup.
  */
 class SnapMapper {
 public:
@@ -137,10 +150,16 @@ private:
   void set_snaps(
     const hobject_t &oid,
     const object_snaps &out,
-    MapCacher::Transaction<std::string, bufferlist> *t);
+    std::map<std::string, bufferlist> *to_set);
 
   void clear_snaps(
     const hobject_t &oid,
+    std::set<std::string> *to_remove);
+
+  /// Queue all key updates of one operation as a single set and remove
+  void apply_keys(
+    const std::map<std::string, bufferlist> &to_set,
+    const std::set<std::string> &to_remove,
     MapCacher::Transaction<std::string, bufferlist> *t);
 
   // True if hoid belongs in this mapping based on mask_bits and match
@@ -151,6 +170,21 @@ private:
     MapCacher::Transaction<std::string, bufferlist> *t ///< [out] transaction
     );
 
+  /// in-memory copy of both mappings for this pg
+  const uint64_t index_max_objects;
+  bool index_loaded = false;
+  bool index_disabled = false;
+  mempool::osd::map<hobject_t, mempool::osd::set<snapid_t>> object_index;
+  mempool::osd::map<snapid_t, mempool::osd::set<hobject_t>> snap_index;
+
+  /// Read this pg's object keys into object_index/snap_index
+  int load_index();
+  void reset_index();
+  /// True if mappings of objects in oid_pool can be served from the index
+  bool use_index(int64_t oid_pool);
+  void index_set(const hobject_t &oid, const std::set<snapid_t> &snaps);
+  void index_erase(const hobject_t &oid);
+
 public:
   static string make_shard_prefix(shard_id_t shard) {
     if (shard == shard_id_t::NO_SHARD)
@@ -174,7 +208,10 @@ public:
     int64_t pool,    ///< [in] pool
     shard_id_t shard ///< [in] shard
     )
-    : cct(cct), backend(driver), mask_bits(bits), match(match), pool(pool),
+    : cct(cct), backend(driver),
+      index_max_objects(
+	cct->_conf.get_val<uint64_t>("osd_snap_mapper_index_max_objects")),
+      mask_bits(bits), match(match), pool(pool),
       shard(shard), shard_prefix(make_shard_prefix(shard)) {
     update_bits(mask_bits);
   }
@@ -185,6 +222,7 @@ public:
     uint32_t new_bits  ///< [in] new split bits
     ) {
     mask_bits = new_bits;
+    reset_index();
     set<string> _prefixes = hobject_t::get_prefixes(
       mask_bits,
       match,
@@ -0,0 +1,64 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "TxnBatch.h"
+#include "messages/MOSDOp.h"
+
+bool TxnBatch::add(std::vector<ObjectStore::Transaction>& tls,
+		   OpRequestRef op)
+{
+  if (!open || !op) {
+    return false;
+  }
+  for (auto& t : tls) {
+    txns.push_back(std::move(t));
+  }
+  tls.clear();
+  if (!first_op) {
+    first_op = op;
+  }
+  ++ops;
+  if (op->get_req()->get_type() == CEPH_MSG_OSD_OP) {
+    heads.insert(
+      static_cast<const MOSDOp*>(op->get_req())->get_hobj().get_head());
+  }
+  return true;
+}
+
+bool TxnBatch::conflicts(const hobject_t& head,
+			 const std::vector<OSDOp>& ops) const
+{
+  if (heads.empty()) {
+    return false;
+  }
+  if (heads.count(head)) {
+    return true;
+  }
+  // copy-from, clone-range and the like name a source object
+  for (auto& osd_op : ops) {
+    if (osd_op.soid.oid.name.length()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+OpRequestRef TxnBatch::take(std::vector<ObjectStore::Transaction> *tls)
+{
+  *tls = std::move(txns);
+  txns.clear();
+  ops = 0;
+  heads.clear();
+  OpRequestRef op;
+  op.swap(first_op);
+  return op;
+}
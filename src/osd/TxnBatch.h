@@ -0,0 +1,75 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_TXNBATCH_H
+#define CEPH_OSD_TXNBATCH_H
+
+#include <set>
+#include <vector>
+
+#include "os/ObjectStore.h"
+#include "osd/OpRequest.h"
+
+/**
+ * TxnBatch
+ *
+ * Transactions of writes processed back-to-back under one pg lock
+ * (OSD::dequeue_op_batch), held back so that the pg can submit them
+ * with a single queue_transactions() call.  They keep their order and
+ * their own commit callbacks, so each op is still acked on its own,
+ * in op order.  The pg must submit the batch before anything that
+ * could read what it holds or overtake it: see add() and conflicts().
+ */
+class TxnBatch {
+  bool open = false;
+  std::vector<ObjectStore::Transaction> txns;
+  OpRequestRef first_op;
+  unsigned ops = 0;
+  std::set<hobject_t> heads;  ///< heads written by the batch
+
+public:
+  void begin() {
+    open = true;
+  }
+  void end() {
+    open = false;
+  }
+  bool is_open() const {
+    return open;
+  }
+  bool empty() const {
+    return txns.empty();
+  }
+  unsigned get_ops() const {
+    return ops;
+  }
+
+  /**
+   * hold back the transactions of op
+   *
+   * Returns false, leaving tls alone, if they must be submitted on
+   * their own: when the batch is closed, or for internal writes (no
+   * op), which the op queue does not order.  The caller submits the
+   * batch before them.
+   */
+  bool add(std::vector<ObjectStore::Transaction>& tls, OpRequestRef op);
+
+  /// whether an op on head, with these sub ops, may read the store
+  /// where the batch has written
+  bool conflicts(const hobject_t& head, const std::vector<OSDOp>& ops) const;
+
+  /// take what is held back for submission, leaving the batch empty
+  /// (and open if it was); returns the op to submit them with
+  OpRequestRef take(std::vector<ObjectStore::Transaction> *tls);
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "include/types.h"
 #include "messages/MWatchNotify.h"
+#include "messages/MWatchNotifyBatch.h"
 
 #include <map>
 
@@ -17,6 +18,54 @@ struct CancelableContext : public Context {
   virtual void cancel() = 0;
 };
 
+void NotifyStats::note_complete(utime_t lat, bool timed_out)
+{
+  uint64_t ns = lat.to_nsec();
+  latency_sum_ns += ns;
+  uint64_t max = latency_max_ns;
+  while (ns > max && !latency_max_ns.compare_exchange_weak(max, ns))
+    ;
+  if (timed_out)
+    ++timeouts;
+  --in_flight;
+}
+
+void NotifyStats::dump(Formatter *f) const
+{
+  uint64_t n = notifies;
+  uint64_t done = n - in_flight;
+  f->dump_unsigned("notifies", n);
+  f->dump_unsigned("in_flight", in_flight);
+  f->dump_unsigned("timeouts", timeouts);
+  f->dump_float("avg_watchers", n ? (double)watchers_notified / n : 0.0);
+  f->dump_float("avg_latency",
+		done ? (double)latency_sum_ns / done / 1000000000.0 : 0.0);
+  f->dump_float("max_latency", (double)latency_max_ns / 1000000000.0);
+}
+
+void NotifyBatch::send()
+{
+  for (auto& [con, cookies] : pending) {
+    if (cookies.size() > 1 &&
+	HAVE_FEATURE(con->get_features(), SERVER_NAUTILUS)) {
+      auto m = new MWatchNotifyBatch(notif->version, notif->notify_id,
+				     notif->client_gid, notif->payload);
+      m->cookies.swap(cookies);
+      notif->osd->logger->inc(l_osd_notify_batch, m->cookies.size());
+      con->send_message(m);
+      continue;
+    }
+    for (auto cookie : cookies) {
+      MWatchNotify *m = new MWatchNotify(
+	cookie, notif->version, notif->notify_id,
+	CEPH_WATCH_EVENT_NOTIFY, notif->payload);
+      m->notifier_gid = notif->client_gid;
+      con->send_message(m);
+    }
+  }
+  pending.clear();
+}
+
 #define dout_context osd->cct
 #define dout_subsys ceph_subsys_osd
 #undef dout_prefix
@@ -36,7 +85,8 @@ Notify::Notify(
   uint64_t cookie,
   uint64_t notify_id,
   uint64_t version,
-  OSDService *osd)
+  OSDService *osd,
+  NotifyStatsRef stats)
   : client(client), client_gid(client_gid),
     complete(false),
     discarded(false),
@@ -48,7 +98,8 @@ Notify::Notify(
     version(version),
     osd(osd),
     cb(NULL),
-    lock("Notify::lock") {}
+    lock("Notify::lock"),
+    stats(stats) {}
 
 NotifyRef Notify::makeNotifyRef(
   ConnectionRef client,
@@ -58,13 +109,14 @@ NotifyRef Notify::makeNotifyRef(
   uint64_t cookie,
   uint64_t notify_id,
   uint64_t version,
-  OSDService *osd) {
+  OSDService *osd,
+  NotifyStatsRef stats) {
   NotifyRef ret(
     new Notify(
       client, client_gid,
       payload, timeout,
       cookie, notify_id,
-      version, osd));
+      version, osd, stats));
   ret->set_self(ret);
   return ret;
 }
@@ -102,20 +154,10 @@ void Notify::do_timeout()
   timed_out = true;         // we will send the client an error code
   maybe_complete_notify();
   ceph_assert(complete);
-  set<WatchRef> _watchers;
-  _watchers.swap(watchers);
+  // no pg lock: the watchers that did not ack drop us in
+  // Watch::prune_notifies()
+  watchers.clear();
   lock.Unlock();
-
-  for (set<WatchRef>::iterator i = _watchers.begin();
-       i != _watchers.end();
-       ++i) {
-    boost::intrusive_ptr<PrimaryLogPG> pg((*i)->get_pg());
-    pg->lock();
-    if (!(*i)->is_discarded()) {
-      (*i)->cancel_notify(self.lock());
-    }
-    pg->unlock();
-  }
 }
 
 void Notify::register_cb()
@@ -204,12 +246,21 @@ void Notify::maybe_complete_notify()
     unregister_cb();
 
     complete = true;
+
+    utime_t lat = ceph_clock_now() - start;
+    osd->logger->tinc(l_osd_notify_lat, lat);
+    if (timed_out)
+      osd->logger->inc(l_osd_notify_timeout);
+    if (stats)
+      stats->note_complete(lat, timed_out);
   }
 }
 
 void Notify::discard()
 {
   Mutex::Locker l(lock);
+  if (!is_discarded() && stats)
+    --stats->in_flight;
   discarded = true;
   unregister_cb();
   watchers.clear();
@@ -218,6 +269,14 @@ void Notify::discard()
 void Notify::init()
 {
   Mutex::Locker l(lock);
+  start = ceph_clock_now();
+  osd->logger->inc(l_osd_notify);
+  osd->logger->inc(l_osd_notify_watchers, watchers.size());
+  if (stats) {
+    ++stats->notifies;
+    ++stats->in_flight;
+    stats->watchers_notified += watchers.size();
+  }
   register_cb();
   maybe_complete_notify();
 }
@@ -353,6 +412,7 @@ void Watch::unregister_cb()
 void Watch::got_ping(utime_t t)
 {
   last_ping = t;
+  prune_notifies();
   if (conn) {
     register_cb();
   }
@@ -367,6 +427,7 @@ void Watch::connect(ConnectionRef con, bool _will_ping)
   dout(10) << __func__ << " con " << con << dendl;
   conn = con;
   will_ping = _will_ping;
+  prune_notifies();
   auto priv = con->get_priv();
   if (priv) {
     auto sessionref = static_cast<Session*>(priv.get());
@@ -445,8 +506,9 @@ void Watch::remove(bool send_disconnect)
   discard_state();
 }
 
-void Watch::start_notify(NotifyRef notif)
+void Watch::start_notify(NotifyRef notif, NotifyBatch *batch)
 {
+  prune_notifies();
   ceph_assert(in_progress_notifies.find(notif->notify_id) ==
 	 in_progress_notifies.end());
   if (will_ping) {
@@ -464,7 +526,20 @@ void Watch::start_notify(NotifyRef notif)
   in_progress_notifies[notif->notify_id] = notif;
   notif->start_watcher(self.lock());
   if (connected())
-    send_notify(notif);
+    send_notify(notif, batch);
+}
+
+void Watch::prune_notifies()
+{
+  for (auto i = in_progress_notifies.begin();
+       i != in_progress_notifies.end(); ) {
+    if (i->second->is_done()) {
+      dout(10) << __func__ << " " << i->first << dendl;
+      i = in_progress_notifies.erase(i);
+    } else {
+      ++i;
+    }
+  }
 }
 
 void Watch::cancel_notify(NotifyRef notif)
@@ -473,9 +548,13 @@ void Watch::cancel_notify(NotifyRef notif)
   in_progress_notifies.erase(notif->notify_id);
 }
 
-void Watch::send_notify(NotifyRef notif)
+void Watch::send_notify(NotifyRef notif, NotifyBatch *batch)
 {
   dout(10) << "send_notify" << dendl;
+  if (batch) {
+    batch->add(conn, cookie);
+    return;
+  }
   MWatchNotify *notify_msg = new MWatchNotify(
     cookie, notif->version, notif->notify_id,
     CEPH_WATCH_EVENT_NOTIFY, notif->payload);
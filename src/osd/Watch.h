@@ -14,9 +14,14 @@
 #ifndef CEPH_WATCH_H
 #define CEPH_WATCH_H
 
+#include <atomic>
+#include <map>
 #include <set>
+#include <vector>
 #include "msg/Connection.h"
 #include "include/Context.h"
+#include "include/utime.h"
+#include "common/Formatter.h"
 
 enum WatcherState {
   WATCHER_PENDING,
@@ -40,13 +45,58 @@ typedef std::weak_ptr<Notify> WNotifyRef;
 
 struct CancelableContext;
 
+/**
+ * NotifyStats accumulates the notifies sent on one object
+ *
+ * Held by the ObjectContext and by each Notify on the object; notifies
+ * complete under Notify::lock only, so the counters are atomic.
+ */
+struct NotifyStats {
+  std::atomic<uint64_t> notifies = {0};
+  std::atomic<uint64_t> in_flight = {0};
+  std::atomic<uint64_t> timeouts = {0};
+  std::atomic<uint64_t> watchers_notified = {0};
+  std::atomic<uint64_t> latency_sum_ns = {0};
+  std::atomic<uint64_t> latency_max_ns = {0};
+
+  void note_complete(utime_t lat, bool timed_out);
+  void dump(Formatter *f) const;
+};
+typedef std::shared_ptr<NotifyStats> NotifyStatsRef;
+
+/**
+ * NotifyBatch collects the watches of one notify fanout by connection
+ *
+ * Sent once every watcher has been registered with the Notify: the
+ * watches a client holds over one connection get a single
+ * MWatchNotifyBatch carrying the payload once, or one MWatchNotify each
+ * if the client predates that message.
+ */
+class NotifyBatch {
+  NotifyRef notif;
+  std::map<ConnectionRef, std::vector<uint64_t>> pending;
+public:
+  explicit NotifyBatch(NotifyRef notif) : notif(notif) {}
+  ~NotifyBatch() {
+    send();
+  }
+  void add(ConnectionRef con, uint64_t cookie) {
+    pending[con].push_back(cookie);
+  }
+  void send();
+};
+
 /**
  * Notify tracks the progress of a particular notify
  *
- * References are held by Watch and the timeout callback.
+ * References are held by Watch and the timeout callback.  Completion,
+ * by the last ack or by the timeout, happens under Notify::lock alone;
+ * watches drop a completed notify the next time they are used, under
+ * their pg lock.
  */
 class Notify {
   friend class NotifyTimeoutCB;
+  friend class NotifyBatch;
   friend class Watch;
   WNotifyRef self;
   ConnectionRef client;
@@ -66,6 +116,9 @@ class Notify {
   CancelableContext *cb;
   Mutex lock;
 
+  utime_t start;
+  NotifyStatsRef stats;
+
   /// (gid,cookie) -> reply_bl for everyone who acked the notify
   multimap<pair<uint64_t,uint64_t>,bufferlist> notify_replies;
 
@@ -88,7 +141,8 @@ class Notify {
     uint64_t cookie,
     uint64_t notify_id,
     uint64_t version,
-    OSDService *osd);
+    OSDService *osd,
+    NotifyStatsRef stats);
 
   /// registers a timeout callback with the watch_timer
   void register_cb();
@@ -113,7 +167,8 @@ public:
     uint64_t cookie,
     uint64_t notify_id,
     uint64_t version,
-    OSDService *osd);
+    OSDService *osd,
+    NotifyStatsRef stats);
 
   /// Call after creation to initialize
   void init();
@@ -135,6 +190,12 @@ public:
 
   /// Called when the notify is canceled due to a new peering interval
   void discard();
+
+  /// true once the notify completed, timed out or was discarded
+  bool is_done() {
+    Mutex::Locker l(lock);
+    return is_discarded();
+  }
 };
 
 /**
@@ -177,8 +238,11 @@ class Watch {
   /// Registers the timeout callback with watch_timer
   void register_cb();
 
-  /// send a Notify message when connected for notif
-  void send_notify(NotifyRef notif);
+  /// send a Notify message when connected for notif, or add it to batch
+  void send_notify(NotifyRef notif, NotifyBatch *batch = nullptr);
+
+  /// forget notifies that completed or timed out without our ack
+  void prune_notifies();
 
   /// Cleans up state on discard or remove (including Connection state, obc)
   void discard_state();
@@ -250,7 +314,8 @@ public:
 
   /// Adds notif as in-progress notify
   void start_notify(
-    NotifyRef notif ///< [in] Reference to new in-progress notify
+    NotifyRef notif, ///< [in] Reference to new in-progress notify
+    NotifyBatch *batch = nullptr ///< [in] batch to send the notify in
     );
 
   /// Removes timed out notify
@@ -17,6 +17,7 @@
 
 #include "osd/mClockClientQueue.h"
 #include "common/dout.h"
+#include "messages/MOSDOp.h"
 
 namespace dmc = crimson::dmclock;
 using namespace std::placeholders;
@@ -44,13 +45,40 @@ namespace ceph {
   const dmc::ClientInfo* mClockClientQueue::op_class_client_info_f(
     const mClockClientQueue::InnerClient& client)
   {
-    return client_info_mgr.get_client_info(client.second);
+    if (client.tenant) {
+      return &tenant_infos.at(client.tenant);
+    }
+    return client_info_mgr.get_client_info(client.type);
+  }
+
+  const ceph::mclock::TenantInfo*
+  mClockClientQueue::get_tenant(const Request& request) {
+    boost::optional<OpRequestRef> op = request.maybe_get_op();
+    if (!op) {
+      return nullptr;
+    }
+    return (*op)->qos_tenant.get();
   }
 
   mClockClientQueue::InnerClient
   inline mClockClientQueue::get_inner_client(const Client& cl,
 					     const Request& request) {
-    return InnerClient(cl, client_info_mgr.osd_op_type(request));
+    osd_op_type_t type = client_info_mgr.osd_op_type(request);
+    if (type == osd_op_type_t::client_op) {
+      if (auto tenant = get_tenant(request); tenant) {
+	auto [p, inserted] = tenant_infos.try_emplace(
+	  tenant->id, tenant->reservation, tenant->weight, tenant->limit);
+	if (!inserted &&
+	    (p->second.reservation != tenant->reservation ||
+	     p->second.weight != tenant->weight ||
+	     p->second.limit != tenant->limit)) {
+	  p->second = dmc::ClientInfo(tenant->reservation, tenant->weight,
+				      tenant->limit);
+	}
+	return InnerClient{0, type, tenant->id};
+      }
+    }
+    return InnerClient{cl, type, 0};
   }
 
   // Formatted output of the queue
@@ -78,7 +106,21 @@ namespace ceph {
 					 unsigned priority,
 					 unsigned cost,
 					 Request&& item) {
-    queue.enqueue(get_inner_client(cl, item), priority, 1u, std::move(item));
+    InnerClient inner = get_inner_client(cl, item);
+    if (inner.type == osd_op_type_t::client_op) {
+      boost::optional<OpRequestRef> op = item.maybe_get_op();
+      if (op && (*op)->get_req()->get_type() == CEPH_MSG_OSD_OP) {
+	auto m = static_cast<const MOSDOp*>((*op)->get_req());
+	uint32_t delta = m->get_qos_delta();
+	if (delta > 0) {
+	  uint32_t rho = std::min(m->get_qos_rho(), delta);
+	  queue.enqueue_distributed(inner, priority, 1u, std::move(item),
+				    dmc::ReqParams(delta, rho));
+	  return;
+	}
+      }
+    }
+    queue.enqueue(inner, priority, 1u, std::move(item));
   }
 
   // Enqueue the op in the front of the regular queue
@@ -92,6 +134,28 @@ namespace ceph {
 
   // Return an op to be dispatched
   inline Request mClockClientQueue::dequeue() {
-    return queue.dequeue();
+    boost::optional<dmc::PhaseType> phase;
+    Request r = queue.dequeue_distributed(&phase);
+    if (!phase) {
+      return r;
+    }
+    boost::optional<OpRequestRef> op = r.maybe_get_op();
+    if (!op || (*op)->get_req()->get_type() != CEPH_MSG_OSD_OP) {
+      return r;
+    }
+    // the phase goes back to the client in the reply, for its
+    // delta/rho accounting
+    bool reservation = *phase == dmc::PhaseType::reservation;
+    static_cast<MOSDOp*>((*op)->get_nonconst_req())->set_qos_phase(
+      reservation ? 0 : 1);
+    if (auto& tenant = (*op)->qos_tenant; tenant) {
+      tenant->logger->inc(l_mclock_tenant_ops);
+      if (reservation) {
+	tenant->logger->inc(l_mclock_tenant_res_ops);
+      }
+      tenant->logger->tinc(l_mclock_tenant_queue_lat,
+			   ceph_clock_now() - r.get_start_time());
+    }
+    return r;
   }
 } // namespace ceph
@@ -15,7 +15,9 @@
 
 #pragma once
 
+#include <map>
 #include <ostream>
+#include <tuple>
 
 #include "boost/variant.hpp"
 
@@ -39,7 +41,22 @@ namespace ceph {
 
     using osd_op_type_t = ceph::mclock::osd_op_type_t;
 
-    using InnerClient = std::pair<uint64_t,osd_op_type_t>;
+    // client ops of a qos tenant share one inner client, keyed by the
+    // tenant id; all other ops are keyed by owner and op class
+    struct InnerClient {
+      uint64_t owner;
+      osd_op_type_t type;
+      uint32_t tenant;
+
+      friend bool operator<(const InnerClient& l, const InnerClient& r) {
+	return std::tie(l.owner, l.type, l.tenant) <
+	  std::tie(r.owner, r.type, r.tenant);
+      }
+      friend bool operator==(const InnerClient& l, const InnerClient& r) {
+	return std::tie(l.owner, l.type, l.tenant) ==
+	  std::tie(r.owner, r.type, r.tenant);
+      }
+    };
 
     using queue_t = mClockQueue<Request, InnerClient>;
 
@@ -47,6 +64,10 @@ namespace ceph {
 
     ceph::mclock::OpClassClientInfoMgr client_info_mgr;
 
+    // the queue holds on to the ClientInfo of each inner client, so
+    // tenant parameters are kept here by id and updated in place
+    std::map<uint32_t, crimson::dmclock::ClientInfo> tenant_infos;
+
   public:
 
     mClockClientQueue(CephContext *cct);
@@ -106,6 +127,7 @@ namespace ceph {
   protected:
 
     InnerClient get_inner_client(const Client& cl, const Request& request);
+    const ceph::mclock::TenantInfo* get_tenant(const Request& request);
   }; // class mClockClientAdapter
 
 } // namespace ceph
@@ -14,8 +14,11 @@
 
 
 #include "common/dout.h"
+#include "common/strtol.h"
+#include "include/str_list.h"
 #include "osd/mClockOpClassSupport.h"
 #include "osd/OpQueueItem.h"
+#include "osd/OSDMap.h"
 
 #include "include/ceph_assert.h"
 
@@ -113,5 +116,143 @@ namespace ceph {
 	MSG_OSD_EC_READ == mtype ||
 	MSG_OSD_EC_READ_REPLY == mtype;
     }
+
+    int parse_tenant_qos(const std::string& spec,
+			 std::map<EntityName, TenantQos> *out,
+			 std::ostream *err) {
+      for (auto& t : get_str_vec(spec, ", \t")) {
+	auto eq = t.find('=');
+	EntityName entity;
+	if (eq == std::string::npos || !entity.from_str(t.substr(0, eq))) {
+	  *err << "invalid tenant '" << t << "', expected <entity>=<res>:<wgt>:<lim>";
+	  return -EINVAL;
+	}
+	auto vals = get_str_vec(t.substr(eq + 1), ":");
+	if (vals.size() != 3) {
+	  *err << "invalid qos '" << t.substr(eq + 1) << "' for " << entity
+	       << ", expected <res>:<wgt>:<lim>";
+	  return -EINVAL;
+	}
+	double v[3];
+	for (unsigned i = 0; i < 3; ++i) {
+	  std::string e;
+	  v[i] = strict_strtod(vals[i].c_str(), &e);
+	  if (!e.empty() || v[i] < 0) {
+	    *err << "invalid qos value '" << vals[i] << "' for " << entity;
+	    return -EINVAL;
+	  }
+	}
+	if (v[1] == 0) {
+	  *err << "qos weight for " << entity << " must be positive";
+	  return -EINVAL;
+	}
+	(*out)[entity] = TenantQos{v[0], v[1], v[2]};
+      }
+      return 0;
+    }
+
+    TenantInfoMgr::TenantInfoMgr(CephContext *cct) :
+      cct(cct)
+    {
+      std::ostringstream err;
+      if (set_entity_tenants(
+	    cct->_conf.get_val<std::string>("osd_op_queue_mclock_tenants"),
+	    &err) < 0) {
+	lderr(cct) << "osd_op_queue_mclock_tenants: " << err.str() << dendl;
+      }
+    }
+
+    TenantInfoMgr::~TenantInfoMgr() {
+      for (auto& [name, logger] : loggers) {
+	cct->get_perfcounters_collection()->remove(logger);
+	delete logger;
+      }
+    }
+
+    TenantInfoRef TenantInfoMgr::_make_tenant(const std::string& name,
+					      const TenantQos& qos) {
+      uint32_t& id = ids[name];
+      if (!id) {
+	id = ids.size();
+      }
+      PerfCounters *&logger = loggers[name];
+      if (!logger) {
+	PerfCountersBuilder plb(cct, "mclock-tenant-" + name,
+				l_mclock_tenant_first, l_mclock_tenant_last);
+	plb.add_u64_counter(
+	  l_mclock_tenant_ops, "ops", "Client ops dequeued",
+	  "ops", PerfCountersBuilder::PRIO_USEFUL);
+	plb.add_u64_counter(
+	  l_mclock_tenant_res_ops, "res_ops",
+	  "Client ops dequeued in the reservation phase",
+	  "rops", PerfCountersBuilder::PRIO_USEFUL);
+	plb.add_time_avg(
+	  l_mclock_tenant_queue_lat, "queue_lat",
+	  "Time client ops spent in the op queue",
+	  "qlat", PerfCountersBuilder::PRIO_USEFUL);
+	logger = plb.create_perf_counters();
+	cct->get_perfcounters_collection()->add(logger);
+      }
+      return std::make_shared<const TenantInfo>(
+	TenantInfo{name, id, qos.reservation, qos.weight, qos.limit, logger});
+    }
+
+    int TenantInfoMgr::set_entity_tenants(const std::string& spec,
+					  std::ostream *err) {
+      std::map<EntityName, TenantQos> qos;
+      int r = parse_tenant_qos(spec, &qos, err);
+      if (r < 0) {
+	return r;
+      }
+      std::unique_lock l{lock};
+      entity_tenants.clear();
+      for (auto& [entity, q] : qos) {
+	entity_tenants[entity] = _make_tenant(entity.to_str(), q);
+      }
+      _update_has_tenants();
+      return 0;
+    }
+
+    void TenantInfoMgr::set_pool_tenants(const OSDMap& osdmap) {
+      std::map<int64_t, TenantInfoRef> tenants;
+      std::unique_lock l{lock};
+      for (auto& [id, pool] : osdmap.get_pools()) {
+	TenantQos qos;
+	bool set = pool.opts.get(pool_opts_t::QOS_RESERVATION, &qos.reservation);
+	set |= pool.opts.get(pool_opts_t::QOS_WEIGHT, &qos.weight);
+	set |= pool.opts.get(pool_opts_t::QOS_LIMIT, &qos.limit);
+	if (!set) {
+	  continue;
+	}
+	std::string name = "pool." + osdmap.get_pool_name(id);
+	if (auto p = pool_tenants.find(id);
+	    p != pool_tenants.end() &&
+	    p->second->name == name &&
+	    p->second->reservation == qos.reservation &&
+	    p->second->weight == qos.weight &&
+	    p->second->limit == qos.limit) {
+	  tenants[id] = p->second;
+	} else {
+	  tenants[id] = _make_tenant(name, qos);
+	}
+      }
+      pool_tenants.swap(tenants);
+      _update_has_tenants();
+    }
+
+    TenantInfoRef TenantInfoMgr::get_tenant(const EntityName& entity,
+					    int64_t pool) const {
+      if (empty()) {
+	return nullptr;
+      }
+      std::shared_lock l{lock};
+      if (auto p = entity_tenants.find(entity); p != entity_tenants.end()) {
+	return p->second;
+      }
+      if (auto p = pool_tenants.find(pool); p != pool_tenants.end()) {
+	return p->second;
+      }
+      return nullptr;
+    }
   } // namespace mclock
 } // namespace ceph
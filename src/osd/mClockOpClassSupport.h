@@ -15,12 +15,29 @@
 
 #pragma once
 
+#include <atomic>
 #include <bitset>
+#include <map>
+#include <memory>
+#include <string>
 
 #include "dmclock/src/dmclock_server.h"
+#include "common/ceph_mutex.h"
+#include "common/entity_name.h"
+#include "common/perf_counters.h"
 #include "osd/OpRequest.h"
 #include "osd/OpQueueItem.h"
 
+class OSDMap;
+
+enum {
+  l_mclock_tenant_first = 21000,
+  l_mclock_tenant_ops,
+  l_mclock_tenant_res_ops,
+  l_mclock_tenant_queue_lat,
+  l_mclock_tenant_last,
+};
+
 
 namespace ceph {
   namespace mclock {
@@ -99,5 +116,65 @@ namespace ceph {
       // with rep_op_msg_bitmap
       static bool is_rep_op(uint16_t);
     }; // OpClassClientInfoMgr
+
+    // mclock parameters of a client entity or pool; client ops of a
+    // tenant are scheduled as a single mclock client by the
+    // mclock_client queue
+    struct TenantInfo {
+      std::string name;
+      uint32_t id;   // stable for a given name, never 0
+      double reservation;
+      double weight;
+      double limit;
+      PerfCounters *logger;
+    };
+    using TenantInfoRef = std::shared_ptr<const TenantInfo>;
+
+    struct TenantQos {
+      double reservation = 0.0;
+      double weight = 1.0;
+      double limit = 0.0;
+    };
+
+    // parse osd_op_queue_mclock_tenants: <entity>=<res>:<wgt>:<lim>,...
+    int parse_tenant_qos(const std::string& spec,
+			 std::map<EntityName, TenantQos> *out,
+			 std::ostream *err);
+
+    class TenantInfoMgr {
+      CephContext *cct;
+      mutable ceph::shared_mutex lock =
+	ceph::make_shared_mutex("TenantInfoMgr::lock");
+      std::map<EntityName, TenantInfoRef> entity_tenants;
+      std::map<int64_t, TenantInfoRef> pool_tenants;
+      std::atomic<bool> has_tenants = {false};
+
+      // ids and counters live as long as the manager so that ops queued
+      // under an old TenantInfo can still account to them
+      std::map<std::string, uint32_t> ids;
+      std::map<std::string, PerfCounters*> loggers;
+
+      TenantInfoRef _make_tenant(const std::string& name, const TenantQos& qos);
+      void _update_has_tenants() {
+	has_tenants = !entity_tenants.empty() || !pool_tenants.empty();
+      }
+
+    public:
+      explicit TenantInfoMgr(CephContext *cct);
+      ~TenantInfoMgr();
+
+      // replace the client entity tenants; returns -EINVAL and leaves
+      // the current ones in place if spec does not parse
+      int set_entity_tenants(const std::string& spec, std::ostream *err);
+      // refresh the pool tenants from the qos_* pool options
+      void set_pool_tenants(const OSDMap& osdmap);
+
+      bool empty() const {
+	return !has_tenants;
+      }
+      // the tenant of entity's ops on pool, if any: entity tenants take
+      // precedence over pool tenants
+      TenantInfoRef get_tenant(const EntityName& entity, int64_t pool) const;
+    }; // TenantInfoMgr
   } // namespace mclock
 } // namespace ceph
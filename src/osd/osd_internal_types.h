@@ -50,6 +50,7 @@ public:
 
   // any entity in obs.oi.watchers MUST be in either watchers or unconnected_watchers.
   map<pair<uint64_t, entity_name_t>, WatchRef> watchers;
+  NotifyStatsRef notify_stats;  ///< created by the first notify
 
   // attr cache
   map<string, bufferlist> attr_cache;
@@ -360,6 +361,17 @@ public:
   bool empty() const {
     return locks.empty();
   }
+  bool is_locked(const hobject_t &hoid) const {
+    return locks.count(hoid);
+  }
+  /// take over the locks held by other
+  void merge(ObcLockManager &&other) {
+    for (auto& p : other.locks) {
+      ceph_assert(locks.find(p.first) == locks.end());
+      locks.insert(std::move(p));
+    }
+    other.locks.clear();
+  }
   bool get_lock_type(
     ObjectContext::RWState::State type,
     const hobject_t &hoid,
@@ -1063,7 +1063,13 @@ static opt_mapping_t opt_mapping = boost::assign::map_list_of
            ("csum_min_block", pool_opts_t::opt_desc_t(
 	     pool_opts_t::CSUM_MIN_BLOCK, pool_opts_t::INT))
            ("fingerprint_algorithm", pool_opts_t::opt_desc_t(
-	     pool_opts_t::FINGERPRINT_ALGORITHM, pool_opts_t::STR));
+	     pool_opts_t::FINGERPRINT_ALGORITHM, pool_opts_t::STR))
+           ("qos_reservation", pool_opts_t::opt_desc_t(
+	     pool_opts_t::QOS_RESERVATION, pool_opts_t::DOUBLE))
+           ("qos_weight", pool_opts_t::opt_desc_t(
+	     pool_opts_t::QOS_WEIGHT, pool_opts_t::DOUBLE))
+           ("qos_limit", pool_opts_t::opt_desc_t(
+	     pool_opts_t::QOS_LIMIT, pool_opts_t::DOUBLE));
 
 bool pool_opts_t::is_opt_name(const std::string& name) {
     return opt_mapping.count(name);
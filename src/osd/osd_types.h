@@ -1100,6 +1100,9 @@ public:
     CSUM_MAX_BLOCK,
     CSUM_MIN_BLOCK,
     FINGERPRINT_ALGORITHM,
+    QOS_RESERVATION,   // mclock reservation of ops on this pool (ops/s)
+    QOS_WEIGHT,        // mclock weight of ops on this pool
+    QOS_LIMIT,         // mclock limit of ops on this pool (ops/s)
   };
 
   enum type_t {
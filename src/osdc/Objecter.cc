@@ -25,6 +25,7 @@
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "messages/MOSDBackoff.h"
+#include "messages/MOSDOpBatch.h"
 #include "messages/MOSDMap.h"
 
 #include "messages/MPoolOp.h"
@@ -41,6 +42,7 @@
 #include "messages/MCommandReply.h"
 
 #include "messages/MWatchNotify.h"
+#include "messages/MWatchNotifyBatch.h"
 
 #include <errno.h>
 
@@ -143,6 +145,9 @@ enum {
   l_osdc_osdop_omap_rd,
   l_osdc_osdop_omap_del,
 
+  l_osdc_op_batch,
+  l_osdc_op_batch_ops,
+
   l_osdc_last,
 };
 
@@ -365,6 +370,11 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_osdop_omap_del, "omap_del",
 			"OSD OMAP delete operations");
 
+    pcb.add_u64_counter(l_osdc_op_batch, "op_batch",
+			"Batch messages sent");
+    pcb.add_u64_avg(l_osdc_op_batch_ops, "op_batch_ops",
+		    "Operations per batch message");
+
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -932,6 +942,14 @@ void Objecter::handle_watch_notify(MWatchNotify *m)
   }
 }
 
+void Objecter::handle_watch_notify_batch(MWatchNotifyBatch *m)
+{
+  ldout(cct, 10) << __func__ << " " << *m << dendl;
+  for (auto cookie : m->cookies) {
+    handle_watch_notify(m->get_notify(cookie).get());
+  }
+}
+
 void Objecter::_do_watch_notify(LingerOp *info, MWatchNotify *m)
 {
   ldout(cct, 10) << __func__ << " " << *m << dendl;
@@ -982,6 +1000,11 @@ bool Objecter::ms_dispatch(Message *m)
     m->put();
     return true;
 
+  case CEPH_MSG_WATCH_NOTIFY_BATCH:
+    handle_watch_notify_batch(static_cast<MWatchNotifyBatch*>(m));
+    m->put();
+    return true;
+
   case MSG_COMMAND_REPLY:
     if (m->get_source().type() == CEPH_ENTITY_TYPE_OSD) {
       handle_command_reply(static_cast<MCommandReply*>(m));
@@ -1800,6 +1823,11 @@ int Objecter::_get_session(int osd, OSDSession **session, shunique_lock& sul)
     return -EAGAIN;
   }
   OSDSession *s = new OSDSession(cct, osd);
+  // like dmclock's ServiceTracker, start from the current counters so
+  // that replies from other osds before this session existed are not
+  // charged to its first op
+  s->qos_delta_prev = qos_delta_counter;
+  s->qos_rho_prev = qos_rho_counter;
   osd_sessions[osd] = s;
   s->con = messenger->connect_to_osd(osdmap->get_addrs(osd));
   s->con->set_priv(RefCountedPtr{s});
@@ -2272,9 +2300,27 @@ void Objecter::op_submit(Op *op, ceph_tid_t *ptid, int *ctx_budget)
   _op_submit_with_budget(op, rl, ptid, ctx_budget);
 }
 
+void Objecter::op_submit_batch(const vector<Op*>& ops,
+			       const vector<ceph_tid_t*>& ptids)
+{
+  shunique_lock rl(rwlock, ceph::acquire_shared);
+  OpBatch batch;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    ceph_tid_t tid = 0;
+    ceph_tid_t *ptid = &tid;
+    if (i < ptids.size() && ptids[i]) {
+      ptid = ptids[i];
+    }
+    ops[i]->trace.event("op submit");
+    _op_submit_with_budget(ops[i], rl, ptid, nullptr, &batch);
+  }
+  _op_batch_flush(&batch);
+}
+
 void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
 				      ceph_tid_t *ptid,
-				      int *ctx_budget)
+				      int *ctx_budget,
+				      OpBatch *batch)
 {
   ceph_assert(initialized);
 
@@ -2285,7 +2331,7 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
   // throttle.  before we look at any state, because
   // _take_op_budget() may drop our lock while it blocks.
   if (!op->ctx_budgeted || (ctx_budget && (*ctx_budget == -1))) {
-    int op_budget = _take_op_budget(op, sul);
+    int op_budget = _take_op_budget(op, sul, batch);
     // take and pass out the budget for the first OP
     // in the context session
     if (ctx_budget && (*ctx_budget == -1)) {
@@ -2302,7 +2348,7 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
 				      op_cancel(tid, -ETIMEDOUT); });
   }
 
-  _op_submit(op, sul, ptid);
+  _op_submit(op, sul, ptid, batch);
 }
 
 void Objecter::_send_op_account(Op *op)
@@ -2378,7 +2424,8 @@ void Objecter::_send_op_account(Op *op)
   }
 }
 
-void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid)
+void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid,
+			  OpBatch *batch)
 {
   // rwlock is locked
 
@@ -2397,6 +2444,10 @@ void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid)
       (check_for_latest_map && sul.owns_lock_shared()) ||
       cct->_conf->objecter_debug_inject_relock_delay) {
     epoch_t orig_epoch = osdmap->get_epoch();
+    if (batch) {
+      // sessions may be kicked while we are unlocked
+      _op_batch_flush(batch);
+    }
     sul.unlock();
     if (cct->_conf->objecter_debug_inject_relock_delay) {
       sleep(1);
@@ -2477,7 +2528,7 @@ void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid)
   _session_op_assign(s, op);
 
   if (need_send) {
-    _send_op(op);
+    _send_op(op, batch);
   }
 
   // Last chance to touch Op here, after giving up session lock it can
@@ -3222,7 +3273,7 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
   return m;
 }
 
-void Objecter::_send_op(Op *op)
+void Objecter::_send_op(Op *op, OpBatch *batch)
 {
   // rwlock is locked
   // op->session->lock is locked
@@ -3289,7 +3340,116 @@ void Objecter::_send_op(Op *op)
   if (op->trace.valid()) {
     m->trace.init("op msg", nullptr, &op->trace);
   }
-  op->session->con->send_message(m);
+  if (mclock_service_tracker) {
+    _qos_tag_op(op->session, m);
+  }
+  if (batch) {
+    _op_batch_add(batch, op->session->con, m);
+  } else {
+    op->session->con->send_message(m);
+  }
+}
+
+void Objecter::_op_batch_add(OpBatch *batch, const ConnectionRef& con,
+			     MOSDOp *m)
+{
+  uint64_t bytes = 0;
+  for (auto& o : m->ops) {
+    bytes += o.indata.length();
+  }
+  auto key = make_pair(con.get(), m->get_spg());
+  auto p = batch->pending.find(key);
+  // older osds drop the batch message on the floor; the connection
+  // features only tell us about the primary, so also wait for the
+  // whole cluster to be on nautilus
+  if (op_batch_max_ops < 2 ||
+      bytes > op_batch_max_bytes ||
+      osdmap->require_osd_release < CEPH_RELEASE_NAUTILUS ||
+      !HAVE_FEATURE(con->get_features(), SERVER_NAUTILUS)) {
+    // send what is held for this pg first to keep ops on an object in
+    // order
+    if (p != batch->pending.end()) {
+      _op_batch_send(con, p->second.ops);
+      batch->pending.erase(p);
+    }
+    con->send_message(m);
+    return;
+  }
+  if (p == batch->pending.end()) {
+    p = batch->pending.emplace(key, OpBatch::Pending{con, {}}).first;
+  }
+  p->second.ops.push_back(m);
+  if (p->second.ops.size() >= op_batch_max_ops) {
+    _op_batch_send(con, p->second.ops);
+  }
+}
+
+void Objecter::_op_batch_send(const ConnectionRef& con, vector<MOSDOp*>& ops)
+{
+  if (ops.empty()) {
+    return;
+  }
+  if (ops.size() == 1) {
+    con->send_message(ops.front());
+    ops.clear();
+    return;
+  }
+  MOSDOp *first = ops.front();
+  MOSDOpBatch *b = new MOSDOpBatch(first->get_spg(), first->get_map_epoch());
+  b->set_priority(first->get_priority());
+  for (auto m : ops) {
+    b->add_op(m, con->get_features());
+    m->put();
+  }
+  ldout(cct, 15) << __func__ << " " << *b << " on " << con << dendl;
+  logger->inc(l_osdc_op_batch);
+  logger->inc(l_osdc_op_batch_ops, ops.size());
+  ops.clear();
+  con->send_message(b);
+}
+
+void Objecter::_op_batch_flush(OpBatch *batch)
+{
+  for (auto& p : batch->pending) {
+    _op_batch_send(p.second.con, p.second.ops);
+  }
+  batch->pending.clear();
+}
+
+void Objecter::_qos_tag_op(OSDSession *s, MOSDOp *m)
+{
+  // s->lock is locked
+  //
+  // this is the dmclock ServiceTracker: delta is the number of replies
+  // received from other OSDs since our previous op to this one, rho the
+  // number of those served in the reservation phase, plus one for the
+  // op itself.  the OSD advances our tags by these amounts so that our
+  // reservation and weight hold cluster-wide.
+  uint64_t delta = qos_delta_counter;
+  uint64_t rho = qos_rho_counter;
+  uint64_t d = 1 + delta - s->qos_delta_prev - s->qos_my_delta;
+  uint64_t r = 1 + rho - s->qos_rho_prev - s->qos_my_rho;
+  s->qos_delta_prev = delta;
+  s->qos_rho_prev = rho;
+  s->qos_my_delta = 0;
+  s->qos_my_rho = 0;
+  m->set_qos_tags(std::min<uint64_t>(d, UINT32_MAX),
+		  std::min<uint64_t>(r, UINT32_MAX));
+}
+
+void Objecter::_qos_track_reply(OSDSession *s, MOSDOpReply *m)
+{
+  // s->lock is locked
+  int phase = m->get_qos_phase();
+  if (phase < 0) {
+    return;
+  }
+  ++qos_delta_counter;
+  ++s->qos_my_delta;
+  if (phase == 0) {  // reservation
+    ++qos_rho_counter;
+    ++s->qos_my_rho;
+  }
 }
 
 int Objecter::calc_op_budget(const vector<OSDOp>& ops)
@@ -3314,7 +3474,8 @@ int Objecter::calc_op_budget(const vector<OSDOp>& ops)
 
 void Objecter::_throttle_op(Op *op,
 			    shunique_lock& sul,
-			    int op_budget)
+			    int op_budget,
+			    OpBatch *batch)
 {
   ceph_assert(sul && sul.mutex() == &rwlock);
   bool locked_for_write = sul.owns_lock();
@@ -3322,6 +3483,10 @@ void Objecter::_throttle_op(Op *op,
   if (!op_budget)
     op_budget = calc_op_budget(op->ops);
   if (!op_throttle_bytes.get_or_fail(op_budget)) { //couldn't take right now
+    if (batch) {
+      // the budget we wait for may be held by the ops we hold back
+      _op_batch_flush(batch);
+    }
     sul.unlock();
     op_throttle_bytes.get(op_budget);
     if (locked_for_write)
@@ -3330,6 +3495,9 @@ void Objecter::_throttle_op(Op *op,
       sul.lock_shared();
   }
   if (!op_throttle_ops.get_or_fail(1)) { //couldn't take right now
+    if (batch) {
+      _op_batch_flush(batch);
+    }
     sul.unlock();
     op_throttle_ops.get(1);
     if (locked_for_write)
@@ -3369,6 +3537,10 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 
   OSDSession::unique_lock sl(s->lock);
 
+  if (mclock_service_tracker) {
+    _qos_track_reply(s, m);
+  }
+
   map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
   if (iter == s->ops.end()) {
     ldout(cct, 7) << "handle_osd_op_reply " << tid
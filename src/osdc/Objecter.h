@@ -1852,6 +1852,13 @@ public:
     int osd;
     int incarnation;
     ConnectionRef con;
+
+    // dmclock counters, see Objecter::_qos_tag_op()
+    uint64_t qos_delta_prev = 0;  // global delta counter at our last op
+    uint64_t qos_rho_prev = 0;
+    uint64_t qos_my_delta = 0;    // replies from this osd since our last op
+    uint64_t qos_my_rho = 0;
+
     int num_locks;
     std::unique_ptr<std::mutex[]> completion_locks;
     using unique_completion_lock = std::unique_lock<
@@ -1908,8 +1915,20 @@ public:
   ceph::timespan mon_timeout;
   ceph::timespan osd_timeout;
 
+  /// messages held back by op_submit_batch(), by osd connection and pg
+  struct OpBatch {
+    struct Pending {
+      ConnectionRef con;
+      std::vector<MOSDOp*> ops;
+    };
+    std::map<std::pair<Connection*, spg_t>, Pending> pending;
+  };
+  void _op_batch_add(OpBatch *batch, const ConnectionRef& con, MOSDOp *m);
+  void _op_batch_send(const ConnectionRef& con, std::vector<MOSDOp*>& ops);
+  void _op_batch_flush(OpBatch *batch);
+
   MOSDOp *_prepare_osd_op(Op *op);
-  void _send_op(Op *op);
+  void _send_op(Op *op, OpBatch *batch = nullptr);
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
   void _finish_op(Op *op, int r);
@@ -1997,12 +2016,14 @@ private:
    * If throttle_op needs to throttle it will unlock client_lock.
    */
   int calc_op_budget(const vector<OSDOp>& ops);
-  void _throttle_op(Op *op, shunique_lock& sul, int op_size = 0);
-  int _take_op_budget(Op *op, shunique_lock& sul) {
+  void _throttle_op(Op *op, shunique_lock& sul, int op_size = 0,
+		    OpBatch *batch = nullptr);
+  int _take_op_budget(Op *op, shunique_lock& sul,
+		      OpBatch *batch = nullptr) {
     ceph_assert(sul && sul.mutex() == &rwlock);
     int op_budget = calc_op_budget(op->ops);
     if (keep_balanced_budget) {
-      _throttle_op(op, sul, op_budget);
+      _throttle_op(op, sul, op_budget, batch);
     } else { // update take_linger_budget to match this!
       op_throttle_bytes.take(op_budget);
       op_throttle_ops.take(1);
@@ -2040,7 +2061,10 @@ private:
 		      cct->_conf->objecter_inflight_op_bytes),
     op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
     epoch_barrier(0),
-    retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply)
+    retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply),
+    mclock_service_tracker(cct->_conf->objecter_mclock_service_tracker),
+    op_batch_max_ops(cct->_conf->objecter_op_batch_max_ops),
+    op_batch_max_bytes(cct->_conf->objecter_op_batch_max_bytes)
   { }
   ~Objecter() override;
 
@@ -2110,6 +2134,7 @@ private:
     switch (m->get_type()) {
     case CEPH_MSG_OSD_OPREPLY:
     case CEPH_MSG_WATCH_NOTIFY:
+    case CEPH_MSG_WATCH_NOTIFY_BATCH:
       return true;
     default:
       return false;
@@ -2124,6 +2149,7 @@ private:
   void handle_osd_op_reply(class MOSDOpReply *m);
   void handle_osd_backoff(class MOSDBackoff *m);
   void handle_watch_notify(class MWatchNotify *m);
+  void handle_watch_notify_batch(class MWatchNotifyBatch *m);
   void handle_osd_map(class MOSDMap *m);
   void wait_for_osd_map();
 
@@ -2151,13 +2177,25 @@ private:
                              const OSDMap &new_osd_map);
 
   // low-level
-  void _op_submit(Op *op, shunique_lock& lc, ceph_tid_t *ptid);
+  void _op_submit(Op *op, shunique_lock& lc, ceph_tid_t *ptid,
+		  OpBatch *batch = nullptr);
   void _op_submit_with_budget(Op *op, shunique_lock& lc,
 			      ceph_tid_t *ptid,
-			      int *ctx_budget = NULL);
+			      int *ctx_budget = NULL,
+			      OpBatch *batch = nullptr);
   // public interface
 public:
   void op_submit(Op *op, ceph_tid_t *ptid = NULL, int *ctx_budget = NULL);
+  /**
+   * submit several ops at once
+   *
+   * Ops that map to the same pg are sent to its primary in one
+   * MOSDOpBatch message (see objecter_op_batch_max_ops); each op still
+   * completes on its own.  Ops on the same object are sent in order.
+   * If ptids[i] is set, ops[i]'s tid is stored there before it is sent.
+   */
+  void op_submit_batch(const std::vector<Op*>& ops,
+		       const std::vector<ceph_tid_t*>& ptids = {});
   bool is_active() {
     shared_lock l(rwlock);
     return !((!inflight_ops) && linger_ops.empty() &&
@@ -3067,6 +3105,17 @@ public:
 private:
   epoch_t epoch_barrier;
   bool retry_writes_after_first_reply;
+
+  // dmclock service tracking: replies (delta) and reservation-phase
+  // replies (rho) received from all OSDs
+  bool mclock_service_tracker;
+  std::atomic<uint64_t> qos_delta_counter{0};
+  std::atomic<uint64_t> qos_rho_counter{0};
+  void _qos_tag_op(OSDSession *s, MOSDOp *m);
+  void _qos_track_reply(OSDSession *s, class MOSDOpReply *m);
+
+  uint64_t op_batch_max_ops;
+  uint64_t op_batch_max_bytes;
 public:
   void set_epoch_barrier(epoch_t epoch);
 
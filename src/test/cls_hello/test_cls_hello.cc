@@ -18,6 +18,7 @@
 #include "include/rados/librados.hpp"
 #include "include/encoding.h"
 #include "test/librados/test.h"
+#include "json_spirit/json_spirit.h"
 #include "gtest/gtest.h"
 
 using namespace librados;
@@ -183,3 +184,198 @@ TEST(ClsHello, Filter) {
   ASSERT_EQ(0, destroy_one_pool_pp(pool_name, cluster));
 }
 
+
+static void set_omap(IoCtx& ioctx, const std::string& oid)
+{
+  std::map<std::string, bufferlist> vals;
+  for (auto& k : {"a1", "a2", "a3", "b1", "b2"}) {
+    vals[k].append(std::string("val_") + k);
+  }
+  ASSERT_EQ(0, ioctx.omap_set(oid, vals));
+}
+
+static int omap_iterate(IoCtx& ioctx, const std::string& oid,
+			const std::string& start_after,
+			const std::string& prefix, uint64_t max,
+			bool with_values,
+			std::vector<std::pair<std::string, bufferlist>> *entries,
+			bool *more)
+{
+  bufferlist in, out;
+  encode(start_after, in);
+  encode(prefix, in);
+  encode(max, in);
+  encode(with_values, in);
+  int r = ioctx.exec(oid, "hello", "omap_iterate", in, out);
+  if (r < 0)
+    return r;
+  auto p = out.cbegin();
+  decode(*entries, p);
+  decode(*more, p);
+  return 0;
+}
+
+static std::vector<std::string> keys_of(
+  const std::vector<std::pair<std::string, bufferlist>>& entries)
+{
+  std::vector<std::string> keys;
+  for (auto& e : entries)
+    keys.push_back(e.first);
+  return keys;
+}
+
+TEST(ClsHello, OmapIterate) {
+  Rados cluster;
+  std::string pool_name = get_temp_pool_name();
+  ASSERT_EQ("", create_one_pool_pp(pool_name, cluster));
+  IoCtx ioctx;
+  cluster.ioctx_create(pool_name.c_str(), ioctx);
+
+  std::vector<std::pair<std::string, bufferlist>> entries;
+  bool more = true;
+  ASSERT_EQ(-ENOENT, omap_iterate(ioctx, "myobject", "", "", 100, true,
+				  &entries, &more));
+  set_omap(ioctx, "myobject");
+
+  // everything, with values
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "", "", 100, true,
+			    &entries, &more));
+  ASSERT_EQ(std::vector<std::string>({"a1", "a2", "a3", "b1", "b2"}),
+	    keys_of(entries));
+  ASSERT_EQ(std::string("val_a1"), entries[0].second.to_str());
+  ASSERT_EQ(std::string("val_b2"), entries[4].second.to_str());
+  ASSERT_FALSE(more);
+
+  // keys only
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "", "", 100, false,
+			    &entries, &more));
+  ASSERT_EQ(5u, entries.size());
+  for (auto& e : entries)
+    ASSERT_EQ(0u, e.second.length());
+
+  // prefix
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "", "b", 100, true,
+			    &entries, &more));
+  ASSERT_EQ(std::vector<std::string>({"b1", "b2"}), keys_of(entries));
+  ASSERT_FALSE(more);
+
+  // start_after
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "a2", "", 100, true,
+			    &entries, &more));
+  ASSERT_EQ(std::vector<std::string>({"a3", "b1", "b2"}), keys_of(entries));
+  ASSERT_FALSE(more);
+
+  // max, with and without a prefix
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "", "", 2, true,
+			    &entries, &more));
+  ASSERT_EQ(std::vector<std::string>({"a1", "a2"}), keys_of(entries));
+  ASSERT_TRUE(more);
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "a2", "a", 1, true,
+			    &entries, &more));
+  ASSERT_EQ(std::vector<std::string>({"a3"}), keys_of(entries));
+  ASSERT_FALSE(more);
+
+  // past the end
+  ASSERT_EQ(0, omap_iterate(ioctx, "myobject", "b2", "", 100, true,
+			    &entries, &more));
+  ASSERT_TRUE(entries.empty());
+  ASSERT_FALSE(more);
+
+  ASSERT_EQ(0, destroy_one_pool_pp(pool_name, cluster));
+}
+
+TEST(ClsHello, OmapGetByKeys) {
+  Rados cluster;
+  std::string pool_name = get_temp_pool_name();
+  ASSERT_EQ("", create_one_pool_pp(pool_name, cluster));
+  IoCtx ioctx;
+  cluster.ioctx_create(pool_name.c_str(), ioctx);
+
+  set_omap(ioctx, "myobject");
+
+  std::set<std::string> keys = {"a2", "b1", "missing"};
+  bufferlist in, out;
+  encode(keys, in);
+  ASSERT_EQ(0, ioctx.exec("myobject", "hello", "omap_get_by_keys", in, out));
+  std::map<std::string, bufferlist> vals;
+  auto p = out.cbegin();
+  decode(vals, p);
+  ASSERT_EQ(2u, vals.size());
+  ASSERT_EQ(std::string("val_a2"), vals["a2"].to_str());
+  ASSERT_EQ(std::string("val_b1"), vals["b1"].to_str());
+
+  // no keys, no values
+  in.clear();
+  out.clear();
+  encode(std::set<std::string>(), in);
+  ASSERT_EQ(0, ioctx.exec("myobject", "hello", "omap_get_by_keys", in, out));
+  p = out.cbegin();
+  decode(vals, p);
+  ASSERT_TRUE(vals.empty());
+
+  ASSERT_EQ(0, destroy_one_pool_pp(pool_name, cluster));
+}
+
+// number of calls to hello.<method> the given osd has counted
+static int64_t get_method_calls(Rados& cluster, int osd,
+				const std::string& method)
+{
+  bufferlist inbl, outbl;
+  std::string outs;
+  int r = cluster.osd_command(
+    osd,
+    "{\"prefix\": \"perf dump\", \"logger\": \"cls-hello\", "
+    "\"format\": \"json\"}",
+    inbl, &outbl, &outs);
+  if (r < 0)
+    return r;
+  json_spirit::mValue v;
+  if (!json_spirit::read(outbl.to_str(), v))
+    return -EINVAL;
+  auto& loggers = v.get_obj();
+  auto l = loggers.find("cls-hello");
+  if (l == loggers.end())
+    return 0;
+  auto& counters = l->second.get_obj();
+  auto c = counters.find(method);
+  if (c == counters.end())
+    return -ENOENT;
+  return c->second.get_obj()["avgcount"].get_int64();
+}
+
+TEST(ClsHello, MethodPerfCounters) {
+  Rados cluster;
+  std::string pool_name = get_temp_pool_name();
+  ASSERT_EQ("", create_one_pool_pp(pool_name, cluster));
+  IoCtx ioctx;
+  cluster.ioctx_create(pool_name.c_str(), ioctx);
+
+  bufferlist in, out;
+  ASSERT_EQ(0, ioctx.write_full("myobject", in));
+
+  // find the primary, which runs the methods
+  bufferlist inbl, outbl;
+  ASSERT_EQ(0, cluster.mon_command(
+    "{\"prefix\": \"osd map\", \"pool\": \"" + pool_name +
+    "\", \"object\": \"myobject\", \"format\": \"json\"}",
+    inbl, &outbl, nullptr));
+  json_spirit::mValue v;
+  ASSERT_TRUE(json_spirit::read(outbl.to_str(), v));
+  int primary = v.get_obj()["acting_primary"].get_int();
+  ASSERT_LE(0, primary);
+
+  // the class is loaded by now
+  ASSERT_EQ(0, ioctx.exec("myobject", "hello", "say_hello", in, out));
+  int64_t say_before = get_method_calls(cluster, primary, "say_hello");
+  int64_t replay_before = get_method_calls(cluster, primary, "replay");
+  ASSERT_LE(1, say_before);
+  ASSERT_LE(0, replay_before);
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(0, ioctx.exec("myobject", "hello", "say_hello", in, out));
+  }
+  ASSERT_EQ(say_before + 3, get_method_calls(cluster, primary, "say_hello"));
+  ASSERT_EQ(replay_before, get_method_calls(cluster, primary, "replay"));
+
+  ASSERT_EQ(0, destroy_one_pool_pp(pool_name, cluster));
+}
@@ -6,6 +6,7 @@
 #include "test/librados/test.h"
 #include "cls/lua/cls_lua_client.h"
 #include "cls/lua/cls_lua.h"
+#include "cls/lua/cls_lua_ops.h"
 
 /*
  * JSON script to test JSON I/O protocol with cls_lua
@@ -520,6 +521,35 @@ objclass.register(current_version)
 objclass.register(current_subop_num)
 objclass.register(current_subop_version)
 
+--
+-- Budget
+--
+function spin()
+  while true do end
+end
+
+function spin_pcall()
+  while true do
+    pcall(spin)
+  end
+end
+
+objclass.register(spin)
+objclass.register(spin_pcall)
+
+--
+-- LoadBinary
+--
+function load_binary()
+  f, err = load(string.dump(function() return 1 end))
+  if f then
+    return 0
+  end
+  return -1
+end
+
+objclass.register(load_binary)
+
 )luascript";
 
 /*
@@ -1104,3 +1134,81 @@ TEST_F(ClsLua, Json) {
   std::string out(outbl.c_str(), outbl.length());
   ASSERT_STREQ(out.c_str(), "omg it works");
 }
+
+TEST_F(ClsLua, NamedScript) {
+  ASSERT_EQ(0, ioctx.create(oid, false));
+
+  /* the name alone is not enough until the script was sent with it */
+  cls_lua_eval_op op;
+  op.script_name = oid;
+  op.handler = "rv_h1";
+  bufferlist inbl, outbl;
+  encode(op, inbl);
+  ASSERT_EQ(-ENOEXEC, ioctx.exec(oid, "lua", "eval_named", inbl, outbl));
+
+  bufferlist input;
+  ASSERT_EQ(1, cls_lua_client::exec_named(ioctx, oid, oid, test_script,
+        "rv_h1", input, reply_output));
+  ASSERT_EQ(1, ioctx.exec(oid, "lua", "eval_named", inbl, outbl));
+
+  /* eval_bufferlist ignores the name */
+  ASSERT_EQ(-EOPNOTSUPP,
+      ioctx.exec(oid, "lua", "eval_bufferlist", inbl, outbl));
+
+  /* a name needs a script the first time */
+  cls_lua_eval_op noname;
+  noname.handler = "rv_h1";
+  bufferlist nonamebl;
+  encode(noname, nonamebl);
+  ASSERT_EQ(-EINVAL, ioctx.exec(oid, "lua", "eval_named", nonamebl, outbl));
+}
+
+TEST_F(ClsLua, NamedScriptScope) {
+  ASSERT_EQ(0, ioctx.create(oid, false));
+
+  bufferlist input;
+  ASSERT_EQ(1, cls_lua_client::exec_named(ioctx, oid, oid, test_script,
+        "rv_h1", input, reply_output));
+
+  cls_lua_eval_op op;
+  op.script_name = oid;
+  op.handler = "rv_h1";
+  bufferlist inbl, outbl;
+  encode(op, inbl);
+  ASSERT_EQ(1, ioctx.exec(oid, "lua", "eval_named", inbl, outbl));
+
+  /* another namespace of the same pool does not see the name */
+  librados::IoCtx ns_ioctx;
+  ns_ioctx.dup(ioctx);
+  ns_ioctx.set_namespace("other");
+  ASSERT_EQ(0, ns_ioctx.create(oid, false));
+  ASSERT_EQ(-ENOEXEC, ns_ioctx.exec(oid, "lua", "eval_named", inbl, outbl));
+
+  /* neither does another client */
+  librados::Rados other;
+  ASSERT_EQ(0, other.init_with_context(rados.cct()));
+  ASSERT_EQ(0, other.connect());
+  librados::IoCtx other_ioctx;
+  ASSERT_EQ(0, other.ioctx_create(pool_name.c_str(), other_ioctx));
+  ASSERT_EQ(-ENOEXEC, other_ioctx.exec(oid, "lua", "eval_named", inbl, outbl));
+
+  /* and registering it there does not change what this client runs */
+  std::string other_script = "function rv_h1() return 2; end\n"
+    "cls.register(rv_h1)\n";
+  ASSERT_EQ(2, cls_lua_client::exec_named(other_ioctx, oid, oid, other_script,
+        "rv_h1", input, reply_output));
+  ASSERT_EQ(1, ioctx.exec(oid, "lua", "eval_named", inbl, outbl));
+  other_ioctx.close();
+  other.shutdown();
+}
+
+TEST_F(ClsLua, Budget) {
+  ASSERT_EQ(0, ioctx.create(oid, false));
+  ASSERT_EQ(-ETIMEDOUT, clslua_exec(test_script, NULL, "spin"));
+  /* catching the error does not keep the script going */
+  ASSERT_EQ(-ETIMEDOUT, clslua_exec(test_script, NULL, "spin_pcall"));
+}
+
+TEST_F(ClsLua, LoadBinary) {
+  ASSERT_EQ(-1, clslua_exec(test_script, NULL, "load_binary"));
+}
@@ -128,3 +128,16 @@ TEST(blkdev, is_rotational)
 }
 
 
+
+TEST(blkdev, io_ticks)
+{
+  const char* env = getenv("CEPH_ROOT");
+  ASSERT_NE(env, nullptr) << "Environment Variable CEPH_ROOT not found!";
+  string root = string(env) + "/src/test/common/test_blkdev_sys_block";
+  set_block_device_sandbox_dir(root.c_str());
+
+  uint64_t ms = 0;
+  ASSERT_EQ(0, block_device_io_ticks("sda", &ms));
+  ASSERT_EQ(358212u, ms);
+  ASSERT_GT(0, block_device_io_ticks("sdb", &ms));
+}
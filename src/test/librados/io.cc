@@ -1,13 +1,18 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*
 // vim: ts=8 sw=2 smarttab
 
+#include <atomic>
 #include <climits>
+#include <numeric>
+#include <mutex>
+#include <thread>
 
 #include "include/rados/librados.h"
 #include "include/rados/librados.hpp"
 #include "include/encoding.h"
 #include "include/err.h"
 #include "include/scope_guard.h"
+#include "include/stringify.h"
 #include "test/librados/test.h"
 #include "test/librados/TestCase.h"
 
@@ -301,6 +306,244 @@ TEST_F(LibRadosIoPP, RoundTripPP2)
   ASSERT_EQ(0, memcmp(bl.c_str(), "ceph", 4));
 }
 
+TEST_F(LibRadosIoPP, AioOperateBatchPP)
+{
+  // three appends to one object, which share a pg and so a batch, plus
+  // an op on a missing object that fails on its own
+  std::vector<std::string> oids = {"foo", "foo", "bar", "foo"};
+  std::vector<ObjectWriteOperation> writes(oids.size());
+  const char *parts[] = {"ce", "ph", nullptr, "!"};
+  for (size_t i = 0; i < oids.size(); ++i) {
+    if (parts[i]) {
+      bufferlist bl;
+      bl.append(parts[i]);
+      writes[i].append(bl);
+    } else {
+      writes[i].assert_exists();
+      writes[i].write_full(bufferlist());
+    }
+  }
+  std::vector<ObjectWriteOperation*> ops;
+  std::vector<AioCompletion*> cs;
+  for (auto& w : writes) {
+    ops.push_back(&w);
+    cs.push_back(cluster.aio_create_completion());
+  }
+  int64_t sent = get_client_perf_counter_pp(cluster, "objecter", "op_batch");
+  int64_t sent_ops = get_client_perf_counter_pp(cluster, "objecter",
+						"op_batch_ops", "sum");
+  int64_t received = sum_osd_perf_counter_pp(cluster, "osd", "op_batch");
+  int64_t received_ops = sum_osd_perf_counter_pp(cluster, "osd",
+						 "op_batch_ops", "sum");
+  ASSERT_LE(0, sent);
+  ASSERT_LE(0, received);
+  ASSERT_EQ(-EINVAL, ioctx.aio_operate_batch(oids, {}, ops));
+  ASSERT_EQ(0, ioctx.aio_operate_batch(oids, cs, ops));
+  for (size_t i = 0; i < cs.size(); ++i) {
+    ASSERT_EQ(0, cs[i]->wait_for_safe());
+    ASSERT_EQ(parts[i] ? 0 : -ENOENT, cs[i]->get_return_value());
+    cs[i]->release();
+  }
+
+  bufferlist bl;
+  ASSERT_EQ(5, ioctx.read("foo", bl, 0, 0));
+  ASSERT_EQ(std::string("ceph!"), bl.to_str());
+  ASSERT_EQ(-ENOENT, ioctx.stat("bar", nullptr, nullptr));
+
+  // the three ops on "foo" went out (and arrived) as one batch message
+  ASSERT_LT(sent, get_client_perf_counter_pp(cluster, "objecter", "op_batch"));
+  ASSERT_LE(sent_ops + 3, get_client_perf_counter_pp(cluster, "objecter",
+						     "op_batch_ops", "sum"));
+  ASSERT_LT(received, sum_osd_perf_counter_pp(cluster, "osd", "op_batch"));
+  ASSERT_LE(received_ops + 3, sum_osd_perf_counter_pp(cluster, "osd",
+						      "op_batch_ops", "sum"));
+}
+
+// the tests below exercise the osd read fast path (osd_read_fast_path,
+// on by default), where simple reads run under a shared pg lock
+
+TEST_F(LibRadosIoPP, FastReadRacingWritePP)
+{
+  // each write replaces the data and an xattr naming its fill byte in
+  // one transaction; a read of both must never see them disagree
+  const size_t len = 64 << 10;
+  auto write_fill = [&](char c) {
+    bufferlist data, tag;
+    data.append(std::string(len, c));
+    tag.append(c);
+    ObjectWriteOperation op;
+    op.write_full(data);
+    op.setxattr("fill", tag);
+    return ioctx.operate("foo", &op);
+  };
+  ASSERT_EQ(0, write_fill('a'));
+  int64_t fast_reads = sum_osd_perf_counter_pp(cluster, "osd", "op_fast_read");
+
+  std::atomic<bool> done = { false };
+  int write_r = 0;
+  std::thread writer([&] {
+    for (int i = 0; i < 200 && write_r == 0; ++i) {
+      write_r = write_fill('a' + i % 26);
+    }
+    done = true;
+  });
+  auto check_read = [&] {
+    bufferlist data, tag;
+    int read_rval = -1, tag_rval = -1;
+    ObjectReadOperation op;
+    op.read(0, 0, &data, &read_rval);
+    op.getxattr("fill", &tag, &tag_rval);
+    ASSERT_EQ(0, ioctx.operate("foo", &op, nullptr));
+    ASSERT_EQ(0, read_rval);
+    ASSERT_EQ(0, tag_rval);
+    ASSERT_EQ(1u, tag.length());
+    ASSERT_EQ(std::string(len, tag[0]), data.to_str());
+  };
+  unsigned reads = 0;
+  while (!done) {
+    check_read();
+    if (HasFatalFailure()) {
+      break;
+    }
+    ++reads;
+  }
+  writer.join();
+  ASSERT_FALSE(HasFatalFailure()) << "after " << reads << " reads";
+  ASSERT_EQ(0, write_r);
+  // and once the object is idle
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_NO_FATAL_FAILURE(check_read());
+  }
+  ASSERT_LT(fast_reads,
+	    sum_osd_perf_counter_pp(cluster, "osd", "op_fast_read"));
+}
+
+TEST_F(LibRadosIoPP, FastReadOrderedAfterWritePP)
+{
+  // reads queued behind a write to the same object find it busy, are
+  // declined by the fast path and requeued; they must still see the
+  // write queued ahead of them and never a later one
+  const int n = 50;
+  std::vector<AioCompletion*> writes, reads;
+  std::vector<bufferlist> out(n);
+  for (int i = 0; i < n; ++i) {
+    bufferlist bl;
+    bl.append(stringify(i));
+    writes.push_back(cluster.aio_create_completion());
+    ASSERT_EQ(0, ioctx.aio_write_full("foo", writes.back(), bl));
+    reads.push_back(cluster.aio_create_completion());
+    ASSERT_EQ(0, ioctx.aio_read("foo", reads.back(), &out[i], 0, 0));
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(0, writes[i]->wait_for_safe());
+    ASSERT_EQ(0, writes[i]->get_return_value());
+    writes[i]->release();
+    ASSERT_EQ(0, reads[i]->wait_for_complete());
+    ASSERT_LT(0, reads[i]->get_return_value());
+    ASSERT_EQ(stringify(i), out[i].to_str());
+    reads[i]->release();
+  }
+}
+
+TEST_F(LibRadosIoPP, FastReadStatsOncePP)
+{
+  // reads served on the fast path are folded into the pg stats later;
+  // check on a pool of our own that each counts exactly once
+  std::string pool_name = get_temp_pool_name();
+  ASSERT_EQ(0, cluster.pool_create(pool_name.c_str()));
+  auto remove_pool = make_scope_guard([&] {
+    cluster.pool_delete(pool_name.c_str());
+  });
+  IoCtx io;
+  ASSERT_EQ(0, cluster.ioctx_create(pool_name.c_str(), io));
+
+  bufferlist bl;
+  bl.append(std::string(4096, 'x'));
+  ASSERT_EQ(0, io.write_full("foo", bl));
+  const int n = 20;
+  for (int i = 0; i < n; ++i) {
+    bufferlist out;
+    ASSERT_EQ(4096, io.read("foo", out, 0, 0));
+  }
+  // a write publishes the pg stats, fast reads included
+  ASSERT_EQ(0, io.write_full("foo", bl));
+
+  std::list<std::string> pools = {pool_name};
+  pool_stat_t st = {};
+  for (int i = 0; i < 120; ++i) {
+    stats_map stats;
+    ASSERT_EQ(0, cluster.get_pool_stats(pools, stats));
+    st = stats[pool_name];
+    if (st.num_wr >= 2 && st.num_rd >= (uint64_t)n) {
+      break;
+    }
+    sleep(1);
+  }
+  ASSERT_EQ(2u, st.num_wr);
+  ASSERT_EQ((uint64_t)n, st.num_rd);
+}
+
+TEST_F(LibRadosIoPP, TxnBatchOrderPP)
+{
+  // pipelined writes to one pg may reach the store as one transaction
+  // batch (osd_txn_batch_max_ops).  each must still be acked on its
+  // own and in order, including failed writes, which add only an error
+  // entry to the pg log (submit_log_entries) and must not overtake the
+  // writes batched before them
+  bufferlist right, wrong;
+  right.append("right");
+  wrong.append("wrong");
+  ASSERT_EQ(0, ioctx.setxattr("foo", "x", right));
+
+  struct Acks {
+    std::mutex lock;
+    std::vector<int> order;
+  } acks;
+  struct Ack {
+    Acks *acks;
+    int id;
+  };
+  auto on_ack = [](completion_t, void *arg) {
+    auto a = static_cast<Ack*>(arg);
+    std::lock_guard<std::mutex> l(a->acks->lock);
+    a->acks->order.push_back(a->id);
+  };
+
+  const int n = 48;
+  std::vector<Ack> args(n);
+  std::vector<AioCompletion*> cs;
+  std::string expected;
+  for (int i = 0; i < n; ++i) {
+    args[i] = {&acks, i};
+    cs.push_back(cluster.aio_create_completion(&args[i], nullptr, on_ack));
+    bufferlist bl;
+    bl.append(stringify(i) + ",");
+    ObjectWriteOperation op;
+    if (i % 4 == 3) {
+      op.cmpxattr("x", CEPH_OSD_CMPXATTR_OP_EQ, wrong);
+    } else {
+      expected += bl.to_str();
+    }
+    op.append(bl);
+    ASSERT_EQ(0, ioctx.aio_operate("foo", cs.back(), &op));
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(0, cs[i]->wait_for_safe_and_cb());
+    ASSERT_EQ(i % 4 == 3 ? -ECANCELED : 0, cs[i]->get_return_value());
+    cs[i]->release();
+  }
+  std::vector<int> in_order(n);
+  std::iota(in_order.begin(), in_order.end(), 0);
+  {
+    std::lock_guard<std::mutex> l(acks.lock);
+    ASSERT_EQ(in_order, acks.order);
+  }
+
+  bufferlist bl;
+  ASSERT_EQ((int)expected.size(), ioctx.read("foo", bl, 0, 0));
+  ASSERT_EQ(expected, bl.to_str());
+}
+
 TEST_F(LibRadosIo, Checksum) {
   char buf[128];
   memset(buf, 0xcc, sizeof(buf));
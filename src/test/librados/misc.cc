@@ -845,6 +845,77 @@ TEST_F(LibRadosMiscPP, CopyPP) {
   }
 }
 
+TEST_F(LibRadosMiscPP, CopyLocalClonePP) {
+  // a shared locator key puts source and destination in the same pg, so
+  // the osd may serve the copy with an object store clone
+  ioctx.locator_set_key("copy_local_clone");
+
+  bufferlist bl, x, h;
+  bl.append("hi there");
+  x.append("bar");
+  h.append("header");
+  map<string, bufferlist> to_set;
+  to_set["a"].append("va");
+  to_set["b"].append("vb");
+  {
+    bufferlist blc = bl, xc = x;
+    ASSERT_EQ(0, ioctx.write_full("foo", blc));
+    ASSERT_EQ(0, ioctx.setxattr("foo", "myattr", xc));
+    ASSERT_EQ(0, ioctx.omap_set_header("foo", h));
+    ASSERT_EQ(0, ioctx.omap_set("foo", to_set));
+  }
+  version_t uv = ioctx.get_last_version();
+
+  // an existing destination is replaced
+  bufferlist old;
+  old.append("old contents of the destination");
+  ASSERT_EQ(0, ioctx.write_full("foo.copy", old));
+  ASSERT_EQ(0, ioctx.setxattr("foo.copy", "oldattr", old));
+  int64_t shared = sum_osd_perf_counter_pp(cluster, "osd",
+					   "copyfrom_bytes_shared");
+  ASSERT_LE(0, shared);
+  {
+    ObjectWriteOperation op;
+    op.copy_from2("foo", ioctx, uv, 0);
+    ASSERT_EQ(0, ioctx.operate("foo.copy", &op));
+  }
+  // served by a clone, not a read and rewrite
+  ASSERT_LE(shared + (int64_t)bl.length(),
+	    sum_osd_perf_counter_pp(cluster, "osd", "copyfrom_bytes_shared"));
+  {
+    bufferlist bl2, x2, h2;
+    ASSERT_EQ((int)bl.length(), ioctx.read("foo.copy", bl2, 10000, 0));
+    ASSERT_TRUE(bl.contents_equal(bl2));
+    ASSERT_EQ((int)x.length(), ioctx.getxattr("foo.copy", "myattr", x2));
+    ASSERT_TRUE(x.contents_equal(x2));
+    ASSERT_EQ(-ENODATA, ioctx.getxattr("foo.copy", "oldattr", x2));
+    map<string, bufferlist> vals;
+    ObjectReadOperation rop;
+    rop.omap_get_header(&h2, nullptr);
+    rop.omap_get_vals2("", 10, &vals, nullptr, nullptr);
+    ASSERT_EQ(0, ioctx.operate("foo.copy", &rop, nullptr));
+    ASSERT_TRUE(h.contents_equal(h2));
+    ASSERT_EQ(to_set.size(), vals.size());
+  }
+
+  // the copy is independent of its source
+  bufferlist y;
+  y.append("changed");
+  ASSERT_EQ(0, ioctx.write_full("foo.copy", y));
+  {
+    bufferlist bl2;
+    ASSERT_EQ((int)bl.length(), ioctx.read("foo", bl2, 10000, 0));
+    ASSERT_TRUE(bl.contents_equal(bl2));
+  }
+
+  // a stale source version is still refused
+  {
+    ObjectWriteOperation op;
+    op.copy_from2("foo", ioctx, uv - 1, 0);
+    ASSERT_EQ(-ERANGE, ioctx.operate("foo.copy2", &op));
+  }
+}
+
 class LibRadosTwoPoolsECPP : public RadosTestECPP
 {
 public:
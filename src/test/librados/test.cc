@@ -8,6 +8,9 @@
 #include "include/stringify.h"
 #include "common/ceph_context.h"
 #include "common/config.h"
+#include "common/Formatter.h"
+#include "common/perf_counters.h"
+#include "json_spirit/json_spirit.h"
 
 #include <errno.h>
 #include <sstream>
@@ -420,3 +423,70 @@ void assert_eq_sparse(bufferlist& expected,
   }
   ASSERT_EQ(expected.length(), pos);
 }
+
+// add the value of logger.counter in a perf dump to *sum
+static int add_perf_counter(const std::string &dump, const std::string &logger,
+			    const std::string &counter,
+			    const std::string &avg_field, int64_t *sum)
+{
+  json_spirit::mValue v;
+  if (!json_spirit::read(dump, v))
+    return -EINVAL;
+  auto& loggers = v.get_obj();
+  auto l = loggers.find(logger);
+  if (l == loggers.end())
+    return 0;
+  auto& counters = l->second.get_obj();
+  auto c = counters.find(counter);
+  if (c == counters.end())
+    return -ENOENT;
+  if (c->second.type() == json_spirit::obj_type)
+    *sum += c->second.get_obj()[avg_field].get_int64();
+  else
+    *sum += c->second.get_int64();
+  return 0;
+}
+
+int64_t sum_osd_perf_counter_pp(Rados &cluster, const std::string &logger,
+				const std::string &counter,
+				const std::string &avg_field)
+{
+  bufferlist inbl, outbl;
+  int r = cluster.mon_command("{\"prefix\": \"osd ls\", \"format\": \"json\"}",
+			      inbl, &outbl, nullptr);
+  if (r < 0)
+    return r;
+  json_spirit::mValue osds;
+  if (!json_spirit::read(outbl.to_str(), osds))
+    return -EINVAL;
+  int64_t sum = 0;
+  for (auto& osd : osds.get_array()) {
+    outbl.clear();
+    r = cluster.osd_command(
+      osd.get_int(),
+      "{\"prefix\": \"perf dump\", \"logger\": \"" + logger +
+      "\", \"counter\": \"" + counter + "\", \"format\": \"json\"}",
+      inbl, &outbl, nullptr);
+    if (r < 0)
+      continue;  // down
+    r = add_perf_counter(outbl.to_str(), logger, counter, avg_field, &sum);
+    if (r < 0)
+      return r;
+  }
+  return sum;
+}
+
+int64_t get_client_perf_counter_pp(Rados &cluster, const std::string &logger,
+				   const std::string &counter,
+				   const std::string &avg_field)
+{
+  CephContext *cct = static_cast<CephContext*>(cluster.cct());
+  JSONFormatter f;
+  cct->get_perfcounters_collection()->dump_formatted(&f, false, logger,
+						     counter);
+  std::ostringstream ss;
+  f.flush(ss);
+  int64_t value = 0;
+  int r = add_perf_counter(ss.str(), logger, counter, avg_field, &value);
+  return r < 0 ? r : value;
+}
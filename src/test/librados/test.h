@@ -45,6 +45,17 @@ int destroy_one_ec_pool_pp(const std::string &pool_name, librados::Rados &cluste
 void assert_eq_sparse(bufferlist& expected,
                       const std::map<uint64_t, uint64_t>& extents,
                       bufferlist& actual);
+/// sum of an osd perf counter over all osds; for an average, of its
+/// avgcount or sum
+int64_t sum_osd_perf_counter_pp(librados::Rados &cluster,
+				const std::string &logger,
+				const std::string &counter,
+				const std::string &avg_field = "avgcount");
+/// a perf counter of the client itself, e.g. of its objecter
+int64_t get_client_perf_counter_pp(librados::Rados &cluster,
+				   const std::string &logger,
+				   const std::string &counter,
+				   const std::string &avg_field = "avgcount");
 
 class TestAlarm
 {
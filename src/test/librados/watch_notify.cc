@@ -509,6 +509,54 @@ TEST_P(LibRadosWatchNotifyPP, WatchNotify2) {
   ioctx.unwatch2(handle);
 }
 
+TEST_P(LibRadosWatchNotifyPP, WatchNotify2ManyWatchers) {
+  // the watches all go over one connection, so each notify reaches
+  // them in a single batch message
+  const unsigned num_watches = 64;
+  notify_oid = "foo";
+  notify_ioctx = &ioctx;
+  notify_sleep = 0;
+  notify_cookies.clear();
+  bufferlist bl1;
+  bl1.append("foo");
+  ASSERT_EQ(0, ioctx.write_full(notify_oid, bl1));
+  WatchNotifyTestCtx2 ctx(this);
+  std::vector<uint64_t> handles(num_watches);
+  for (auto& handle : handles) {
+    ASSERT_EQ(0, ioctx.watch2(notify_oid, &handle, &ctx));
+  }
+  std::list<obj_watch_t> watches;
+  ASSERT_EQ(0, ioctx.list_watchers(notify_oid, &watches));
+  ASSERT_EQ(num_watches, watches.size());
+
+  int64_t batches = sum_osd_perf_counter_pp(cluster, "osd", "notify_batch");
+  ASSERT_LE(0, batches);
+  for (int i = 0; i < 2; ++i) {
+    notify_cookies.clear();
+    bufferlist bl2, bl_reply;
+    ASSERT_EQ(0, ioctx.notify2(notify_oid, bl2, 300000, &bl_reply));
+    auto p = bl_reply.cbegin();
+    std::map<std::pair<uint64_t,uint64_t>,bufferlist> reply_map;
+    std::set<std::pair<uint64_t,uint64_t> > missed_map;
+    decode(reply_map, p);
+    decode(missed_map, p);
+    ASSERT_EQ(num_watches, notify_cookies.size());
+    for (auto handle : handles) {
+      ASSERT_EQ(1u, notify_cookies.count(handle));
+    }
+    ASSERT_EQ(num_watches, reply_map.size());
+    ASSERT_EQ(0u, missed_map.size());
+  }
+  ASSERT_LE(batches + 2,
+	    sum_osd_perf_counter_pp(cluster, "osd", "notify_batch"));
+
+  for (auto handle : handles) {
+    ASSERT_GT(ioctx.watch_check(handle), 0);
+    ioctx.unwatch2(handle);
+  }
+  cluster.watch_flush();
+}
+
 TEST_P(LibRadosWatchNotifyPP, AioWatchNotify2) {
   notify_oid = "foo";
   notify_ioctx = &ioctx;
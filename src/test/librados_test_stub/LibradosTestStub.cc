@@ -426,6 +426,21 @@ int IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
   return ctx->aio_operate(oid, *ops, c->pc, NULL, 0);
 }
 
+int IoCtx::aio_operate_batch(const std::vector<std::string>& oids,
+                             const std::vector<AioCompletion*>& cs,
+                             const std::vector<ObjectWriteOperation*>& ops) {
+  if (oids.size() != cs.size() || oids.size() != ops.size()) {
+    return -EINVAL;
+  }
+  for (size_t i = 0; i < oids.size(); ++i) {
+    int r = aio_operate(oids[i], cs[i], ops[i]);
+    if (r < 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
 int IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
                        ObjectWriteOperation *op, snap_t seq,
                        std::vector<snap_t>& snaps, int flags,
@@ -1199,6 +1214,15 @@ int cls_get_request_origin(cls_method_context_t hctx, entity_inst_t *origin) {
   return 0;
 }
 
+int cls_get_request_object(cls_method_context_t hctx, hobject_t *obj) {
+  librados::TestClassHandler::MethodContext *ctx =
+    reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
+  *obj = hobject_t(object_t(ctx->oid), "", CEPH_NOSNAP, 0,
+                   ctx->io_ctx_impl->get_id(),
+                   ctx->io_ctx_impl->get_namespace());
+  return 0;
+}
+
 int cls_cxx_getxattr(cls_method_context_t hctx, const char *name,
                      bufferlist *outbl) {
   std::map<string, bufferlist> attrs;
@@ -1274,6 +1298,41 @@ int cls_cxx_map_get_vals(cls_method_context_t hctx, const string &start_obj,
   return vals->size();
 }
 
+int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
+                                 const std::set<string> &keys,
+                                 std::map<string, bufferlist> *vals) {
+  vals->clear();
+  for (auto& key : keys) {
+    bufferlist bl;
+    int r = cls_cxx_map_get_val(hctx, key, &bl);
+    if (r == -ENOENT) {
+      continue;
+    } else if (r < 0) {
+      return r;
+    }
+    (*vals)[key].claim(bl);
+  }
+  return 0;
+}
+
+int cls_cxx_map_iterate(cls_method_context_t hctx, const string &start_after,
+                        const string &filter_prefix, uint64_t max_to_get,
+                        bool with_values,
+                        const std::function<void(const string&, bufferlist&)>& f,
+                        bool *more) {
+  std::map<string, bufferlist> vals;
+  int r = cls_cxx_map_get_vals(hctx, start_after, filter_prefix, max_to_get,
+                               &vals, more);
+  if (r < 0) {
+    return r;
+  }
+  bufferlist empty;
+  for (auto& p : vals) {
+    f(p.first, with_values ? p.second : empty);
+  }
+  return vals.size();
+}
+
 int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key) {
   std::set<std::string> keys;
   keys.insert(key);
@@ -1371,6 +1430,13 @@ uint64_t cls_get_client_features(cls_method_context_t hctx) {
   return CEPH_FEATURES_SUPPORTED_DEFAULT;
 }
 
+int cls_get_config_value(const std::string &name, std::string *val) {
+  if (g_ceph_context == nullptr) {
+    return -ENOENT;
+  }
+  return g_ceph_context->_conf.get_val(name, val);
+}
+
 int cls_get_snapset_seq(cls_method_context_t hctx, uint64_t *snap_seq) {
   librados::TestClassHandler::MethodContext *ctx =
     reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
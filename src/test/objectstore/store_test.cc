@@ -2310,6 +2310,52 @@ TEST_P(StoreTest, ZeroVsObjectSize) {
   ASSERT_EQ(100200, stat.st_size);
 }
 
+TEST_P(StoreTest, VerifyAndSummarize) {
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("foo", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    bufferlist bl;
+    bl.append(std::string(0x13000, 'a'));
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    // an unaligned overwrite, a hole and an unaligned tail
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(std::string(0x1234, 'b'));
+    t.write(cid, hoid, 0x2345, bl.length(), bl);
+    t.zero(cid, hoid, 0x8000, 0x4000);
+    bufferlist tail;
+    tail.append(std::string(0x321, 'c'));
+    t.write(cid, hoid, 0x20000, tail.length(), tail);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  uint64_t offsets[] = { 0, 0x1000, 0x2345, 0x10001 };
+  for (auto offset : offsets) {
+    bufferlist bl;
+    r = store->read(ch, hoid, offset, 0x30000, bl);
+    ASSERT_EQ((int)(0x20321 - offset), r);
+    uint32_t digest = 0x1234;
+    r = store->verify_and_summarize(ch, hoid, offset, 0x30000, &digest);
+    ASSERT_EQ((int)(0x20321 - offset), r);
+    ASSERT_EQ(bl.crc32c(0x1234), digest);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, ZeroLengthWrite) {
   int r;
   coll_t cid;
@@ -182,3 +182,36 @@ TEST_F(MClockClientQueueTest, TestRemoveByClass) {
   r = q.dequeue();
   ASSERT_EQ(104u, r.get_map_epoch());
 }
+
+
+TEST(MClockTenantQos, Parse) {
+  std::map<EntityName, ceph::mclock::TenantQos> qos;
+  std::ostringstream err;
+  ASSERT_EQ(0, ceph::mclock::parse_tenant_qos(
+	      "client.db=100:10:0, client.batch=0:1.5:200", &qos, &err));
+  ASSERT_EQ(2u, qos.size());
+  EntityName db, batch;
+  ASSERT_TRUE(db.from_str("client.db"));
+  ASSERT_TRUE(batch.from_str("client.batch"));
+  ASSERT_EQ(100.0, qos[db].reservation);
+  ASSERT_EQ(10.0, qos[db].weight);
+  ASSERT_EQ(0.0, qos[db].limit);
+  ASSERT_EQ(0.0, qos[batch].reservation);
+  ASSERT_EQ(1.5, qos[batch].weight);
+  ASSERT_EQ(200.0, qos[batch].limit);
+
+  qos.clear();
+  ASSERT_EQ(0, ceph::mclock::parse_tenant_qos("", &qos, &err));
+  ASSERT_TRUE(qos.empty());
+}
+
+TEST(MClockTenantQos, ParseInvalid) {
+  std::map<EntityName, ceph::mclock::TenantQos> qos;
+  std::ostringstream err;
+  ASSERT_EQ(-EINVAL, ceph::mclock::parse_tenant_qos("client.db", &qos, &err));
+  ASSERT_EQ(-EINVAL, ceph::mclock::parse_tenant_qos("db=1:1:1", &qos, &err));
+  ASSERT_EQ(-EINVAL, ceph::mclock::parse_tenant_qos("client.db=1:1", &qos, &err));
+  ASSERT_EQ(-EINVAL, ceph::mclock::parse_tenant_qos("client.db=1:x:1", &qos, &err));
+  ASSERT_EQ(-EINVAL, ceph::mclock::parse_tenant_qos("client.db=-1:1:1", &qos, &err));
+  ASSERT_EQ(-EINVAL, ceph::mclock::parse_tenant_qos("client.db=1:0:1", &qos, &err));
+}
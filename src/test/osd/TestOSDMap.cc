@@ -274,6 +274,64 @@ TEST_F(OSDMapTest, MapFunctionsMatch) {
   EXPECT_EQ(acting_osds, acting_osds_two);
 }
 
+TEST_F(OSDMapTest, IncrementalMappingUpdate) {
+  set_up_map();
+  mapping.update(osdmap);
+  ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+  uint64_t num_pgs = mapping.get_num_pgs();
+  ASSERT_EQ(num_pgs, mapping.get_num_update_pgs());
+
+  auto check_mapping = [&]() {
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	pg_t pgid(ps, p.first);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2);
+	ASSERT_EQ(up_primary, up_primary2);
+	ASSERT_EQ(acting, acting2);
+	ASSERT_EQ(acting_primary, acting_primary2);
+      }
+    }
+  };
+
+  // a pg_temp change only remaps that pg
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up_osds, acting_osds;
+  osdmap.pg_to_up_acting_osds(pgid, up_osds, acting_osds);
+  OSDMap::Incremental pgtemp_inc(osdmap.get_epoch() + 1);
+  pgtemp_inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+    acting_osds.rbegin(), acting_osds.rend());
+  osdmap.apply_incremental(pgtemp_inc);
+  mapping.note_incremental(pgtemp_inc);
+  mapping.update(osdmap);
+  ASSERT_EQ(1u, mapping.get_num_update_pgs());
+  check_mapping();
+
+  // marking an osd out remaps the pools that can use it
+  OSDMap::Incremental out_inc(osdmap.get_epoch() + 1);
+  out_inc.new_weight[acting_osds[0]] = CEPH_OSD_OUT;
+  osdmap.apply_incremental(out_inc);
+  mapping.note_incremental(out_inc);
+  mapping.update(osdmap);
+  ASSERT_EQ(num_pgs, mapping.get_num_update_pgs());
+  check_mapping();
+
+  // a missed incremental forces a full remap
+  OSDMap::Incremental missed_inc(osdmap.get_epoch() + 1);
+  missed_inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>();
+  osdmap.apply_incremental(missed_inc);
+  OSDMap::Incremental noted_inc(osdmap.get_epoch() + 1);
+  osdmap.apply_incremental(noted_inc);
+  mapping.note_incremental(noted_inc);
+  mapping.update(osdmap);
+  ASSERT_EQ(num_pgs, mapping.get_num_update_pgs());
+  check_mapping();
+}
+
 /** This test must be removed or modified appropriately when we allow
  * other ways to specify a primary. */
 TEST_F(OSDMapTest, PrimaryIsFirst) {
@@ -429,6 +487,63 @@ TEST_F(OSDMapTest, KeepsNecessaryTemps) {
   EXPECT_FALSE(pending_inc.new_primary_temp.count(pgid));
 }
 
+TEST_F(OSDMapTest, SharedCopyIsolated) {
+  set_up_map();
+
+  pg_t rawpg(0, my_rep_pool);
+  pg_t pgid = osdmap.raw_pg_to_pg(rawpg);
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  vector<int> new_acting_osds(acting_osds.rbegin(), acting_osds.rend());
+
+  // tmpmap shares its sub-structures with osdmap; modifying it must not
+  // leak into osdmap
+  OSDMap tmpmap;
+  tmpmap.deepish_copy_from(osdmap);
+  OSDMap::Incremental pending_inc(tmpmap.get_epoch() + 1);
+  pending_inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+    new_acting_osds.begin(), new_acting_osds.end());
+  int spare = 0;
+  while (std::find(up_osds.begin(), up_osds.end(), spare) != up_osds.end())
+    ++spare;
+  pending_inc.new_pg_upmap_items[pgid] =
+    mempool::osdmap::vector<pair<int32_t,int32_t>>(
+      {{up_osds[0], spare}});
+  uuid_d new_uuid;
+  new_uuid.generate_random();
+  pending_inc.new_uuid[0] = new_uuid;
+  epoch_t old_up_thru = osdmap.get_up_thru(0);
+  pending_inc.new_up_thru[0] = old_up_thru + 1;
+  entity_addr_t bad;
+  bad.parse("10.1.2.3:0/1");
+  pending_inc.new_blacklist[bad] = ceph_clock_now();
+  tmpmap.apply_incremental(pending_inc);
+
+  vector<int> tmp_up, tmp_acting;
+  tmpmap.pg_to_up_acting_osds(pgid, tmp_up, tmp_acting);
+  EXPECT_EQ(new_acting_osds, tmp_acting);
+  EXPECT_EQ(spare, tmp_up[0]);
+  EXPECT_EQ(new_uuid, tmpmap.get_uuid(0));
+
+  vector<int> up_after, acting_after;
+  osdmap.pg_to_up_acting_osds(pgid, up_after, acting_after);
+  EXPECT_EQ(up_osds, up_after);
+  EXPECT_EQ(acting_osds, acting_after);
+  EXPECT_NE(new_uuid, osdmap.get_uuid(0));
+  EXPECT_EQ(old_up_thru + 1, tmpmap.get_up_thru(0));
+  EXPECT_EQ(old_up_thru, osdmap.get_up_thru(0));
+  EXPECT_TRUE(tmpmap.is_blacklisted(bad));
+  EXPECT_FALSE(osdmap.is_blacklisted(bad));
+
+  // deduping against the original keeps tmpmap's own changes
+  OSDMap::dedup(&osdmap, &tmpmap);
+  tmpmap.pg_to_up_acting_osds(pgid, tmp_up, tmp_acting);
+  EXPECT_EQ(new_acting_osds, tmp_acting);
+  EXPECT_EQ(spare, tmp_up[0]);
+}
+
 TEST_F(OSDMapTest, PrimaryAffinity) {
   set_up_map();
 
@@ -2291,6 +2291,29 @@ TEST_F(PGLogTest, split_into_preserves_may_include_deletes) {
   }
 }
 
+TEST_F(PGLogTest, trim_budget_keeps_dups_when_degraded) {
+  // trim ten entries with a dup budget of two, once with a missing
+  // object and once without
+  for (bool degraded : {true, false}) {
+    clear();
+    pg_info_t info;
+    info.last_update = mk_evt(10, 10);
+    info.last_complete = degraded ? mk_evt(10, 0) : info.last_update;
+    for (unsigned v = 1; v <= 10; ++v) {
+      log.add(mk_ple_mod(mk_obj(v), mk_evt(10, v), eversion_t()));
+    }
+    log.head = mk_evt(10, 10);
+    log.skip_can_rollback_to_to_head();
+    if (degraded) {
+      missing.add(mk_obj(10), mk_evt(10, 10), eversion_t(), false);
+    }
+    set_dups_tracked(2);
+    trim(mk_evt(10, 9), info);
+    EXPECT_EQ(1u, log.log.size());
+    EXPECT_EQ(degraded ? 9u : 2u, log.dups.size()) << "degraded " << degraded;
+  }
+}
+
 class PGLogTestRebuildMissing : public PGLogTest, public StoreTestFixture {
 public:
   PGLogTestRebuildMissing() : PGLogTest(), StoreTestFixture("memstore") {}
@@ -2803,6 +2826,36 @@ TEST_F(PGLogTrimTest, TestTrimNoDups)
   EXPECT_EQ(0u, trimmed_dups.size());
 }
 
+TEST_F(PGLogTrimTest, TestTrimDupsTracked)
+{
+  // an explicit dups_tracked overrides osd_pg_log_dups_tracked
+  SetUp(1, 2, 20);
+  PGLog::IndexedLog log;
+  log.head = mk_evt(20, 0);
+  log.skip_can_rollback_to_to_head();
+  log.head = mk_evt(9, 0);
+
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(8, 70)));
+  log.add(mk_ple_dt(mk_obj(2), mk_evt(15, 150), mk_evt(10, 100)));
+  log.add(mk_ple_mod_rb(mk_obj(3), mk_evt(15, 155), mk_evt(15, 150)));
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(20, 160), mk_evt(25, 152)));
+  log.add(mk_ple_mod(mk_obj(4), mk_evt(21, 165), mk_evt(26, 160)));
+  log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
+
+  std::set<eversion_t> trimmed;
+  std::set<std::string> trimmed_dups;
+  eversion_t write_from_dups = eversion_t::max();
+
+  log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups, &write_from_dups,
+	   10);
+
+  EXPECT_EQ(eversion_t::max(), write_from_dups);
+  EXPECT_EQ(3u, log.log.size());
+  EXPECT_EQ(3u, trimmed.size());
+  EXPECT_EQ(0u, log.dups.size());
+  EXPECT_EQ(0u, trimmed_dups.size());
+}
+
 TEST_F(PGLogTrimTest, TestNoTrim)
 {
   SetUp(1, 2, 20);
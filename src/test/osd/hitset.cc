@@ -195,3 +195,102 @@ TEST_F(ExplicitObjectHitSetTest, RejectsNoMatch) {
   }
   EXPECT_EQ(matches, 0);
 }
+
+class CountingHitSetTest : public testing::Test, public HitSetTestStrap {
+public:
+
+  CountingHitSetTest() : HitSetTestStrap(new HitSet(new CountingHitSet)) {}
+
+  void rebuild(uint64_t target, double decay, uint64_t seed) {
+    CountingHitSet::Params *cparams =
+      new CountingHitSet::Params(target, decay, seed);
+    HitSet::Params param(cparams);
+    HitSet new_set(param);
+    *hitset = new_set;
+  }
+
+  CountingHitSet *get_hitset() { return static_cast<CountingHitSet*>(hitset->impl.get()); }
+};
+
+TEST_F(CountingHitSetTest, Params) {
+  CountingHitSet::Params params(100, 0.5, 5);
+  EXPECT_EQ((unsigned)100, params.target_size);
+  EXPECT_EQ(0.5, params.get_decay());
+  EXPECT_EQ((unsigned)5, params.seed);
+  params.set_decay(0.25);
+
+  bufferlist bl;
+  params.encode(bl);
+  CountingHitSet::Params p2;
+  auto iter = bl.cbegin();
+  p2.decode(iter);
+  EXPECT_EQ((unsigned)100, p2.target_size);
+  EXPECT_EQ(0.25, p2.get_decay());
+  EXPECT_EQ((unsigned)5, p2.seed);
+}
+
+TEST_F(CountingHitSetTest, InsertsMatch) {
+  rebuild(100, 0.5, 1);
+  ASSERT_EQ(hitset->impl->get_type(), HitSet::TYPE_COUNTING);
+  fill(50);
+  verify_fill(50);
+  EXPECT_GE(hitset->approx_unique_insert_count(), 40u);
+  EXPECT_LE(hitset->approx_unique_insert_count(), 60u);
+  EXPECT_FALSE(hitset->is_full());
+}
+
+TEST_F(CountingHitSetTest, Counts) {
+  rebuild(100, 0.5, 1);
+  hobject_t hot(object_t("hot"), "", 0, 1234, 0, "");
+  hobject_t warm(object_t("warm"), "", 0, 5678, 0, "");
+  for (unsigned i = 0; i < 8; ++i) {
+    hitset->insert(hot);
+  }
+  hitset->insert(warm);
+  fill(50);
+  // collisions can only add to a count
+  EXPECT_GE(hitset->get_count(hot), 8u);
+  EXPECT_LE(hitset->get_count(hot), 9u);
+  EXPECT_GE(hitset->get_count(warm), 1u);
+  EXPECT_LE(hitset->get_count(warm), 2u);
+
+  // counts survive a copy and an encode/decode round trip
+  HitSet copy(*hitset);
+  EXPECT_EQ(hitset->get_count(hot), copy.get_count(hot));
+  bufferlist bl;
+  hitset->encode(bl);
+  HitSet decoded;
+  auto iter = bl.cbegin();
+  decoded.decode(iter);
+  EXPECT_EQ(hitset->get_count(hot), decoded.get_count(hot));
+  EXPECT_EQ(hitset->insert_count(), decoded.insert_count());
+}
+
+TEST_F(CountingHitSetTest, Decay) {
+  rebuild(100, 0.5, 1);
+  hobject_t hot(object_t("hot"), "", 0, 1234, 0, "");
+  hobject_t cold(object_t("cold"), "", 0, 5678, 0, "");
+  for (unsigned i = 0; i < 8; ++i) {
+    hitset->insert(hot);
+  }
+  hitset->insert(cold);
+  unsigned hot_count = hitset->get_count(hot);
+
+  get_hitset()->decay(0.5);
+  EXPECT_EQ(hot_count / 2, hitset->get_count(hot));
+  EXPECT_EQ(4u, hitset->insert_count());
+  // a single hit does not survive a halving
+  EXPECT_FALSE(hitset->contains(cold));
+
+  get_hitset()->decay(0);
+  EXPECT_FALSE(hitset->contains(hot));
+}
+
+TEST_F(CountingHitSetTest, Saturates) {
+  rebuild(10, 0.5, 1);
+  hobject_t hot(object_t("hot"), "", 0, 1234, 0, "");
+  for (unsigned i = 0; i < 1000; ++i) {
+    hitset->insert(hot);
+  }
+  EXPECT_EQ(255u, hitset->get_count(hot));
+}
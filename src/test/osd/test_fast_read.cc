@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "global/global_context.h"
+#include "osd/OSD.h"
+
+class FastReadQueue : public ::testing::Test {
+protected:
+  OpTracker tracker{g_ceph_context, false, 1};
+  spg_t pgid{pg_t(0x1234, 1), shard_id_t::NO_SHARD};
+
+  OpQueueItem make_op(uint64_t tid, int flags = CEPH_OSD_FLAG_READ) {
+    hobject_t hoid(object_t("foo"), "", CEPH_NOSNAP, 0x1234, 1, "");
+    auto m = MOSDOp::create(1, tid, hoid, pgid, 10, flags,
+			    CEPH_FEATURES_SUPPORTED_DEFAULT);
+    if (flags & CEPH_OSD_FLAG_WRITE) {
+      bufferlist bl;
+      bl.append("data");
+      m->write(0, bl.length(), bl);
+    } else {
+      m->read(0, 4096);
+    }
+    OpRequestRef op = tracker.create_request<OpRequest, Message*>(m.detach());
+    return OpQueueItem(
+      unique_ptr<OpQueueItem::OpQueueable>(new PGOpItem(pgid, op)),
+      10, CEPH_MSG_PRIO_DEFAULT, utime_t(), 1, 10);
+  }
+
+  static uint64_t tid_of(const OpQueueItem& qi) {
+    return (*qi.maybe_get_op())->get_req()->get_tid();
+  }
+};
+
+TEST_F(FastReadQueue, Candidates)
+{
+  EXPECT_TRUE(make_op(1).is_fast_read_candidate());
+  EXPECT_FALSE(make_op(2, CEPH_OSD_FLAG_WRITE).is_fast_read_candidate());
+  EXPECT_FALSE(make_op(3, CEPH_OSD_FLAG_READ | CEPH_OSD_FLAG_WRITE)
+	       .is_fast_read_candidate());
+  EXPECT_FALSE(make_op(4, CEPH_OSD_FLAG_READ | CEPH_OSD_FLAG_RWORDERED)
+	       .is_fast_read_candidate());
+  EXPECT_FALSE(make_op(5, CEPH_OSD_FLAG_READ | CEPH_OSD_FLAG_BALANCE_READS)
+	       .is_fast_read_candidate());
+  EXPECT_FALSE(make_op(6, CEPH_OSD_FLAG_READ | CEPH_OSD_FLAG_IGNORE_OVERLAY)
+	       .is_fast_read_candidate());
+
+  OpQueueItem trim(
+    unique_ptr<OpQueueItem::OpQueueable>(new PGSnapTrim(pgid, 10)),
+    10, CEPH_MSG_PRIO_DEFAULT, utime_t(), 0, 10);
+  EXPECT_FALSE(trim.is_fast_read_candidate());
+}
+
+TEST_F(FastReadQueue, DeclinedReadTakesLockedPath)
+{
+  // OSD::dequeue_fast_read() marks an op do_fast_read() declined, so
+  // once requeued it is not tried again
+  OpQueueItem qi = make_op(1);
+  ASSERT_TRUE(qi.is_fast_read_candidate());
+  (*qi.maybe_get_op())->no_fast_read = true;
+  EXPECT_FALSE(qi.is_fast_read_candidate());
+}
+
+TEST_F(FastReadQueue, RequeueFrontKeepsOrder)
+{
+  // a declined read (1) is requeued while another thread has taken
+  // the next op (2) off the pqueue and is waiting for the pg lock
+  OSDShardPGSlot slot;
+  deque<OpQueueItem> pqueue;
+  OpQueueItem declined = make_op(1);
+  slot.to_process.push_back(make_op(2, CEPH_OSD_FLAG_WRITE));
+  pqueue.push_back(make_op(3));
+  pqueue.push_back(make_op(4, CEPH_OSD_FLAG_WRITE));
+
+  pqueue.push_front(slot.requeue_front(std::move(declined)));
+
+  ASSERT_EQ(1u, slot.to_process.size());
+  EXPECT_EQ(1u, tid_of(slot.to_process.front()));
+  ASSERT_EQ(3u, pqueue.size());
+  EXPECT_EQ(2u, tid_of(pqueue[0]));
+  EXPECT_EQ(3u, tid_of(pqueue[1]));
+  EXPECT_EQ(4u, tid_of(pqueue[2]));
+}
+
+TEST_F(FastReadQueue, RequeueFrontSeveralWaiting)
+{
+  OSDShardPGSlot slot;
+  deque<OpQueueItem> pqueue;
+  slot.to_process.push_back(make_op(2));
+  slot.to_process.push_back(make_op(3, CEPH_OSD_FLAG_WRITE));
+  pqueue.push_back(make_op(4));
+
+  pqueue.push_front(slot.requeue_front(make_op(1)));
+
+  deque<uint64_t> order;
+  for (auto& qi : slot.to_process) {
+    order.push_back(tid_of(qi));
+  }
+  for (auto& qi : pqueue) {
+    order.push_back(tid_of(qi));
+  }
+  EXPECT_EQ(deque<uint64_t>({1, 2, 3, 4}), order);
+}
@@ -0,0 +1,135 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "common/Throttle.h"
+#include "include/stringify.h"
+#include "global/global_context.h"
+#include "messages/MOSDOpBatch.h"
+
+static const uint64_t FEATURES = CEPH_FEATURES_SUPPORTED_DEFAULT;
+
+class MOSDOpBatchTest : public ::testing::Test {
+protected:
+  spg_t pgid{pg_t(0x1234, 1), shard_id_t::NO_SHARD};
+  Throttle bytes{g_ceph_context, "test_batch_bytes", 1 << 20, false};
+  Throttle msgs{g_ceph_context, "test_batch_msgs", 100, false};
+
+  MOSDOpBatch::ref make_batch(unsigned n) {
+    auto b = MOSDOpBatch::create(pgid, 10);
+    for (unsigned i = 0; i < n; ++i) {
+      string name = "obj" + stringify(i);
+      hobject_t hoid(object_t(name), "", CEPH_NOSNAP, 0x1234, 1, "");
+      auto m = MOSDOp::create(1, 100 + i, hoid, pgid, 10,
+			      CEPH_OSD_FLAG_WRITE, FEATURES);
+      bufferlist bl;
+      bl.append(string(1000 * (i + 1), 'a' + i));
+      m->write(0, bl.length(), bl);
+      b->add_op(m.get(), FEATURES);
+    }
+    return b;
+  }
+
+  // what the messenger hands to the osd: a decoded batch holding one
+  // message slot and all its bytes
+  MOSDOpBatch::ref receive(MOSDOpBatch *b) {
+    b->encode_payload(FEATURES);
+    auto d = MOSDOpBatch::create();
+    d->set_header(b->get_header());
+    d->set_payload(b->get_payload());
+    d->set_data(b->get_data());
+    d->decode_payload();
+    bytes.take(d->get_payload().length() + d->get_middle().length() +
+	       d->get_data().length());
+    msgs.take(1);
+    d->set_byte_throttler(&bytes);
+    d->set_message_throttler(&msgs);
+    return d;
+  }
+
+  static uint64_t op_bytes(Message *m) {
+    return m->get_payload().length() + m->get_middle().length() +
+      m->get_data().length();
+  }
+};
+
+TEST_F(MOSDOpBatchTest, ClaimOps)
+{
+  auto d = receive(make_batch(3).get());
+  EXPECT_EQ(3u, d->num_ops);
+  EXPECT_EQ(pgid, d->pgid);
+  EXPECT_EQ(10u, d->map_epoch);
+
+  vector<MOSDOp*> ops = d->claim_ops(g_ceph_context);
+  ASSERT_EQ(3u, ops.size());
+
+  // each op holds a message slot and exactly its own bytes; the
+  // batch's framing was released and it holds nothing any more
+  uint64_t claimed = 0;
+  for (auto m : ops) {
+    claimed += op_bytes(m);
+  }
+  EXPECT_EQ((int64_t)claimed, bytes.get_current());
+  EXPECT_EQ(3, msgs.get_current());
+  d.reset();
+  EXPECT_EQ((int64_t)claimed, bytes.get_current());
+  EXPECT_EQ(3, msgs.get_current());
+
+  for (unsigned i = 0; i < ops.size(); ++i) {
+    MOSDOp *m = ops[i];
+    EXPECT_EQ(100u + i, m->get_tid());
+    m->finish_decode();
+    EXPECT_EQ(object_t("obj" + stringify(i)), m->get_oid());
+    ASSERT_EQ(1u, m->ops.size());
+    EXPECT_EQ(string(1000 * (i + 1), 'a' + i), m->ops[0].indata.to_str());
+    m->put();
+  }
+  EXPECT_EQ(0, bytes.get_current());
+  EXPECT_EQ(0, msgs.get_current());
+}
+
+TEST_F(MOSDOpBatchTest, PartialDecode)
+{
+  auto b = make_batch(3);
+  // cut the last op short
+  bufferlist cut;
+  cut.substr_of(b->get_data(), 0, b->get_data().length() - 100);
+  b->set_data(cut);
+  auto d = receive(b.get());
+
+  vector<MOSDOp*> ops = d->claim_ops(g_ceph_context);
+  ASSERT_EQ(2u, ops.size());
+  EXPECT_EQ(100u, ops[0]->get_tid());
+  EXPECT_EQ(101u, ops[1]->get_tid());
+  EXPECT_EQ(2, msgs.get_current());
+
+  // nothing leaks, whichever of the batch and its ops goes first
+  d.reset();
+  for (auto m : ops) {
+    m->put();
+  }
+  EXPECT_EQ(0, bytes.get_current());
+  EXPECT_EQ(0, msgs.get_current());
+}
+
+TEST_F(MOSDOpBatchTest, NothingDecodes)
+{
+  auto b = make_batch(2);
+  b->set_data(bufferlist());
+  auto d = receive(b.get());
+  EXPECT_TRUE(d->claim_ops(g_ceph_context).empty());
+  // the batch keeps its message slot and gives it back when it goes
+  EXPECT_EQ(1, msgs.get_current());
+  EXPECT_EQ(0, bytes.get_current());
+  d.reset();
+  EXPECT_EQ(0, msgs.get_current());
+}
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "messages/MOSDOp.h"
+#include "messages/MOSDOpReply.h"
+
+static MOSDOp::ref make_op()
+{
+  hobject_t hoid(object_t("foo"), "", CEPH_NOSNAP, 0x1234, 1, "");
+  spg_t pgid(pg_t(0x1234, 1), shard_id_t::NO_SHARD);
+  auto m = MOSDOp::create(1, 42, hoid, pgid, 10, CEPH_OSD_FLAG_READ,
+			  CEPH_FEATURES_SUPPORTED_DEFAULT);
+  m->read(0, 4096);
+  return m;
+}
+
+// encode m with the given features and decode it into a fresh message
+template<typename T>
+static typename T::ref round_trip(T *m, uint64_t features)
+{
+  m->encode_payload(features);
+  auto d = T::create();
+  d->set_header(m->get_header());
+  d->set_payload(m->get_payload());
+  d->set_data(m->get_data());
+  d->decode_payload();
+  return d;
+}
+
+TEST(MOSDOp, qos_tags_v9)
+{
+  auto m = make_op();
+  m->set_qos_tags(7, 3);
+  auto d = round_trip(m.get(), CEPH_FEATURES_SUPPORTED_DEFAULT);
+  ASSERT_EQ(9, d->get_header().version);
+  EXPECT_EQ(7u, d->get_qos_delta());
+  EXPECT_EQ(3u, d->get_qos_rho());
+  d->finish_decode();
+  EXPECT_EQ(1u, d->ops.size());
+  EXPECT_EQ(object_t("foo"), d->get_oid());
+}
+
+TEST(MOSDOp, qos_tags_pre_nautilus)
+{
+  // pre-nautilus OSDs get a v8 message without the tags
+  auto m = make_op();
+  m->set_qos_tags(7, 3);
+  auto d = round_trip(m.get(),
+		      CEPH_FEATURES_SUPPORTED_DEFAULT &
+		      ~CEPH_FEATURE_SERVER_NAUTILUS);
+  ASSERT_EQ(8, d->get_header().version);
+  EXPECT_EQ(0u, d->get_qos_delta());
+  EXPECT_EQ(0u, d->get_qos_rho());
+  d->finish_decode();
+  EXPECT_EQ(1u, d->ops.size());
+  EXPECT_EQ(object_t("foo"), d->get_oid());
+}
+
+TEST(MOSDOpReply, qos_phase)
+{
+  for (int phase : {-1, 0, 1}) {
+    auto m = make_op();
+    m->set_qos_phase(phase);
+    auto r = MOSDOpReply::create(m.get(), 0, 10, CEPH_OSD_FLAG_ACK, false);
+    auto d = round_trip(r.get(), CEPH_FEATURES_SUPPORTED_DEFAULT);
+    ASSERT_EQ(9, d->get_header().version);
+    EXPECT_EQ(phase, d->get_qos_phase());
+    EXPECT_EQ(object_t("foo"), d->get_oid());
+  }
+}
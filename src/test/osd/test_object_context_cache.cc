@@ -0,0 +1,142 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "global/global_context.h"
+#include "include/stringify.h"
+#include "osd/ObjectContextCache.h"
+
+static hobject_t make_oid(int64_t pool, uint32_t hash, const string& name)
+{
+  return hobject_t(object_t(name), "", CEPH_NOSNAP, hash, pool, "");
+}
+
+TEST(ObjectContextCache, lookup_or_create)
+{
+  ObjectContextCache cache(g_ceph_context, 16, 4);
+  spg_t pgid(pg_t(1, 1));
+  hobject_t oid = make_oid(1, 1, "foo");
+
+  ASSERT_FALSE(cache.lookup(pgid, oid));
+  ObjectContextRef a = cache.lookup_or_create(pgid, oid);
+  ASSERT_TRUE(a);
+  ASSERT_EQ(a, cache.lookup_or_create(pgid, oid));
+  ASSERT_EQ(a, cache.lookup(pgid, oid));
+  ASSERT_EQ(1, cache.get_count(pgid));
+
+  // the same object name in another pg is a different context
+  spg_t other(pg_t(2, 1));
+  ObjectContextRef b = cache.lookup_or_create(other, oid);
+  ASSERT_NE(a, b);
+  ASSERT_EQ(1, cache.get_count(other));
+  ASSERT_EQ(2u, cache.get_count());
+}
+
+TEST(ObjectContextCache, clear_pg)
+{
+  ObjectContextCache cache(g_ceph_context, 64, 4);
+  spg_t pg1(pg_t(1, 1)), pg2(pg_t(2, 1));
+  for (unsigned i = 0; i < 8; ++i) {
+    cache.lookup_or_create(pg1, make_oid(1, i, "a" + stringify(i)));
+    cache.lookup_or_create(pg2, make_oid(1, i, "b" + stringify(i)));
+  }
+  ObjectContextRef held = cache.lookup(pg1, make_oid(1, 0, "a0"));
+  ASSERT_EQ(8, cache.get_count(pg1));
+
+  cache.clear(pg1);
+  ASSERT_EQ(0, cache.get_count(pg1));
+  ASSERT_EQ(8, cache.get_count(pg2));
+  // a live reference keeps the context reachable
+  ASSERT_FALSE(cache.empty(pg1));
+  ASSERT_EQ(held, cache.lookup(pg1, make_oid(1, 0, "a0")));
+  cache.clear(pg1);
+  held.reset();
+  ASSERT_TRUE(cache.empty(pg1));
+  ASSERT_FALSE(cache.empty(pg2));
+  cache.clear();
+  ASSERT_TRUE(cache.empty(pg2));
+}
+
+TEST(ObjectContextCache, get_next)
+{
+  ObjectContextCache cache(g_ceph_context, 1024, 8);
+  spg_t pg1(pg_t(1, 1)), pg2(pg_t(2, 1));
+  set<hobject_t> expected;
+  for (unsigned i = 0; i < 20; ++i) {
+    hobject_t oid = make_oid(1, i * 7, "o" + stringify(i));
+    cache.lookup_or_create(pg1, oid);
+    expected.insert(oid);
+    cache.lookup_or_create(pg2, make_oid(1, i, "p" + stringify(i)));
+  }
+
+  set<hobject_t> seen;
+  pair<hobject_t, ObjectContextRef> i;
+  hobject_t last;
+  while (cache.get_next(pg1, i.first, &i)) {
+    ASSERT_TRUE(last < i.first);
+    last = i.first;
+    seen.insert(i.first);
+  }
+  ASSERT_EQ(expected, seen);
+  i.second.reset();
+  cache.clear();
+}
+
+TEST(ObjectContextCache, many_shards)
+{
+  // more shards than a single PG spreads over
+  ObjectContextCache cache(g_ceph_context, 4096, 32);
+  set<hobject_t> expected;
+  for (unsigned ps = 0; ps < 16; ++ps) {
+    for (unsigned i = 0; i < 32; ++i) {
+      hobject_t oid = make_oid(1, ps + i * 16, "o" + stringify(i));
+      cache.lookup_or_create(spg_t(pg_t(ps, 1)), oid);
+      if (ps == 3) {
+	expected.insert(oid);
+      }
+    }
+  }
+  spg_t pgid(pg_t(3, 1));
+  ASSERT_EQ(32, cache.get_count(pgid));
+
+  set<hobject_t> seen;
+  pair<hobject_t, ObjectContextRef> i;
+  while (cache.get_next(pgid, i.first, &i)) {
+    seen.insert(i.first);
+  }
+  ASSERT_EQ(expected, seen);
+  i.second.reset();
+
+  cache.clear(pgid);
+  ASSERT_TRUE(cache.empty(pgid));
+  ASSERT_EQ(32, cache.get_count(spg_t(pg_t(4, 1))));
+  cache.clear();
+}
+
+TEST(ObjectContextCache, trim)
+{
+  ObjectContextCache cache(g_ceph_context, 4, 1);
+  spg_t pgid(pg_t(1, 1));
+  for (unsigned i = 0; i < 10; ++i) {
+    cache.lookup_or_create(pgid, make_oid(1, i, stringify(i)));
+  }
+  ASSERT_EQ(4, cache.get_count(pgid));
+  ASSERT_EQ(6u, cache.get_evictions());
+  // evicted entries with no other reference are gone
+  ASSERT_FALSE(cache.lookup(pgid, make_oid(1, 0, "0")));
+  ASSERT_TRUE(cache.lookup(pgid, make_oid(1, 9, "9")));
+
+  cache.set_size(2);
+  ASSERT_EQ(2, cache.get_count(pgid));
+  cache.clear();
+  ASSERT_TRUE(cache.empty(pgid));
+}
@@ -0,0 +1,203 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "include/stringify.h"
+#include "osd/PeeringBatch.h"
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+typedef map<int, map<spg_t,pg_query_t>> query_map_t;
+typedef map<int, vector<pair<pg_notify_t,PastIntervals>>> notify_map_t;
+
+static const uint64_t MAX_PGS = 4;
+static const double MAX_DELAY = 0.01;
+
+static OSDMapRef make_map(epoch_t e)
+{
+  auto m = std::make_shared<OSDMap>();
+  m->set_epoch(e);
+  return m;
+}
+
+static spg_t pg(int ps)
+{
+  return spg_t(pg_t(ps, 1), shard_id_t::NO_SHARD);
+}
+
+// what each peer osd receives, in order: (pg, tag) of every notify,
+// info or query, where the tag names the event that produced it
+class PeeringBatchTest : public ::testing::Test {
+protected:
+  PeeringBatch batch;
+  map<int, vector<pair<spg_t,string>>> wire;
+  bool queue_empty = false;
+  utime_t now{100, 0};
+
+  void send(PeeringBatch& b) {
+    for (auto& [peer, notifies] : b.notify_list) {
+      for (auto& n : notifies) {
+	wire[peer].emplace_back(n.first.info.pgid, "notify" +
+				stringify(n.first.query_epoch));
+      }
+    }
+    for (auto& [peer, queries] : b.query_map) {
+      for (auto& [pgid, q] : queries) {
+	wire[peer].emplace_back(pgid, "query" + stringify(q.epoch_sent));
+      }
+    }
+    for (auto& [peer, infos] : b.info_map) {
+      for (auto& i : infos) {
+	wire[peer].emplace_back(i.first.info.pgid, "info" +
+				stringify(i.first.query_epoch));
+      }
+    }
+  }
+
+  // what OSD::queue_peering_messages does with one event of pgid that
+  // sends a notify (or an info) tagged tag to peer
+  void event(spg_t pgid, epoch_t e, int peer, int tag, bool info = false) {
+    pg_info_t pi(pgid);
+    notify_map_t notifies, infos;
+    query_map_t queries;
+    (info ? infos : notifies)[peer].emplace_back(
+      pg_notify_t(shard_id_t::NO_SHARD, shard_id_t::NO_SHARD, tag, e, pi),
+      PastIntervals());
+    PeeringBatch prev, full;
+    if (batch.must_split(pgid, e)) {
+      prev.swap(batch);
+    }
+    batch.add(pgid, make_map(e), now, queries, notifies, infos);
+    EXPECT_TRUE(notifies.empty());
+    EXPECT_TRUE(infos.empty());
+    if (batch.ready(now, queue_empty, MAX_PGS, MAX_DELAY)) {
+      full.swap(batch);
+    }
+    send(prev);
+    send(full);
+  }
+
+  // what OSD::_process does before pgid handles a queued item that
+  // sends a message directly
+  void direct(spg_t pgid, int peer, const string& what) {
+    if (batch.has(pgid)) {
+      PeeringBatch b;
+      b.swap(batch);
+      send(b);
+    }
+    wire[peer].emplace_back(pgid, what);
+  }
+
+  // what OSD::flush_peering_batch does from the top of _process
+  void tick() {
+    if (batch.ready(now, queue_empty, MAX_PGS, MAX_DELAY)) {
+      PeeringBatch b;
+      b.swap(batch);
+      send(b);
+    }
+  }
+};
+
+TEST_F(PeeringBatchTest, CombinesPGs)
+{
+  event(pg(1), 10, 1, 1);
+  event(pg(2), 10, 1, 1);
+  event(pg(3), 10, 2, 1, true);
+  EXPECT_TRUE(wire.empty());
+  EXPECT_EQ(3u, batch.pgs.size());
+  EXPECT_EQ(2u, batch.notify_list[1].size());
+  EXPECT_EQ(1u, batch.info_map[2].size());
+  EXPECT_EQ(10u, batch.osdmap->get_epoch());
+}
+
+TEST_F(PeeringBatchTest, SplitsOnEpochAndRepeatedPG)
+{
+  EXPECT_FALSE(batch.must_split(pg(1), 10));
+  event(pg(1), 10, 1, 1);
+  EXPECT_FALSE(batch.must_split(pg(2), 10));
+  EXPECT_TRUE(batch.must_split(pg(1), 10));
+  EXPECT_TRUE(batch.must_split(pg(2), 11));
+
+  // a second event of pg 1 sends the first one's messages before it
+  event(pg(1), 10, 1, 2);
+  ASSERT_EQ(1u, wire[1].size());
+  EXPECT_EQ(make_pair(pg(1), string("notify1")), wire[1][0]);
+  // and a new epoch starts a new batch
+  event(pg(2), 11, 1, 3);
+  ASSERT_EQ(2u, wire[1].size());
+  EXPECT_EQ(make_pair(pg(1), string("notify2")), wire[1][1]);
+  EXPECT_EQ(11u, batch.osdmap->get_epoch());
+}
+
+TEST_F(PeeringBatchTest, MaxPGs)
+{
+  for (unsigned i = 1; i < MAX_PGS; ++i) {
+    event(pg(i), 10, 1, 1);
+  }
+  EXPECT_TRUE(wire.empty());
+  EXPECT_FALSE(batch.ready(now, false, MAX_PGS, MAX_DELAY));
+  event(pg(MAX_PGS), 10, 1, 1);
+  EXPECT_EQ(MAX_PGS, wire[1].size());
+  EXPECT_TRUE(batch.empty());
+}
+
+TEST_F(PeeringBatchTest, MaxDelay)
+{
+  event(pg(1), 10, 1, 1);
+  tick();
+  EXPECT_TRUE(wire.empty());
+  now += MAX_DELAY / 2;
+  tick();
+  EXPECT_TRUE(wire.empty());
+  now += MAX_DELAY;
+  tick();
+  EXPECT_EQ(1u, wire[1].size());
+  EXPECT_TRUE(batch.empty());
+  EXPECT_FALSE(batch.ready(now, true, MAX_PGS, MAX_DELAY));
+}
+
+TEST_F(PeeringBatchTest, QueueDrained)
+{
+  event(pg(1), 10, 1, 1);
+  EXPECT_TRUE(wire.empty());
+  queue_empty = true;
+  tick();
+  EXPECT_EQ(1u, wire[1].size());
+  // with nothing queued behind it an event is sent right away
+  event(pg(2), 10, 1, 1);
+  EXPECT_EQ(2u, wire[1].size());
+}
+
+TEST_F(PeeringBatchTest, DirectSendKeepsPerPeerOrder)
+{
+  event(pg(1), 10, 1, 1, true);
+  event(pg(2), 10, 1, 1);
+  event(pg(2), 10, 2, 1);
+  // pg 3 has nothing batched, its direct send need not wait
+  direct(pg(3), 1, "log");
+  ASSERT_EQ(1u, wire[1].size());
+  EXPECT_FALSE(batch.empty());
+  // pg 1's direct send must not overtake its batched info
+  direct(pg(1), 1, "log");
+  vector<pair<spg_t,string>> peer1 = {
+    {pg(3), "log"},
+    {pg(2), "notify1"},
+    {pg(1), "info1"},
+    {pg(1), "log"},
+  };
+  EXPECT_EQ(peer1, wire[1]);
+  EXPECT_EQ(1u, wire[2].size());
+  EXPECT_TRUE(batch.empty());
+}
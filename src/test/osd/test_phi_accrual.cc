@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/PhiAccrual.h"
+
+static utime_t after(utime_t t, double seconds)
+{
+  t += seconds;
+  return t;
+}
+
+// ack n pings, one every interval seconds, starting at start
+static utime_t ack_every(PhiAccrual& d, utime_t start, double interval,
+			 unsigned n)
+{
+  utime_t t = start;
+  for (unsigned i = 0; i < n; ++i) {
+    d.note_ack(t);
+    t += interval;
+  }
+  t -= interval;
+  return t;
+}
+
+TEST(PhiAccrual, FirstAckStartsHistory)
+{
+  PhiAccrual d;
+  d.note_ack(utime_t(100, 0));
+  EXPECT_EQ(0u, d.intervals);
+  EXPECT_EQ(utime_t(100, 0), d.last_ack);
+  d.note_ack(utime_t(106, 0));
+  EXPECT_EQ(1u, d.intervals);
+  EXPECT_DOUBLE_EQ(6, d.mean);
+  EXPECT_DOUBLE_EQ(0, d.var);
+}
+
+TEST(PhiAccrual, NotReadyBeforeMinSamples)
+{
+  PhiAccrual d;
+  // MIN_SAMPLES acks make MIN_SAMPLES - 1 intervals
+  ack_every(d, utime_t(100, 0), 6, PhiAccrual::MIN_SAMPLES);
+  EXPECT_EQ(PhiAccrual::MIN_SAMPLES - 1, d.intervals);
+  EXPECT_FALSE(d.ready());
+  d.note_ack(after(d.last_ack, 6.0));
+  EXPECT_TRUE(d.ready());
+}
+
+TEST(PhiAccrual, GrowsWithSilence)
+{
+  PhiAccrual d;
+  utime_t last = ack_every(d, utime_t(100, 0), 6, 20);
+  ASSERT_TRUE(d.ready());
+  EXPECT_DOUBLE_EQ(6, d.mean);
+
+  // on time is no suspicion at all, a silence well past the usual
+  // interval is
+  double on_time = d.phi(after(last, 6.0));
+  double late = d.phi(after(last, 12.0));
+  double very_late = d.phi(after(last, 20.0));
+  EXPECT_LT(on_time, 1);
+  EXPECT_LT(on_time, late);
+  EXPECT_LT(late, very_late);
+  EXPECT_GT(very_late, 8);
+
+  // a peer silent for ever saturates rather than overflowing
+  EXPECT_DOUBLE_EQ(308, d.phi(after(last, 100000.0)));
+}
+
+TEST(PhiAccrual, JitterRaisesTolerance)
+{
+  PhiAccrual steady, jittery;
+  utime_t t(100, 0);
+  for (unsigned i = 0; i < 40; ++i) {
+    steady.note_ack(after(t, 6.0 * i));
+    jittery.note_ack(after(t, 6.0 * i + (i % 2 ? 2.5 : 0)));
+  }
+  ASSERT_GT(jittery.stddev(), steady.stddev());
+  utime_t now_s = after(steady.last_ack, 14.0);
+  utime_t now_j = after(jittery.last_ack, 14.0);
+  // the same silence is less suspicious for a peer known to be erratic
+  EXPECT_GT(steady.phi(now_s), jittery.phi(now_j));
+}
@@ -0,0 +1,135 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/RecoveryThrottle.h"
+
+static constexpr uint64_t ACTIVE_MAX = 8;
+static constexpr double SLEEP_MAX = 0.5;
+
+// one step with recovery using all its slots
+static int step(RecoveryThrottle& t, bool over, double base_sleep = 0)
+{
+  return t.step(over, false, t.max_active, ACTIVE_MAX, base_sleep, SLEEP_MAX);
+}
+
+TEST(RecoveryThrottle, backoff)
+{
+  RecoveryThrottle t(8, 0);
+  // halve the concurrency first
+  ASSERT_EQ(-1, step(t, true));
+  ASSERT_EQ(4u, t.max_active);
+  ASSERT_EQ(0, t.sleep);
+  ASSERT_EQ(-1, step(t, true));
+  ASSERT_EQ(-1, step(t, true));
+  ASSERT_EQ(1u, t.max_active);
+  ASSERT_EQ(0, t.sleep);
+  // then start sleeping, doubling up to the cap
+  ASSERT_EQ(-1, step(t, true));
+  ASSERT_EQ(1u, t.max_active);
+  ASSERT_DOUBLE_EQ(0.01, t.sleep);
+  ASSERT_EQ(-1, step(t, true));
+  ASSERT_DOUBLE_EQ(0.02, t.sleep);
+  for (int i = 0; i < 10; ++i) {
+    step(t, true);
+  }
+  ASSERT_DOUBLE_EQ(SLEEP_MAX, t.sleep);
+  ASSERT_EQ(0, step(t, true));
+  ASSERT_EQ(1u, t.max_active);
+}
+
+TEST(RecoveryThrottle, sleep_decay)
+{
+  RecoveryThrottle t(1, 0.4);
+  // the sleep shrinks by a quarter per step before any concurrency is
+  // added back
+  ASSERT_EQ(1, step(t, false, 0.1));
+  ASSERT_DOUBLE_EQ(0.3, t.sleep);
+  ASSERT_EQ(1u, t.max_active);
+  ASSERT_EQ(1, step(t, false, 0.1));
+  ASSERT_DOUBLE_EQ(0.225, t.sleep);
+  int steps = 0;
+  while (t.sleep > 0.1 && steps < 100) {
+    ASSERT_EQ(1, step(t, false, 0.1));
+    ASSERT_EQ(1u, t.max_active);
+    ++steps;
+  }
+  // and snaps to the configured sleep rather than creeping up on it
+  ASSERT_LT(steps, 100);
+  ASSERT_EQ(0.1, t.sleep);
+  ASSERT_EQ(1, step(t, false, 0.1));
+  ASSERT_EQ(2u, t.max_active);
+  ASSERT_EQ(0.1, t.sleep);
+}
+
+TEST(RecoveryThrottle, growth)
+{
+  RecoveryThrottle t(1, 0);
+  // one more slot per step while recovery uses all it has
+  for (uint64_t i = 2; i <= ACTIVE_MAX; ++i) {
+    ASSERT_EQ(1, step(t, false));
+    ASSERT_EQ(i, t.max_active);
+  }
+  ASSERT_EQ(0, step(t, false));
+  ASSERT_EQ(ACTIVE_MAX, t.max_active);
+
+  // but not while slots are left unused
+  RecoveryThrottle u(2, 0);
+  ASSERT_EQ(0, u.step(false, false, 1, ACTIVE_MAX, 0, SLEEP_MAX));
+  ASSERT_EQ(2u, u.max_active);
+  // unless pgs are waiting for them
+  ASSERT_EQ(1, u.step(false, true, 1, ACTIVE_MAX, 0, SLEEP_MAX));
+  ASSERT_EQ(3u, u.max_active);
+}
+
+TEST(RecoveryThrottle, bounds)
+{
+  // lowered bounds apply before the step
+  RecoveryThrottle t(16, 2.0);
+  ASSERT_EQ(1, t.step(false, false, 0, ACTIVE_MAX, 0.5, 1.0));
+  ASSERT_EQ(ACTIVE_MAX, t.max_active);
+  ASSERT_DOUBLE_EQ(0.75, t.sleep);
+
+  // max_active never drops below 1 nor the sleep below the configured
+  RecoveryThrottle u(0, 0);
+  ASSERT_EQ(0, u.step(false, false, 0, ACTIVE_MAX, 0.1, SLEEP_MAX));
+  ASSERT_EQ(1u, u.max_active);
+  ASSERT_EQ(0.1, u.sleep);
+
+  // a zero active_max still allows one op, and a sleep_max below the
+  // configured sleep is ignored
+  RecoveryThrottle v(4, 0);
+  ASSERT_EQ(0, v.step(true, false, 4, 0, 0.2, 0.1));
+  ASSERT_EQ(1u, v.max_active);
+  ASSERT_EQ(0.2, v.sleep);
+  ASSERT_EQ(0, v.step(true, false, 1, 0, 0.2, 0.1));
+  ASSERT_EQ(0.2, v.sleep);
+}
+
+TEST(RecoveryThrottle, step_sleep)
+{
+  // from no sleep at all the backoff starts at 10ms, then doubles up to
+  // the cap
+  ASSERT_DOUBLE_EQ(0.01, RecoveryThrottle::step_sleep(true, 0, 0, 1.0));
+  ASSERT_DOUBLE_EQ(0.4, RecoveryThrottle::step_sleep(true, 0.2, 0, 1.0));
+  ASSERT_DOUBLE_EQ(1.0, RecoveryThrottle::step_sleep(true, 0.8, 0, 1.0));
+
+  // it shrinks by a quarter and snaps to the configured sleep once close
+  ASSERT_DOUBLE_EQ(0.75, RecoveryThrottle::step_sleep(false, 1.0, 0, 1.0));
+  ASSERT_EQ(0.1, RecoveryThrottle::step_sleep(false, 0.1005, 0.1, 1.0));
+  ASSERT_EQ(0.1, RecoveryThrottle::step_sleep(false, 0.1, 0.1, 1.0));
+
+  // the bounds apply to the sleep passed in as well
+  ASSERT_EQ(0.5, RecoveryThrottle::step_sleep(false, 0, 0.5, 1.0));
+  ASSERT_DOUBLE_EQ(0.75, RecoveryThrottle::step_sleep(false, 2.0, 0, 1.0));
+  ASSERT_EQ(0.2, RecoveryThrottle::step_sleep(true, 0.2, 0.2, 0.1));
+}
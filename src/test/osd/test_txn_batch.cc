@@ -0,0 +1,134 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "global/global_context.h"
+#include "messages/MOSDOp.h"
+#include "osd/TxnBatch.h"
+
+class TxnBatchTest : public ::testing::Test {
+protected:
+  OpTracker tracker{g_ceph_context, false, 1};
+  spg_t pgid{pg_t(0x1234, 1), shard_id_t::NO_SHARD};
+  coll_t coll{pgid};
+  vector<int> committed;
+
+  static hobject_t obj(const char *name, snapid_t snap = CEPH_NOSNAP) {
+    return hobject_t(object_t(name), "", snap, 0x1234, 1, "");
+  }
+
+  OpRequestRef make_write(const char *name, uint64_t tid) {
+    auto m = MOSDOp::create(1, tid, obj(name), pgid, 10,
+			    CEPH_OSD_FLAG_WRITE,
+			    CEPH_FEATURES_SUPPORTED_DEFAULT);
+    bufferlist bl;
+    bl.append("data");
+    m->write(0, bl.length(), bl);
+    return tracker.create_request<OpRequest, Message*>(m.detach());
+  }
+
+  // what an op submits: a write of name that records its commit
+  vector<ObjectStore::Transaction> make_txns(const char *name, int id) {
+    vector<ObjectStore::Transaction> tls(1);
+    tls[0].touch(coll, ghobject_t(obj(name)));
+    tls[0].register_on_commit(new FunctionContext([this, id](int) {
+      committed.push_back(id);
+    }));
+    return tls;
+  }
+
+  // what the store does on commit of a queue_transactions() call
+  static void commit(vector<ObjectStore::Transaction>& tls) {
+    list<Context*> on_applied, on_commit, on_applied_sync;
+    ObjectStore::Transaction::collect_contexts(
+      tls, &on_applied, &on_commit, &on_applied_sync);
+    finish_contexts(g_ceph_context, on_commit, 0);
+  }
+};
+
+TEST_F(TxnBatchTest, ClosedOrInternalNotHeld)
+{
+  TxnBatch b;
+  auto tls = make_txns("foo", 0);
+  EXPECT_FALSE(b.add(tls, make_write("foo", 1)));
+  EXPECT_EQ(1u, tls.size());
+  EXPECT_TRUE(b.empty());
+  commit(tls);
+
+  // internal writes (no op) are submitted on their own, after the
+  // pg submitted what the batch holds
+  b.begin();
+  auto held = make_txns("foo", 1);
+  ASSERT_TRUE(b.add(held, make_write("foo", 1)));
+  auto internal = make_txns("bar", 2);
+  EXPECT_FALSE(b.add(internal, OpRequestRef()));
+  EXPECT_EQ(1u, internal.size());
+  EXPECT_EQ(1u, b.get_ops());
+
+  vector<ObjectStore::Transaction> batch;
+  b.take(&batch);
+  commit(batch);
+  commit(internal);
+  EXPECT_EQ(vector<int>({0, 1, 2}), committed);
+  b.end();
+}
+
+TEST_F(TxnBatchTest, KeepsOpOrder)
+{
+  TxnBatch b;
+  b.begin();
+  vector<OpRequestRef> ops;
+  for (int i = 0; i < 4; ++i) {
+    ops.push_back(make_write(i % 2 ? "foo" : "bar", i + 1));
+    auto tls = make_txns(i % 2 ? "foo" : "bar", i);
+    ASSERT_TRUE(b.add(tls, ops.back()));
+    EXPECT_TRUE(tls.empty());
+  }
+  EXPECT_EQ(4u, b.get_ops());
+
+  vector<ObjectStore::Transaction> tls;
+  OpRequestRef op = b.take(&tls);
+  EXPECT_EQ(ops[0], op);
+  EXPECT_EQ(4u, tls.size());
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(0u, b.get_ops());
+  EXPECT_TRUE(b.is_open());
+
+  // each op keeps its own commit callback, in op order
+  commit(tls);
+  EXPECT_EQ(vector<int>({0, 1, 2, 3}), committed);
+  b.end();
+}
+
+TEST_F(TxnBatchTest, Conflicts)
+{
+  TxnBatch b;
+  vector<OSDOp> plain(1);
+  EXPECT_FALSE(b.conflicts(obj("foo"), plain));
+
+  b.begin();
+  auto tls = make_txns("foo", 1);
+  ASSERT_TRUE(b.add(tls, make_write("foo", 1)));
+  EXPECT_TRUE(b.conflicts(obj("foo"), plain));
+  EXPECT_FALSE(b.conflicts(obj("bar"), plain));
+
+  // an op naming a source object, e.g. copy-from or clone-range
+  vector<OSDOp> with_src(2);
+  with_src[1].soid = sobject_t(object_t("baz"), CEPH_NOSNAP);
+  EXPECT_TRUE(b.conflicts(obj("bar"), with_src));
+
+  // taking the batch clears what it has written
+  vector<ObjectStore::Transaction> held;
+  b.take(&held);
+  EXPECT_FALSE(b.conflicts(obj("foo"), plain));
+  b.end();
+}
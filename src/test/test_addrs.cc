@@ -265,3 +265,25 @@ TEST(entity_addrvec_t, parse)
     }
   }
 }
+
+TEST(entity_addr_t, is_same_host)
+{
+  // two daemons on one host: same ip, different port and nonce
+  for (auto [l, r] : { make_pair("1.2.3.4:6800/1234", "1.2.3.4:6804/5678"),
+		       make_pair("[2607:f298:4:2243::5522]:6800/1234",
+				 "[2607:f298:4:2243::5522]:6804/5678") }) {
+    entity_addr_t a, b;
+    ASSERT_TRUE(a.parse(l));
+    ASSERT_TRUE(b.parse(r));
+    ASSERT_FALSE(a == b);
+    ASSERT_TRUE(a.is_same_host(b));
+    ASSERT_TRUE(b.is_same_host(a));
+  }
+
+  entity_addr_t a, b, c;
+  ASSERT_TRUE(a.parse("1.2.3.4:6800/1234"));
+  ASSERT_TRUE(b.parse("1.2.3.5:6800/1234"));
+  ASSERT_TRUE(c.parse("[2607:f298:4:2243::5522]:6800/1234"));
+  ASSERT_FALSE(a.is_same_host(b));
+  ASSERT_FALSE(a.is_same_host(c));
+}
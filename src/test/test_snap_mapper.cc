@@ -578,6 +578,14 @@ public:
     ceph_assert(r == 0);
     ASSERT_EQ(snaps, obj->second);
   }
+
+  /// drop the in-memory index and rebuild it from the store
+  void reload() {
+    Mutex::Locker l(lock);
+    driver->flush();
+    mapper.reset(
+      new SnapMapper(g_ceph_context, driver, mask, bits, 0, shard_id_t(1)));
+  }
 };
 
 class SnapMapperTest : public ::testing::Test {
@@ -620,7 +628,7 @@ protected:
     for (int i = 0; i < 5000; ++i) {
       if (!(i % 50))
 	std::cout << i << std::endl;
-      switch (rand() % 5) {
+      switch (rand() % 6) {
       case 0:
 	get_tester().create_snap();
 	break;
@@ -636,6 +644,9 @@ protected:
       case 4:
 	get_tester().remove_oid();
 	break;
+      case 5:
+	get_tester().reload();
+	break;
       }
     }
   }
@@ -657,3 +668,19 @@ TEST_F(SnapMapperTest, MultiPG) {
   init(50);
   run();
 }
+
+TEST_F(SnapMapperTest, SmallIndex) {
+  // the pg outgrows the index early on, which drops it; each reload()
+  // then rebuilds it or declines it again depending on the object count
+  g_ceph_context->_conf.set_val("osd_snap_mapper_index_max_objects", "10");
+  init(1);
+  run();
+  g_ceph_context->_conf.rm_val("osd_snap_mapper_index_max_objects");
+}
+
+TEST_F(SnapMapperTest, NoIndex) {
+  g_ceph_context->_conf.set_val("osd_snap_mapper_index_max_objects", "0");
+  init(4);
+  run();
+  g_ceph_context->_conf.rm_val("osd_snap_mapper_index_max_objects");
+}
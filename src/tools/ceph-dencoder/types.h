@@ -125,6 +125,7 @@ TYPE(ECSubReadReply)
 TYPE_NONDETERMINISTIC(ExplicitHashHitSet)
 TYPE_NONDETERMINISTIC(ExplicitObjectHitSet)
 TYPE(BloomHitSet)
+TYPE(CountingHitSet)
 TYPE_NONDETERMINISTIC(HitSet)   // because some subclasses are
 TYPE(HitSet::Params)
 
@@ -773,6 +774,8 @@ MESSAGE(MOSDMap)
 
 #include "messages/MOSDOp.h"
 MESSAGE(MOSDOp)
+#include "messages/MOSDOpBatch.h"
+MESSAGE(MOSDOpBatch)
 
 #include "messages/MOSDOpReply.h"
 MESSAGE(MOSDOpReply)
@@ -869,3 +872,5 @@ MESSAGE(MTimeCheck2)
 
 #include "messages/MWatchNotify.h"
 MESSAGE(MWatchNotify)
+#include "messages/MWatchNotifyBatch.h"
+MESSAGE(MWatchNotifyBatch)